@@ -401,6 +401,12 @@ function updateConfig(data, options) {
       _('rcvr-uart-baud').value = '19200';
       _('sbus-config').style.display = 'none';
     }
+    else if (proto === 8 || proto === 9) { // IBUS or FPort
+      _('rcvr-uart-baud').disabled = true;
+      _('rcvr-uart-baud').value = '115200';
+      _('sbus-config').style.display = 'block';
+      _('sbus-failsafe').value = data['sbus-failsafe'];
+    }
   }
 
   _('serial1-protocol').onchange = () => {
@@ -1,11 +1,17 @@
 #pragma once
 
-#include <functional>
+#include "DeferredQueue.h"
 
-void deferExecutionMicros(unsigned long us, std::function<void()> f);
+void deferExecutionMicros(unsigned long us, deferredFunction_t f, void *context);
+void deferExecutionMicros(unsigned long us, void (*f)());
 void executeDeferredFunction(unsigned long now);
 
-static inline void deferExecutionMillis(unsigned long ms, std::function<void()> f)
+static inline void deferExecutionMillis(unsigned long ms, deferredFunction_t f, void *context)
+{
+    deferExecutionMicros(ms * 1000, f, context);
+}
+
+static inline void deferExecutionMillis(unsigned long ms, void (*f)())
 {
     deferExecutionMicros(ms * 1000, f);
-}
\ No newline at end of file
+}
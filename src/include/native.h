@@ -73,6 +73,20 @@ public:
 static HardwareSerial Serial;
 static Stream *SerialLogger = &Serial;
 
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 1
+#define FALLING 2
+#define GPIO_PIN_NSS 0
+inline void pinMode(int8_t pin, uint8_t mode) {}
+inline void digitalWrite(int8_t pin, uint8_t val) {}
+inline int digitalRead(int8_t pin) { return LOW; }
+inline int8_t digitalPinToInterrupt(int8_t pin) { return pin; }
+inline void attachInterrupt(int8_t pin, void (*isr)(), int mode) {}
+inline void detachInterrupt(int8_t pin) {}
+
 inline void interrupts() {}
 inline void noInterrupts() {}
 
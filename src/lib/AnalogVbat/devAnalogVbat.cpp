@@ -118,6 +118,7 @@ device_t AnalogVbat_device = {
     .start = start,
     .event = nullptr,
     .timeout = timeout,
+    .name = "Vbat",
 };
 
 #endif /* if USE_ANALOG_VCC */
\ No newline at end of file
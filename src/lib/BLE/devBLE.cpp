@@ -98,7 +98,8 @@ device_t BLE_device = {
   .initialize = initialize,
   .start = NULL,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .name = "BLE",
 };
 
 #endif
\ No newline at end of file
@@ -124,7 +124,8 @@ device_t Button_device = {
     .initialize = nullptr,
     .start = start,
     .event = nullptr,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "Button",
 };
 
 #endif
@@ -370,5 +370,6 @@ device_t Backpack_device = {
     .initialize = initialize,
     .start = start,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "Backpack",
 };
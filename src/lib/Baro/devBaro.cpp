@@ -193,6 +193,7 @@ device_t Baro_device = {
     .start = start,
     .event = nullptr,
     .timeout = timeout,
+    .name = "Baro",
 };
 
 #endif
\ No newline at end of file
@@ -1225,6 +1225,15 @@ void RxConfig::SetFailsafeMode(eFailsafeMode failsafeMode)
     }
 }
 
+void RxConfig::SetSerialTimedOutput(bool timedOutput)
+{
+    if (m_config.serialTimedOutput != timedOutput)
+    {
+        m_config.serialTimedOutput = timedOutput;
+        m_modified = true;
+    }
+}
+
 void RxConfig::SetBindStorage(rx_config_bindstorage_t value)
 {
     if (m_config.bindStorage != value)
@@ -9,10 +9,49 @@ CROSSFIRE2MSP::CROSSFIRE2MSP()
 
 void CROSSFIRE2MSP::reset()
 {
-    pktLen = 0;
-    idx = 0;
+    for (auto &slot : slots)
+    {
+        slot.pktLen = 0;
+        slot.idx = 0;
+        slot.active = false;
+        slot.lastUsed = 0;
+        slot.seqNumberPrev = 0;
+        slot.src = 0;
+        slot.dest = 0;
+        slot.MSPvers = MSP_FRAME_UNKNOWN;
+    }
+    lastSlot = &slots[0];
     frameComplete = false;
-    MSPvers = MSP_FRAME_UNKNOWN;
+    useCounter = 0;
+}
+
+CROSSFIRE2MSP::slot_t *CROSSFIRE2MSP::findSlot(uint8_t src, uint8_t dest, bool allocate)
+{
+    slot_t *lru = &slots[0];
+    for (auto &slot : slots)
+    {
+        if (slot.src == src && slot.dest == dest && (slot.active || allocate))
+        {
+            return &slot;
+        }
+        if (!slot.active && lru->active)
+        {
+            lru = &slot;
+        }
+        else if (slot.active == lru->active && slot.lastUsed < lru->lastUsed)
+        {
+            lru = &slot;
+        }
+    }
+    if (!allocate)
+    {
+        return nullptr;
+    }
+    // Reuse a free slot, or drop the stream that has been idle the longest
+    lru->src = src;
+    lru->dest = dest;
+    lru->active = false;
+    return lru;
 }
 
 void CROSSFIRE2MSP::parse(const uint8_t *data)
@@ -20,51 +59,65 @@ void CROSSFIRE2MSP::parse(const uint8_t *data)
     uint8_t CRSFpayloadLen = data[CRSF_FRAME_PAYLOAD_LEN_IDX] - CRSF_EXT_FRAME_PAYLOAD_LEN_SIZE_OFFSET;
     bool error = isError(data);
     bool newFrame = isNewFrame(data);
-
-    bool seqError;
     uint8_t seqNumber = getSeqNumber(data);
-    uint8_t SeqNumberNext;
 
-    SeqNumberNext = (seqNumberPrev + 1) & 0b1111;
-    SeqNumberNext == seqNumber ? seqError = false : seqError = true;
-    seqNumberPrev = seqNumber;
+    slot_t *slot = findSlot(data[CRSF_MSP_SRC_OFFSET], data[CRSF_MSP_DEST_OFFSET], newFrame);
+    if (slot == nullptr)
+    {
+        // continuation chunk for a stream we are not reassembling
+        return;
+    }
+
+    bool seqError = ((slot->seqNumberPrev + 1) & 0b1111) != seqNumber;
+    slot->seqNumberPrev = seqNumber;
+    slot->lastUsed = ++useCounter;
 
     if ((!newFrame && seqError) || error)
     {
-        reset();
+        slot->active = false;
+        slot->idx = 0;
+        slot->pktLen = 0;
         return;
     }
 
+    uint8_t *outBuffer = slot->outBuffer;
     if (newFrame) // If it's a new frame then out a header on first
     {
-        idx = 3; // skip the header start wiring at offset 3.
-        MSPvers = getVersion(data);
-        src = data[CRSF_MSP_SRC_OFFSET];
-        dest = data[CRSF_MSP_DEST_OFFSET];
+        slot->idx = 3; // skip the header start wiring at offset 3.
+        slot->MSPvers = getVersion(data);
         outBuffer[0] = '$';
-        outBuffer[1] = (MSPvers == MSP_FRAME_V1 || MSPvers == MSP_FRAME_V1_JUMBO) ? 'M' : 'X';
+        outBuffer[1] = (slot->MSPvers == MSP_FRAME_V1 || slot->MSPvers == MSP_FRAME_V1_JUMBO) ? 'M' : 'X';
         outBuffer[2] = error ? '!' : getHeaderDir(data);
-        pktLen = getFrameLen(data, MSPvers);
+        slot->pktLen = getFrameLen(data, slot->MSPvers);
+        slot->active = true;
+        if (slot->pktLen + 4 > MSP_FRAME_MAX_LEN)
+        {
+            // too large to reassemble
+            slot->active = false;
+            return;
+        }
     }
 
     // process the chunk of MSP frame
     // if the last CRSF frame is zero padded we can't use the CRSF payload length
     // but if this isn't the last chunk we can't use the MSP payload length
     // the solution is to use the minimum of the two lengths
-    uint32_t frameLen = pktLen - (idx - 3);
+    uint32_t frameLen = slot->pktLen - (slot->idx - 3);
     uint32_t minLen = frameLen < CRSFpayloadLen ? frameLen : CRSFpayloadLen;
-    memcpy(&outBuffer[idx], &data[CRSF_MSP_FRAME_OFFSET], minLen); // chunk of MSP data
-    idx += minLen;
+    memcpy(&outBuffer[slot->idx], &data[CRSF_MSP_FRAME_OFFSET], minLen); // chunk of MSP data
+    slot->idx += minLen;
 
-    if (idx - 3 == pktLen) // we have a complete MSP frame, -3 because the header isn't counted
+    if (slot->idx - 3 == slot->pktLen) // we have a complete MSP frame, -3 because the header isn't counted
     {
         // we need to append the MSP checksum
-        outBuffer[idx] = getChecksum(outBuffer + 3, pktLen, MSPvers); // +3 because the header isn't in checksum
+        outBuffer[slot->idx] = getChecksum(outBuffer + 3, slot->pktLen, slot->MSPvers); // +3 because the header isn't in checksum
         frameComplete = true;
+        lastSlot = slot;
+        slot->active = false;
 
         FIFOout.lock();
-        FIFOout.pushSize(idx + 1);
-        FIFOout.pushBytes(outBuffer, idx + 1);
+        FIFOout.pushSize(slot->idx + 1);
+        FIFOout.pushBytes(outBuffer, slot->idx + 1);
         FIFOout.unlock();
     }
 }
@@ -190,20 +243,20 @@ bool CROSSFIRE2MSP::isFrameReady()
 
 const uint8_t *CROSSFIRE2MSP::getFrame()
 {
-    return outBuffer;
+    return lastSlot->outBuffer;
 }
 
 uint32_t CROSSFIRE2MSP::getFrameLen()
 {
-    return idx + 1; // include the last byte (crc)
+    return lastSlot->idx + 1; // include the last byte (crc)
 }
 
 uint8_t CROSSFIRE2MSP::getSrc()
 {
-    return src;
+    return lastSlot->src;
 }
 
 uint8_t CROSSFIRE2MSP::getDest()
 {
-    return dest;
+    return lastSlot->dest;
 }
\ No newline at end of file
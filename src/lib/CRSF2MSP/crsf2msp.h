@@ -8,19 +8,31 @@
 
 /*  Takes a CRSF(MSP) frame and converts it to raw MSP frame
     adding the MSP header and checksum. Handles chunked MSP messages.
+    Chunks from up to CRSF_MSP_STREAMS different src/dest pairs can be
+    interleaved, each stream is reassembled in its own slot.
 */
 
 class CROSSFIRE2MSP
 {
 private:
-    uint8_t outBuffer[MSP_FRAME_MAX_LEN];
-    uint32_t pktLen; // packet length of the incomming msp frame
-    uint32_t idx;    // number of bytes received in the current msp frame
-    uint8_t seqNumberPrev;
+    typedef struct {
+        uint8_t outBuffer[MSP_FRAME_MAX_LEN];
+        uint32_t pktLen;        // packet length of the incomming msp frame
+        uint32_t idx;           // number of bytes received in the current msp frame
+        uint8_t seqNumberPrev;
+        bool active;            // a frame is being reassembled in this slot
+        uint8_t src;            // source of the msp frame (from CRSF ext header)
+        uint8_t dest;           // destination of the msp frame (from CRSF ext header)
+        uint32_t lastUsed;      // for choosing the least recently used slot
+        MSPframeType_e MSPvers; // need to store the MSP version since it can only be inferred from the first frame
+    } slot_t;
+
+    slot_t slots[CRSF_MSP_STREAMS];
+    slot_t *lastSlot;           // slot holding the last complete frame
     bool frameComplete;
-    uint8_t src;            // source of the msp frame (from CRSF ext header)
-    uint8_t dest;           // destination of the msp frame (from CRSF ext header)
-    MSPframeType_e MSPvers; // need to store the MSP version since it can only be inferred from the first frame
+    uint32_t useCounter;
+
+    slot_t *findSlot(uint8_t src, uint8_t dest, bool allocate);
 
     bool isNewFrame(const uint8_t *data);
     bool isError(const uint8_t *data);
@@ -33,7 +45,8 @@ private:
 
 public:
     CROSSFIRE2MSP();
-    FIFO<MSP_FRAME_MAX_LEN> FIFOout;
+    // Holds one MSP_FRAME_MAX_LEN frame with its 16-bit size prefix
+    FIFO<MSP_FRAME_MAX_LEN + 2> FIFOout;
     void parse(const uint8_t *data); // accept crsf frame input
     bool isFrameReady();
     const uint8_t *getFrame();
@@ -11,10 +11,21 @@
 #define CRSF_MSP_TYPE_IDX 2                                                 // MSP type index in CRSF packet
 #define MSP_FRAME_MAX_LEN 512                                               // Max MSP frame length (increase as needed)
 #define CRSF_MSP_OUT_BUFFER_DEPTH (MSP_FRAME_MAX_LEN / CRSF_MAX_PACKET_LEN) // Max number of CRSF frames to buffer
+#if defined(PLATFORM_ESP32) || defined(UNIT_TEST)
+#define CRSF_MSP_STREAMS 4                                                  // Number of src/dest MSP streams reassembled concurrently
+#else
+#define CRSF_MSP_STREAMS 1                                                  // Each stream is MSP_FRAME_MAX_LEN of RAM
+#endif
 
 #define CRSF_MSP_LEN_TO_ENCAP_FRAME_OFFSET (CRSF_MAX_PACKET_LEN - CRSF_MSP_MAX_BYTES_PER_CHUNK) // equals 7
 // <sync><crsf_len><crsf_cmd><dst><source><header><msp_len><msp_cmd>
 
+// Largest MSP payload that still reassembles into MSP_FRAME_MAX_LEN, sized for the MSP v2 header (8) plus checksum
+#define MSP_PAYLOAD_MAX_LEN (MSP_FRAME_MAX_LEN - 9)
+// Bytes msp2crsf pushes to its FIFO for an MSP frame of frameLen, excluding the $M< header and the MSP
+// checksum which are not sent: every chunk, including a trailing empty one, carries a 7 byte header and a CRC
+#define CRSF_MSP_FRAGMENTED_LEN(frameLen) ((frameLen) + ((frameLen) / CRSF_MSP_MAX_BYTES_PER_CHUNK + 1) * (CRSF_MSP_LEN_TO_ENCAP_FRAME_OFFSET + 1))
+
 #define MSP_V1_FRAME_LEN_FROM_PAYLOAD_LEN(payload_len) ((payload_len) + 2)       // doesn't include $M< header
 #define MSP_V1_JUMBO_FRAME_LEN_FROM_PAYLOAD_LEN(payload_len) ((payload_len) + 4) // extra 2 bytes for jumbo frame
 #define MSP_V2_FRAME_LEN_FROM_PAYLOAD_LEN(payload_len) ((payload_len) + 5)       // doesn't include $X< header
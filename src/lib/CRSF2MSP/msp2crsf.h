@@ -28,7 +28,8 @@ private:
 
 public:
     MSP2CROSSFIRE();
-    FIFO<MSP_FRAME_MAX_LEN> FIFOout;
+    // Holds one MSP_FRAME_MAX_LEN frame after fragmentation
+    FIFO<CRSF_MSP_FRAGMENTED_LEN(MSP_FRAME_MAX_LEN)> FIFOout;
     void parse(const uint8_t *data, uint32_t frameLen, uint8_t src = CRSF_ADDRESS_CRSF_RECEIVER, uint8_t dest = CRSF_ADDRESS_FLIGHT_CONTROLLER);
     bool validate(const uint8_t *data, uint32_t expectLen);
 };
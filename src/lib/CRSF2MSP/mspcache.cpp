@@ -0,0 +1,275 @@
+#include "mspcache.h"
+#include "msptypes.h"
+
+#include <cstring>
+
+MSPResponseCache::MSPResponseCache(uint32_t ttlMs) : ttlMs(ttlMs), useCounter(0), hits(0), misses(0)
+{
+    memset(entries, 0, sizeof(entries));
+    invalidate();
+}
+
+void MSPResponseCache::invalidate()
+{
+    for (auto &entry : entries)
+    {
+        entry.valid = false;
+        entry.lastUsed = 0;
+    }
+    pending = nullptr;
+    replay = nullptr;
+    replaying = false;
+}
+
+bool MSPResponseCache::isIdempotent(uint16_t function)
+{
+    // MSPv2 shares the v1 function ids below 256
+    switch (function)
+    {
+    case MSP_API_VERSION:
+    case MSP_FC_VARIANT:
+    case MSP_FC_VERSION:
+    case MSP_BOARD_INFO:
+    case MSP_BUILD_INFO:
+    case MSP_NAME:
+    case MSP_FEATURE_CONFIG:
+    case MSP_VTX_CONFIG:
+    case MSP_VTXTABLE_BAND:
+    case MSP_VTXTABLE_POWERLEVEL:
+    case MSP_UID:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool MSPResponseCache::isStateChanging(const uint8_t *frame)
+{
+    if (frame[CRSF_MSP_TYPE_IDX] == CRSF_FRAMETYPE_MSP_WRITE)
+        return true;
+
+    // Only the first chunk of a request has the MSP header, the rest go with it
+    const uint8_t status = frame[CRSF_MSP_STATUS_BYTE_OFFSET];
+    if (frame[CRSF_MSP_TYPE_IDX] != CRSF_FRAMETYPE_MSP_REQ || (status & 0b10000) == 0)
+        return false;
+
+    const uint8_t *msp = &frame[CRSF_MSP_FRAME_OFFSET];
+    const uint8_t version = (status >> 5) & 0b11;
+    uint16_t function;
+    bool hasPayload;
+    if (version == MSP_FRAME_V1)
+    {
+        function = msp[1];
+        hasPayload = msp[0] != 0;
+    }
+    else if (version == MSP_FRAME_V2)
+    {
+        function = msp[1] | (msp[2] << 8);
+        hasPayload = (msp[3] | msp[4]) != 0;
+    }
+    else
+    {
+        return true;
+    }
+
+    switch (function)
+    {
+    case MSP_SET_NAME:
+    case MSP_SET_FEATURE_CONFIG:
+    case MSP_SET_RX_CONFIG:
+    case MSP_REBOOT:
+    case MSP_SET_VTX_CONFIG:
+        return true;
+    default:
+        break;
+    }
+    // The v1 functions from 200 are all MSP_SET_* or commands, e.g. MSP_EEPROM_WRITE
+    if (function >= 200 && function < 256)
+        return true;
+    // MSPv2 functions have no such split, one with a payload is taken as a write
+    return function >= 256 && hasPayload;
+}
+
+bool MSPResponseCache::parseRequest(const uint8_t *frame, entry_t *key)
+{
+    const uint8_t status = frame[CRSF_MSP_STATUS_BYTE_OFFSET];
+    const uint8_t *msp = &frame[CRSF_MSP_FRAME_OFFSET];
+    const uint8_t chunkLen = frame[CRSF_FRAME_PAYLOAD_LEN_IDX] - CRSF_EXT_FRAME_PAYLOAD_LEN_SIZE_OFFSET;
+    uint16_t reqLen;
+    uint8_t headerLen;
+
+    // Must be the single chunk start of a request
+    if (frame[CRSF_MSP_TYPE_IDX] != CRSF_FRAMETYPE_MSP_REQ || (status & 0b10010000) != 0b00010000)
+        return false;
+
+    key->version = (status >> 5) & 0b11;
+    if (key->version == MSP_FRAME_V1)
+    {
+        reqLen = msp[0];
+        key->function = msp[1];
+        headerLen = 2;
+    }
+    else if (key->version == MSP_FRAME_V2)
+    {
+        key->function = msp[1] | (msp[2] << 8);
+        reqLen = msp[3] | (msp[4] << 8);
+        headerLen = 5;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (reqLen > MSP_CACHE_MAX_REQUEST_LEN || headerLen + reqLen > chunkLen)
+        return false;
+
+    key->orig = frame[CRSF_MSP_SRC_OFFSET];
+    key->reqLen = reqLen;
+    memcpy(key->req, &msp[headerLen], reqLen);
+    return true;
+}
+
+MSPResponseCache::entry_t *MSPResponseCache::find(const entry_t *key)
+{
+    for (auto &entry : entries)
+    {
+        if (entry.orig == key->orig && entry.version == key->version && entry.function == key->function &&
+            entry.reqLen == key->reqLen && memcmp(entry.req, key->req, key->reqLen) == 0)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+MSPResponseCache::entry_t *MSPResponseCache::allocate()
+{
+    entry_t *lru = &entries[0];
+    for (auto &entry : entries)
+    {
+        if (!entry.valid)
+            return &entry;
+        if (entry.lastUsed < lru->lastUsed)
+            lru = &entry;
+    }
+    return lru;
+}
+
+bool MSPResponseCache::handleRequest(const uint8_t *frame, uint32_t now)
+{
+    if (isStateChanging(frame))
+    {
+        invalidate();
+        return false;
+    }
+
+    entry_t key;
+    if (!parseRequest(frame, &key) || !isIdempotent(key.function))
+        return false;
+
+    entry_t *entry = find(&key);
+    if (entry && entry->valid && (now - entry->storedMs) < ttlMs)
+    {
+        ++hits;
+        entry->lastUsed = ++useCounter;
+        replay = entry;
+        replayIdx = 0;
+        return true;
+    }
+
+    // Forward to the FC and capture the response
+    ++misses;
+    if (entry == nullptr)
+        entry = allocate();
+    if (entry == replay)
+        replay = nullptr;
+    entry->valid = false;
+    entry->orig = key.orig;
+    entry->version = key.version;
+    entry->function = key.function;
+    entry->reqLen = key.reqLen;
+    memcpy(entry->req, key.req, key.reqLen);
+    entry->chunkCount = 0;
+    entry->lastUsed = ++useCounter;
+    pending = entry;
+    pendingReceived = 0;
+    pendingLen = 0;
+    return false;
+}
+
+void MSPResponseCache::handleResponse(const uint8_t *frame, uint32_t now)
+{
+    // Our own replayed chunks come back through the telemetry path
+    if (replaying)
+        return;
+    if (pending == nullptr || frame[CRSF_MSP_TYPE_IDX] != CRSF_FRAMETYPE_MSP_RESP || frame[CRSF_MSP_DEST_OFFSET] != pending->orig)
+        return;
+
+    const uint8_t status = frame[CRSF_MSP_STATUS_BYTE_OFFSET];
+    const uint8_t *msp = &frame[CRSF_MSP_FRAME_OFFSET];
+    const uint8_t chunkLen = frame[CRSF_FRAME_PAYLOAD_LEN_IDX] - CRSF_EXT_FRAME_PAYLOAD_LEN_SIZE_OFFSET;
+    const uint8_t seq = status & 0b1111;
+    const bool newFrame = status & 0b10000;
+    const bool error = status & 0b10000000;
+
+    if (newFrame)
+    {
+        uint16_t function;
+        if (pending->version == MSP_FRAME_V1 && msp[0] != 0xFF)
+        {
+            function = msp[1];
+            pendingLen = MSP_V1_FRAME_LEN_FROM_PAYLOAD_LEN(msp[0]);
+        }
+        else if (pending->version == MSP_FRAME_V2)
+        {
+            function = msp[1] | (msp[2] << 8);
+            pendingLen = MSP_V2_FRAME_LEN_FROM_PAYLOAD_LEN(msp[3] | (msp[4] << 8));
+        }
+        else
+        {
+            // v1 jumbo responses are too big to cache anyway
+            pending = nullptr;
+            return;
+        }
+        if (error || function != pending->function)
+        {
+            pending = nullptr;
+            return;
+        }
+        pending->chunkCount = 0;
+        pendingReceived = 0;
+    }
+    else if (pending->chunkCount == 0 || seq != ((pendingSeq + 1) & 0b1111) || error)
+    {
+        pending = nullptr;
+        return;
+    }
+
+    if (pending->chunkCount >= MSP_CACHE_MAX_CHUNKS)
+    {
+        pending = nullptr;
+        return;
+    }
+
+    memcpy(pending->chunks[pending->chunkCount++], frame, CRSF_FRAME_SIZE(frame[CRSF_FRAME_PAYLOAD_LEN_IDX]));
+    pendingSeq = seq;
+    pendingReceived += chunkLen;
+    if (pendingReceived >= pendingLen)
+    {
+        pending->valid = true;
+        pending->storedMs = now;
+        pending = nullptr;
+    }
+}
+
+bool MSPResponseCache::getReplayChunk(uint8_t **frame)
+{
+    if (replay == nullptr)
+        return false;
+
+    *frame = replay->chunks[replayIdx++];
+    replaying = true;
+    if (replayIdx >= replay->chunkCount)
+        replay = nullptr;
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include "crsfmsp_common.h"
+#include "crsf_protocol.h"
+
+#define MSP_CACHE_ENTRIES 8           // Number of distinct requests that are cached
+#define MSP_CACHE_MAX_CHUNKS 4        // Largest response cached, in CRSF chunks
+#define MSP_CACHE_MAX_REQUEST_LEN 4   // Largest request payload used as part of the cache key
+
+/*  Answers repeated read-only MSP requests (API version, board info, vtx table...)
+    locally with the last response from the FC, saving the round trip over the air.
+
+    Requests are CRSF encapsulated MSP frames as received OTA, responses are the
+    CRSF MSP_RESP chunks as received from the FC. Any request that changes the FC
+    state (MSP_WRITE frames, MSP_SET_*, MSP_EEPROM_WRITE...) invalidates the whole
+    cache, entries also expire after the TTL.
+*/
+
+class MSPResponseCache
+{
+private:
+    typedef struct {
+        bool valid;
+        uint8_t orig;           // requester, responses are addressed to it
+        uint8_t version;        // MSP version from the CRSF status byte
+        uint16_t function;
+        uint8_t reqLen;
+        uint8_t req[MSP_CACHE_MAX_REQUEST_LEN];
+        uint32_t storedMs;
+        uint32_t lastUsed;
+        uint8_t chunkCount;
+        uint8_t chunks[MSP_CACHE_MAX_CHUNKS][CRSF_MAX_PACKET_LEN];
+    } entry_t;
+
+    entry_t entries[MSP_CACHE_ENTRIES];
+    uint32_t ttlMs;
+    uint32_t useCounter;
+
+    entry_t *pending;           // request forwarded to the FC, waiting for the response
+    uint32_t pendingLen;        // MSP bytes expected in the response
+    uint32_t pendingReceived;   // MSP bytes received so far
+    uint8_t pendingSeq;
+
+    entry_t *replay;            // entry being sent back in place of the FC
+    uint8_t replayIdx;
+    bool replaying;             // a replayed chunk is being queued, it must not be captured
+
+    uint32_t hits;
+    uint32_t misses;
+
+    static bool isIdempotent(uint16_t function);
+    static bool isStateChanging(const uint8_t *frame);
+    bool parseRequest(const uint8_t *frame, entry_t *key);
+    entry_t *find(const entry_t *key);
+    entry_t *allocate();
+
+public:
+    explicit MSPResponseCache(uint32_t ttlMs);
+    void setTTL(uint32_t ms) { ttlMs = ms; }
+    void invalidate();
+
+    /**
+     * @brief Process a CRSF MSP frame received OTA that is about to be sent to the FC
+     * @return true if the request will be answered from the cache and should not be forwarded
+     */
+    bool handleRequest(const uint8_t *frame, uint32_t now);
+
+    /**
+     * @brief Process a CRSF frame received from the FC, capturing responses to cacheable requests
+     */
+    void handleResponse(const uint8_t *frame, uint32_t now);
+
+    /**
+     * @brief Get the next chunk of a cached response to queue as telemetry, one per call
+     * @return true if frame points to a complete CRSF frame to send
+     */
+    bool getReplayChunk(uint8_t **frame);
+
+    /**
+     * @brief Call once the chunk from getReplayChunk() has been queued
+     */
+    void endReplayChunk() { replaying = false; }
+
+    uint32_t getHits() const { return hits; }
+    uint32_t getMisses() const { return misses; }
+};
+
+#if defined(MSP_RESPONSE_CACHE_TTL_MS)
+extern MSPResponseCache mspResponseCache;
+#endif
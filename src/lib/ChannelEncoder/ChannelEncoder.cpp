@@ -0,0 +1,189 @@
+#include "ChannelEncoder.h"
+#include "crsf_protocol.h"
+
+extern GENERIC_CRC8 crsf_crc;
+
+uint8_t rcEncodeChannels(const rcEncoderDesc_t &desc, const uint32_t *channelData, uint8_t *out)
+{
+    const uint8_t *start = out;
+    const uint32_t mask = (1U << desc.bits) - 1;
+    uint32_t acc = 0;
+    uint8_t accBits = 0;
+
+    for (uint8_t i = 0; i < desc.numChannels; i++)
+    {
+        const rcChannelMap_t &ch = desc.channels[i];
+        uint32_t value = channelData[ch.source];
+        if (ch.scale != RC_SCALE_NONE)
+            value = rcScale(desc.scales[ch.scale], value);
+        value = (value << desc.outShift) & mask;
+
+        if (desc.bits == 16 && desc.bigEndian)
+        {
+            *out++ = value >> 8;
+            *out++ = value;
+            continue;
+        }
+
+        // LSB first, at most 7 bits are left over from the previous channel so 16 bit channels fit too
+        acc |= value << accBits;
+        accBits += desc.bits;
+        while (accBits >= 8)
+        {
+            *out++ = acc;
+            acc >>= 8;
+            accBits -= 8;
+        }
+    }
+    if (accBits)
+        *out++ = acc;
+
+    return out - start;
+}
+
+RCFrameEncoder::RCFrameEncoder(const rcEncoderDesc_t &desc) : m_desc(&desc)
+{
+    if (desc.crc == RC_ENCODER_CRC16_CCITT)
+    {
+        m_crc16.init(16, 0x1021);
+    }
+}
+
+uint8_t RCFrameEncoder::getFrameLen() const
+{
+    const uint8_t crcLen = m_desc->crc == RC_ENCODER_CRC8_CRSF ? 1 : m_desc->crc == RC_ENCODER_CRC_NONE ? 0 : 2;
+    return m_desc->headerLen + (m_desc->numChannels * m_desc->bits + 7) / 8 + crcLen;
+}
+
+uint8_t RCFrameEncoder::encode(const uint32_t *channelData, uint8_t *out)
+{
+    memcpy(out, m_desc->header, m_desc->headerLen);
+    uint8_t len = m_desc->headerLen;
+    len += rcEncodeChannels(*m_desc, channelData, &out[len]);
+
+    switch (m_desc->crc)
+    {
+    case RC_ENCODER_CRC8_CRSF:
+        out[len] = crsf_crc.calc(&out[m_desc->crcStart], len - m_desc->crcStart);
+        ++len;
+        break;
+    case RC_ENCODER_CRC16_CCITT:
+    {
+        const uint16_t crc = m_crc16.calc(&out[m_desc->crcStart], len - m_desc->crcStart, 0);
+        out[len++] = crc >> 8;
+        out[len++] = crc;
+        break;
+    }
+    case RC_ENCODER_CHECKSUM_IBUS:
+    {
+        uint16_t sum = 0xFFFF;
+        for (uint8_t i = m_desc->crcStart; i < len; i++)
+            sum -= out[i];
+        out[len++] = sum;
+        out[len++] = sum >> 8;
+        break;
+    }
+    default:
+        break;
+    }
+    return len;
+}
+
+/***
+ * CRSF RC_CHANNELS_PACKED, 16 channels of 11 bits
+ */
+static const rcChannelMap_t crsfChannels[] = {
+    {0, RC_SCALE_NONE}, {1, RC_SCALE_NONE}, {2, RC_SCALE_NONE}, {3, RC_SCALE_NONE},
+    {4, RC_SCALE_NONE}, {5, RC_SCALE_NONE}, {6, RC_SCALE_NONE}, {7, RC_SCALE_NONE},
+    {8, RC_SCALE_NONE}, {9, RC_SCALE_NONE}, {10, RC_SCALE_NONE}, {11, RC_SCALE_NONE},
+    {12, RC_SCALE_NONE}, {13, RC_SCALE_NONE}, {14, RC_SCALE_NONE}, {15, RC_SCALE_NONE},
+};
+
+static const uint8_t crsfHeader[] = {
+    CRSF_ADDRESS_FLIGHT_CONTROLLER,
+    CRSF_FRAME_SIZE(sizeof(crsf_channels_t)),
+    CRSF_FRAMETYPE_RC_CHANNELS_PACKED
+};
+
+const rcEncoderDesc_t rcEncoderCRSF = {
+    16, 11, false, 0, crsfChannels, nullptr,
+    crsfHeader, sizeof(crsfHeader), RC_ENCODER_CRC8_CRSF, 2
+};
+
+/***
+ * SBUS uses the same channel packing as CRSF, the flags and footer are added by SerialSBUS
+ */
+static const uint8_t sbusHeader[] = {0x0F};
+
+const rcEncoderDesc_t rcEncoderSBUS = {
+    16, 11, false, 0, crsfChannels, nullptr,
+    sbusHeader, sizeof(sbusHeader), RC_ENCODER_CRC_NONE, 0
+};
+
+/***
+ * DJI RS Pro gimbal over SBUS, with its channel order and ranges
+ */
+static const rcChannelScale_t djiRsProScales[] = {
+    rcScaleLinear(CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696),
+    rcScaleLinear(CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 176, 848),
+    rcScaleSwitch(CRSF_CHANNEL_VALUE_MID, 352, 1696),
+};
+
+static const rcChannelMap_t djiRsProChannels[] = {
+    {0, 0}, {1, 0}, {2, 0}, {3, 0},
+    {5, 0},     // Record start/stop and photo
+    {6, 0},     // Mode
+    {7, 1},     // Recenter and Selfie
+    {8, 0}, {9, 0}, {10, 0}, {11, 0}, {12, 0}, {13, 0}, {14, 0}, {15, 0},
+    {4, 2},     // Arm as a switch on the last channel
+};
+
+const rcEncoderDesc_t rcEncoderSBUSDJIRSPro = {
+    16, 11, false, 0, djiRsProChannels, djiRsProScales,
+    sbusHeader, sizeof(sbusHeader), RC_ENCODER_CRC_NONE, 0
+};
+
+// CRSF_to_US()
+static const rcChannelScale_t usScales[] = {
+    rcScaleLinear(CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 988, 2012),
+};
+
+/***
+ * Graupner SUMD, 16 channels of microseconds * 8 big endian
+ */
+static const rcChannelMap_t sumdChannels[] = {
+    {0, 0}, {1, 0}, {2, 0}, {3, 0},
+    {7, 0},     // channel 8 mapped to 5 to move arm channel away from the aileron function
+    {5, 0}, {6, 0},
+    {4, 0},     // channel 5 mapped to 8
+    {8, 0}, {9, 0}, {10, 0}, {11, 0}, {12, 0}, {13, 0}, {14, 0}, {15, 0},
+};
+
+static const uint8_t sumdHeader[] = {
+    0xA8,   // Graupner
+    0x01,   // SUMD
+    0x10,   // 16CH
+};
+
+const rcEncoderDesc_t rcEncoderSUMD = {
+    16, 16, true, 3, sumdChannels, usScales,
+    sumdHeader, sizeof(sumdHeader), RC_ENCODER_CRC16_CCITT, 0
+};
+
+/***
+ * FlySky IBUS servo frame, 14 channels of microseconds little endian
+ */
+static const rcChannelMap_t ibusChannels[] = {
+    {0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 0}, {6, 0},
+    {7, 0}, {8, 0}, {9, 0}, {10, 0}, {11, 0}, {12, 0}, {13, 0},
+};
+
+static const uint8_t ibusHeader[] = {
+    0x20,   // length
+    0x40,   // servo command
+};
+
+const rcEncoderDesc_t rcEncoderIBUS = {
+    14, 16, false, 0, ibusChannels, usScales,
+    ibusHeader, sizeof(ibusHeader), RC_ENCODER_CHECKSUM_IBUS, 0
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "targets.h"
+#include "crc.h"
+
+/**
+ * Table driven RC channel encoders for the serial output protocols.
+ *
+ * Each protocol is described by a rcEncoderDesc_t giving the channel order, the scaling
+ * of each channel, how the channels are packed and the header/CRC of the frame. One
+ * generic packer (rcEncodeChannels) consumes the descriptor, so adding a protocol is a
+ * matter of adding a table rather than another hand unrolled sendRCFrame.
+ *
+ * Scaling uses a fixed-point multiplier precomputed at compile time which gives exactly
+ * the same result as fmap() for inputs up to RC_SCALE_MAX_INPUT, without the divide.
+ */
+
+#define RC_SCALE_MAX_INPUT  4095    // largest input value the scale is exact for
+#define RC_SCALE_NONE       0xFF    // channel map scale index for a channel passed through unscaled
+
+typedef enum : uint8_t {
+    RC_SCALE_LINEAR,    // fmap(x, inMin, inMax, outMin, outMax)
+    RC_SCALE_SWITCH,    // x < inMin ? outMin : outMax
+} rcScaleType_e;
+
+typedef struct {
+    rcScaleType_e type;
+    uint8_t shift;
+    uint16_t inMin;
+    uint16_t outMin;
+    uint16_t outMax;
+    uint32_t mult;      // 2 * (outMax - outMin) / (inMax - inMin) in fixed point with shift fractional bits
+} rcChannelScale_t;
+
+typedef struct {
+    uint8_t source;     // index into the channel data
+    uint8_t scale;      // index into the descriptor's scales, or RC_SCALE_NONE
+} rcChannelMap_t;
+
+typedef enum : uint8_t {
+    RC_ENCODER_CRC_NONE,
+    RC_ENCODER_CRC8_CRSF,       // crsf_crc, poly 0xD5
+    RC_ENCODER_CRC16_CCITT,     // poly 0x1021, big endian
+    RC_ENCODER_CHECKSUM_IBUS,   // 0xFFFF - sum of bytes, little endian
+} rcEncoderCrc_e;
+
+typedef struct {
+    uint8_t numChannels;
+    uint8_t bits;               // bits per channel. Less than 16 are packed LSB first, 16 are written whole
+    bool bigEndian;             // byte order of 16 bit channels
+    uint8_t outShift;           // left shift applied to every scaled value
+    const rcChannelMap_t *channels;
+    const rcChannelScale_t *scales;
+    const uint8_t *header;
+    uint8_t headerLen;
+    rcEncoderCrc_e crc;
+    uint8_t crcStart;           // offset of the first frame byte covered by the CRC
+} rcEncoderDesc_t;
+
+// Fractional bits needed for the multiplier to be exact over the whole input range
+constexpr uint8_t rcScaleShift(uint32_t inRange, uint8_t shift = 0)
+{
+    return ((uint64_t)1 << shift) >= (uint64_t)(RC_SCALE_MAX_INPUT + 1) * inRange ? shift : rcScaleShift(inRange, shift + 1);
+}
+
+constexpr uint32_t rcScaleMult(uint32_t outRange2, uint32_t inRange, uint8_t shift)
+{
+    return (((uint64_t)outRange2 << shift) + inRange - 1) / inRange;
+}
+
+constexpr rcChannelScale_t rcScaleLinear(uint16_t inMin, uint16_t inMax, uint16_t outMin, uint16_t outMax)
+{
+    return {RC_SCALE_LINEAR, rcScaleShift(inMax - inMin), inMin, outMin, outMax,
+            rcScaleMult(2 * (outMax - outMin), inMax - inMin, rcScaleShift(inMax - inMin))};
+}
+
+constexpr rcChannelScale_t rcScaleSwitch(uint16_t threshold, uint16_t low, uint16_t high)
+{
+    return {RC_SCALE_SWITCH, 0, threshold, low, high, 0};
+}
+
+/**
+ * @brief Scale a value the same way as fmap() with the scale's ranges
+ */
+static inline uint16_t rcScale(const rcChannelScale_t &scale, uint16_t x)
+{
+    if (scale.type == RC_SCALE_SWITCH)
+        return x < scale.inMin ? scale.outMin : scale.outMax;
+
+    // fmap() truncates towards zero below inMin, so scale the magnitude
+    const int32_t d = (int32_t)x - scale.inMin;
+    const uint32_t ad = d < 0 ? -d : d;
+    int32_t q = (int32_t)(((uint64_t)ad * scale.mult) >> scale.shift);
+    if (d < 0)
+        q = -q;
+    return (q + scale.outMin * 2 + 1) / 2;
+}
+
+/**
+ * @brief Pack the channels described by desc into out
+ * @return the number of bytes written
+ */
+uint8_t rcEncodeChannels(const rcEncoderDesc_t &desc, const uint32_t *channelData, uint8_t *out);
+
+/**
+ * Encodes a whole frame for one protocol: header, packed channels and CRC
+ */
+class RCFrameEncoder
+{
+public:
+    explicit RCFrameEncoder(const rcEncoderDesc_t &desc);
+
+    /**
+     * @return the number of bytes written to out, which must hold getFrameLen() bytes
+     */
+    uint8_t encode(const uint32_t *channelData, uint8_t *out);
+    uint8_t getFrameLen() const;
+
+    /**
+     * @brief Switch to another variant of the protocol, which must use the same CRC
+     */
+    void setDescriptor(const rcEncoderDesc_t &desc) { m_desc = &desc; }
+
+private:
+    const rcEncoderDesc_t *m_desc;
+    Crc2Byte m_crc16;           // only initialised for RC_ENCODER_CRC16_CCITT
+};
+
+extern const rcEncoderDesc_t rcEncoderCRSF;
+extern const rcEncoderDesc_t rcEncoderSBUS;
+extern const rcEncoderDesc_t rcEncoderSBUSDJIRSPro;
+extern const rcEncoderDesc_t rcEncoderSUMD;
+extern const rcEncoderDesc_t rcEncoderIBUS;
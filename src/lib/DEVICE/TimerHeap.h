@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief A binary min-heap of timer deadlines keyed by a small id (the device index).
+ *
+ * Each id is in the heap at most once, and a position index makes rescheduling or
+ * removing an id O(log N) without searching. Deadlines are millisecond timestamps
+ * compared with wraparound, so they must be within 2^31ms of each other.
+ *
+ * @tparam N the number of ids, which are 0 to N-1
+ */
+template <uint8_t N>
+class TimerHeap
+{
+public:
+    static const uint8_t NONE = 0xFF;
+
+    TimerHeap() { clear(); }
+
+    void clear()
+    {
+        count = 0;
+        for (uint8_t i = 0; i < N; i++)
+            pos[i] = NONE;
+    }
+
+    bool empty() const { return count == 0; }
+    uint8_t size() const { return count; }
+    bool contains(uint8_t id) const { return pos[id] != NONE; }
+
+    /**
+     * @brief the id with the earliest deadline, the heap must not be empty
+     */
+    uint8_t top() const { return heap[0].id; }
+    uint32_t topDeadline() const { return heap[0].deadline; }
+
+    /**
+     * @brief Add the id, or move it if it is already in the heap
+     */
+    void set(uint8_t id, uint32_t deadline)
+    {
+        uint8_t i = pos[id];
+        if (i == NONE)
+        {
+            i = count++;
+            heap[i].id = id;
+            heap[i].deadline = deadline;
+            siftUp(i);
+        }
+        else
+        {
+            const bool earlier = before(deadline, heap[i].deadline);
+            heap[i].deadline = deadline;
+            if (earlier)
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+    }
+
+    void remove(uint8_t id)
+    {
+        const uint8_t i = pos[id];
+        if (i == NONE)
+            return;
+        pos[id] = NONE;
+        if (i == --count)
+            return;
+        // Fill the hole with the last entry, which may need to go either way
+        const bool earlier = before(heap[count].deadline, heap[i].deadline);
+        place(i, heap[count]);
+        if (earlier)
+            siftUp(i);
+        else
+            siftDown(i);
+    }
+
+    /**
+     * @brief Remove and return the id with the earliest deadline, the heap must not be empty
+     */
+    uint8_t pop()
+    {
+        const uint8_t id = heap[0].id;
+        remove(id);
+        return id;
+    }
+
+private:
+    typedef struct {
+        uint32_t deadline;
+        uint8_t id;
+    } entry_t;
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void place(uint8_t i, const entry_t &e)
+    {
+        heap[i] = e;
+        pos[e.id] = i;
+    }
+
+    void siftUp(uint8_t i)
+    {
+        const entry_t e = heap[i];
+        while (i > 0)
+        {
+            const uint8_t parent = (i - 1) / 2;
+            if (!before(e.deadline, heap[parent].deadline))
+                break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+
+    void siftDown(uint8_t i)
+    {
+        const entry_t e = heap[i];
+        for (;;)
+        {
+            uint8_t child = 2 * i + 1;
+            if (child >= count)
+                break;
+            if (child + 1 < count && before(heap[child + 1].deadline, heap[child].deadline))
+                child++;
+            if (!before(heap[child].deadline, e.deadline))
+                break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, e);
+    }
+
+    entry_t heap[N];
+    uint8_t pos[N];
+    uint8_t count;
+};
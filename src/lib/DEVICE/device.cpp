@@ -3,6 +3,7 @@
 #include "logging.h"
 #include "helpers.h"
 #include "device.h"
+#include "TimerHeap.h"
 
 ///////////////////////////////////////
 // Even though we aren't using anything this keeps the PIO dependency analyzer happy!
@@ -29,11 +30,22 @@ extern bool connectionHasModelMatch;
 static device_affinity_t *uiDevices;
 static uint8_t deviceCount;
 
-static bool eventFired[2] = {false, false};
+static uint8_t pendingEvents[2] = {0, 0};
 static connectionState_e lastConnectionState[2] = {disconnected, disconnected};
 static bool lastModelMatch[2] = {false, false};
 
-static unsigned long deviceTimeout[16] = {0};
+// The timeout deadlines of the devices on each core, earliest first
+static TimerHeap<DEVICE_MAX_COUNT> deviceTimers[2];
+static deviceStats_t deviceStats[DEVICE_MAX_COUNT];
+static deviceLoopStats_t loopStats;
+static uint32_t lastLoopMicros;
+
+#define DEVICE_LOAD_WINDOW_US 1000000
+static uint32_t coreBusyMicros[2];
+static uint32_t coreWindowStart[2];
+static uint8_t deviceLoad[2];
+
+const uint16_t deviceLoopBucketMicros[DEVICE_LOOP_BUCKET_COUNT - 1] = {100, 250, 500, 1000, 2000, 5000, 10000};
 
 #if MULTICORE
 static TaskHandle_t xDeviceTask = NULL;
@@ -47,8 +59,16 @@ static void deviceTask(void *pvArgs);
 
 void devicesRegister(device_affinity_t *devices, uint8_t count)
 {
+    if (count > DEVICE_MAX_COUNT)
+    {
+        ERRLN("Too many devices %u", count);
+        count = DEVICE_MAX_COUNT;
+    }
     uiDevices = devices;
     deviceCount = count;
+    deviceTimers[0].clear();
+    deviceTimers[1].clear();
+    devicesResetStats();
 
     #if MULTICORE
         taskSemaphore = xSemaphoreCreateBinary();
@@ -78,19 +98,32 @@ void devicesInit()
     #endif
 }
 
+static void scheduleTimeout(TimerHeap<DEVICE_MAX_COUNT> &timers, uint8_t index, unsigned long now, int delay)
+{
+    if (delay == DURATION_NEVER || uiDevices[index].device->timeout == nullptr)
+    {
+        timers.remove(index);
+    }
+    else
+    {
+        timers.set(index, now + delay);
+    }
+}
+
 void devicesStart()
 {
     int32_t core = CURRENT_CORE;
+    TimerHeap<DEVICE_MAX_COUNT> &timers = deviceTimers[core == -1 ? 0 : core];
     unsigned long now = millis();
 
     for(size_t i=0 ; i<deviceCount ; i++)
     {
         if (uiDevices[i].core == core || core == -1) {
-            deviceTimeout[i] = 0xFFFFFFFF;
+            timers.remove(i);
             if (uiDevices[i].device->start)
             {
                 int delay = (uiDevices[i].device->start)();
-                deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+                scheduleTimeout(timers, i, now, delay);
             }
         }
     }
@@ -110,63 +143,161 @@ void devicesStop()
     #endif
 }
 
-void devicesTriggerEvent()
+void devicesTriggerEvent(uint8_t events)
 {
-    eventFired[0] = true;
-    eventFired[1] = true;
+    pendingEvents[0] |= events;
+    pendingEvents[1] |= events;
     #if MULTICORE
     // Release teh semaphore so the tasks on core 0 run now
     xSemaphoreGive(taskSemaphore);
     #endif
 }
 
+const deviceStats_t *devicesGetStats(uint8_t index)
+{
+    return index < deviceCount ? &deviceStats[index] : nullptr;
+}
+
+const deviceLoopStats_t *devicesGetLoopStats()
+{
+    return &loopStats;
+}
+
+void devicesResetStats()
+{
+    memset(deviceStats, 0, sizeof(deviceStats));
+    memset(&loopStats, 0, sizeof(loopStats));
+    lastLoopMicros = 0;
+}
+
+uint8_t devicesGetCount()
+{
+    return deviceCount;
+}
+
+const device_affinity_t *devicesGetDevice(uint8_t index)
+{
+    return index < deviceCount ? &uiDevices[index] : nullptr;
+}
+
+static int runDevice(uint8_t index, int (*func)(), uint32_t &calls)
+{
+    const uint32_t start = micros();
+    const int delay = func();
+    const uint32_t elapsed = micros() - start;
+
+    deviceStats_t &stats = deviceStats[index];
+    calls++;
+    stats.totalMicros += elapsed;
+    stats.maxMicros = std::max(stats.maxMicros, elapsed);
+    return delay;
+}
+
+uint8_t devicesGetDeviceLoad(uint8_t core)
+{
+    return core < 2 ? deviceLoad[core] : 0;
+}
+
+static void recordCoreBusy(int32_t core, uint32_t start)
+{
+    const uint32_t nowMicros = micros();
+    coreBusyMicros[core] += nowMicros - start;
+
+    const uint32_t window = nowMicros - coreWindowStart[core];
+    if (window >= DEVICE_LOAD_WINDOW_US)
+    {
+        // The first window starts at boot, which is close enough
+        deviceLoad[core] = std::min(coreBusyMicros[core] / (window / 100), (uint32_t)100);
+        coreBusyMicros[core] = 0;
+        coreWindowStart[core] = nowMicros;
+    }
+}
+
 static int _devicesUpdate(unsigned long now)
 {
     const int32_t core = CURRENT_CORE;
     const int32_t coreMulti = (core == -1) ? 0 : core;
+    TimerHeap<DEVICE_MAX_COUNT> &timers = deviceTimers[coreMulti];
+    const uint32_t start = micros();
 
     bool newModelMatch = connectionHasModelMatch && teamraceHasModelMatch;
-    bool handleEvents = eventFired[coreMulti] || lastConnectionState[coreMulti] != connectionState || lastModelMatch[coreMulti] != newModelMatch;
-    eventFired[coreMulti] = false;
+    uint8_t events = pendingEvents[coreMulti];
+    pendingEvents[coreMulti] = 0;
+    if (lastConnectionState[coreMulti] != connectionState)
+        events |= DEVICE_EVENT_CONNECTION_STATE;
+    if (lastModelMatch[coreMulti] != newModelMatch)
+        events |= DEVICE_EVENT_MODEL_MATCH;
     lastConnectionState[coreMulti] = connectionState;
     lastModelMatch[coreMulti] = newModelMatch;
 
-    for(size_t i=0 ; i<deviceCount ; i++)
+    if (events)
     {
-        if (uiDevices[i].core == core || core == -1) {
-            if (handleEvents && uiDevices[i].device->event)
+        for(size_t i=0 ; i<deviceCount ; i++)
+        {
+            const device_t *device = uiDevices[i].device;
+            const uint8_t mask = device->eventMask ? device->eventMask : DEVICE_EVENT_ALL;
+            if ((uiDevices[i].core == core || core == -1) && device->event && (mask & events))
             {
-                int delay = (uiDevices[i].device->event)();
+                int delay = runDevice(i, device->event, deviceStats[i].events);
                 if (delay != DURATION_IGNORE)
                 {
-                    deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+                    scheduleTimeout(timers, i, now, delay);
                 }
             }
         }
     }
 
-    int smallest_delay = DURATION_NEVER;
-    for(size_t i=0 ; i<deviceCount ; i++)
+    // Take all the expired timeouts off first so each runs once, even if it
+    // returns DURATION_IMMEDIATELY, and in the order they expired
+    uint8_t expired[DEVICE_MAX_COUNT];
+    uint8_t expiredCount = 0;
+    while (!timers.empty() && (int32_t)(now - timers.topDeadline()) >= 0)
     {
-        if ((uiDevices[i].core == core || core == -1) && uiDevices[i].device->timeout)
+        const uint32_t lateMillis = now - timers.topDeadline();
+        const uint8_t index = timers.pop();
+        if (lateMillis > 0)
         {
-            int delay = deviceTimeout[i] == 0xFFFFFFFF ? DURATION_NEVER : (int)(deviceTimeout[i]-now);
-            if (now >= deviceTimeout[i])
-            {
-                delay = (uiDevices[i].device->timeout)();
-                deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
-            }
-            if (delay != DURATION_NEVER)
-            {
-                smallest_delay = (smallest_delay == DURATION_NEVER) ? delay : std::min(smallest_delay, delay);
-            }
+            deviceStats[index].late++;
+            deviceStats[index].maxLateMillis = std::max(deviceStats[index].maxLateMillis, lateMillis);
         }
+        expired[expiredCount++] = index;
+    }
+
+    for (uint8_t i=0 ; i<expiredCount ; i++)
+    {
+        const uint8_t index = expired[i];
+        int delay = runDevice(index, uiDevices[index].device->timeout, deviceStats[index].timeouts);
+        scheduleTimeout(timers, index, now, delay);
+    }
+    recordCoreBusy(coreMulti, start);
+
+    if (timers.empty())
+    {
+        return DURATION_NEVER;
+    }
+    return std::max((int32_t)(timers.topDeadline() - now), (int32_t)0);
+}
+
+static void recordLoopPeriod()
+{
+    const uint32_t nowMicros = micros();
+    if (lastLoopMicros != 0)
+    {
+        const uint32_t period = nowMicros - lastLoopMicros;
+        uint8_t bucket = 0;
+        while (bucket < DEVICE_LOOP_BUCKET_COUNT - 1 && period > deviceLoopBucketMicros[bucket])
+            bucket++;
+        loopStats.buckets[bucket]++;
+        loopStats.count++;
+        loopStats.totalMicros += period;
+        loopStats.maxMicros = std::max(loopStats.maxMicros, period);
     }
-    return smallest_delay;
+    lastLoopMicros = nowMicros;
 }
 
 void devicesUpdate(unsigned long now)
 {
+    recordLoopPeriod();
     _devicesUpdate(now);
 }
 
@@ -7,6 +7,14 @@
 #define DURATION_NEVER -1       // timeout() will not be called, only event()
 #define DURATION_IMMEDIATELY 0  // timeout() will be called each loop
 
+#define DEVICE_MAX_COUNT 16     // most devices that can be registered at once
+
+// events which can be subscribed to with eventMask
+#define DEVICE_EVENT_TRIGGERED        (1 << 0)  // devicesTriggerEvent() was called
+#define DEVICE_EVENT_CONNECTION_STATE (1 << 1)  // connectionState changed
+#define DEVICE_EVENT_MODEL_MATCH      (1 << 2)  // the model match state changed
+#define DEVICE_EVENT_ALL              (DEVICE_EVENT_TRIGGERED | DEVICE_EVENT_CONNECTION_STATE | DEVICE_EVENT_MODEL_MATCH)
+
 typedef struct {
     /**
      * @brief Called at the beginning of setup() so the device can configure IO pins etc.
@@ -32,6 +40,17 @@ typedef struct {
      * a new duration, this function should not return DURATION_IGNORE.
      */
     int (*timeout)();
+
+    /**
+     * @brief The DEVICE_EVENT_xxx which call event(), 0 (the default when not set) for all
+     * events.
+     */
+    uint8_t eventMask;
+
+    /**
+     * @brief Short name shown by the profiler in LUA and the WiFi JSON.
+     */
+    const char *name;
 } device_t;
 
 typedef struct {
@@ -45,6 +64,26 @@ typedef struct {
   int8_t core; // 0 = alternate core or 1 = loop core
 } device_affinity_t;
 
+typedef struct {
+    uint32_t events;        // calls to event()
+    uint32_t timeouts;      // calls to timeout()
+    uint32_t totalMicros;   // time spent in those calls
+    uint32_t maxMicros;     // longest single call
+    uint32_t late;          // timeouts called after their deadline
+    uint32_t maxLateMillis; // latest a timeout has been called
+} deviceStats_t;
+
+// main loop period histogram buckets, the last catches everything longer
+#define DEVICE_LOOP_BUCKET_COUNT 8
+extern const uint16_t deviceLoopBucketMicros[DEVICE_LOOP_BUCKET_COUNT - 1];
+
+typedef struct {
+    uint32_t count;         // loop periods measured
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t buckets[DEVICE_LOOP_BUCKET_COUNT]; // periods up to each of deviceLoopBucketMicros
+} deviceLoopStats_t;
+
 /**
  * @brief register a list of devices to be actioned
  *
@@ -74,9 +113,53 @@ void devicesUpdate(unsigned long now);
 
 /**
  * @brief Notify the device framework that an event has occurred and on the next call to
- * deviceUpdate() the event() function of the devices should be called.
+ * deviceUpdate() the event() function of the devices subscribed to it should be called.
+ *
+ * @param events the DEVICE_EVENT_xxx which occurred
+ */
+void devicesTriggerEvent(uint8_t events = DEVICE_EVENT_TRIGGERED);
+
+/**
+ * @brief Get the run time statistics of a registered device
+ *
+ * @param index the index of the device in the list passed to devicesRegister()
+ * @return the statistics, or nullptr if there is no such device
+ */
+const deviceStats_t *devicesGetStats(uint8_t index);
+
+/**
+ * @brief Get the period statistics of the loop calling devicesUpdate()
+ */
+const deviceLoopStats_t *devicesGetLoopStats();
+
+/**
+ * @brief Get the share of the last second a core spent running device callbacks. This is
+ * not the load of the whole core: loop() outside devicesUpdate() and ISRs, such as the RF
+ * timing on the loop core, are not counted.
+ *
+ * @param core 0 for the alternate core or 1 for the loop core, everything is counted
+ * against 0 on single core SoCs
+ * @return the load in percent
+ */
+uint8_t devicesGetDeviceLoad(uint8_t core);
+
+/**
+ * @brief Clear the run time statistics of all the devices and the loop.
+ */
+void devicesResetStats();
+
+/**
+ * @return the number of registered devices
+ */
+uint8_t devicesGetCount();
+
+/**
+ * @brief Get a registered device, for looking up its name and affinity
+ *
+ * @param index the index of the device in the list passed to devicesRegister()
+ * @return the device, or nullptr if there is no such device
  */
-void devicesTriggerEvent();
+const device_affinity_t *devicesGetDevice(uint8_t index);
 
 /**
  * @brief Stop all the devices.
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "targets.h"
+
+typedef void (*deferredFunction_t)(void *context);
+
+/**
+ * @brief A fixed size queue of functions to call once a delay has elapsed.
+ *
+ * Entries are a plain function pointer and context, kept sorted by deadline so checking
+ * for work is a look at the first entry. Nothing is allocated, and add() may be called
+ * from an ISR while the main loop is in run().
+ *
+ * @tparam N the number of functions which can be pending at once
+ */
+template <uint8_t N>
+class DeferredQueue
+{
+public:
+    /**
+     * @brief Call function(context) once more than us microseconds have passed since now
+     * @return false if the queue is full and the function will not be called
+     */
+    ICACHE_RAM_ATTR bool add(uint32_t now, uint32_t us, deferredFunction_t function, void *context)
+    {
+        const uint32_t deadline = now + us;
+        lock();
+        if (count == N)
+        {
+            unlock();
+            return false;
+        }
+        // Insert after everything due at or before this, so equal deadlines run in order added
+        uint8_t i = count++;
+        while (i > 0 && (int32_t)(entries[i - 1].deadline - deadline) > 0)
+        {
+            entries[i] = entries[i - 1];
+            i--;
+        }
+        entries[i].deadline = deadline;
+        entries[i].function = function;
+        entries[i].context = context;
+        unlock();
+        return true;
+    }
+
+    /**
+     * @brief Call every function whose delay has elapsed by now.
+     * Functions added while running are left for the next call, even with no delay.
+     */
+    void run(uint32_t now)
+    {
+        for (;;)
+        {
+            lock();
+            if (count == 0 || (int32_t)(now - entries[0].deadline) <= 0)
+            {
+                unlock();
+                return;
+            }
+            const entry_t entry = entries[0];
+            count--;
+            for (uint8_t i = 0; i < count; i++)
+                entries[i] = entries[i + 1];
+            unlock();
+
+            entry.function(entry.context);
+        }
+    }
+
+    uint8_t size() const { return count; }
+
+    void clear()
+    {
+        lock();
+        count = 0;
+        unlock();
+    }
+
+private:
+    typedef struct {
+        uint32_t deadline;
+        deferredFunction_t function;
+        void *context;
+    } entry_t;
+
+    ICACHE_RAM_ATTR void inline lock()
+    {
+    #if defined(PLATFORM_ESP32)
+        portENTER_CRITICAL(&mux);
+    #elif defined(PLATFORM_ESP8266) || defined(PLATFORM_STM32)
+        noInterrupts();
+    #endif
+    }
+
+    ICACHE_RAM_ATTR void inline unlock()
+    {
+    #if defined(PLATFORM_ESP32)
+        portEXIT_CRITICAL(&mux);
+    #elif defined(PLATFORM_ESP8266) || defined(PLATFORM_STM32)
+        interrupts();
+    #endif
+    }
+
+    entry_t entries[N];
+    volatile uint8_t count = 0;
+#if defined(PLATFORM_ESP32)
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "targets.h"
+
+/**
+ * @brief Antenna selection for a single radio with an antenna switch. Predicts the RSSI
+ * each antenna would have on the channel of the next packet, and uses the better one.
+ *
+ * The prediction for an antenna is its recent RSSI over all channels, which follows the
+ * orientation and distance of the craft, plus what that channel has recently been over or
+ * under it, which follows the frequency selective fading. A missed packet counts as a
+ * packet received MISS_PENALTY below what was expected.
+ *
+ * Only the antenna in use can be measured, so the other is probed for a packet every
+ * PROBE_INTERVAL packets to keep its estimate current. Probes are only done for packets
+ * which will be received, never a slot where telemetry is sent.
+ *
+ * RSSIs are kept in 1/FRAC dBm.
+ */
+template <uint8_t MAX_CHANNELS>
+class AntennaDiversity
+{
+public:
+    static const int16_t FRAC = 16;
+    static const int16_t MISS_PENALTY = 10 * FRAC;
+    static const int16_t HYSTERESIS = 2 * FRAC;
+    static const uint8_t PROBE_INTERVAL = 64;
+
+    AntennaDiversity() { reset(); }
+
+    void reset()
+    {
+        for (uint8_t ant = 0; ant < 2; ant++)
+        {
+            rssi[ant] = 0;
+            valid[ant] = false;
+            for (uint8_t ch = 0; ch < MAX_CHANNELS; ch++)
+                offset[ant][ch] = 0;
+        }
+        current = 0;
+        probing = false;
+        sinceOther = 0;
+        lastChannel = 0;
+    }
+
+    /**
+     * @brief The packet on the channel and antenna last chosen was received
+     */
+    void ICACHE_RAM_ATTR received(int8_t packetRssi)
+    {
+        update(packetRssi * FRAC);
+    }
+
+    /**
+     * @brief The packet on the channel and antenna last chosen was missed
+     */
+    void ICACHE_RAM_ATTR missed()
+    {
+        // Before anything was heard on this antenna, it's at least worse than the other
+        uint8_t from = valid[current] ? current : !current;
+        if (valid[from])
+            update(expected(from, lastChannel) - MISS_PENALTY);
+    }
+
+    /**
+     * @brief Choose the antenna for the next packet
+     * @param channel the channel it will be on
+     * @param receiving false if telemetry will be sent instead, which is never a probe
+     * @return the antenna to use, 0 or 1
+     */
+    uint8_t ICACHE_RAM_ATTR choose(uint8_t channel, bool receiving)
+    {
+        lastChannel = (channel < MAX_CHANNELS) ? channel : MAX_CHANNELS - 1;
+
+        // Go back after a probe, unless it found the other is better
+        if (probing)
+        {
+            probing = false;
+            current = !current;
+            sinceOther = 0;
+        }
+
+        uint8_t other = !current;
+        if (!valid[current])
+        {
+            // Nothing heard yet, stay on the antenna which is to be measured
+        }
+        else if (valid[other] &&
+            expected(other, lastChannel) > expected(current, lastChannel) + HYSTERESIS)
+        {
+            current = other;
+            sinceOther = 0;
+        }
+        else if (receiving && (++sinceOther >= PROBE_INTERVAL || !valid[other]))
+        {
+            probing = true;
+            current = other;
+            return current;
+        }
+        return current;
+    }
+
+    /**
+     * @return the RSSI expected on the channel with the antenna, in 1/FRAC dBm
+     */
+    int16_t expected(uint8_t ant, uint8_t channel) const
+    {
+        return rssi[ant] + offset[ant][channel];
+    }
+
+    uint8_t antenna() const { return current; }
+    bool isProbing() const { return probing; }
+
+private:
+    void ICACHE_RAM_ATTR update(int16_t measured)
+    {
+        uint8_t ant = current;
+        if (!valid[ant])
+        {
+            rssi[ant] = measured;
+            valid[ant] = true;
+        }
+        else
+        {
+            // The channel's offset from how the antenna is doing overall, learnt over the
+            // few visits per second, then the overall RSSI without that channel's part
+            int16_t &chOffset = offset[ant][lastChannel];
+            chOffset += (measured - rssi[ant] - chOffset) / 2;
+            rssi[ant] += (measured - chOffset - rssi[ant]) / 4;
+        }
+        // A probe which found the other antenna better stays on it
+        if (probing && valid[!ant] && expected(ant, lastChannel) > expected(!ant, lastChannel) + HYSTERESIS)
+        {
+            probing = false;
+            sinceOther = 0;
+        }
+    }
+
+    int16_t rssi[2];
+    int16_t offset[2][MAX_CHANNELS];
+    bool valid[2];
+    uint8_t current;
+    bool probing;
+    uint8_t sinceOther;
+    uint8_t lastChannel;
+};
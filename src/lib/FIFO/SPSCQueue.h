@@ -0,0 +1,89 @@
+#pragma once
+
+#include "targets.h"
+
+/**
+ * @brief A lock-free queue of fixed size items between exactly one producer and one consumer,
+ * which may be on different cores or one may be an ISR.
+ *
+ * The producer only writes head and the consumer only writes tail, so neither side ever
+ * waits for the other. Items are filled or read in place through reserve()/commit() and
+ * peek()/release(), or copied with push()/pop().
+ *
+ * @tparam T the item type
+ * @tparam N the number of items, which must be a power of two
+ */
+template <typename T, uint8_t N>
+class SPSCQueue
+{
+    static_assert((N & (N - 1)) == 0, "SPSCQueue size must be a power of two");
+
+public:
+    /**
+     * @brief Producer: the next free item to fill, or nullptr if the queue is full
+     */
+    ICACHE_RAM_ATTR T *reserve()
+    {
+        if ((uint8_t)(head - tail) == N)
+            return nullptr;
+        return &items[head & (N - 1)];
+    }
+
+    /**
+     * @brief Producer: make the item from reserve() available to the consumer
+     */
+    ICACHE_RAM_ATTR void commit()
+    {
+        // The item must be written before the consumer can see the new head
+        __sync_synchronize();
+        head = head + 1;
+    }
+
+    /**
+     * @brief Consumer: the oldest item, or nullptr if the queue is empty
+     */
+    ICACHE_RAM_ATTR T *peek()
+    {
+        if (head == tail)
+            return nullptr;
+        __sync_synchronize();
+        return &items[tail & (N - 1)];
+    }
+
+    /**
+     * @brief Consumer: free the item from peek() for the producer to use again
+     */
+    ICACHE_RAM_ATTR void release()
+    {
+        // The item must be read before the producer can overwrite it
+        __sync_synchronize();
+        tail = tail + 1;
+    }
+
+    ICACHE_RAM_ATTR bool push(const T &item)
+    {
+        T *slot = reserve();
+        if (slot == nullptr)
+            return false;
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    ICACHE_RAM_ATTR bool pop(T &item)
+    {
+        T *slot = peek();
+        if (slot == nullptr)
+            return false;
+        item = *slot;
+        release();
+        return true;
+    }
+
+    uint8_t size() const { return (uint8_t)(head - tail); }
+
+private:
+    T items[N];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+};
@@ -0,0 +1,188 @@
+#include "FPort.h"
+#include "ChannelEncoder.h"
+
+// S.Port sensor app ids, each covers the 16 ids above it for multiple sensors of a type
+#define FSSP_DATAID_ALT         0x0100  // cm
+#define FSSP_DATAID_VARIO       0x0110  // cm/s
+#define FSSP_DATAID_CURR        0x0200  // A * 10
+#define FSSP_DATAID_VFAS        0x0210  // V * 100
+#define FSSP_DATAID_T2          0x0410  // Betaflight/INAV put the satellites in the lowest two digits
+#define FSSP_DATAID_FUEL        0x0600  // %
+#define FSSP_DATAID_LATLONG     0x0800  // minutes * 10000, bit 31 set for longitude, bit 30 for negative
+#define FSSP_DATAID_GPS_ALT     0x0820  // cm
+#define FSSP_DATAID_SPEED       0x0830  // knots * 1000
+#define FSSP_DATAID_GPS_COURSE  0x0840  // degrees * 100
+
+uint8_t fportChecksum(const uint8_t *data, uint8_t len)
+{
+    uint16_t sum = 0;
+    while (len--)
+        sum += *data++;
+    while (sum > 0xFF)
+        sum = (sum & 0xFF) + (sum >> 8);
+    return 0xFF - sum;
+}
+
+// Frame the unstuffed len..crc bytes with markers, escaping any which clash with them
+static uint8_t writeFrame(const uint8_t *frame, uint8_t len, uint8_t *out)
+{
+    uint8_t *p = out;
+    *p++ = FPORT_FRAME_MARKER;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (frame[i] == FPORT_FRAME_MARKER || frame[i] == FPORT_ESCAPE_CHAR)
+        {
+            *p++ = FPORT_ESCAPE_CHAR;
+            *p++ = frame[i] ^ FPORT_ESCAPE_MASK;
+        }
+        else
+        {
+            *p++ = frame[i];
+        }
+    }
+    *p++ = FPORT_FRAME_MARKER;
+    return p - out;
+}
+
+FPort::FPort(SensorTelemetry &sensors)
+    : m_tlm(sensors), m_downlinkSent(0), m_awaitingUplink(false), m_uplinkLen(0), m_escape(false),
+      m_uplinkFrames(0), m_checksumErrors(0), m_lateFrames(0)
+{
+}
+
+uint8_t FPort::encodeRCFrame(const uint32_t *channelData, uint8_t flags, uint8_t rssi, uint32_t now, uint8_t *out)
+{
+    // Control frame, the channels are packed as SBUS
+    uint8_t control[FPORT_CONTROL_LEN + 2];
+    control[0] = FPORT_CONTROL_LEN;
+    control[1] = FPORT_TYPE_CONTROL;
+    uint8_t len = 2 + rcEncodeChannels(rcEncoderSBUS, channelData, &control[2]);
+    control[len++] = flags;
+    control[len++] = rssi;
+    control[len] = fportChecksum(control, len);
+    uint8_t outLen = writeFrame(control, len + 1, out);
+
+    // Downlink request, giving the FC the rest of the frame to answer with a sensor value
+    uint8_t downlink[FPORT_DOWNLINK_LEN + 2] = {FPORT_DOWNLINK_LEN, FPORT_TYPE_DOWNLINK, FPORT_PRIM_NULL};
+    downlink[FPORT_DOWNLINK_LEN + 1] = fportChecksum(downlink, FPORT_DOWNLINK_LEN + 1);
+    outLen += writeFrame(downlink, sizeof(downlink), &out[outLen]);
+
+    m_downlinkSent = now;
+    m_awaitingUplink = true;
+    m_uplinkLen = 0;
+    m_escape = false;
+    return outLen;
+}
+
+void FPort::processBytes(const uint8_t *data, uint16_t size, uint32_t now)
+{
+    while (size--)
+    {
+        uint8_t b = *data++;
+        if (b == FPORT_FRAME_MARKER)
+        {
+            // Betaflight doesn't frame its responses, but others may
+            m_uplinkLen = 0;
+            m_escape = false;
+            continue;
+        }
+        if (b == FPORT_ESCAPE_CHAR)
+        {
+            m_escape = true;
+            continue;
+        }
+        if (m_escape)
+        {
+            b ^= FPORT_ESCAPE_MASK;
+            m_escape = false;
+        }
+
+        // Resync on the length and type of an uplink frame
+        if ((m_uplinkLen == 0 && b != FPORT_DOWNLINK_LEN) || (m_uplinkLen == 1 && b != FPORT_TYPE_UPLINK))
+        {
+            m_uplinkLen = 0;
+            if (b != FPORT_DOWNLINK_LEN)
+                continue;
+        }
+        m_uplink[m_uplinkLen++] = b;
+        if (m_uplinkLen == sizeof(m_uplink))
+        {
+            processUplink(now);
+            m_uplinkLen = 0;
+        }
+    }
+}
+
+void FPort::processUplink(uint32_t now)
+{
+    if (fportChecksum(m_uplink, FPORT_DOWNLINK_LEN + 1) != m_uplink[FPORT_DOWNLINK_LEN + 1])
+    {
+        ++m_checksumErrors;
+        return;
+    }
+    // Anything after the slot has closed collided with the next control frame
+    if (!m_awaitingUplink || now - m_downlinkSent > FPORT_UPLINK_TIMEOUT_MS)
+    {
+        ++m_lateFrames;
+        return;
+    }
+    m_awaitingUplink = false;
+    ++m_uplinkFrames;
+
+    if (m_uplink[2] != FPORT_PRIM_DATA)
+        return;
+    const uint16_t appId = m_uplink[3] | (m_uplink[4] << 8);
+    const uint32_t value = m_uplink[5] | (m_uplink[6] << 8) | (m_uplink[7] << 16) | ((uint32_t)m_uplink[8] << 24);
+    processSensor(appId, value);
+}
+
+void FPort::processSensor(uint16_t appId, uint32_t value)
+{
+    switch (appId & 0xFFF0)
+    {
+    case FSSP_DATAID_ALT:
+        m_tlm.setAltitude((int32_t)value);
+        break;
+    case FSSP_DATAID_VARIO:
+    {
+        const int32_t vspd = (int32_t)value;
+        m_tlm.setVerticalSpeed(vspd > INT16_MAX ? INT16_MAX : vspd < INT16_MIN ? INT16_MIN : vspd);
+        break;
+    }
+    case FSSP_DATAID_CURR:
+        m_tlm.setBatteryCurrent(value);
+        break;
+    case FSSP_DATAID_VFAS:
+        m_tlm.setBatteryVoltage(value / 10);
+        break;
+    case FSSP_DATAID_T2:
+        m_tlm.setGpsSatellites(value % 100);
+        break;
+    case FSSP_DATAID_FUEL:
+        m_tlm.setBatteryRemaining(value > 100 ? 100 : value);
+        break;
+    case FSSP_DATAID_LATLONG:
+    {
+        // minutes * 10000 to degrees * 1E7
+        int32_t degE7 = (int32_t)(((uint64_t)(value & 0x3FFFFFFF) * 50) / 3);
+        if (value & (1 << 30))
+            degE7 = -degE7;
+        if (value & (1U << 31))
+            m_tlm.setGpsLongitude(degE7);
+        else
+            m_tlm.setGpsLatitude(degE7);
+        break;
+    }
+    case FSSP_DATAID_GPS_ALT:
+        m_tlm.setGpsAltitude((int32_t)value / 100);
+        break;
+    case FSSP_DATAID_SPEED:
+        m_tlm.setGpsGroundSpeed((uint64_t)value * 1852 / 100000);  // knots * 1000 to km/h * 10
+        break;
+    case FSSP_DATAID_GPS_COURSE:
+        m_tlm.setGpsHeading(value);
+        break;
+    default:
+        break;
+    }
+}
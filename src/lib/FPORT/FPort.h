@@ -0,0 +1,73 @@
+#pragma once
+
+#include "targets.h"
+#include "SensorTelemetry.h"
+
+#define FPORT_FRAME_MARKER      0x7E
+#define FPORT_ESCAPE_CHAR       0x7D
+#define FPORT_ESCAPE_MASK       0x20
+
+#define FPORT_CONTROL_LEN       0x19    // type, 22 bytes of channels, flags, rssi
+#define FPORT_DOWNLINK_LEN      0x08    // type, prim, app id, data
+#define FPORT_TYPE_CONTROL      0x00
+#define FPORT_TYPE_DOWNLINK     0x01    // telemetry poll from the receiver
+#define FPORT_TYPE_UPLINK       0x81    // telemetry response from the FC
+#define FPORT_PRIM_NULL         0x00
+#define FPORT_PRIM_DATA         0x10
+
+#define FPORT_FLAG_FRAME_LOST   (1 << 2)
+#define FPORT_FLAG_FAILSAFE     (1 << 3)
+
+// Longest frame on the wire, a control frame with every byte stuffed
+#define FPORT_MAX_FRAME_LEN     (2 + 2 * (FPORT_CONTROL_LEN + 2))
+// The FC must answer a downlink request within this time or the slot is given up
+#define FPORT_UPLINK_TIMEOUT_MS 4
+
+/**
+ * @brief The FPort checksum, 0xFF minus the sum of the bytes with the carries added back in
+ */
+uint8_t fportChecksum(const uint8_t *data, uint8_t len);
+
+/**
+ * FrSky FPort, SBUS channels and S.Port telemetry on one half duplex line.
+ *
+ * Each RC frame is a control frame followed by a downlink request, which the FC may
+ * answer with one S.Port sensor value before the next RC frame. Sensor values are passed
+ * on to SensorTelemetry, which turns them into CRSF telemetry for the TX.
+ */
+class FPort
+{
+public:
+    explicit FPort(SensorTelemetry &sensors);
+
+    /**
+     * @brief Build the control frame and the downlink request that follows it
+     * @param flags FPORT_FLAG_*
+     * @param rssi 0-100
+     * @return the number of bytes written to out, which must hold 2 * FPORT_MAX_FRAME_LEN bytes
+     */
+    uint8_t encodeRCFrame(const uint32_t *channelData, uint8_t flags, uint8_t rssi, uint32_t now, uint8_t *out);
+
+    // Uplink frames from the FC
+    void processBytes(const uint8_t *data, uint16_t size, uint32_t now);
+
+    uint32_t getUplinkFrames() const { return m_uplinkFrames; }
+    uint32_t getChecksumErrors() const { return m_checksumErrors; }
+    uint32_t getLateFrames() const { return m_lateFrames; }
+
+private:
+    void processUplink(uint32_t now);
+    void processSensor(uint16_t appId, uint32_t data);
+
+    SensorTelemetry &m_tlm;
+    uint32_t m_downlinkSent;
+    bool m_awaitingUplink;
+
+    uint8_t m_uplink[FPORT_DOWNLINK_LEN + 2];
+    uint8_t m_uplinkLen;
+    bool m_escape;
+
+    uint32_t m_uplinkFrames;
+    uint32_t m_checksumErrors;
+    uint32_t m_lateFrames;
+};
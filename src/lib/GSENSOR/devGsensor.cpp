@@ -82,7 +82,8 @@ device_t Gsensor_device = {
     .initialize = initialize,
     .start = start,
     .event = NULL,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "Gsensor",
 };
 
 #endif
@@ -9,7 +9,13 @@ GENERIC_CRC8 crsf_crc(CRSF_CRC_POLY);
 uint8_t CRSF::MspData[ELRS_MSP_BUFFER] = {0};
 uint8_t CRSF::MspDataLength = 0;
 
+// Queue of MSP messages waiting for MspData, sized to let the handset pipeline
+// several configurator requests while the previous one is in flight
+#if defined(PLATFORM_ESP32)
+static const auto MSP_SERIAL_OUT_FIFO_SIZE = 1024U;
+#else
 static const auto MSP_SERIAL_OUT_FIFO_SIZE = 256U;
+#endif
 static FIFO<MSP_SERIAL_OUT_FIFO_SIZE> MspWriteFIFO;
 
 
@@ -49,7 +49,6 @@ bool CRSFHandset::halfDuplex = false;
 
 /// OpenTX mixer sync ///
 static const int32_t OpenTXsyncPacketInterval = 200; // in ms
-static const int32_t OpenTXsyncOffsetSafeMargin = 1000; // 100us
 
 /// UART Handling ///
 static const int32_t TxToHandsetBauds[] = {400000, 115200, 5250000, 3750000, 1870000, 921600, 2250000};
@@ -215,9 +214,7 @@ void CRSFHandset::sendTelemetryToTX(uint8_t *data)
 void ICACHE_RAM_ATTR CRSFHandset::setPacketInterval(int32_t PacketInterval)
 {
     RequestedRCpacketInterval = PacketInterval;
-    OpenTXsyncOffset = 0;
-    OpenTXsyncWindow = 0;
-    OpenTXsyncWindowSize = std::max((int32_t)1, (int32_t)(20000/RequestedRCpacketInterval));
+    OpenTXsync.setPacketInterval(PacketInterval);
     OpenTXsyncLastSent -= OpenTXsyncPacketInterval;
     adjustMaxPacketSize();
 }
@@ -227,25 +224,15 @@ void ICACHE_RAM_ATTR CRSFHandset::JustSentRFpacket()
     // read them in this order to prevent a potential race condition
     uint32_t last = dataLastRecv;
     uint32_t m = micros();
-    auto delta = (int32_t)(m - last);
 
-    if (delta >= (int32_t)RequestedRCpacketInterval)
+    if (!OpenTXsync.rfPacketSent(last, m))
     {
-        // missing/late packet, force resync
-        OpenTXsyncOffset = -(delta % RequestedRCpacketInterval) * 10;
-        OpenTXsyncWindow = 0;
+        // missing/late packet, send the resync as soon as possible
         OpenTXsyncLastSent -= OpenTXsyncPacketInterval;
 #ifdef DEBUG_OPENTX_SYNC
-        DBGLN("Missed packet, forced resync (%d)!", delta);
+        DBGLN("Missed packet, forced resync (%d)!", (int32_t)(m - last));
 #endif
     }
-    else
-    {
-        // The number of packets in the sync window is how many will fit in 20ms.
-        // This gives quite quite coarse changes for 50Hz, but more fine grained changes at 1000Hz.
-        OpenTXsyncWindow = std::min(OpenTXsyncWindow + 1, (int32_t)OpenTXsyncWindowSize);
-        OpenTXsyncOffset = ((OpenTXsyncOffset * (OpenTXsyncWindow-1)) + delta * 10) / OpenTXsyncWindow;
-    }
 }
 
 void CRSFHandset::sendSyncPacketToTX() // in values in us.
@@ -254,9 +241,10 @@ void CRSFHandset::sendSyncPacketToTX() // in values in us.
     if (controllerConnected && (now - OpenTXsyncLastSent) >= OpenTXsyncPacketInterval)
     {
         int32_t packetRate = RequestedRCpacketInterval * 10; //convert from us to right format
-        int32_t offset = OpenTXsyncOffset - OpenTXsyncOffsetSafeMargin; // offset so that opentx always has some headroom
+        int32_t offset = OpenTXsync.getOffset(); // includes a jitter based margin so that opentx always has some headroom
 #ifdef DEBUG_OPENTX_SYNC
-        DBGLN("Offset %d", offset); // in 10ths of us (OpenTX sync unit)
+        DBGLN("Offset %d period %d margin %d jitter p50 %u p99 %u", offset, OpenTXsync.getHandsetPeriod(), OpenTXsync.getMargin(),
+            OpenTXsync.getJitterPercentile(50), OpenTXsync.getJitterPercentile(99)); // offset in 10ths of us (OpenTX sync unit)
 #endif
 
         struct otxSyncData {
@@ -376,6 +364,7 @@ bool CRSFHandset::ProcessPacket()
     if (packetType == CRSF_FRAMETYPE_RC_CHANNELS_PACKED)
     {
         RCdataLastRecv = micros();
+        OpenTXsync.handsetPacketReceived(RCdataLastRecv);
         RcPacketToChannelsData();
         packetReceived = true;
     }
@@ -7,6 +7,7 @@
 #include "HardwareSerial.h"
 #endif
 #include "common.h"
+#include "HandsetSync.h"
 
 #ifdef PLATFORM_ESP32
 #include "driver/uart.h"
@@ -55,9 +56,7 @@ private:
 
     /// OpenTX mixer sync ///
     volatile uint32_t dataLastRecv = 0;
-    volatile int32_t OpenTXsyncOffset = 0;
-    volatile int32_t OpenTXsyncWindow = 0;
-    volatile int32_t OpenTXsyncWindowSize = 0;
+    HandsetSync OpenTXsync;
     uint32_t OpenTXsyncLastSent = 0;
 
     /// UART Handling ///
@@ -0,0 +1,137 @@
+#include "HandsetSync.h"
+#include "targets.h"
+
+void ICACHE_RAM_ATTR HandsetSync::setPacketInterval(int32_t intervalUs)
+{
+    interval = intervalUs > 0 ? intervalUs : 1;
+    locked = false;
+    phase = 0;
+    drift = 0;
+    handsetPeriod = 0;
+    resyncCount = 0;
+    resetStatistics();
+}
+
+void ICACHE_RAM_ATTR HandsetSync::resetStatistics()
+{
+    for (unsigned i = 0; i < JITTER_BUCKETS; i++)
+    {
+        jitterHistogram[i] = 0;
+    }
+    jitterTotal = 0;
+    jitterSamples = 0;
+}
+
+void HandsetSync::handsetPacketReceived(uint32_t timeUs)
+{
+    const auto delta = (int32_t)(timeUs - lastHandsetRecv);
+    lastHandsetRecv = timeUs;
+
+    // Ignore gaps (dropped frames, handset paused) so they do not pull the period estimate
+    if (delta <= 0 || delta >= 2 * interval)
+        return;
+
+    if (handsetPeriod == 0)
+    {
+        handsetPeriod = delta << FP_SHIFT;
+    }
+    else
+    {
+        handsetPeriod += ((delta << FP_SHIFT) - handsetPeriod) >> HANDSET_PERIOD_SHIFT;
+    }
+}
+
+bool ICACHE_RAM_ATTR HandsetSync::rfPacketSent(uint32_t lastRecvUs, uint32_t nowUs)
+{
+    const uint32_t elapsed = nowUs - lastRecvUs;
+    const auto delta = (int32_t)elapsed;
+
+    if (elapsed >= (uint32_t)interval)
+    {
+        // missing/late packet, force resync
+        phase = -(int32_t)((elapsed % interval) << FP_SHIFT);
+        drift = 0;
+        locked = false;
+        ++resyncCount;
+        return false;
+    }
+
+    if (!locked)
+    {
+        phase = delta << FP_SHIFT;
+        drift = 0;
+        locked = true;
+        return true;
+    }
+
+    // Alpha-beta filter, predict the phase for this packet from the last estimate and drift
+    const int32_t predicted = phase + drift;
+    const int32_t residual = (delta << FP_SHIFT) - predicted;
+    phase = predicted + (residual >> ALPHA_SHIFT);
+    drift += residual >> BETA_SHIFT;
+
+    addJitterSample(residual >> FP_SHIFT);
+    return true;
+}
+
+void ICACHE_RAM_ATTR HandsetSync::addJitterSample(int32_t residualUs)
+{
+    uint32_t bucket = (residualUs < 0 ? -residualUs : residualUs) / JITTER_BUCKET_US;
+    if (bucket >= JITTER_BUCKETS)
+        bucket = JITTER_BUCKETS - 1;
+
+    // Exponential forgetting so the percentiles follow changes in the handset behaviour
+    if (jitterTotal >= JITTER_DECAY_TOTAL)
+    {
+        jitterTotal = 0;
+        for (unsigned i = 0; i < JITTER_BUCKETS; i++)
+        {
+            jitterHistogram[i] >>= 1;
+            jitterTotal += jitterHistogram[i];
+        }
+    }
+
+    ++jitterHistogram[bucket];
+    ++jitterTotal;
+    ++jitterSamples;
+}
+
+uint32_t HandsetSync::getJitterPercentile(uint8_t percent) const
+{
+    if (jitterTotal == 0)
+        return 0;
+
+    const uint32_t target = ((uint32_t)jitterTotal * percent + 99) / 100;
+    uint32_t count = 0;
+    for (unsigned i = 0; i < JITTER_BUCKETS; i++)
+    {
+        count += jitterHistogram[i];
+        if (count >= target && count > 0)
+            return (i + 1) * JITTER_BUCKET_US;
+    }
+    return JITTER_BUCKETS * JITTER_BUCKET_US;
+}
+
+int32_t HandsetSync::getMargin() const
+{
+    if (jitterSamples < MIN_SAMPLES_FOR_ADAPTIVE_MARGIN)
+        return DEFAULT_MARGIN_US;
+
+    int32_t margin = (int32_t)getJitterPercentile(99) + MARGIN_GUARD_US;
+    if (margin < MIN_MARGIN_US)
+        margin = MIN_MARGIN_US;
+    if (margin > interval / 2)
+        margin = interval / 2;
+    return margin;
+}
+
+int32_t HandsetSync::getOffset() const
+{
+    // Take one copy of the estimate, rfPacketSent() may update it from the ISR while this runs
+    const bool isLocked = locked;
+    const int32_t curPhase = phase;
+    const int32_t curDrift = drift;
+    // Advertise where the phase will be at the next RF packet, so the handset corrects for drift
+    const int32_t nextPhase = isLocked ? (curPhase + curDrift) : curPhase;
+    return ((nextPhase * 10) >> FP_SHIFT) - getMargin() * 10;
+}
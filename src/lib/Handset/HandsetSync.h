@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Estimator for synchronising the handset mixer to the OTA packet timing.
+ *
+ * Each time an RF packet is sent, the age of the newest handset RC packet (the "phase") is measured.
+ * An alpha-beta filter tracks both the phase and its drift per packet, the drift being caused by the
+ * difference between the handset and the TX module clocks. The predicted phase at the next RF packet,
+ * minus a safety margin, is advertised to the handset as the OpenTX sync offset which the handset
+ * then drives towards zero by adjusting its mixer period.
+ *
+ * The safety margin adapts to the measured jitter: the 99th percentile of the filter residual
+ * plus a small guard. A clean UART link therefore converges on much fresher channel data than a
+ * fixed margin allows, while a jittery one backs off to avoid sending stale (missed) frames.
+ *
+ * All times are in microseconds. The class has no platform dependencies so it can be driven
+ * with synthetic timestamp streams in unit tests.
+ */
+class HandsetSync
+{
+public:
+    static constexpr unsigned JITTER_BUCKET_US = 4;
+    static constexpr unsigned JITTER_BUCKETS = 64;
+    static constexpr int32_t DEFAULT_MARGIN_US = 100;
+    static constexpr int32_t MIN_MARGIN_US = 30;
+    static constexpr int32_t MARGIN_GUARD_US = 20;
+    static constexpr unsigned MIN_SAMPLES_FOR_ADAPTIVE_MARGIN = 64;
+
+    /**
+     * @brief Reset the estimator for a new expected packet interval
+     * @param intervalUs the OTA packet interval, in microseconds
+     */
+    void setPacketInterval(int32_t intervalUs);
+
+    /**
+     * @brief Record the arrival of an RC packet from the handset, used to track the handset period
+     * @param timeUs the micros() time the packet was received
+     */
+    void handsetPacketReceived(uint32_t timeUs);
+
+    /**
+     * @brief Update the phase estimate when an RF packet has just been sent
+     * @param lastRecvUs the micros() time the newest handset packet was received
+     * @param nowUs the current micros() time
+     * @return false if the handset packet was missing or late and the estimator was forced to resync
+     */
+    bool rfPacketSent(uint32_t lastRecvUs, uint32_t nowUs);
+
+    /**
+     * @return the offset to advertise to the handset, in 1/10ths of a microsecond (OpenTX sync units)
+     */
+    int32_t getOffset() const;
+
+    /**
+     * @return the filtered age of the handset data at the time the RF packet is sent, in microseconds
+     */
+    int32_t getPhase() const { return phase >> FP_SHIFT; }
+
+    /**
+     * @return the measured handset packet period in microseconds, or 0 if not known yet
+     */
+    int32_t getHandsetPeriod() const { return handsetPeriod >> FP_SHIFT; }
+
+    /**
+     * @return the safety margin currently subtracted from the phase, in microseconds
+     */
+    int32_t getMargin() const;
+
+    /**
+     * @param percent the percentile to report (0-100)
+     * @return the upper bound of the absolute phase jitter for the requested percentile, in microseconds
+     */
+    uint32_t getJitterPercentile(uint8_t percent) const;
+
+    /**
+     * @return the number of forced resyncs since the last setPacketInterval()
+     */
+    uint32_t getResyncCount() const { return resyncCount; }
+
+    void resetStatistics();
+
+private:
+    static constexpr unsigned FP_SHIFT = 8;
+    static constexpr unsigned ALPHA_SHIFT = 3; // alpha = 1/8
+    static constexpr unsigned BETA_SHIFT = 7;  // beta = 1/128, critically damped for this alpha
+    static constexpr unsigned HANDSET_PERIOD_SHIFT = 4;
+    static constexpr uint16_t JITTER_DECAY_TOTAL = 4096;
+
+    int32_t interval = 5000;
+    // Written in the ISR by rfPacketSent(), copy them once when reading from the loop
+    volatile bool locked = false;
+    volatile int32_t phase = 0;  // fixed point
+    volatile int32_t drift = 0;  // fixed point, change in phase per RF packet
+
+    uint32_t lastHandsetRecv = 0;
+    int32_t handsetPeriod = 0; // fixed point
+
+    uint16_t jitterHistogram[JITTER_BUCKETS] = {};
+    uint16_t jitterTotal = 0;
+    uint32_t jitterSamples = 0;
+    uint32_t resyncCount = 0;
+
+    void addJitterSample(int32_t residualUs);
+};
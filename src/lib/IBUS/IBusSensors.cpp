@@ -0,0 +1,160 @@
+#include "IBusSensors.h"
+
+uint16_t ibusChecksum(const uint8_t *data, uint8_t len)
+{
+    uint16_t sum = 0xFFFF;
+    while (len--)
+        sum -= *data++;
+    return sum;
+}
+
+IBusSensorMaster::IBusSensorMaster(SensorTelemetry &sensors)
+    : m_tlm(sensors), m_sensors(), m_address(IBUS_FIRST_ADDRESS), m_discoveryPass(0), m_polls(0), m_hasCourse(false),
+      m_responseLen(0), m_responses(0), m_checksumErrors(0)
+{
+}
+
+uint8_t IBusSensorMaster::nextCommand(uint8_t *out)
+{
+    if (++m_polls >= IBUS_REDISCOVER_POLLS)
+    {
+        // Look for sensors which weren't there at startup, e.g. GPS enabled after boot
+        m_polls = 0;
+        m_discoveryPass = 0;
+    }
+
+    for (uint8_t i = IBUS_FIRST_ADDRESS; i <= IBUS_MAX_ADDRESS; i++)
+    {
+        const uint8_t address = m_address;
+        if (++m_address > IBUS_MAX_ADDRESS)
+        {
+            m_address = IBUS_FIRST_ADDRESS;
+            if (m_discoveryPass < IBUS_DISCOVERY_PASSES)
+                ++m_discoveryPass;
+        }
+
+        const sensor_t &sensor = m_sensors[address];
+        uint8_t cmd;
+        if (sensor.present && sensor.size == 0)
+            cmd = IBUS_CMD_TYPE;
+        else if (sensor.present)
+            cmd = IBUS_CMD_MEASURE;
+        else if (m_discoveryPass < IBUS_DISCOVERY_PASSES)
+            cmd = IBUS_CMD_DISCOVER;
+        else
+            continue;
+
+        out[0] = IBUS_CMD_LEN;
+        out[1] = cmd | address;
+        const uint16_t checksum = ibusChecksum(out, 2);
+        out[2] = checksum;
+        out[3] = checksum >> 8;
+        return IBUS_CMD_LEN;
+    }
+    return 0;
+}
+
+void IBusSensorMaster::processBytes(const uint8_t *data, uint16_t size)
+{
+    while (size--)
+    {
+        const uint8_t b = *data++;
+        // Every frame starts with its length, anything else is out of sync
+        if (m_responseLen == 0 && (b < IBUS_CMD_LEN || b > IBUS_MAX_RESPONSE_LEN))
+            continue;
+        m_response[m_responseLen++] = b;
+        if (m_responseLen == m_response[0])
+        {
+            processResponse();
+            m_responseLen = 0;
+        }
+    }
+}
+
+void IBusSensorMaster::processResponse()
+{
+    const uint8_t len = m_response[0];
+    const uint16_t checksum = m_response[len - 2] | (m_response[len - 1] << 8);
+    if (checksum != ibusChecksum(m_response, len - 2))
+    {
+        ++m_checksumErrors;
+        return;
+    }
+
+    const uint8_t address = m_response[1] & 0x0F;
+    if (address < IBUS_FIRST_ADDRESS)
+        return;
+    sensor_t &sensor = m_sensors[address];
+    ++m_responses;
+
+    switch (m_response[1] & 0xF0)
+    {
+    case IBUS_CMD_DISCOVER:
+        sensor.present = true;
+        break;
+    case IBUS_CMD_TYPE:
+        if (len == 6)
+        {
+            sensor.present = true;
+            sensor.type = m_response[2];
+            sensor.size = m_response[3];
+        }
+        break;
+    case IBUS_CMD_MEASURE:
+        if (sensor.size == 2 && len == 6)
+            processMeasurement(sensor, m_response[2] | (m_response[3] << 8));
+        else if (sensor.size == 4 && len == 8)
+            processMeasurement(sensor, m_response[2] | (m_response[3] << 8) | (m_response[4] << 16) | ((uint32_t)m_response[5] << 24));
+        break;
+    default:
+        break;
+    }
+}
+
+void IBusSensorMaster::processMeasurement(const sensor_t &sensor, int32_t value)
+{
+    switch (sensor.type)
+    {
+    case IBUS_SENSOR_TYPE_EXTERNAL_VOLTAGE:
+        m_tlm.setBatteryVoltage(value / 10);
+        break;
+    case IBUS_SENSOR_TYPE_BAT_CURR:
+        m_tlm.setBatteryCurrent(value / 10);
+        break;
+    case IBUS_SENSOR_TYPE_FUEL:
+        m_tlm.setBatteryRemaining(value > 100 ? 100 : value);
+        break;
+    case IBUS_SENSOR_TYPE_CMP_HEAD:
+        // Course over ground is what CRSF expects, the compass is only used without it
+        if (!m_hasCourse)
+            m_tlm.setGpsHeading(value * 100);
+        break;
+    case IBUS_SENSOR_TYPE_COG:
+        m_hasCourse = true;
+        m_tlm.setGpsHeading(value);
+        break;
+    case IBUS_SENSOR_TYPE_CLIMB_RATE:
+        m_tlm.setVerticalSpeed((int16_t)value);
+        break;
+    case IBUS_SENSOR_TYPE_GPS_STATUS:
+        m_tlm.setGpsSatellites(value >> 8);
+        break;
+    case IBUS_SENSOR_TYPE_GROUND_SPEED:
+        m_tlm.setGpsGroundSpeed(value * 36 / 100);  // cm/s to km/h * 10
+        break;
+    case IBUS_SENSOR_TYPE_GPS_LAT:
+        m_tlm.setGpsLatitude(value);
+        break;
+    case IBUS_SENSOR_TYPE_GPS_LON:
+        m_tlm.setGpsLongitude(value);
+        break;
+    case IBUS_SENSOR_TYPE_GPS_ALT:
+        m_tlm.setGpsAltitude(value / 100);
+        break;
+    case IBUS_SENSOR_TYPE_ALT:
+        m_tlm.setAltitude(value);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "targets.h"
+#include "SensorTelemetry.h"
+
+#define IBUS_SERVO_FRAME_LEN    32
+#define IBUS_CMD_LEN            4
+#define IBUS_MAX_RESPONSE_LEN   8
+#define IBUS_FIRST_ADDRESS      1       // address 0 is the receiver's own sensor
+#define IBUS_MAX_ADDRESS        15
+
+#define IBUS_CMD_DISCOVER       0x80
+#define IBUS_CMD_TYPE           0x90
+#define IBUS_CMD_MEASURE        0xA0
+
+#define IBUS_DISCOVERY_PASSES   3       // times every address is tried before only polling those found
+#define IBUS_REDISCOVER_POLLS   2000    // polls between looking for new sensors again
+
+typedef enum : uint8_t {
+    IBUS_SENSOR_TYPE_NONE               = 0x00,
+    IBUS_SENSOR_TYPE_EXTERNAL_VOLTAGE   = 0x03, // V * 100
+    IBUS_SENSOR_TYPE_BAT_CURR           = 0x05, // A * 100
+    IBUS_SENSOR_TYPE_FUEL               = 0x06, // %
+    IBUS_SENSOR_TYPE_CMP_HEAD           = 0x08, // degrees
+    IBUS_SENSOR_TYPE_CLIMB_RATE         = 0x09, // m/s * 100
+    IBUS_SENSOR_TYPE_COG                = 0x0a, // degrees * 100
+    IBUS_SENSOR_TYPE_GPS_STATUS         = 0x0b, // fix type, satellites
+    IBUS_SENSOR_TYPE_GROUND_SPEED       = 0x13, // m/s * 100
+    IBUS_SENSOR_TYPE_GPS_LAT            = 0x80, // degrees * 1E7
+    IBUS_SENSOR_TYPE_GPS_LON            = 0x81, // degrees * 1E7
+    IBUS_SENSOR_TYPE_GPS_ALT            = 0x82, // m * 100
+    IBUS_SENSOR_TYPE_ALT                = 0x83, // m * 100
+} ibusSensorType_e;
+
+/**
+ * @brief 0xFFFF minus the sum of the bytes, as used by every IBUS frame
+ */
+uint16_t ibusChecksum(const uint8_t *data, uint8_t len);
+
+/**
+ * The master side of the IBUS sensor bus, polling sensors emulated by the FC on the same
+ * UART as the servo frames (as the FS-A8S and friends do, which Betaflight and INAV answer
+ * when IBUS telemetry shares the serial RX port).
+ *
+ * One command is sent after each servo frame. Every address is discovered and its type
+ * read, then the sensors found are polled for measurements in turn, which are passed on
+ * to SensorTelemetry.
+ */
+class IBusSensorMaster
+{
+public:
+    explicit IBusSensorMaster(SensorTelemetry &sensors);
+
+    /**
+     * @brief Build the next command to send to the sensors
+     * @return the command length, out must hold IBUS_CMD_LEN bytes
+     */
+    uint8_t nextCommand(uint8_t *out);
+
+    // Responses from the sensors
+    void processBytes(const uint8_t *data, uint16_t size);
+
+    uint8_t getSensorType(uint8_t address) const { return m_sensors[address].type; }
+    uint32_t getResponses() const { return m_responses; }
+    uint32_t getChecksumErrors() const { return m_checksumErrors; }
+
+private:
+    typedef struct {
+        bool present;
+        uint8_t type;
+        uint8_t size;
+    } sensor_t;
+
+    void processResponse();
+    void processMeasurement(const sensor_t &sensor, int32_t value);
+
+    SensorTelemetry &m_tlm;
+    sensor_t m_sensors[IBUS_MAX_ADDRESS + 1];
+    uint8_t m_address;
+    uint8_t m_discoveryPass;
+    uint16_t m_polls;
+    bool m_hasCourse;
+
+    uint8_t m_response[IBUS_MAX_RESPONSE_LEN];
+    uint8_t m_responseLen;
+
+    uint32_t m_responses;
+    uint32_t m_checksumErrors;
+};
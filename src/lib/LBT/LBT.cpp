@@ -2,8 +2,10 @@
 #include "common.h"
 #include "logging.h"
 #include "LBT.h"
+#include "FHSS.h"
 
 LQCALC<100> LBTSuccessCalc;
+lbtStats_t LBTStats;
 static uint32_t rxStartTime;
 
 #if !defined(LBT_RSSI_THRESHOLD_OFFSET_DB)
@@ -12,6 +14,9 @@ static uint32_t rxStartTime;
 
 bool LBTEnabled = false;
 static uint32_t validRSSIdelayUs = 0;
+// Checks in a row each channel has been found in use on every radio, past LBT_BLOCKED_RUN
+// it counts the visits skipped since the last recheck
+static uint8_t channelBlockedRun[LBT_MAX_CHANNELS];
 
 static uint32_t ICACHE_RAM_ATTR SpreadingFactorToRSSIvalidDelayUs(
   SX1280_RadioLoRaSpreadingFactors_t SF,
@@ -97,6 +102,11 @@ static int8_t ICACHE_RAM_ATTR PowerEnumToLBTLimit(PowerLevels_e txPower, uint8_t
   }
 }
 
+void LBTResetStats()
+{
+  memset(&LBTStats, 0, sizeof(LBTStats));
+}
+
 void ICACHE_RAM_ATTR SetClearChannelAssessmentTime(void)
 {
   if (!LBTEnabled)
@@ -123,23 +133,45 @@ SX12XX_Radio_Number_t ICACHE_RAM_ATTR ChannelIsClear(SX12XX_Radio_Number_t radio
     return SX12XX_Radio_All;
   }
 
+  // A channel which keeps being found in use, e.g. next to a WiFi network, is taken as in use
+  // without listening, only listening every LBT_BLOCKED_RECHECK visits to see if it has cleared.
+  // Not sending is always allowed, and it saves the RSSI wait on the channels least likely to
+  // be usable. These count as blocked in LBTSuccessCalc and the per-channel stats.
+  const uint8_t channel = FHSSsequence[FHSSgetCurrIndex()];
+  uint8_t *blockedRun = (channel < LBT_MAX_CHANNELS) ? &channelBlockedRun[channel] : nullptr;
+  if (blockedRun && *blockedRun >= LBT_BLOCKED_RUN && *blockedRun < LBT_BLOCKED_RUN + LBT_BLOCKED_RECHECK - 1)
+  {
+    (*blockedRun)++;
+    LBTStats.skips++;
+    if (LBTStats.channelChecks[channel] < UINT16_MAX)
+    {
+      LBTStats.channelChecks[channel]++;
+      LBTStats.channelBlocked[channel]++;
+    }
+    return SX12XX_Radio_NONE;
+  }
+
   // Read rssi after waiting the minimum RSSI valid delay.
   // If this function is called long enough after RX enable,
-  // this will always be ok on first try as is the case for TX.
-
-  // TODO: Better way than busypolling this for RX?
-  // this loop should only run for RX, where listen before talk RX is started right after FHSS hop
-  // so there is no dead-time to run RX before telemetry TX is supposed to happen.
-  // if flipping the logic, so telemetry TX happens right before FHSS hop, then TX-side ends up with polling here instead?
-  // Maybe it could be skipped if there was only TX of telemetry happening when FHSShop does not happen.
-  // Then RX for LBT could stay enabled from last received packet, and RSSI would be valid instantly.
-  // But for now, FHSShops and telemetry rates does not divide evenly, so telemetry will some times happen
-  // right after FHSS and we need wait here.
-
+  // this will always be ok on first try as is the case for TX,
+  // and for RX telemetry when there was no FHSS hop since the last RX start.
+
+  // The RX only waits here when the telemetry slot follows an FHSS hop. The hop is done
+  // when the last packet is received, about PACKET_TO_TOCK_SLACK before the telemetry is
+  // sent, which covers the RSSI valid delay of the fastest modes. The slower modes, or a
+  // missed packet which leaves the hop to the Tock, wait for the rest. The new channel
+  // can't be listened to any earlier as the radio is receiving the packet before the hop.
+  // LBTStats counts the waits so their cost can be seen per mode.
+  LBTStats.checks++;
   uint32_t elapsed = micros() - rxStartTime;
   if(elapsed < validRSSIdelayUs)
   {
-    delayMicroseconds(validRSSIdelayUs - elapsed);
+    const uint32_t wait = validRSSIdelayUs - elapsed;
+    delayMicroseconds(wait);
+    LBTStats.waits++;
+    LBTStats.waitMicros += wait;
+    if (wait > LBTStats.maxWaitMicros)
+      LBTStats.maxWaitMicros = wait;
   }
 
   int8_t rssiInst1 = 0;
@@ -173,6 +205,22 @@ SX12XX_Radio_Number_t ICACHE_RAM_ATTR ChannelIsClear(SX12XX_Radio_Number_t radio
     LBTSuccessCalc.add(); // Add success only when actually preparing for TX
   }
 
+  // Which channels are busy, for finding a neighbour which keeps blocking the link
+  if (blockedRun)
+  {
+    // Still in use after a recheck starts the skipping again
+    if (clearChannelsMask == SX12XX_Radio_NONE)
+      *blockedRun = (*blockedRun < LBT_BLOCKED_RUN) ? *blockedRun + 1 : LBT_BLOCKED_RUN;
+    else
+      *blockedRun = 0;
+    if (LBTStats.channelChecks[channel] < UINT16_MAX)
+    {
+      LBTStats.channelChecks[channel]++;
+      if (clearChannelsMask != radioNumber)
+        LBTStats.channelBlocked[channel]++;
+    }
+  }
+
   return clearChannelsMask;
 }
 #endif
@@ -8,6 +8,26 @@
 extern LQCALC<100> LBTSuccessCalc;
 extern bool LBTEnabled;
 
+// Enough for the 80 channels of the 2.4GHz ISM band
+#define LBT_MAX_CHANNELS 80
+// Checks in a row a channel must be in use before it is taken as in use without listening
+#define LBT_BLOCKED_RUN 8
+// Such a channel is still listened to once in this many visits
+#define LBT_BLOCKED_RECHECK 4
+
+typedef struct {
+    uint32_t checks;
+    uint32_t waits;          // checks which had to wait for the RSSI to become valid
+    uint32_t waitMicros;
+    uint16_t maxWaitMicros;
+    uint32_t skips;          // visits to a channel taken as in use without a check
+    uint16_t channelChecks[LBT_MAX_CHANNELS];
+    uint16_t channelBlocked[LBT_MAX_CHANNELS];
+} lbtStats_t;
+
+extern lbtStats_t LBTStats;
+void LBTResetStats();
+
 void ICACHE_RAM_ATTR SetClearChannelAssessmentTime(void);
 SX12XX_Radio_Number_t ICACHE_RAM_ATTR ChannelIsClear(SX12XX_Radio_Number_t radioNumber);
 #endif
@@ -314,7 +314,8 @@ device_t LED_device = {
     .initialize = initialize,
     .start = event,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "LED",
 };
 
 #endif
\ No newline at end of file
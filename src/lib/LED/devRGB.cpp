@@ -508,7 +508,8 @@ device_t RGB_device = {
     .initialize = initialize,
     .start = start,
     .event = timeout,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "RGB",
 };
 
 #endif
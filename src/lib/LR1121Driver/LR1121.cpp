@@ -60,6 +60,7 @@ bool LR1121Driver::Begin(uint32_t minimumFrequency, uint32_t maximumFrequency)
     hal.IsrCallback_2 = &LR1121Driver::IsrCallback_2;
 
     hal.reset();
+    shadow.invalidate(SX12XX_Radio_All);
 
     // Validate that the LR1121 is working.
     uint8_t version[5] = {0};
@@ -144,6 +145,7 @@ void LR1121Driver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t regfreq,
                           SX12XX_Radio_Number_t radioNumber)
 {
     PayloadLength = _PayloadLength;
+    txStage.clear();
     
     bool isSubGHz = regfreq < 1000000000;
 
@@ -167,8 +169,15 @@ void LR1121Driver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t regfreq,
     useFSK = setFSKModulation;
     
     // 8.1.1 SetPacketType
+    // The modulation and packet params are lost when changing packet type
     uint8_t buf[1] = {useFSK ? LR11XX_RADIO_PKT_TYPE_GFSK : LR11XX_RADIO_PKT_TYPE_LORA};
-    hal.WriteCommand(LR11XX_RADIO_SET_PKT_TYPE_OC, buf, sizeof(buf), radioNumber);
+    SX12XX_Radio_Number_t changed = shadow.changed(SHADOW_PKT_TYPE, buf, sizeof(buf), radioNumber);
+    if (changed)
+    {
+        shadow.invalidate(changed);
+        shadow.store(SHADOW_PKT_TYPE, buf, sizeof(buf), changed);
+        hal.WriteCommand(LR11XX_RADIO_SET_PKT_TYPE_OC, buf, sizeof(buf), changed);
+    }
 
     if (useFSK)
     {
@@ -224,7 +233,7 @@ void LR1121Driver::ConfigModParamsFSK(uint32_t Bitrate, uint8_t BWF, uint32_t Fd
     buf[7] = Fdev >> 16;
     buf[8] = Fdev >> 8;
     buf[9] = Fdev >> 0;
-    hal.WriteCommand(LR11XX_RADIO_SET_MODULATION_PARAM_OC, buf, sizeof(buf), radioNumber);    
+    WriteCommandShadowed(SHADOW_MODULATION_PARAM, LR11XX_RADIO_SET_MODULATION_PARAM_OC, buf, sizeof(buf), radioNumber);
 }
 
 void LR1121Driver::SetPacketParamsFSK(uint8_t PreambleLength, uint8_t PayloadLength, SX12XX_Radio_Number_t radioNumber)
@@ -240,7 +249,7 @@ void LR1121Driver::SetPacketParamsFSK(uint8_t PreambleLength, uint8_t PayloadLen
     buf[6] = PayloadLength;                                 // PayloadLen
     buf[7] = LR11XX_RADIO_GFSK_CRC_OFF;                     // CrcType - 0x01: CRC_OFF (No CRC).
     buf[8] = LR11XX_RADIO_GFSK_DC_FREE_WHITENING;           // DcFree - 0x01: SX127x/SX126x/LR11xx compatible whitening enable. 0x03: SX128x compatible whitening enable
-    hal.WriteCommand(LR11XX_RADIO_SET_PKT_PARAM_OC, buf, sizeof(buf), radioNumber);
+    WriteCommandShadowed(SHADOW_PKT_PARAM, LR11XX_RADIO_SET_PKT_PARAM_OC, buf, sizeof(buf), radioNumber);
 }
 
 void LR1121Driver::SetFSKSyncWord(uint8_t fskSyncWord1, uint8_t fskSyncWord2, SX12XX_Radio_Number_t radioNumber)
@@ -248,7 +257,7 @@ void LR1121Driver::SetFSKSyncWord(uint8_t fskSyncWord1, uint8_t fskSyncWord2, SX
     // 8.5.3 SetGfskSyncWord
     // SyncWordLen is 16 bits as set in SetPacketParamsFSK().  Fill the rest with preamble bytes.
     uint8_t synbuf[8] = {fskSyncWord1, fskSyncWord2, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55};
-    hal.WriteCommand(LR11XX_RADIO_SET_GFSK_SYNC_WORD_OC, synbuf, sizeof(synbuf), radioNumber);
+    WriteCommandShadowed(SHADOW_GFSK_SYNC_WORD, LR11XX_RADIO_SET_GFSK_SYNC_WORD_OC, synbuf, sizeof(synbuf), radioNumber);
 }
 
 void LR1121Driver::SetDioAsRfSwitch()
@@ -322,7 +331,7 @@ void LR1121Driver::CorrectRegisterForSF6(uint8_t sf, SX12XX_Radio_Number_t radio
 /***
  * @brief: Schedule an output power change after the next transmit
  ***/
-void LR1121Driver::SetOutputPower(int8_t power, bool isSubGHz)
+void ICACHE_RAM_ATTR LR1121Driver::SetOutputPower(int8_t power, bool isSubGHz)
 {
     uint8_t pwrNew;
 
@@ -432,6 +441,7 @@ void LR1121Driver::SetMode(lr11xx_RadioOperatingModes_t OPmode, SX12XX_Radio_Num
     case LR1121_MODE_SLEEP:
         // 2.1.5.1 SetSleep
         hal.WriteCommand(LR11XX_SYSTEM_SET_SLEEP_OC, buf, 5, radioNumber);
+        shadow.invalidate(radioNumber);
         break;
 
     case LR1121_MODE_STDBY_RC:
@@ -488,7 +498,7 @@ void LR1121Driver::ConfigModParamsLoRa(uint8_t bw, uint8_t sf, uint8_t cr, SX12X
     buf[1] = bw;
     buf[2] = cr;
     buf[3] = 0x00; // 0x00: LowDataRateOptimize off
-    hal.WriteCommand(LR11XX_RADIO_SET_MODULATION_PARAM_OC, buf, sizeof(buf), radioNumber);    
+    WriteCommandShadowed(SHADOW_MODULATION_PARAM, LR11XX_RADIO_SET_MODULATION_PARAM_OC, buf, sizeof(buf), radioNumber);
 
     if (radioNumber & SX12XX_Radio_1 && radio1isSubGHz)
         CorrectRegisterForSF6(sf, SX12XX_Radio_1);
@@ -511,7 +521,7 @@ void LR1121Driver::SetPacketParamsLoRa(uint8_t PreambleLength, lr11xx_RadioLoRaP
     buf[3] = PayloadLength; // PayloadLen defines the size of the payload
     buf[4] = LR11XX_RADIO_LORA_CRC_OFF;
     buf[5] = InvertIQ;
-    hal.WriteCommand(LR11XX_RADIO_SET_PKT_PARAM_OC, buf, sizeof(buf), radioNumber);
+    WriteCommandShadowed(SHADOW_PKT_PARAM, LR11XX_RADIO_SET_PKT_PARAM_OC, buf, sizeof(buf), radioNumber);
 }
 
 void ICACHE_RAM_ATTR LR1121Driver::SetFrequencyHz(uint32_t freq, SX12XX_Radio_Number_t radioNumber)
@@ -522,7 +532,7 @@ void ICACHE_RAM_ATTR LR1121Driver::SetFrequencyHz(uint32_t freq, SX12XX_Radio_Nu
     buf[1] = freq >> 16;
     buf[2] = freq >> 8;
     buf[3] = freq & 0xFF;
-    hal.WriteCommand(LR11XX_RADIO_SET_RF_FREQUENCY_OC, buf, sizeof(buf), radioNumber);
+    WriteCommandShadowed(SHADOW_RF_FREQUENCY, LR11XX_RADIO_SET_RF_FREQUENCY_OC, buf, sizeof(buf), radioNumber);
 
     currFreq = freq;
 }
@@ -532,6 +542,14 @@ void ICACHE_RAM_ATTR LR1121Driver::SetFrequencyReg(uint32_t freq, SX12XX_Radio_N
     SetFrequencyHz(freq, radioNumber);
 }
 
+// Write a configuration command only to the radios whose shadow says it would change something
+void ICACHE_RAM_ATTR LR1121Driver::WriteCommandShadowed(uint8_t slot, uint16_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    SX12XX_Radio_Number_t changed = shadow.update(slot, buffer, size, radioNumber);
+    if (changed)
+        hal.WriteCommand(opcode, buffer, size, changed);
+}
+
 // 4.1.1 SetDioIrqParams
 void LR1121Driver::SetDioIrqParams()
 {
@@ -554,14 +572,19 @@ uint32_t ICACHE_RAM_ATTR LR1121Driver::GetIrqStatus(SX12XX_Radio_Number_t radioN
     return status[2] << 24 | status[3] << 16 | status[4] << 8 | status[5];
 }
 
-void ICACHE_RAM_ATTR LR1121Driver::ClearIrqStatus(SX12XX_Radio_Number_t radioNumber)
+// With post set, don't wait for the radio to finish a command started just before, e.g. the
+// SetRx from the TX done callback
+void ICACHE_RAM_ATTR LR1121Driver::ClearIrqStatus(SX12XX_Radio_Number_t radioNumber, bool post)
 {
     uint8_t buf[4];
     buf[0] = 0xFF;
     buf[1] = 0xFF;
     buf[2] = 0xFF;
     buf[3] = 0xFF;
-    hal.WriteCommand(LR11XX_SYSTEM_CLEAR_IRQ_OC, buf, sizeof(buf), radioNumber);
+    if (post)
+        hal.PostCommand(LR11XX_SYSTEM_CLEAR_IRQ_OC, buf, sizeof(buf), radioNumber);
+    else
+        hal.WriteCommand(LR11XX_SYSTEM_CLEAR_IRQ_OC, buf, sizeof(buf), radioNumber);
 }
 
 void ICACHE_RAM_ATTR LR1121Driver::TXnbISR()
@@ -575,6 +598,25 @@ void ICACHE_RAM_ATTR LR1121Driver::TXnbISR()
 }
 
 void ICACHE_RAM_ATTR LR1121Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    txStage.load(data, size);
+    TXnbStaged(radioNumber);
+}
+
+/***
+ * @brief: Write the next packet into the TX buffer of radioNumber ahead of TXnbStaged().
+ * The TX buffer is separate from the RX buffer, so this can be done while receiving.
+ ***/
+void ICACHE_RAM_ATTR LR1121Driver::TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    txStage.stage(*this, data, size, radioNumber);
+}
+
+/***
+ * @brief: Transmit the packet from TXstage() on radioNumber, which only needs the SetTx
+ * command if it was staged on that radio
+ ***/
+void ICACHE_RAM_ATTR LR1121Driver::TXnbStaged(SX12XX_Radio_Number_t radioNumber)
 {
     transmittingRadio = radioNumber;
     
@@ -590,6 +632,7 @@ void ICACHE_RAM_ATTR LR1121Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
 
     if (radioNumber == SX12XX_Radio_NONE)
     {
+        txStage.clear();
         SetMode(fallBackMode, SX12XX_Radio_All);
         return;
     }
@@ -605,6 +648,15 @@ void ICACHE_RAM_ATTR LR1121Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
     }
 #endif
 
+    txStage.transmit(*this, radioNumber);
+
+#ifdef DEBUG_LLCC68_OTA_TIMING
+    beginTX = micros();
+#endif
+}
+
+void ICACHE_RAM_ATTR LR1121Driver::TxPrepare(SX12XX_Radio_Number_t radioNumber)
+{
     // Normal diversity mode
     if (GPIO_PIN_NSS_2 != UNDEF_PIN && radioNumber != SX12XX_Radio_All)
     {
@@ -618,7 +670,10 @@ void ICACHE_RAM_ATTR LR1121Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
             SetMode(fallBackMode, SX12XX_Radio_1);
         }
     }
+}
 
+void ICACHE_RAM_ATTR LR1121Driver::TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
     if (useFEC)
     {
         uint8_t FECBuffer[PayloadLength] = {0};
@@ -632,12 +687,11 @@ void ICACHE_RAM_ATTR LR1121Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
         // 3.7.4 WriteBuffer8
         hal.WriteCommand(LR11XX_REGMEM_WRITE_BUFFER8_OC, data, size, radioNumber);
     }
+}
 
+void ICACHE_RAM_ATTR LR1121Driver::TxStart(SX12XX_Radio_Number_t radioNumber)
+{
     SetMode(LR1121_MODE_TX, radioNumber);
-
-#ifdef DEBUG_LLCC68_OTA_TIMING
-    beginTX = micros();
-#endif
 }
 
 bool ICACHE_RAM_ATTR LR1121Driver::RXnbISR(SX12XX_Radio_Number_t radioNumber)
@@ -849,7 +903,7 @@ void ICACHE_RAM_ATTR LR1121Driver::IsrCallback(SX12XX_Radio_Number_t radioNumber
     if (irqStatus & LR1121_IRQ_TX_DONE)
     {
         instance->TXnbISR();
-        instance->ClearIrqStatus(SX12XX_Radio_All);
+        instance->ClearIrqStatus(SX12XX_Radio_All, true);
     }
     else if (irqStatus & LR1121_IRQ_RX_DONE)
     {
@@ -33,6 +33,7 @@ public:
     void SetFrequencyReg(uint32_t freq, SX12XX_Radio_Number_t radioNumber = SX12XX_Radio_All);
     void SetRxTimeoutUs(uint32_t interval);
     void SetOutputPower(int8_t power, bool isSubGHz = true);
+    void CommitOutputPower();
     void startCWTest(uint32_t freq, SX12XX_Radio_Number_t radioNumber);
 
 
@@ -41,10 +42,12 @@ public:
     bool FrequencyErrorAvailable() const { return false; }
 
     void TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXnbStaged(SX12XX_Radio_Number_t radioNumber);
     void RXnb(lr11xx_RadioOperatingModes_t rxMode = LR1121_MODE_RX);
 
     uint32_t GetIrqStatus(SX12XX_Radio_Number_t radioNumber);
-    void ClearIrqStatus(SX12XX_Radio_Number_t radioNumber);
+    void ClearIrqStatus(SX12XX_Radio_Number_t radioNumber, bool post = false);
 
     int8_t GetRssiInst(SX12XX_Radio_Number_t radioNumber);
     void GetLastPacketStats();
@@ -67,7 +70,18 @@ private:
     lr11xx_RadioOperatingModes_t fallBackMode;
     bool useFEC;
 
+    // SX12xxShadow slots, for the configuration which is kept until written again
+    enum
+    {
+        SHADOW_PKT_TYPE,
+        SHADOW_MODULATION_PARAM,
+        SHADOW_PKT_PARAM,
+        SHADOW_RF_FREQUENCY,
+        SHADOW_GFSK_SYNC_WORD,
+    };
+
     void SetMode(lr11xx_RadioOperatingModes_t OPmode, SX12XX_Radio_Number_t radioNumber);
+    void WriteCommandShadowed(uint8_t slot, uint16_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber);
 
     // LoRa functions
     void ConfigModParamsLoRa(uint8_t bw, uint8_t sf, uint8_t cr, SX12XX_Radio_Number_t radioNumber);
@@ -87,6 +101,11 @@ private:
     static void IsrCallback(SX12XX_Radio_Number_t radioNumber);
     bool RXnbISR(SX12XX_Radio_Number_t radioNumber); // ISR for non-blocking RX routine
     void TXnbISR(); // ISR for non-blocking TX routine
-    void CommitOutputPower();
     void WriteOutputPower(uint8_t pwr, bool isSubGHz, SX12XX_Radio_Number_t radioNumber);
+
+    // SX12xxTxStage operations
+    friend class SX12xxTxStage;
+    void TxPrepare(SX12XX_Radio_Number_t radioNumber);
+    void TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TxStart(SX12XX_Radio_Number_t radioNumber);
 };
@@ -1,5 +1,3 @@
-#ifndef UNIT_TEST
-
 #include "LR1121_hal.h"
 #include "LR1121_Regs.h"
 #include "logging.h"
@@ -19,6 +17,14 @@ void LR1121Hal::end()
     {
         detachInterrupt(GPIO_PIN_DIO1_2);
     }
+#if defined(SX12XX_POSTED_COMMANDS)
+    detachInterrupt(GPIO_PIN_BUSY);
+    if (GPIO_PIN_BUSY_2 != UNDEF_PIN)
+    {
+        detachInterrupt(GPIO_PIN_BUSY_2);
+    }
+#endif
+    posted.clear();
     SPIEx.end();
     IsrCallback_1 = nullptr;
     IsrCallback_2 = nullptr;
@@ -83,6 +89,13 @@ void LR1121Hal::init()
     {
         attachInterrupt(digitalPinToInterrupt(GPIO_PIN_DIO1_2), this->dioISR_2, RISING);
     }
+#if defined(SX12XX_POSTED_COMMANDS)
+    attachInterrupt(digitalPinToInterrupt(GPIO_PIN_BUSY), this->busyISR, FALLING);
+    if (GPIO_PIN_BUSY_2 != UNDEF_PIN)
+    {
+        attachInterrupt(digitalPinToInterrupt(GPIO_PIN_BUSY_2), this->busyISR, FALLING);
+    }
+#endif
 }
 
 void LR1121Hal::reset(bool bootloader)
@@ -153,6 +166,31 @@ void ICACHE_RAM_ATTR LR1121Hal::WriteCommand(uint16_t command, SX12XX_Radio_Numb
     SPIEx.write(radioNumber, OutBuffer, 2);
 }
 
+void ICACHE_RAM_ATTR LR1121Hal::PostCommand(uint16_t command, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+#if defined(SX12XX_POSTED_COMMANDS)
+    if (posted.add(command, buffer, size, radioNumber, 0))
+    {
+        posted.service(*this, false);
+        return;
+    }
+#endif
+    WriteCommand(command, buffer, size, radioNumber);
+}
+
+void ICACHE_RAM_ATTR LR1121Hal::WritePosted(uint16_t command, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+{
+    WORD_ALIGNED_ATTR uint8_t OutBuffer[WORD_PADDED(size + 2)] = {
+        (uint8_t)((command & 0xFF00) >> 8),
+        (uint8_t)(command & 0x00FF),
+    };
+
+    memcpy(OutBuffer + 2, buffer, size);
+
+    SpinOnBusy(radioNumber);
+    SPIEx.write(radioNumber, OutBuffer, size + 2);
+}
+
 void ICACHE_RAM_ATTR LR1121Hal::ReadCommand(uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber)
 {
     WORD_ALIGNED_ATTR uint8_t InBuffer[WORD_PADDED(size)] = {0};
@@ -167,6 +205,24 @@ void ICACHE_RAM_ATTR LR1121Hal::ReadCommand(uint8_t *buffer, uint8_t size, SX12X
 
 bool ICACHE_RAM_ATTR LR1121Hal::WaitOnBusy(SX12XX_Radio_Number_t radioNumber)
 {
+    // Anything posted goes first, so the radio sees the commands in order
+    if (posted.size())
+        posted.service(*this, true);
+    return SpinOnBusy(radioNumber);
+}
+
+bool ICACHE_RAM_ATTR LR1121Hal::IsBusy(SX12XX_Radio_Number_t radioNumber)
+{
+    if ((radioNumber & SX12XX_Radio_1) && digitalRead(GPIO_PIN_BUSY) == HIGH)
+        return true;
+    if ((radioNumber & SX12XX_Radio_2) && GPIO_PIN_BUSY_2 != UNDEF_PIN && digitalRead(GPIO_PIN_BUSY_2) == HIGH)
+        return true;
+    return false;
+}
+
+bool ICACHE_RAM_ATTR LR1121Hal::SpinOnBusy(SX12XX_Radio_Number_t radioNumber)
+{
+    SPI_TRACE_BUSY();
     constexpr uint32_t wtimeoutUS = 1000U;
     uint32_t startTime = 0;
 
@@ -198,6 +254,11 @@ bool ICACHE_RAM_ATTR LR1121Hal::WaitOnBusy(SX12XX_Radio_Number_t radioNumber)
     }
 }
 
+void ICACHE_RAM_ATTR LR1121Hal::busyISR()
+{
+    instance->posted.service(*instance, false);
+}
+
 void ICACHE_RAM_ATTR LR1121Hal::dioISR_1()
 {
     if (instance->IsrCallback_1)
@@ -209,5 +270,3 @@ void ICACHE_RAM_ATTR LR1121Hal::dioISR_2()
     if (instance->IsrCallback_2)
         instance->IsrCallback_2();
 }
-
-#endif // UNIT_TEST
@@ -2,6 +2,7 @@
 
 #include "LR1121_Regs.h"
 #include "LR1121.h"
+#include "SX12xxCommandQueue.h"
 
 class LR1121Hal
 {
@@ -20,12 +21,24 @@ public:
     void ICACHE_RAM_ATTR ReadCommand(uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber);
 
     bool ICACHE_RAM_ATTR WaitOnBusy(SX12XX_Radio_Number_t radioNumber);
+    bool ICACHE_RAM_ATTR IsBusy(SX12XX_Radio_Number_t radioNumber);
+
+    /**
+     * @brief Write a command which nothing waits on, without spinning while the radio is BUSY.
+     * If it is, the command is written from the BUSY interrupt, or before the next transaction.
+     */
+    void ICACHE_RAM_ATTR PostCommand(uint16_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber);
 
     static ICACHE_RAM_ATTR void dioISR_1();
     static ICACHE_RAM_ATTR void dioISR_2();
+    static ICACHE_RAM_ATTR void busyISR();
     void (*IsrCallback_1)();
     void (*IsrCallback_2)();
 
 private:
+    friend class SX12xxCommandQueue<4>;
+    SX12xxCommandQueue<4> posted;
 
+    bool ICACHE_RAM_ATTR SpinOnBusy(SX12XX_Radio_Number_t radioNumber);
+    void ICACHE_RAM_ATTR WritePosted(uint16_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay);
 };
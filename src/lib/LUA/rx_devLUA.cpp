@@ -19,7 +19,7 @@ static char pwmModes[] = "50Hz;60Hz;100Hz;160Hz;333Hz;400Hz;10kHzDuty;On/Off;DSh
 static struct luaItem_selection luaSerialProtocol = {
     {"Protocol", CRSF_TEXT_SELECTION},
     0, // value
-    "CRSF;Inverted CRSF;SBUS;Inverted SBUS;SUMD;DJI RS Pro;HoTT Telemetry;MAVLINK",
+    "CRSF;Inverted CRSF;SBUS;Inverted SBUS;SUMD;DJI RS Pro;HoTT Telemetry;MAVLINK;IBUS;FPort",
     STR_EMPTYSPACE
 };
 
@@ -27,7 +27,7 @@ static struct luaItem_selection luaSerialProtocol = {
 static struct luaItem_selection luaSerial1Protocol = {
     {"Protocol2", CRSF_TEXT_SELECTION},
     0, // value
-    "Off;CRSF;Inverted CRSF;SBUS;Inverted SBUS;SUMD;DJI RS Pro;HoTT Telemetry;Tramp;SmartAudio",
+    "Off;CRSF;Inverted CRSF;SBUS;Inverted SBUS;SUMD;DJI RS Pro;HoTT Telemetry;Tramp;SmartAudio;IBUS;FPort",
     STR_EMPTYSPACE
 };
 #endif
@@ -39,6 +39,15 @@ static struct luaItem_selection luaSBUSFailsafeMode = {
     STR_EMPTYSPACE
 };
 
+#if defined(PLATFORM_ESP32)
+static struct luaItem_selection luaSerialTiming = {
+    {"Serial Timing", CRSF_TEXT_SELECTION},
+    0, // value
+    "Main Loop;Packet Synced",
+    STR_EMPTYSPACE
+};
+#endif
+
 #if defined(POWER_OUTPUT_VALUES)
 static struct luaItem_selection luaTlmPower = {
     {"Tlm Power", CRSF_TEXT_SELECTION},
@@ -510,6 +519,12 @@ static void registerLuaParameters()
     config.SetFailsafeMode((eFailsafeMode)arg);
   });
 
+#if defined(PLATFORM_ESP32)
+  registerLUAParameter(&luaSerialTiming, [](struct luaPropertiesCommon* item, uint8_t arg){
+    config.SetSerialTimedOutput(arg);
+  });
+#endif
+
   if (GPIO_PIN_ANT_CTRL != UNDEF_PIN)
   {
     registerLUAParameter(&luaAntennaMode, [](struct luaPropertiesCommon* item, uint8_t arg){
@@ -563,6 +578,8 @@ static void registerLuaParameters()
     sendLuaCommandResponse(&luaBindMode, arg < 5 ? lcsExecuting : lcsIdle, arg < 5 ? "Entering..." : "");
   });
 
+  luadevRegisterProfiler();
+
   registerLUAParameter(&luaModelNumber);
   registerLUAParameter(&luaELRSversion);
   registerLUAParameter(nullptr);
@@ -584,6 +601,9 @@ static int event()
 #endif
   
   setLuaTextSelectionValue(&luaSBUSFailsafeMode, config.GetFailsafeMode());
+#if defined(PLATFORM_ESP32)
+  setLuaTextSelectionValue(&luaSerialTiming, config.GetSerialTimedOutput());
+#endif
 
   if (GPIO_PIN_ANT_CTRL != UNDEF_PIN)
   {
@@ -633,6 +653,7 @@ static int event()
 static int timeout()
 {
   luaHandleUpdateParameter();
+  luadevUpdateProfiler();
   // Receivers can only `UpdateParamReq == true` every 4th packet due to the transmitter cadence in 1:2
   // Channels, Downlink Telemetry Slot, Uplink Telemetry (the write command), Downlink Telemetry Slot...
   // (interval * 4 / 1000) or 1 second if not connected
@@ -650,7 +671,8 @@ device_t LUA_device = {
   .initialize = nullptr,
   .start = start,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .name = "LUA",
 };
 
 #endif
@@ -41,3 +41,117 @@ void luadevGeneratePowerOpts(luaItem_selection *luaPower)
     strcat(strPowerLevels, ";MatchTX ");
 #endif
 }
+
+//---------------------------- Profiler -----------------------------
+#define PROFILER_UPDATE_INTERVAL_MS 1000
+
+static char strProfilerDevices[DEVICE_MAX_COUNT * 13];
+static char strProfilerCalls[24];
+static char strProfilerTime[24];
+static char strProfilerLate[24];
+static char strProfilerLoop[24];
+static char strProfilerLoad[24];
+static uint32_t profilerLastUpdate;
+
+static struct luaItem_folder luaProfilerFolder = {
+    {"Profiler", CRSF_FOLDER},
+};
+
+static struct luaItem_selection luaProfilerDevice = {
+    {"Device", CRSF_TEXT_SELECTION},
+    0, // value
+    strProfilerDevices,
+    STR_EMPTYSPACE
+};
+
+static struct luaItem_string luaProfilerCalls = {
+    {"Calls", CRSF_INFO},
+    strProfilerCalls
+};
+
+static struct luaItem_string luaProfilerTime = {
+    {"Time", CRSF_INFO},
+    strProfilerTime
+};
+
+static struct luaItem_string luaProfilerLate = {
+    {"Late", CRSF_INFO},
+    strProfilerLate
+};
+
+static struct luaItem_string luaProfilerLoop = {
+    {"Loop", CRSF_INFO},
+    strProfilerLoop
+};
+
+static struct luaItem_string luaProfilerLoad = {
+    {"Device Load", CRSF_INFO},
+    strProfilerLoad
+};
+
+static struct luaItem_command luaProfilerReset = {
+    {"Reset Stats", CRSF_COMMAND},
+    lcsIdle, // step
+    STR_EMPTYSPACE
+};
+
+static void updateProfilerStrings()
+{
+    profilerLastUpdate = millis();
+
+    const deviceStats_t *stats = devicesGetStats(luaProfilerDevice.value);
+    if (stats)
+    {
+        const uint32_t runs = stats->events + stats->timeouts;
+        snprintf(strProfilerCalls, sizeof(strProfilerCalls), "E:%u T:%u", stats->events, stats->timeouts);
+        snprintf(strProfilerTime, sizeof(strProfilerTime), "%uus max %uus", runs ? stats->totalMicros / runs : 0, stats->maxMicros);
+        snprintf(strProfilerLate, sizeof(strProfilerLate), "%ux max %ums", stats->late, stats->maxLateMillis);
+    }
+
+    const deviceLoopStats_t *loop = devicesGetLoopStats();
+    snprintf(strProfilerLoop, sizeof(strProfilerLoop), "%uus max %uus",
+        loop->count ? (uint32_t)(loop->totalMicros / loop->count) : 0, loop->maxMicros);
+    snprintf(strProfilerLoad, sizeof(strProfilerLoad), "C0 %u%% C1 %u%%", devicesGetDeviceLoad(0), devicesGetDeviceLoad(1));
+}
+
+void luadevRegisterProfiler()
+{
+    // The devices in the order they were registered, which is the index of their stats
+    char *out = strProfilerDevices;
+    for (uint8_t i = 0; i < devicesGetCount(); i++)
+    {
+        const char *name = devicesGetDevice(i)->device->name;
+        if (i > 0)
+            *out++ = ';';
+        out += snprintf(out, 13, "%.12s", name ? name : "?");
+    }
+    *out = '\0';
+
+    registerLUAParameter(&luaProfilerFolder);
+    registerLUAParameter(&luaProfilerDevice, [](struct luaPropertiesCommon *item, uint8_t arg) {
+        setLuaTextSelectionValue(&luaProfilerDevice, arg);
+        updateProfilerStrings();
+    }, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerCalls, nullptr, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerTime, nullptr, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerLate, nullptr, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerLoop, nullptr, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerLoad, nullptr, luaProfilerFolder.common.id);
+    registerLUAParameter(&luaProfilerReset, [](struct luaPropertiesCommon *item, uint8_t arg) {
+        if (arg == lcsClick)
+        {
+            devicesResetStats();
+            updateProfilerStrings();
+        }
+        sendLuaCommandResponse(&luaProfilerReset, lcsIdle, STR_EMPTYSPACE);
+    }, luaProfilerFolder.common.id);
+    updateProfilerStrings();
+}
+
+void luadevUpdateProfiler()
+{
+    if (millis() - profilerLastUpdate >= PROFILER_UPDATE_INTERVAL_MS)
+    {
+        updateProfilerStrings();
+    }
+}
@@ -8,6 +8,8 @@
 
 // Common functions
 void luadevGeneratePowerOpts(luaItem_selection *luaPower);
+void luadevRegisterProfiler();
+void luadevUpdateProfiler();
 
 // Common Lua storage (mutable)
 extern char strPowerLevels[];
@@ -847,6 +847,8 @@ static void registerLuaParameters()
     registerLUAParameter(&luaBind, &luahandSimpleSendCmd);
   }
 
+  luadevRegisterProfiler();
+
   registerLUAParameter(&luaInfo);
   if (strlen(version) < 21) {
     strlcpy(version_domain, version, 21);
@@ -931,6 +933,7 @@ static int timeout()
   {
     SetSyncSpam();
   }
+  luadevUpdateProfiler();
   return DURATION_IMMEDIATELY;
 }
 
@@ -954,7 +957,8 @@ device_t LUA_device = {
   .initialize = NULL,
   .start = start,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .name = "LUA",
 };
 
 #endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Link margin model for the dynamic power controller. Keeps a filtered estimate of
+ * the margin the receiver has over the point where power must be raised, and its trend,
+ * so the controller can go straight to the lowest power which holds the margin instead of
+ * stepping one level per telemetry update.
+ *
+ * Margins are in 1/FRAC dB. Each measurement is normalized by the output power it was
+ * taken at, so the estimate carries across power changes and can be evaluated at any
+ * level. A level's output is taken as its nominal dBm.
+ *
+ * The filter is a fixed point Holt (level + trend) filter. Only a falling trend is used
+ * for prediction, a rising one never lowers the power sooner, and a falling one holds it
+ * up until the fade stops.
+ */
+class LinkMargin
+{
+public:
+    static const int16_t FRAC = 16;
+    static const uint8_t LEVELS = 8;
+    static const uint8_t HORIZON = 2;       // Updates ahead a fade is predicted
+    static const uint8_t WARMUP = 3;        // Updates before the power will be lowered
+
+    LinkMargin() { reset(); }
+
+    /**
+     * @brief Forget the estimate, e.g. on a rate change where the thresholds differ
+     */
+    void reset()
+    {
+        count = 0;
+        level = 0;
+        trend = 0;
+        last = 0;
+    }
+
+    /**
+     * @brief Add a measured margin
+     * @param margin over the raise threshold, in 1/FRAC dB
+     * @param power the level it was measured at
+     */
+    void add(int16_t margin, uint8_t power)
+    {
+        int32_t x = (int32_t)margin - levelDbm(power) * FRAC;
+        last = x;
+        if (count == 0)
+        {
+            level = x;
+            trend = 0;
+        }
+        else
+        {
+            int32_t last = level;
+            level = (x + level + trend) / 2;
+            trend += (level - last - trend) / 4;
+        }
+        if (count < WARMUP)
+            ++count;
+    }
+
+    /**
+     * @return the filtered margin if transmitting at power
+     */
+    int16_t marginAt(uint8_t power) const
+    {
+        return level + levelDbm(power) * FRAC;
+    }
+
+    /**
+     * @return the margin expected HORIZON updates ahead if transmitting at power. This
+     * starts from the last measurement if it is lower than the filtered margin, as the
+     * filter lags a sudden drop.
+     */
+    int16_t predictedAt(uint8_t power) const
+    {
+        int32_t fade = (trend < 0) ? trend * HORIZON : 0;
+        int32_t base = (last < level) ? last : level;
+        return base + levelDbm(power) * FRAC + fade;
+    }
+
+    /**
+     * @brief The power level to use next. Raises straight to the lowest level predicted to
+     * hold half the window once the margin is predicted to go below 0, and lowers to the
+     * lowest level predicted to keep half the window once it is predicted over the window,
+     * which is the hysteresis between the two. Lowering is at least one level, as a
+     * saturated SNR can hide margin which is really there.
+     * @param window the margin over which the power may be lowered, in 1/FRAC dB
+     * @param allowLower false to only ever raise, e.g. while LQ is poor
+     */
+    uint8_t choose(uint8_t current, uint8_t minPower, uint8_t maxPower, int16_t window, bool allowLower) const
+    {
+        if (count == 0)
+            return current;
+
+        int16_t target = window / 2;
+        if (predictedAt(current) < 0)
+        {
+            uint8_t power = current;
+            while (power < maxPower && predictedAt(power) < target)
+                ++power;
+            return power;
+        }
+
+        if (allowLower && count >= WARMUP && current > minPower && predictedAt(current) >= window)
+        {
+            uint8_t power = minPower;
+            while (power < current - 1 && predictedAt(power) < target)
+                ++power;
+            return power;
+        }
+
+        return current;
+    }
+
+    static int8_t levelDbm(uint8_t power)
+    {
+        static const int8_t dbm[LEVELS] = {10, 14, 17, 20, 24, 27, 30, 33};
+        return dbm[power < LEVELS ? power : LEVELS - 1];
+    }
+
+private:
+    uint8_t count;
+    int32_t level;  // Margin at 0dBm
+    int32_t trend;  // Change per update
+    int32_t last;   // Last measurement at 0dBm
+};
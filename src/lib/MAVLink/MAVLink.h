@@ -1,11 +1,11 @@
 #include "CRSF.h"
-#if !defined(PLATFORM_STM32)
+#if !defined(PLATFORM_STM32) && !defined(UNIT_TEST)
 #define MAVLINK_COMM_NUM_BUFFERS 1
 #include "common/mavlink.h"
 #endif
 #include <CRSFHandset.h>
 
-// Takes a MAVLink message wrapped in CRSF and possibly converts it to a CRSF telemetry message
-void convert_mavlink_to_crsf_telem(uint8_t *CRSFinBuffer, uint8_t count, Handset *handset);
+// Takes a chunk of a MAVLink stream and converts what it can to CRSF telemetry messages
+void convert_mavlink_to_crsf_telem(const uint8_t *data, uint16_t len, Handset *handset);
 
 bool isThisAMavPacket(uint8_t *buffer, uint16_t bufferSize);
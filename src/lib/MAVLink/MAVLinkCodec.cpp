@@ -0,0 +1,324 @@
+#include "MAVLinkCodec.h"
+
+#include <string.h>
+
+// Periodic messages where only the latest sample matters
+static const uint32_t latestOnlyMsgIds[] = {
+    30, // ATTITUDE
+    33, // GLOBAL_POSITION_INT
+};
+
+void MAVLinkSeqPredictor::reset()
+{
+    for (auto &source : m_sources)
+        source.used = false;
+    m_nextSlot = 0;
+}
+
+bool MAVLinkSeqPredictor::predict(uint8_t sysid, uint8_t compid, uint8_t *seq) const
+{
+    for (const auto &source : m_sources)
+    {
+        if (source.used && source.sysid == sysid && source.compid == compid)
+        {
+            *seq = source.nextSeq;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MAVLinkSeqPredictor::update(uint8_t sysid, uint8_t compid, uint8_t seq)
+{
+    for (auto &source : m_sources)
+    {
+        if (source.used && source.sysid == sysid && source.compid == compid)
+        {
+            source.nextSeq = seq + 1;
+            return;
+        }
+    }
+    // Round robin replacement so the TX end makes the same choice
+    auto &source = m_sources[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % MAVLINK_CODEC_SEQ_SOURCES;
+    source.used = true;
+    source.sysid = sysid;
+    source.compid = compid;
+    source.nextSeq = seq + 1;
+}
+
+void MAVLinkEncoder::reset()
+{
+    startChunk();
+}
+
+void MAVLinkEncoder::startChunk()
+{
+    m_seq.reset();
+    m_haveSource = false;
+}
+
+uint16_t MAVLinkEncoder::encode(const mavlink_scanned_msg_t *msg, uint8_t *out, uint16_t maxLen)
+{
+    // The TX can't rebuild the signature, or a frame it doesn't have the CRC_EXTRA for
+    if (!msg->known || msg->incompatFlags || msg->compatFlags)
+        return 0;
+
+    uint8_t payloadLen;
+    if (msg->v2)
+    {
+        payloadLen = msg->len;
+        while (payloadLen > 1 && msg->payload[payloadLen - 1] == 0)
+            --payloadLen;
+    }
+    else
+    {
+        // v1 has no extension fields, keep the length as sent
+        payloadLen = msg->frame[1];
+    }
+
+    const uint8_t msgidLen = msg->msgid < 256 ? 1 : 3;
+    const uint16_t tokenLen = 1 + 2 + 1 + msgidLen + 1 + payloadLen;
+    if (tokenLen > maxLen)
+        return 0;
+
+    uint8_t *p = out;
+    *p++ = MAVLINK_TOKEN_COMPRESSED | (msg->v2 ? 0 : MAVLINK_TOKEN_V1) | (msgidLen == 1 ? MAVLINK_TOKEN_MSGID_8BIT : 0);
+    *p++ = msg->sysid;
+    *p++ = msg->compid;
+    *p++ = msg->seq;
+    *p++ = msg->msgid;
+    if (msgidLen == 3)
+    {
+        *p++ = msg->msgid >> 8;
+        *p++ = msg->msgid >> 16;
+    }
+    *p++ = payloadLen;
+    memcpy(p, msg->payload, payloadLen);
+    return tokenLen;
+}
+
+uint16_t MAVLinkEncoder::compact(const uint8_t *token, uint16_t len, uint8_t *out)
+{
+    if (token[0] == MAVLINK_TOKEN_RAW)
+    {
+        memcpy(out, token, len);
+        return len;
+    }
+
+    // Full token: flags sysid compid seq msgid...
+    uint8_t flags = token[0];
+    const uint8_t sysid = token[1];
+    const uint8_t compid = token[2];
+    const uint8_t seq = token[3];
+    uint16_t outLen = 1;
+
+    if (m_haveSource && sysid == m_sysid && compid == m_compid)
+    {
+        flags |= MAVLINK_TOKEN_SAME_SOURCE;
+    }
+    else
+    {
+        out[outLen++] = sysid;
+        out[outLen++] = compid;
+    }
+
+    uint8_t predicted;
+    if (m_seq.predict(sysid, compid, &predicted) && predicted == seq)
+        flags |= MAVLINK_TOKEN_SEQ_PREDICTED;
+    else
+        out[outLen++] = seq;
+
+    out[0] = flags;
+    memcpy(&out[outLen], &token[4], len - 4);
+    outLen += len - 4;
+
+    m_seq.update(sysid, compid, seq);
+    m_haveSource = true;
+    m_sysid = sysid;
+    m_compid = compid;
+    return outLen;
+}
+
+uint16_t MAVLinkEncoder::encodeRaw(const uint8_t *data, uint8_t len, uint8_t *out)
+{
+    out[0] = MAVLINK_TOKEN_RAW;
+    out[1] = len;
+    memcpy(&out[2], data, len);
+    return len + 2;
+}
+
+void MAVLinkDecoder::reset()
+{
+    m_seq.reset();
+    m_len = 0;
+}
+
+void MAVLinkDecoder::startChunk(const uint8_t *data, uint8_t len)
+{
+    m_data = data;
+    m_len = len;
+    m_pos = 0;
+    m_haveSource = false;
+    m_seq.reset();
+}
+
+uint16_t MAVLinkDecoder::fail()
+{
+    // Nothing after a bad token can be trusted
+    ++m_errors;
+    m_pos = m_len;
+    return 0;
+}
+
+uint16_t MAVLinkDecoder::next(uint8_t *out)
+{
+    while (m_pos < m_len)
+    {
+        const uint8_t *token = &m_data[m_pos];
+        const uint8_t avail = m_len - m_pos;
+        const uint8_t flags = token[0];
+
+        if (flags == MAVLINK_TOKEN_RAW)
+        {
+            if (avail < 2 || avail - 2 < token[1])
+                return fail();
+            const uint8_t len = token[1];
+            memcpy(out, &token[2], len);
+            m_pos += 2 + len;
+            if (len == 0)
+                continue;
+            return len;
+        }
+
+        if (!(flags & MAVLINK_TOKEN_COMPRESSED) || (flags & MAVLINK_TOKEN_RESERVED))
+            return fail();
+
+        const bool v2 = !(flags & MAVLINK_TOKEN_V1);
+        const uint8_t headerLen = 1 + ((flags & MAVLINK_TOKEN_SAME_SOURCE) ? 0 : 2) + ((flags & MAVLINK_TOKEN_SEQ_PREDICTED) ? 0 : 1) +
+                                  ((flags & MAVLINK_TOKEN_MSGID_8BIT) ? 1 : 3) + 1;
+        if (avail < headerLen || avail - headerLen < token[headerLen - 1])
+            return fail();
+
+        uint8_t idx = 1;
+        if (!(flags & MAVLINK_TOKEN_SAME_SOURCE))
+        {
+            m_sysid = token[idx++];
+            m_compid = token[idx++];
+            m_haveSource = true;
+        }
+        else if (!m_haveSource)
+        {
+            return fail();
+        }
+
+        uint8_t seq;
+        if (flags & MAVLINK_TOKEN_SEQ_PREDICTED)
+        {
+            if (!m_seq.predict(m_sysid, m_compid, &seq))
+                return fail();
+        }
+        else
+        {
+            seq = token[idx++];
+        }
+
+        uint32_t msgid = token[idx++];
+        if (!(flags & MAVLINK_TOKEN_MSGID_8BIT))
+        {
+            msgid |= (token[idx] << 8) | ((uint32_t)token[idx + 1] << 16);
+            idx += 2;
+        }
+        const uint8_t payloadLen = token[idx++];
+
+        mavlink_scanner_msg_info_t info;
+        if (!m_lookup(msgid, &info) || (!v2 && msgid > 0xFF))
+            return fail();
+
+        uint8_t frameHeaderLen;
+        if (v2)
+        {
+            const uint8_t header[] = {0xFD, payloadLen, 0, 0, seq, m_sysid, m_compid,
+                                      (uint8_t)msgid, (uint8_t)(msgid >> 8), (uint8_t)(msgid >> 16)};
+            memcpy(out, header, sizeof(header));
+            frameHeaderLen = sizeof(header);
+        }
+        else
+        {
+            const uint8_t header[] = {0xFE, payloadLen, seq, m_sysid, m_compid, (uint8_t)msgid};
+            memcpy(out, header, sizeof(header));
+            frameHeaderLen = sizeof(header);
+        }
+        memcpy(&out[frameHeaderLen], &token[idx], payloadLen);
+
+        uint16_t crc = crc_x25_update(0xFFFF, &out[1], frameHeaderLen - 1 + payloadLen);
+        crc = crc_x25_update(crc, &info.crcExtra, 1);
+        out[frameHeaderLen + payloadLen] = crc & 0xFF;
+        out[frameHeaderLen + payloadLen + 1] = crc >> 8;
+
+        m_seq.update(m_sysid, m_compid, seq);
+        m_pos += idx + payloadLen;
+        return frameHeaderLen + payloadLen + 2;
+    }
+    return 0;
+}
+
+void MAVLinkLatestOnly::reset()
+{
+    for (auto &slot : m_slots)
+        slot.used = false;
+}
+
+bool MAVLinkLatestOnly::hold(const mavlink_scanned_msg_t *msg)
+{
+    if (!msg->known || !msg->v2 || msg->incompatFlags || msg->compatFlags || msg->len > MAVLINK_CODEC_HELD_PAYLOAD)
+        return false;
+
+    bool latestOnly = false;
+    for (auto msgid : latestOnlyMsgIds)
+        latestOnly |= msg->msgid == msgid;
+    if (!latestOnly)
+        return false;
+
+    slot_t *target = nullptr;
+    for (auto &slot : m_slots)
+    {
+        if (slot.used && slot.msg.msgid == msg->msgid && slot.msg.sysid == msg->sysid && slot.msg.compid == msg->compid)
+        {
+            // Superseded before it was sent, keep its place in the queue
+            ++m_dropped;
+            target = &slot;
+            break;
+        }
+        if (!slot.used && target == nullptr)
+            target = &slot;
+    }
+    if (target == nullptr)
+        return false;
+
+    if (!target->used)
+    {
+        target->used = true;
+        target->order = m_order++;
+    }
+    target->msg = *msg;
+    memcpy(target->payload, msg->payload, msg->len);
+    target->msg.payload = target->payload;
+    target->msg.frame = nullptr;
+    target->msg.frameLen = 0;
+    return true;
+}
+
+const mavlink_scanned_msg_t *MAVLinkLatestOnly::release()
+{
+    slot_t *oldest = nullptr;
+    for (auto &slot : m_slots)
+    {
+        if (slot.used && (oldest == nullptr || (int32_t)(slot.order - oldest->order) < 0))
+            oldest = &slot;
+    }
+    if (oldest == nullptr)
+        return nullptr;
+    oldest->used = false;
+    return &oldest->msg;
+}
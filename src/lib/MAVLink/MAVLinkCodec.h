@@ -0,0 +1,159 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "MAVLinkScanner.h"
+
+/*  Compressed MAVLink telemetry, parsed into frames on the RX and rebuilt on the TX.
+
+    A compressed downlink chunk starts with MAVLINK_COMPRESSED_TLM_MARKER instead of
+    CRSF_ADDRESS_USB and contains whole tokens only, so every chunk decodes on its own:
+
+    Raw token:        0x00 len bytes[len]
+        Part of a frame (or a whole frame) that could not be compressed: unknown
+        message, signed, or too big for one chunk. Written out as is.
+    Compressed token: flags [sysid compid] [seq] msgid(1 or 3 bytes) len payload[len]
+        The header and checksum are dropped and rebuilt on the TX, as are trailing
+        zeros of v2 payloads. seq is omitted when it follows on from the previous
+        frame from the same sysid/compid in the chunk, sysid/compid when they are the
+        same as the previous frame in the chunk. Nothing is predicted across chunks,
+        so a lost chunk can't put the wrong seq on the frames after it.
+*/
+
+#define MAVLINK_COMPRESSED_TLM_MARKER 0x11  // In place of CRSF_ADDRESS_USB for compressed chunks
+#define MAVLINK_CODEC_MAX_FRAME_LEN 280     // Max size of a signed v2 frame
+#define MAVLINK_CODEC_SEQ_SOURCES 4         // Number of sysid/compid seq numbers tracked
+#define MAVLINK_CODEC_HELD_SLOTS 4          // Periodic messages held back so only the latest sample is sent
+#define MAVLINK_CODEC_HELD_PAYLOAD 40
+
+#define MAVLINK_TOKEN_RAW 0x00
+#define MAVLINK_TOKEN_COMPRESSED 0x80
+#define MAVLINK_TOKEN_SEQ_PREDICTED 0x40
+#define MAVLINK_TOKEN_SAME_SOURCE 0x20
+#define MAVLINK_TOKEN_MSGID_8BIT 0x10
+#define MAVLINK_TOKEN_V1 0x08
+#define MAVLINK_TOKEN_RESERVED 0x07
+
+// Next expected seq per sysid/compid within a chunk, reset by startChunk() at both ends
+class MAVLinkSeqPredictor
+{
+public:
+    MAVLinkSeqPredictor() { reset(); }
+    void reset();
+    bool predict(uint8_t sysid, uint8_t compid, uint8_t *seq) const;
+    void update(uint8_t sysid, uint8_t compid, uint8_t seq);
+
+private:
+    struct {
+        bool used;
+        uint8_t sysid;
+        uint8_t compid;
+        uint8_t nextSeq;
+    } m_sources[MAVLINK_CODEC_SEQ_SOURCES];
+    uint8_t m_nextSlot;
+};
+
+/**
+ * Frames are first encoded on their own into full tokens, with the sysid/compid and seq
+ * always present, which can be queued until the link is ready. When a chunk is built
+ * each full token is compacted against the previous frames.
+ */
+class MAVLinkEncoder
+{
+public:
+    /**
+     * @brief Compress a frame into a single full token
+     * @return the token length, or 0 if the frame has to be sent as raw tokens
+     */
+    static uint16_t encode(const mavlink_scanned_msg_t *msg, uint8_t *out, uint16_t maxLen);
+
+    /**
+     * @brief Wrap len bytes of a frame in a raw token of len + 2 bytes
+     */
+    static uint16_t encodeRaw(const uint8_t *data, uint8_t len, uint8_t *out);
+
+    /**
+     * @brief Start a new chunk, tokens must not refer back to the previous chunk
+     */
+    void startChunk();
+
+    /**
+     * @brief Drop what the TX can predict from a full token, raw tokens are copied unchanged
+     * @return the compacted length, never more than len
+     */
+    uint16_t compact(const uint8_t *token, uint16_t len, uint8_t *out);
+
+    void reset();
+
+private:
+    MAVLinkSeqPredictor m_seq;
+    bool m_haveSource = false;
+    uint8_t m_sysid;
+    uint8_t m_compid;
+};
+
+class MAVLinkDecoder
+{
+public:
+    explicit MAVLinkDecoder(mavlink_msg_lookup_t lookup) : m_lookup(lookup), m_data(nullptr), m_len(0), m_errors(0) {}
+
+    void startChunk(const uint8_t *data, uint8_t len);
+
+    /**
+     * @brief Rebuild the next frame, or part of a frame for raw tokens, from the chunk
+     * @param out buffer of at least MAVLINK_CODEC_MAX_FRAME_LEN bytes
+     * @return number of bytes written to out, 0 when the chunk is finished
+     */
+    uint16_t next(uint8_t *out);
+
+    void reset();
+    uint32_t getErrors() const { return m_errors; }
+
+private:
+    mavlink_msg_lookup_t m_lookup;
+    MAVLinkSeqPredictor m_seq;
+    const uint8_t *m_data;
+    uint8_t m_len;
+    uint8_t m_pos;
+    bool m_haveSource;
+    uint8_t m_sysid;
+    uint8_t m_compid;
+    uint32_t m_errors;
+
+    uint16_t fail();
+};
+
+/**
+ * Holds back periodic messages (ATTITUDE, GLOBAL_POSITION_INT) while the link is busy,
+ * a newer sample from the same sysid/compid replaces one that has not been sent yet.
+ */
+class MAVLinkLatestOnly
+{
+public:
+    MAVLinkLatestOnly() : m_dropped(0), m_order(0) { reset(); }
+
+    /**
+     * @return true if the message was taken, false if it should be sent as normal
+     */
+    bool hold(const mavlink_scanned_msg_t *msg);
+
+    /**
+     * @brief Take the oldest held message, valid until the next call to hold()
+     */
+    const mavlink_scanned_msg_t *release();
+
+    void reset();
+    uint32_t getDropped() const { return m_dropped; }
+
+private:
+    typedef struct {
+        bool used;
+        uint32_t order;
+        mavlink_scanned_msg_t msg;
+        uint8_t payload[MAVLINK_CODEC_HELD_PAYLOAD];
+    } slot_t;
+
+    slot_t m_slots[MAVLINK_CODEC_HELD_SLOTS];
+    uint32_t m_dropped;
+    uint32_t m_order;
+};
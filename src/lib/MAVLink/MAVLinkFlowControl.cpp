@@ -0,0 +1,89 @@
+#include "MAVLinkFlowControl.h"
+#include "MAVLinkScanner.h"
+
+#define MAVLINK_MSG_ID_RADIO_STATUS 109
+#define MAVLINK_RADIO_STATUS_LEN 9
+#define MAVLINK_RADIO_STATUS_CRC_EXTRA 185
+
+MAVLinkFlowControl::MAVLinkFlowControl(uint16_t bufferSize, uint8_t sysid, uint8_t compid)
+    : m_bufferSize(bufferSize), m_sysid(sysid), m_compid(compid), m_seq(0),
+      m_budget(0), m_window(MAVLINK_FLOW_MIN_WINDOW), m_level(0), m_lastDrain(0), m_lastStatus(0)
+{
+}
+
+void MAVLinkFlowControl::setLinkRate(uint16_t airRateHz, uint8_t tlmRatio, uint8_t tlmBurst, uint8_t bytesPerCall, uint8_t packageLen)
+{
+    if (tlmRatio <= 1 || bytesPerCall == 0 || packageLen == 0)
+    {
+        // No telemetry
+        m_budget = 0;
+        m_window = MAVLINK_FLOW_MIN_WINDOW;
+        return;
+    }
+
+    // One in every tlmBurst + 1 telemetry packets is LinkStats, and every package
+    // costs one extra packet waiting for the confirm before the next can start
+    const uint32_t slotsPerPackage = (packageLen + bytesPerCall - 1) / bytesPerCall + 1;
+    m_budget = (uint32_t)airRateHz * tlmBurst * packageLen / tlmRatio / (tlmBurst + 1) / slotsPerPackage;
+
+    uint32_t window = m_budget * MAVLINK_FLOW_MAX_LATENCY_MS / 1000;
+    if (window < MAVLINK_FLOW_MIN_WINDOW)
+        window = MAVLINK_FLOW_MIN_WINDOW;
+    if (window > m_bufferSize)
+        window = m_bufferSize;
+    m_window = window;
+}
+
+void MAVLinkFlowControl::drain(uint32_t now)
+{
+    const uint32_t elapsed = now - m_lastDrain;
+    m_lastDrain = now;
+    // Anything queued a second ago is long gone, and keeps the product in range
+    const uint32_t drained = elapsed < MAVLINK_FLOW_MAX_LATENCY_MS ? elapsed * m_budget : UINT32_MAX;
+    m_level = drained < m_level ? m_level - drained : 0;
+}
+
+void MAVLinkFlowControl::received(uint16_t bytes, uint32_t now)
+{
+    drain(now);
+    m_level += (uint32_t)bytes * 1000;
+}
+
+uint8_t MAVLinkFlowControl::getTxBuf(uint16_t queued, uint32_t now)
+{
+    drain(now);
+    uint32_t fill = m_level / 1000;
+    if (queued > fill)
+        fill = queued;
+    if (fill >= m_window)
+        return 0;
+    return 100 - fill * 100 / m_window;
+}
+
+bool MAVLinkFlowControl::update(Stream *out, uint16_t queued, const mavlink_flow_link_status_t &link, uint32_t now)
+{
+    const uint8_t txbuf = getTxBuf(queued, now);
+    const uint32_t interval = txbuf < MAVLINK_FLOW_URGENT_TXBUF ? MAVLINK_FLOW_URGENT_INTERVAL_MS : MAVLINK_FLOW_STATUS_INTERVAL_MS;
+    if (now - m_lastStatus < interval)
+        return false;
+    m_lastStatus = now;
+
+    // RADIO_STATUS v2 frame, payload fields in wire order: rxerrors fixed rssi remrssi txbuf noise remnoise
+    uint8_t frame[10 + MAVLINK_RADIO_STATUS_LEN + 2] = {
+        0xFD, MAVLINK_RADIO_STATUS_LEN, 0, 0, m_seq++, m_sysid, m_compid, MAVLINK_MSG_ID_RADIO_STATUS, 0, 0,
+        0, 0, 0, 0, link.rssi, link.remrssi, txbuf, link.noise, 0
+    };
+    uint8_t len = 10 + MAVLINK_RADIO_STATUS_LEN;
+    // v2 truncates trailing zeros, always keeping at least one payload byte
+    while (len > 11 && frame[len - 1] == 0)
+        --len;
+    frame[1] = len - 10;
+
+    uint16_t crc = crc_x25_update(0xFFFF, &frame[1], len - 1);
+    const uint8_t crcExtra = MAVLINK_RADIO_STATUS_CRC_EXTRA;
+    crc = crc_x25_update(crc, &crcExtra, 1);
+    frame[len++] = crc & 0xFF;
+    frame[len++] = crc >> 8;
+    out->write(frame, len);
+    return true;
+}
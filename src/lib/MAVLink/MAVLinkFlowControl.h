@@ -0,0 +1,67 @@
+#pragma once
+
+#include "targets.h"
+
+#define MAVLINK_FLOW_STATUS_INTERVAL_MS 100 // RADIO_STATUS interval while there is room in the window
+#define MAVLINK_FLOW_URGENT_INTERVAL_MS 10  // and when the window is nearly full
+#define MAVLINK_FLOW_URGENT_TXBUF 20        // txbuf below which ArduPilot/PX4 back off hardest
+#define MAVLINK_FLOW_MAX_LATENCY_MS 1000    // Queue no more than this much air time
+#define MAVLINK_FLOW_MIN_WINDOW 128         // but always allow a few frames
+
+typedef struct {
+    uint8_t rssi;
+    uint8_t remrssi;
+    uint8_t noise;
+} mavlink_flow_link_status_t;
+
+/**
+ * Software flow control towards the FC based on the telemetry link budget.
+ *
+ * The bytes the FC sends are run through a token bucket that drains at the rate the
+ * telemetry downlink can actually carry, which depends on the packet rate, telemetry
+ * ratio and burst. The fill of the bucket (or of the real queue if that is higher) is
+ * reported as txbuf in RADIO_STATUS relative to a window of at most
+ * MAVLINK_FLOW_MAX_LATENCY_MS of air time, so the autopilot slows its streams down
+ * long before the input FIFO overflows, rather than when half of a FIFO that could
+ * take seconds to drain is already used.
+ */
+class MAVLinkFlowControl
+{
+public:
+    MAVLinkFlowControl(uint16_t bufferSize, uint8_t sysid, uint8_t compid);
+
+    /**
+     * @brief Set the downlink budget from the current air rate config
+     * @param bytesPerCall telemetry payload bytes per OTA packet
+     * @param packageLen size of the packages the stubborn sender sends, each needs a confirm
+     */
+    void setLinkRate(uint16_t airRateHz, uint8_t tlmRatio, uint8_t tlmBurst, uint8_t bytesPerCall, uint8_t packageLen);
+    uint32_t getBudget() const { return m_budget; }
+    uint16_t getWindow() const { return m_window; }
+
+    // Account for bytes received from the FC
+    void received(uint16_t bytes, uint32_t now);
+
+    // txbuf percentage to advertise, given the number of bytes in the input FIFO
+    uint8_t getTxBuf(uint16_t queued, uint32_t now);
+
+    /**
+     * @brief Write a RADIO_STATUS to out if one is due
+     * @return true if one was sent
+     */
+    bool update(Stream *out, uint16_t queued, const mavlink_flow_link_status_t &link, uint32_t now);
+
+private:
+    void drain(uint32_t now);
+
+    const uint16_t m_bufferSize;
+    const uint8_t m_sysid;
+    const uint8_t m_compid;
+    uint8_t m_seq;
+
+    uint32_t m_budget;          // bytes per second
+    uint16_t m_window;
+    uint32_t m_level;           // token bucket fill in 1/1000 bytes
+    uint32_t m_lastDrain;
+    uint32_t m_lastStatus;
+};
@@ -0,0 +1,190 @@
+#include "MAVLinkScanner.h"
+
+#include <string.h>
+#include "checksum.h"
+
+#define MAVLINK_STX_V1 0xFE
+#define MAVLINK_STX_V2 0xFD
+#define MAVLINK_HEADER_LEN_V1 6
+#define MAVLINK_HEADER_LEN_V2 10
+#define MAVLINK_CHECKSUM_LEN 2
+#define MAVLINK_SIGNATURE_LEN 13
+#define MAVLINK_IFLAG_SIGNED 0x01
+
+uint16_t crc_x25_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        crc_accumulate(*data++, &crc);
+    }
+    return crc;
+}
+
+MAVLinkScanner::MAVLinkScanner(const mavlink_scanner_msg_info_t *wanted, uint8_t wantedCount)
+    : m_wanted(wanted), m_wantedCount(wantedCount), m_lookup(nullptr), m_passUnknown(false),
+      m_crcErrors(0), m_skippedFrames(0), m_droppedBytes(0)
+{
+    reset();
+}
+
+MAVLinkScanner::MAVLinkScanner(mavlink_msg_lookup_t lookup, bool passUnknown)
+    : m_wanted(nullptr), m_wantedCount(0), m_lookup(lookup), m_passUnknown(passUnknown),
+      m_crcErrors(0), m_skippedFrames(0), m_droppedBytes(0)
+{
+    reset();
+}
+
+void MAVLinkScanner::reset()
+{
+    m_len = 0;
+    m_pos = 0;
+}
+
+const mavlink_scanner_msg_info_t *MAVLinkScanner::lookup(uint32_t msgid)
+{
+    if (m_lookup)
+        return m_lookup(msgid, &m_info) ? &m_info : nullptr;
+
+    for (uint8_t i = 0; i < m_wantedCount; i++)
+    {
+        if (m_wanted[i].msgid == msgid)
+            return &m_wanted[i];
+    }
+    return nullptr;
+}
+
+void MAVLinkScanner::push(const uint8_t *data, size_t len)
+{
+    // Move the unconsumed partial frame to the front
+    if (m_pos)
+    {
+        m_len -= m_pos;
+        memmove(m_buffer, &m_buffer[m_pos], m_len);
+        m_pos = 0;
+    }
+
+    if (len > (size_t)MAVLINK_SCANNER_BUFFER_SIZE - m_len)
+    {
+        // Only happens if push() is called without draining with next(), start again
+        m_droppedBytes += m_len;
+        m_len = 0;
+        if (len > MAVLINK_SCANNER_BUFFER_SIZE)
+        {
+            m_droppedBytes += len - MAVLINK_SCANNER_BUFFER_SIZE;
+            data += len - MAVLINK_SCANNER_BUFFER_SIZE;
+            len = MAVLINK_SCANNER_BUFFER_SIZE;
+        }
+    }
+    memcpy(&m_buffer[m_len], data, len);
+    m_len += len;
+}
+
+const mavlink_scanned_msg_t *MAVLinkScanner::next()
+{
+    while (m_pos < m_len)
+    {
+        const uint8_t *frame = &m_buffer[m_pos];
+        const uint16_t avail = m_len - m_pos;
+
+        if (frame[0] != MAVLINK_STX_V2 && frame[0] != MAVLINK_STX_V1)
+        {
+            // Out of sync, skip to the next start byte
+            uint16_t skip = 1;
+            while (skip < avail && frame[skip] != MAVLINK_STX_V2 && frame[skip] != MAVLINK_STX_V1)
+                ++skip;
+            m_droppedBytes += skip;
+            m_pos += skip;
+            continue;
+        }
+
+        const bool v2 = frame[0] == MAVLINK_STX_V2;
+        const uint8_t headerLen = v2 ? MAVLINK_HEADER_LEN_V2 : MAVLINK_HEADER_LEN_V1;
+        if (avail < headerLen)
+            break;
+
+        // Unknown frames are skipped without a CRC check, so reject start bytes
+        // that can't be a header before trusting the length
+        if (v2 && (frame[2] & ~MAVLINK_IFLAG_SIGNED))
+        {
+            ++m_droppedBytes;
+            ++m_pos;
+            continue;
+        }
+
+        const uint8_t payloadLen = frame[1];
+        uint16_t frameLen = headerLen + payloadLen + MAVLINK_CHECKSUM_LEN;
+        if (v2 && (frame[2] & MAVLINK_IFLAG_SIGNED))
+            frameLen += MAVLINK_SIGNATURE_LEN;
+        if (avail < frameLen)
+            break;
+
+        const uint32_t msgid = v2 ? frame[7] | (frame[8] << 8) | ((uint32_t)frame[9] << 16) : frame[5];
+        const mavlink_scanner_msg_info_t *info = lookup(msgid);
+        if (info == nullptr)
+        {
+            // Without a CRC_EXTRA the CRC can't be checked, so only trust the length if
+            // another frame starts right after it. Wait for that byte when it isn't here yet
+            if (avail == frameLen)
+                break;
+            if (frame[frameLen] != MAVLINK_STX_V2 && frame[frameLen] != MAVLINK_STX_V1)
+            {
+                ++m_droppedBytes;
+                ++m_pos;
+                continue;
+            }
+        }
+        if (info == nullptr && !m_passUnknown)
+        {
+            ++m_skippedFrames;
+            m_pos += frameLen;
+            continue;
+        }
+
+        m_msg.msgid = msgid;
+        m_msg.sysid = frame[v2 ? 5 : 3];
+        m_msg.compid = frame[v2 ? 6 : 4];
+        m_msg.seq = frame[v2 ? 4 : 2];
+        m_msg.v2 = v2;
+        m_msg.incompatFlags = v2 ? frame[2] : 0;
+        m_msg.compatFlags = v2 ? frame[3] : 0;
+        m_msg.frame = frame;
+        m_msg.frameLen = frameLen;
+
+        if (info == nullptr)
+        {
+            ++m_skippedFrames;
+            m_msg.known = false;
+            m_msg.len = payloadLen;
+            m_msg.payload = &frame[headerLen];
+            m_pos += frameLen;
+            return &m_msg;
+        }
+
+        uint16_t crc = crc_x25_update(0xFFFF, &frame[1], headerLen - 1 + payloadLen);
+        crc = crc_x25_update(crc, &info->crcExtra, 1);
+        const uint8_t *checksum = &frame[headerLen + payloadLen];
+        if (payloadLen > info->len || crc != (checksum[0] | (checksum[1] << 8)))
+        {
+            // Could be a start byte inside something else, resync from the next byte
+            ++m_crcErrors;
+            ++m_pos;
+            continue;
+        }
+
+        m_msg.known = true;
+        m_msg.len = info->len;
+        if (payloadLen == info->len)
+        {
+            m_msg.payload = &frame[headerLen];
+        }
+        else
+        {
+            memcpy(m_payload, &frame[headerLen], payloadLen);
+            memset(&m_payload[payloadLen], 0, info->len - payloadLen);
+            m_msg.payload = m_payload;
+        }
+        m_pos += frameLen;
+        return &m_msg;
+    }
+    return nullptr;
+}
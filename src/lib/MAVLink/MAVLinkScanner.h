@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAVLINK_SCANNER_BUFFER_SIZE 512 // Room for a partial max size signed frame plus incoming chunks
+#define MAVLINK_SCANNER_MAX_PAYLOAD 255
+
+// X.25 (CRC-16/MCRF4XX) as used by MAVLink, continues from crc
+uint16_t crc_x25_update(uint16_t crc, const uint8_t *data, size_t len);
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t sysid;
+    uint8_t compid;
+    uint8_t seq;
+    uint8_t len;            // full payload length, truncated v2 payloads are zero extended to this
+    const uint8_t *payload;
+    bool known;             // false for frames passed through without a CRC check, len is then the wire length
+    bool v2;
+    uint8_t incompatFlags;
+    uint8_t compatFlags;
+    const uint8_t *frame;   // the whole frame as received
+    uint16_t frameLen;
+} mavlink_scanned_msg_t;
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t crcExtra;
+    uint8_t len;            // full payload length including extensions
+} mavlink_scanner_msg_info_t;
+
+// Looks up the CRC_EXTRA and length of a message, returns false if it is not known
+typedef bool (*mavlink_msg_lookup_t)(uint32_t msgid, mavlink_scanner_msg_info_t *info);
+
+// Lookup in the full message set of the mavlink library, on targets that have it
+bool mavlinkLookupMsg(uint32_t msgid, mavlink_scanner_msg_info_t *info);
+
+/**
+ * Finds MAVLink v1 and v2 frames in a byte stream using the length field rather
+ * than running every byte through a parser state machine. Only the messages in the
+ * supplied list have their CRC checked and are returned, all other frames are skipped
+ * over by length without touching their contents:
+ *
+ *   scanner.push(data, len);
+ *   while ((msg = scanner.next()) != nullptr)
+ *       use(msg);
+ *
+ * The returned message is valid until the next call to push() or next().
+ *
+ * When constructed with a lookup function and passUnknown, every frame is returned,
+ * messages the lookup does not know are passed through without a CRC check.
+ *
+ * Frames that aren't known can't have their CRC checked, their length is only trusted
+ * when the next frame's start byte follows it. They are held until that byte arrives.
+ */
+class MAVLinkScanner
+{
+public:
+    MAVLinkScanner(const mavlink_scanner_msg_info_t *wanted, uint8_t wantedCount);
+    MAVLinkScanner(mavlink_msg_lookup_t lookup, bool passUnknown);
+
+    void push(const uint8_t *data, size_t len);
+    const mavlink_scanned_msg_t *next();
+    void reset();
+
+    uint32_t getCrcErrors() const { return m_crcErrors; }
+    uint32_t getSkippedFrames() const { return m_skippedFrames; }
+    uint32_t getDroppedBytes() const { return m_droppedBytes; }
+
+private:
+    const mavlink_scanner_msg_info_t *m_wanted;
+    uint8_t m_wantedCount;
+    mavlink_msg_lookup_t m_lookup;
+    bool m_passUnknown;
+    mavlink_scanner_msg_info_t m_info;
+
+    uint8_t m_buffer[MAVLINK_SCANNER_BUFFER_SIZE];
+    uint16_t m_len;
+    uint16_t m_pos;
+
+    mavlink_scanned_msg_t m_msg;
+    uint8_t m_payload[MAVLINK_SCANNER_MAX_PAYLOAD];
+
+    uint32_t m_crcErrors;
+    uint32_t m_skippedFrames;
+    uint32_t m_droppedBytes;
+
+    const mavlink_scanner_msg_info_t *lookup(uint32_t msgid);
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Table driven CRC8-DVB-S2 over a span of bytes, continues from crc
+uint8_t crc8_dvb_s2_update(uint8_t crc, const uint8_t *data, size_t len);
+
+typedef enum {
+    MSP_PARSER_V1 = 1,
+    MSP_PARSER_V2 = 2,
+    MSP_PARSER_V1_JUMBO = 3,
+} mspParserVersion_e;
+
+/**
+ * Streaming MSP frame parser for MSP v1, v1 jumbo and v2 native frames.
+ *
+ * parse() consumes as much of the supplied buffer as it can, handling the payload
+ * as a single span (memcpy/CRC table) rather than one byte at a time, and returns
+ * as soon as a complete frame has been validated so the caller can use it before
+ * continuing with the rest of the buffer:
+ *
+ *   size_t pos = 0;
+ *   while (pos < len) {
+ *       pos += parser.parse(&data[pos], len - pos);
+ *       if (parser.frameReady()) {
+ *           use(parser.getFrame(), parser.getFrameLen());
+ *           parser.markFrameConsumed();
+ *       }
+ *   }
+ *
+ * A frame that starts and ends within the same parse() call is not copied, getFrame()
+ * and getPayload() point into the source buffer and are only valid until the source
+ * buffer is released. Frames split across calls are assembled in an internal buffer
+ * sized from the MaxPayload template parameter. Frames with a payload larger than
+ * MaxPayload are skipped and counted.
+ */
+template <uint16_t MaxPayload>
+class MSPParser
+{
+public:
+    static constexpr uint16_t MAX_HEADER_LEN = 8; // $X< flags func(2) size(2)
+    static constexpr uint16_t MAX_FRAME_LEN = MaxPayload + MAX_HEADER_LEN + 1;
+
+    MSPParser() { reset(); }
+
+    void reset()
+    {
+        m_state = STATE_IDLE;
+        m_ready = false;
+    }
+
+    /**
+     * @brief Feed bytes into the parser
+     * @return the number of bytes consumed, which is less than len if a frame was completed
+     */
+    size_t parse(const uint8_t *data, size_t len)
+    {
+        if (m_ready)
+            return 0;
+
+        m_source = data;
+        m_frameInSource = m_state == STATE_IDLE; // updated when a frame starts in this buffer
+        size_t pos = 0;
+
+        while (pos < len)
+        {
+            if (m_state == STATE_IDLE)
+            {
+                // Skip straight to the next framing char
+                const uint8_t *start = (const uint8_t *)memchr(&data[pos], '$', len - pos);
+                if (start == nullptr)
+                    return len;
+                pos = start - data;
+                m_frameStart = pos;
+                m_frameInSource = true;
+                m_frameLen = 0;
+                m_state = STATE_HEADER;
+                m_headerLen = 0;
+            }
+
+            if (m_state == STATE_PAYLOAD)
+            {
+                size_t chunk = m_remaining < len - pos ? m_remaining : len - pos;
+                m_crc = m_version == MSP_PARSER_V2 ? crc8_dvb_s2_update(m_crc, &data[pos], chunk) : xorSpan(m_crc, &data[pos], chunk);
+                append(&data[pos], chunk);
+                pos += chunk;
+                m_remaining -= chunk;
+                if (m_remaining == 0)
+                    m_state = STATE_CHECKSUM;
+                continue;
+            }
+
+            if (m_state == STATE_SKIP)
+            {
+                size_t chunk = m_remaining < len - pos ? m_remaining : len - pos;
+                pos += chunk;
+                m_remaining -= chunk;
+                if (m_remaining == 0)
+                    m_state = STATE_IDLE;
+                continue;
+            }
+
+            const uint8_t c = data[pos++];
+            if (m_state == STATE_CHECKSUM)
+            {
+                append(&c, 1);
+                if (c == m_crc)
+                {
+                    m_ready = true;
+                    m_state = STATE_IDLE;
+                    return pos;
+                }
+                ++m_crcErrors;
+                m_state = STATE_IDLE;
+                continue;
+            }
+
+            // STATE_HEADER
+            append(&c, 1);
+            m_header[m_headerLen++] = c;
+            if (!processHeader())
+            {
+                // Not a frame after all, restart the search after the '$'
+                pos = restartAfterBadHeader(data, pos);
+            }
+        }
+
+        // Frame continues in the next buffer, make sure what we have so far is in our own buffer
+        if (m_state != STATE_IDLE && m_state != STATE_SKIP && m_frameInSource)
+        {
+            memcpy(m_buffer, &data[m_frameStart], m_frameLen);
+            m_frameInSource = false;
+        }
+        return pos;
+    }
+
+    bool frameReady() const { return m_ready; }
+    void markFrameConsumed() { m_ready = false; }
+
+    // Whole frame including the $ header and the checksum
+    const uint8_t *getFrame() const { return m_frameInSource ? &m_source[m_frameStart] : m_buffer; }
+    uint16_t getFrameLen() const { return m_frameLen; }
+
+    const uint8_t *getPayload() const { return getFrame() + m_payloadOffset; }
+    uint16_t getPayloadSize() const { return m_payloadSize; }
+    uint16_t getFunction() const { return m_function; }
+    uint8_t getFlags() const { return m_flags; }
+    // The direction char, '<' command, '>' response or '!' error
+    uint8_t getType() const { return m_header[2]; }
+    mspParserVersion_e getVersion() const { return m_version; }
+
+    uint32_t getCrcErrors() const { return m_crcErrors; }
+    uint32_t getOversizeFrames() const { return m_oversizeFrames; }
+
+private:
+    enum {
+        STATE_IDLE,
+        STATE_HEADER,
+        STATE_PAYLOAD,
+        STATE_CHECKSUM,
+        STATE_SKIP,
+    } m_state;
+
+    bool m_ready;
+    const uint8_t *m_source;
+    size_t m_frameStart;
+    bool m_frameInSource;
+    uint16_t m_frameLen;
+
+    uint8_t m_header[MAX_HEADER_LEN];
+    uint8_t m_headerLen;
+    mspParserVersion_e m_version;
+    uint8_t m_flags;
+    uint16_t m_function;
+    uint16_t m_payloadSize;
+    uint16_t m_payloadOffset;
+    uint16_t m_remaining;
+    uint8_t m_crc;
+
+    uint32_t m_crcErrors = 0;
+    uint32_t m_oversizeFrames = 0;
+
+    uint8_t m_buffer[MAX_FRAME_LEN];
+
+    static uint8_t xorSpan(uint8_t crc, const uint8_t *data, size_t len)
+    {
+        while (len--)
+            crc ^= *data++;
+        return crc;
+    }
+
+    void append(const uint8_t *data, size_t len)
+    {
+        if (!m_frameInSource)
+            memcpy(&m_buffer[m_frameLen], data, len);
+        m_frameLen += len;
+    }
+
+    size_t restartAfterBadHeader(const uint8_t *data, size_t pos)
+    {
+        m_state = STATE_IDLE;
+        if (m_frameInSource)
+            return m_frameStart + 1;
+        // The start of the frame was in a previous buffer, only the current byte can start a new frame
+        return data[pos - 1] == '$' ? pos - 1 : pos;
+    }
+
+    void startPayload(uint16_t payloadSize, uint8_t crc)
+    {
+        m_payloadSize = payloadSize;
+        m_payloadOffset = m_headerLen;
+        m_remaining = payloadSize;
+        m_crc = crc;
+        if (payloadSize > MaxPayload)
+        {
+            // Too big to buffer, skip the payload and checksum
+            ++m_oversizeFrames;
+            m_remaining = payloadSize + 1;
+            m_state = STATE_SKIP;
+        }
+        else
+        {
+            m_state = payloadSize ? STATE_PAYLOAD : STATE_CHECKSUM;
+        }
+    }
+
+    // Returns false if the header is not valid
+    bool processHeader()
+    {
+        const uint8_t *h = m_header;
+        switch (m_headerLen)
+        {
+        case 2:
+            if (h[1] == 'X')
+                m_version = MSP_PARSER_V2;
+            else if (h[1] == 'M')
+                m_version = MSP_PARSER_V1;
+            else
+                return false;
+            return true;
+        case 3:
+            return h[2] == '<' || h[2] == '>' || h[2] == '!';
+        case 5:
+            if (m_version == MSP_PARSER_V1)
+            {
+                if (h[3] == 0xFF)
+                {
+                    m_version = MSP_PARSER_V1_JUMBO;
+                    return true;
+                }
+                m_flags = 0;
+                m_function = h[4];
+                startPayload(h[3], h[3] ^ h[4]);
+            }
+            return true;
+        case 7:
+            if (m_version == MSP_PARSER_V1_JUMBO)
+            {
+                m_flags = 0;
+                m_function = h[4];
+                startPayload(h[5] | (h[6] << 8), h[3] ^ h[4] ^ h[5] ^ h[6]);
+            }
+            return true;
+        case 8:
+            m_flags = h[3];
+            m_function = h[4] | (h[5] << 8);
+            startPayload(h[6] | (h[7] << 8), crc8_dvb_s2_update(0, &h[3], 5));
+            return true;
+        default:
+            return true;
+        }
+    }
+};
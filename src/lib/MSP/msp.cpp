@@ -1,4 +1,5 @@
 #include "msp.h"
+#include "crc.h"
 
 #include "logging.h"
 
@@ -16,125 +17,60 @@ Offset: Usage:         In CRC:  Comment:
 n+8     checksum                uint8, (n= payload size), crc8_dvb_s2 checksum
 ========================================== */
 
+static GENERIC_CRC8 crc8_dvb_s2_calc(0xD5);
+
 // CRC helper function. External to MSP class
-// TODO: Move all our CRC functions to a CRC lib
 uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a)
 {
-    crc ^= a;
-    for (int ii = 0; ii < 8; ++ii) {
-        if (crc & 0x80) {
-            crc = (crc << 1) ^ 0xD5;
-        } else {
-            crc = crc << 1;
-        }
-    }
-    return crc;
+    return crc8_dvb_s2_calc.calc(&a, 1, crc);
+}
+
+uint8_t crc8_dvb_s2_update(uint8_t crc, const uint8_t *data, size_t len)
+{
+    return crc8_dvb_s2_calc.calc(data, len, crc);
 }
 
 bool
 MSP::processReceivedByte(uint8_t c)
 {
-    switch (m_inputState) {
-
-        case MSP_IDLE:
-            // Wait for framing char
-            if (c == '$') {
-                m_inputState = MSP_HEADER_START;
-            }
-            break;
-
-        case MSP_HEADER_START:
-            // Waiting for 'X' (MSPv2 native)
-            switch (c) {
-                case 'X':
-                    m_inputState = MSP_HEADER_X;
-                    break;
-                default:
-                    m_inputState = MSP_IDLE;
-                    break;
-            }
-            break;
-
-        case MSP_HEADER_X:
-            // Wait for the packet type (cmd or req)
-            m_inputState = MSP_HEADER_V2_NATIVE;
-
-            // Start of a new packet
-            // reset the packet, offset iterator, and CRC
-            m_packet.reset();
-            m_offset = 0;
-            m_crc = 0;
-
-            switch (c) {
-                case '<':
-                    m_packet.type = MSP_PACKET_COMMAND;
-                    break;
-                case '>':
-                    m_packet.type = MSP_PACKET_RESPONSE;
-                    break;
-                default:
-                    m_packet.type = MSP_PACKET_UNKNOWN;
-                    m_inputState = MSP_IDLE;
-                    break;
-            }
-            break;
+    if (m_inputState == MSP_COMMAND_RECEIVED) {
+        // The previous packet has not been marked as received, this byte is dropped
+        m_inputState = MSP_IDLE;
+        return false;
+    }
 
-        case MSP_HEADER_V2_NATIVE:
-            // Read bytes until we have a full header
-            m_inputBuffer[m_offset++] = c;
-            m_crc = crc8_dvb_s2(m_crc, c);
-
-            // If we've received the correct amount of bytes for a full header
-            if (m_offset == sizeof(mspHeaderV2_t)) {
-                // Copy header values into packet
-                mspHeaderV2_t* header = (mspHeaderV2_t*)&m_inputBuffer[0];
-                m_packet.payloadSize = header->payloadSize;
-                m_packet.function = header->function;
-                m_packet.flags = header->flags;
-                // reset the offset iterator for re-use in payload below
-                m_offset = 0;
-				if (m_packet.payloadSize == 0)
-                	m_inputState = MSP_CHECKSUM_V2_NATIVE;
-				else
-                	m_inputState = MSP_PAYLOAD_V2_NATIVE;
-            }
-            break;
+    m_parser.parse(&c, 1);
+    if (!m_parser.frameReady()) {
+        return false;
+    }
+    m_parser.markFrameConsumed();
 
-        case MSP_PAYLOAD_V2_NATIVE:
-            // Read bytes until we reach payloadSize
-            m_packet.payload[m_offset++] = c;
-            m_crc = crc8_dvb_s2(m_crc, c);
+    // Only MSPv2 native command and response frames are handled here
+    if (m_parser.getVersion() != MSP_PARSER_V2) {
+        return false;
+    }
 
-            // If we've received the correct amount of bytes for payload
-            if (m_offset == m_packet.payloadSize) {
-                // Then we're up to the CRC
-                m_inputState = MSP_CHECKSUM_V2_NATIVE;
-            }
+    m_packet.reset();
+    switch (m_parser.getType()) {
+        case '<':
+            m_packet.type = MSP_PACKET_COMMAND;
             break;
-
-        case MSP_CHECKSUM_V2_NATIVE:
-            // Assert that the checksums match
-            if (m_crc == c) {
-                m_inputState = MSP_COMMAND_RECEIVED;
-            }
-            else {
-                DBGLN("CRC failure on MSP packet - Got %d expected %d", c, m_crc);
-                m_inputState = MSP_IDLE;
-            }
+        case '>':
+            m_packet.type = MSP_PACKET_RESPONSE;
             break;
-        
         default:
-            m_inputState = MSP_IDLE;
-            break;
+            return false;
     }
+    m_packet.flags = m_parser.getFlags();
+    m_packet.function = m_parser.getFunction();
+    m_packet.payloadSize = m_parser.getPayloadSize();
+    memcpy(m_packet.payload, m_parser.getPayload(), m_packet.payloadSize);
 
-    // If we've successfully parsed a complete packet
+    // We've successfully parsed a complete packet
     // return true so the calling function knows that
     // a new packet is ready.
-    if (m_inputState == MSP_COMMAND_RECEIVED) {
-        return true;
-    }
-    return false;
+    m_inputState = MSP_COMMAND_RECEIVED;
+    return true;
 }
 
 mspPacket_t*
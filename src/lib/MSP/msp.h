@@ -1,10 +1,11 @@
 #pragma once
 
 #include "targets.h"
+#include "MSPParser.h"
 
-// TODO: MSP_PORT_INBUF_SIZE should be changed to
-// dynamically allocate array length based on the payload size
-// Hardcoding payload size to 64 bytes for now, to match CRSF TLM
+// Payload size of mspPacket_t, 64 bytes to match CRSF TLM. This is also the limit for
+// MSP::processReceivedByte (the backpack link), larger frames are skipped. Streams with larger
+// frames, e.g. MSP2WIFI, use an MSPParser sized for them (MSP_PAYLOAD_MAX_LEN, v1 jumbo included)
 #define MSP_PORT_INBUF_SIZE 64
 
 #define CHECK_PACKET_PARSING() \
@@ -14,13 +15,6 @@
 
 typedef enum {
     MSP_IDLE,
-    MSP_HEADER_START,
-    MSP_HEADER_X,
-
-    MSP_HEADER_V2_NATIVE,
-    MSP_PAYLOAD_V2_NATIVE,
-    MSP_CHECKSUM_V2_NATIVE,
-
     MSP_COMMAND_RECEIVED
 } mspState_e;
 
@@ -93,9 +87,7 @@ public:
     static bool     sendPacket(mspPacket_t* packet, Stream* port);
 
 private:
-    mspState_e  m_inputState;
-    uint16_t    m_offset;
-    uint8_t     m_inputBuffer[MSP_PORT_INBUF_SIZE];
+    mspState_e  m_inputState = MSP_IDLE;
+    MSPParser<MSP_PORT_INBUF_SIZE> m_parser;
     mspPacket_t m_packet;
-    uint8_t     m_crc;
 };
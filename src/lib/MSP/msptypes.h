@@ -2,7 +2,17 @@
 
 #define MSP_ELRS_FUNC       0x4578 // ['E','x']
 
+#define MSP_API_VERSION     1    //out message         API version
+#define MSP_FC_VARIANT      2    //out message         FC variant identifier
+#define MSP_FC_VERSION      3    //out message         FC firmware version
+#define MSP_BOARD_INFO      4    //out message         Board and target information
+#define MSP_BUILD_INFO      5    //out message         Build date and revision
+#define MSP_NAME            10   //out message         Craft name
+#define MSP_SET_NAME        11   //in message          Set craft name
+#define MSP_FEATURE_CONFIG  36   //out message         Enabled features
+#define MSP_SET_FEATURE_CONFIG 37 //in message         Set enabled features
 #define MSP_SET_RX_CONFIG   45
+#define MSP_REBOOT          68   //in message          Reboot the FC
 #define MSP_VTX_CONFIG      88   //out message         Get vtx settings - betaflight
 #define MSP_SET_VTX_CONFIG  89   //in message          Set vtx settings - betaflight
 
@@ -12,6 +22,7 @@
 #define MSP_VTXTABLE_POWERLEVEL         138 //out message         vtxTable powerLevel data
 #define MSP_SET_VTXTABLE_POWERLEVEL     228 //in message          set vtxTable powerLevel data (one powerLevel at a time)
 
+#define MSP_UID             160  //out message         Unique device ID
 #define MSP_EEPROM_WRITE    250  //in message          no param
 
 // ELRS specific opcodes
@@ -391,7 +391,8 @@ device_t MSPVTx_device = {
     .initialize = initialize,
     .start = nullptr,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "MSPVTX",
 };
 
 #endif
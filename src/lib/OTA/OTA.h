@@ -42,6 +42,7 @@ typedef struct {
     uint8_t lq:7,
             mspConfirm:1;
     int8_t SNR;
+    uint8_t tlmQueued; // Telemetry waiting on the RX, in TLM_QUEUED_UNIT bytes
 } PACKED OTA_LinkStats_s;
 
 typedef struct {
@@ -79,7 +80,6 @@ typedef struct {
             union {
                 struct {
                     OTA_LinkStats_s stats;
-                    uint8_t free;
                 } PACKED ul_link_stats;
                 uint8_t payload[ELRS4_TELEMETRY_BYTES_PER_CALL];
             };
@@ -44,6 +44,7 @@ PowerLevels_e crsfpowerToPower(uint8_t crsfpower)
 #include "device.h"
 #include "DAC.h"
 #include "helpers.h"
+#include "FHSS.h"
 
 /*
  * Moves the power management values and special cases out of the main code and into `targets.h`.
@@ -93,7 +94,16 @@ static const int16_t *powerValues = nullptr;
 #endif
 #endif
 
-static int8_t powerCaliValues[PWR_COUNT] = {0};
+// The most channels of any regulatory domain
+#define POWER_CALI_MAX_CHANNELS 80
+
+static int8_t powerCaliValues[PWR_COUNT][POWER_CALI_BANDS] = {{0}};
+// Offset for each channel at the current power level, interpolated from powerCaliValues
+static int8_t channelCaliValues[POWER_CALI_MAX_CHANNELS] = {0};
+static uint8_t currentChannel = 0;
+// Only when the output is set from powerValues, the other methods aren't calibrated
+static bool channelCaliActive = false;
+int8_t POWERMGNT::CurrentCaliOffset = 0;
 
 #if defined(PLATFORM_ESP32)
 nvs_handle POWERMGNT::handle = 0;
@@ -123,7 +133,7 @@ void POWERMGNT::incSX1280Output()
     if (CurrentSX1280Power < 13 && CurrentSX1280Power < powerValues[CurrentPower] + 3)
     {
         CurrentSX1280Power++;
-        Radio.SetOutputPower(CurrentSX1280Power);
+        Radio.SetOutputPower(channelOutput());
     }
 }
 
@@ -133,7 +143,7 @@ void POWERMGNT::decSX1280Output()
     if (CurrentSX1280Power > -18 && CurrentSX1280Power > powerValues[CurrentPower] - 3)
     {
         CurrentSX1280Power--;
-        Radio.SetOutputPower(CurrentSX1280Power);
+        Radio.SetOutputPower(channelOutput());
     }
 }
 
@@ -162,11 +172,13 @@ uint8_t POWERMGNT::getPowerIndBm()
 void POWERMGNT::SetPowerCaliValues(int8_t *values, size_t size)
 {
     bool isUpdate = false;
+    int8_t *cali = &powerCaliValues[0][0];
+    size = std::min(size, sizeof(powerCaliValues));
     for(size_t i=0 ; i<size ; i++)
     {
-        if(powerCaliValues[i] != values[i])
+        if(cali[i] != values[i])
         {
-            powerCaliValues[i] = values[i];
+            cali[i] = values[i];
             isUpdate = true;
         }
     }
@@ -176,16 +188,47 @@ void POWERMGNT::SetPowerCaliValues(int8_t *values, size_t size)
         nvs_set_blob(handle, "powercali", &powerCaliValues, sizeof(powerCaliValues));
     }
     nvs_commit(handle);
-#else
-    UNUSED(isUpdate);
 #endif
+    if (isUpdate && CurrentPower != PWR_COUNT)
+    {
+        // Apply it now, setPower() would see no change in level
+        PowerLevels_e power = CurrentPower;
+        CurrentPower = PWR_COUNT;
+        setPower(power);
+    }
 }
 
 void POWERMGNT::GetPowerCaliValues(int8_t *values, size_t size)
 {
+    const int8_t *cali = &powerCaliValues[0][0];
+    size = std::min(size, sizeof(powerCaliValues));
     for(size_t i=0 ; i<size ; i++)
     {
-        *(values + i) = powerCaliValues[i];
+        *(values + i) = cali[i];
+    }
+}
+
+void POWERMGNT::UpdateChannelCali()
+{
+    uint32_t count = std::min(FHSSconfig->freq_count, (uint32_t)POWER_CALI_MAX_CHANNELS);
+    for (uint32_t channel = 0; channel < count; channel++)
+    {
+        channelCaliValues[channel] = powerCaliInterpolate(powerCaliValues[CurrentPower], channel, count);
+    }
+}
+
+int8_t ICACHE_RAM_ATTR POWERMGNT::channelOutput()
+{
+    // CurrentSX1280Power holds the offset of the channel in use when it was set
+    return CurrentSX1280Power + channelCaliValues[currentChannel] - CurrentCaliOffset;
+}
+
+void ICACHE_RAM_ATTR POWERMGNT::setChannel(uint8_t channel)
+{
+    currentChannel = std::min(channel, (uint8_t)(POWER_CALI_MAX_CHANNELS - 1));
+    if (channelCaliActive)
+    {
+        powerCaliSetHopOutput(Radio, channelOutput());
     }
 }
 
@@ -209,6 +252,21 @@ void POWERMGNT::LoadCalibration()
         size_t size = sizeof(powerCaliValues);
         nvs_get_blob(handle, "powercali", &powerCaliValues, &size);
     }
+    else if (nvs_get_u32(handle, "calversion", &version) != ESP_ERR_NVS_NOT_FOUND
+        && version == (uint32_t)(1 | CALIBRATION_MAGIC))
+    {
+        // Version 1 had a single offset per power level, which applies to every band
+        int8_t values[PWR_COUNT] = {0};
+        size_t size = sizeof(values);
+        nvs_get_blob(handle, "powercali", &values, &size);
+        for (uint8_t power = 0; power < PWR_COUNT; power++)
+        {
+            memset(powerCaliValues[power], values[power], POWER_CALI_BANDS);
+        }
+        nvs_set_blob(handle, "powercali", &powerCaliValues, sizeof(powerCaliValues));
+        nvs_set_u32(handle, "calversion", CALIBRATION_VERSION | CALIBRATION_MAGIC);
+        nvs_commit(handle);
+    }
     else
     {
         nvs_set_blob(handle, "powercali", &powerCaliValues, sizeof(powerCaliValues));
@@ -306,7 +364,12 @@ void POWERMGNT::setPower(PowerLevels_e Power)
     }
     else if (powerValues != nullptr)
     {
-        CurrentSX1280Power = powerValues[Power - MinPower] + powerCaliValues[Power];
+        CurrentPower = Power;
+        UpdateChannelCali();
+        CurrentCaliOffset = channelCaliValues[currentChannel];
+        CurrentSX1280Power = powerValues[Power - MinPower] + CurrentCaliOffset;
+        channelCaliActive = true;
+        DBGLN("SetPower: %d", CurrentSX1280Power);
         Radio.SetOutputPower(CurrentSX1280Power);
     }
 #endif
@@ -38,6 +38,47 @@ typedef enum
 uint8_t powerToCrsfPower(PowerLevels_e Power);
 PowerLevels_e crsfpowerToPower(uint8_t crsfpower);
 
+// Number of frequency bands across the regulatory domain each power level is calibrated for
+#define POWER_CALI_BANDS 4
+
+/**
+ * @brief The calibration offset for a channel, interpolated between the calibration points
+ * of the bands either side of it. The first band is calibrated at the lowest channel and
+ * the last at the highest, with the others evenly spaced between.
+ *
+ * @param cali the offsets for each band at one power level
+ * @param channel the channel index, in order of frequency
+ * @param channelCount the number of channels in the domain
+ */
+static inline int8_t powerCaliInterpolate(const int8_t cali[POWER_CALI_BANDS], uint32_t channel, uint32_t channelCount)
+{
+    if (channelCount < 2)
+        return cali[0];
+    // Position in 1/(channelCount - 1) of a band
+    uint32_t pos = channel * (POWER_CALI_BANDS - 1);
+    uint32_t band = pos / (channelCount - 1);
+    if (band >= POWER_CALI_BANDS - 1)
+        return cali[POWER_CALI_BANDS - 1];
+    int32_t frac = pos - band * (channelCount - 1);
+    int32_t delta = (cali[band + 1] - cali[band]) * frac;
+    // Round to nearest, away from zero at the halves
+    int32_t half = (delta < 0 ? -1 : 1) * (int32_t)(channelCount - 1) / 2;
+    return cali[band] + (delta + half) / (int32_t)(channelCount - 1);
+}
+
+/**
+ * @brief Set the output power for the channel just hopped to. SetOutputPower() only takes
+ * effect after the next transmit, which would send the first packet on the new channel with
+ * the old channel's offset, so it is committed now. The hop is done after transmitting,
+ * while the radio is idle and the power can be changed.
+ */
+template <class RadioDriver>
+static inline void powerCaliSetHopOutput(RadioDriver &radio, int8_t output)
+{
+    radio.SetOutputPower(output);
+    radio.CommitOutputPower();
+}
+
 class PowerLevelContainer
 {
 protected:
@@ -57,7 +98,10 @@ private:
 #if defined(PLATFORM_ESP32)
     static nvs_handle  handle;
 #endif
+    static int8_t CurrentCaliOffset;
     static void LoadCalibration();
+    static void UpdateChannelCali();
+    static int8_t channelOutput();
 
 public:
     /**
@@ -165,12 +209,25 @@ public:
      */
     static void init();
 
+    /**
+     * @brief Apply the calibration for the channel about to be used, from the table
+     * precomputed for the current power level. Called on each hop, after transmitting,
+     * and takes effect for the next packet.
+     *
+     * @param channel the channel index of the new frequency
+     */
+    static void setChannel(uint8_t channel);
+
+    /**
+     * @brief Set or get the calibration offsets, PWR_COUNT x POWER_CALI_BANDS values with
+     * the bands of each power level together
+     */
     static void SetPowerCaliValues(int8_t *values, size_t size);
     static void GetPowerCaliValues(int8_t *values, size_t size);
 };
 
 
 #define CALIBRATION_MAGIC    0x43414C << 8   //['C', 'A', 'L']
-#define CALIBRATION_VERSION   1
+#define CALIBRATION_VERSION   2
 
 #endif /* !UNIT_TEST */
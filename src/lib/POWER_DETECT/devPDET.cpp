@@ -96,6 +96,7 @@ device_t PDET_device = {
     .initialize = NULL,
     .start = start,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "PDET",
 };
 #endif
\ No newline at end of file
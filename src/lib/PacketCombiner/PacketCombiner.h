@@ -0,0 +1,77 @@
+#pragma once
+
+#include "targets.h"
+#include <string.h>
+
+// The most bits the copies can differ by, each one doubles the candidates checked. Every
+// candidate is another 1 in 2^CRC bits chance of a corrupt packet passing, so the 14 bit CRC
+// of OTA4 packets gets fewer than the 16 bit CRC of OTA8.
+#define PACKET_COMBINE_MAX_BITS_OTA4 3
+#define PACKET_COMBINE_MAX_BITS_OTA8 5
+#define PACKET_COMBINE_MAX_BITS PACKET_COMBINE_MAX_BITS_OTA8
+
+/**
+ * @brief Recover a packet from two copies which both failed their CRC, as received by the
+ * two radios of a dual radio receiver. Where the copies agree they are taken as right, and
+ * where they differ each combination of the differing bits is checked against the CRC.
+ * Combinations taking the fewest bits from the weaker copy are tried first, so the copy from
+ * the radio with the stronger signal is favoured.
+ *
+ * Each candidate checked is another chance of a corrupt packet passing the CRC, so the
+ * copies must not differ by more than maxBits, 2^maxBits - 2 candidates.
+ *
+ * @param out the recovered packet, only meaningful if true is returned
+ * @param stronger the copy from the radio with the stronger signal
+ * @param weaker the copy from the other radio
+ * @param len the length of the packet
+ * @param maxBits the most bits the copies can differ by, up to PACKET_COMBINE_MAX_BITS
+ * @param validate bool validate(uint8_t *packet), true if the packet's CRC is right
+ * @return true if a combination passed the CRC
+ */
+template <typename Validate>
+bool ICACHE_RAM_ATTR PacketCombine(uint8_t *out, const uint8_t *stronger, const uint8_t *weaker, uint8_t len, uint8_t maxBits, Validate validate)
+{
+    // Where the copies differ, as byte index and bit mask
+    uint8_t diffByte[PACKET_COMBINE_MAX_BITS];
+    uint8_t diffMask[PACKET_COMBINE_MAX_BITS];
+    uint8_t diffCount = 0;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        uint8_t diff = stronger[i] ^ weaker[i];
+        while (diff)
+        {
+            if (diffCount == maxBits || diffCount == PACKET_COMBINE_MAX_BITS)
+                return false;
+            uint8_t bit = diff & -diff;
+            diffByte[diffCount] = i;
+            diffMask[diffCount] = bit;
+            ++diffCount;
+            diff &= ~bit;
+        }
+    }
+
+    // Each copy on its own has already failed, so there is nothing to combine unless they
+    // differ by at least two bits
+    if (diffCount < 2)
+        return false;
+
+    // Every mix of the differing bits except all or none from the weaker copy, fewest first
+    uint8_t const all = (1 << diffCount) - 1;
+    for (uint8_t fromWeaker = 1; fromWeaker < diffCount; fromWeaker++)
+    {
+        for (uint8_t mix = 1; mix < all; mix++)
+        {
+            if (__builtin_popcount(mix) != fromWeaker)
+                continue;
+            memcpy(out, stronger, len);
+            for (uint8_t d = 0; d < diffCount; d++)
+            {
+                if (mix & (1 << d))
+                    out[diffByte[d]] ^= diffMask[d];
+            }
+            if (validate(out))
+                return true;
+        }
+    }
+    return false;
+}
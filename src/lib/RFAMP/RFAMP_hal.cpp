@@ -1,5 +1,3 @@
-#ifndef UNIT_TEST
-
 #include "RFAMP_hal.h"
 #include "logging.h"
 
@@ -273,5 +271,3 @@ void ICACHE_RAM_ATTR RFAMP_hal::TXRXdisable()
     }
 #endif
 }
-
-#endif // UNIT_TEST
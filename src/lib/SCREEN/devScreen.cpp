@@ -200,5 +200,7 @@ device_t Screen_device = {
     .initialize = initialize,
     .start = start,
     .event = event,
-    .timeout = timeout};
+    .timeout = timeout,
+    .name = "Screen",
+};
 #endif
\ No newline at end of file
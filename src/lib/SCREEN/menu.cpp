@@ -242,12 +242,15 @@ static void saveValueIndex(bool init)
             // If the switch mode is going to change, block the change while connected
             if (newSwitchMode == OtaSwitchModeCurrent || connectionState == disconnected)
             {
-                deferExecutionMillis(100, [actualRate, newSwitchMode](){
+                // The rate and switch mode are packed into the context
+                deferExecutionMillis(100, [](void *context){
+                    uint8_t actualRate = (uintptr_t)context >> 8;
+                    uint8_t newSwitchMode = (uintptr_t)context & 0xFF;
                     config.SetRate(actualRate);
                     config.SetSwitchMode(newSwitchMode);
                     OtaUpdateSerializers((OtaSwitchMode_e)newSwitchMode, ExpressLRS_currAirRate_Modparams->PayloadLength);
                     SetSyncSpam();
-                });
+                }, (void *)(uintptr_t)(actualRate << 8 | newSwitchMode));
             }
             break;
         }
@@ -256,11 +259,12 @@ static void saveValueIndex(bool init)
             // the pack and unpack functions are matched
             if (connectionState == disconnected)
             {
-                deferExecutionMillis(100, [val](){
+                deferExecutionMillis(100, [](void *context){
+                    uint8_t val = (uintptr_t)context;
                     config.SetSwitchMode(val);
                     OtaUpdateSerializers((OtaSwitchMode_e)val, ExpressLRS_currAirRate_Modparams->PayloadLength);
                     SetSyncSpam();
-                });
+                }, (void *)(uintptr_t)val);
             }
             break;
         }
@@ -268,10 +272,10 @@ static void saveValueIndex(bool init)
             config.SetAntennaMode(values_index);
             break;
         case STATE_TELEMETRY:
-            deferExecutionMillis(100, [val](){
-                config.SetTlm(val);
+            deferExecutionMillis(100, [](void *context){
+                config.SetTlm((uintptr_t)context);
                 SetSyncSpam();
-            });
+            }, (void *)(uintptr_t)val);
             break;
         case STATE_POWERSAVE:
             config.SetMotionMode(values_index);
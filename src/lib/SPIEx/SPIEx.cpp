@@ -4,8 +4,12 @@
 #include <soc/spi_struct.h>
 #endif
 
+#if !defined(UNIT_TEST)
 void ICACHE_RAM_ATTR SPIExClass::_transfer(uint8_t cs_mask, uint8_t *data, uint32_t size, bool reading)
 {
+#if defined(DEBUG_SPI_TRACE)
+    spiTrace.record(cs_mask, data, size, reading);
+#endif
 #if defined(PLATFORM_ESP32)
     spi_dev_t *spi = *(reinterpret_cast<spi_dev_t**>(bus()));
     // wait for SPI to become non-busy
@@ -87,7 +91,12 @@ void ICACHE_RAM_ATTR SPIExClass::_transfer(uint8_t cs_mask, uint8_t *data, uint3
     transfer(data, size);
     digitalWrite(GPIO_PIN_NSS, HIGH);
 #endif
+#if defined(DEBUG_SPI_TRACE)
+    if (reading)
+        spiTrace.recordRead(data, size);
+#endif
 }
+#endif
 
 #if defined(PLATFORM_ESP32_S3) || defined(PLATFORM_ESP32_C3)
 SPIExClass SPIEx(FSPI);
@@ -1,4 +1,19 @@
 #include "targets.h"
+#include "SPITrace.h"
+
+#if defined(UNIT_TEST)
+/**
+ * @brief The native stand in for SPIEx, there is no bus and the transactions go to spiTrace
+ */
+class SPIExClass
+{
+public:
+    void begin() {}
+    void end() {}
+    void read(uint8_t cs_mask, uint8_t *data, uint32_t size) { spiTrace.transfer(cs_mask, data, size, true); }
+    void write(uint8_t cs_mask, uint8_t * data, uint32_t size) { spiTrace.transfer(cs_mask, data, size, false); }
+};
+#else
 #include <SPI.h>
 
 /**
@@ -50,5 +65,6 @@ public:
 private:
     void _transfer(uint8_t cs_mask, uint8_t *data, uint32_t size, bool reading);
 };
+#endif
 
 extern SPIExClass SPIEx;
@@ -0,0 +1,100 @@
+#include "SPITrace.h"
+
+#if defined(SPI_TRACE_ENABLED)
+
+SPITrace spiTrace;
+
+void SPITrace::reset()
+{
+    recorded = 0;
+    pendingBusy = 0;
+    memset(&stats, 0, sizeof(stats));
+    golden = nullptr;
+    goldenCount = 0;
+    replayIndex = 0;
+    mismatch = -1;
+}
+
+void ICACHE_RAM_ATTR SPITrace::record(uint8_t csMask, const uint8_t *data, uint32_t size, bool reading)
+{
+    const uint8_t len = size < SPITRACE_MAX_BYTES ? size : SPITRACE_MAX_BYTES;
+    const bool repeat = recorded > 0 && !reading && !last().reading &&
+        last().csMask == csMask && last().size == size && memcmp(last().out, data, len) == 0;
+
+    spiTraceEntry_t &e = entries[recorded++ % SPITRACE_SIZE];
+    e.csMask = csMask;
+    e.reading = reading;
+    e.size = size;
+    memcpy(e.out, data, len);
+    memset(e.in, 0, sizeof(e.in));
+    e.micros = micros();
+    e.busyMicros = pendingBusy > UINT16_MAX ? UINT16_MAX : pendingBusy;
+
+    stats.transactions++;
+    stats.bytes += size;
+    stats.busyMicros += pendingBusy;
+    if (e.busyMicros > stats.maxBusyMicros)
+        stats.maxBusyMicros = e.busyMicros;
+    if (repeat)
+        stats.repeats++;
+    pendingBusy = 0;
+}
+
+void ICACHE_RAM_ATTR SPITrace::recordRead(const uint8_t *data, uint32_t size)
+{
+    if (recorded == 0)
+        return;
+    memcpy(last().in, data, size < SPITRACE_MAX_BYTES ? size : SPITRACE_MAX_BYTES);
+}
+
+const spiTraceEntry_t &SPITrace::entry(uint16_t index) const
+{
+    const uint32_t first = recorded < SPITRACE_SIZE ? 0 : recorded - SPITRACE_SIZE;
+    return entries[(first + index) % SPITRACE_SIZE];
+}
+
+void SPITrace::replay(const spiTraceEntry_t *trace, uint16_t count)
+{
+    golden = trace;
+    goldenCount = count;
+    replayIndex = 0;
+    mismatch = -1;
+}
+
+void SPITrace::transfer(uint8_t csMask, uint8_t *data, uint32_t size, bool reading)
+{
+    record(csMask, data, size, reading);
+    if (golden == nullptr)
+    {
+        if (reading)
+            memset(data, 0, size);
+        return;
+    }
+
+    const uint8_t len = size < SPITRACE_MAX_BYTES ? size : SPITRACE_MAX_BYTES;
+    if (replayIndex >= goldenCount)
+    {
+        if (mismatch < 0)
+            mismatch = replayIndex;
+        if (reading)
+            memset(data, 0, size);
+        return;
+    }
+
+    const spiTraceEntry_t &expected = golden[replayIndex];
+    if (mismatch < 0 && (expected.csMask != csMask || expected.reading != reading ||
+        expected.size != size || memcmp(expected.out, data, len) != 0))
+    {
+        mismatch = replayIndex;
+    }
+    replayIndex++;
+
+    if (reading)
+    {
+        memset(data, 0, size);
+        memcpy(data, expected.in, len);
+        recordRead(data, size);
+    }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "targets.h"
+
+/**
+ * @brief A record of the radio SPI transactions, for finding redundant or slow ones and
+ * for checking the drivers' command sequences against golden traces.
+ *
+ * Built with DEBUG_SPI_TRACE on a target, SPIEx records every transaction and the HALs
+ * the time each one waited on BUSY. In native unit tests SPIEx has no hardware behind
+ * it, so it always records, and reads are answered from the golden trace passed to
+ * replay(), which every transaction is also checked against.
+ */
+
+#if defined(DEBUG_SPI_TRACE) || defined(UNIT_TEST)
+#define SPI_TRACE_ENABLED
+#endif
+
+#define SPITRACE_MAX_BYTES 16
+#if !defined(SPITRACE_SIZE)
+#define SPITRACE_SIZE 64
+#endif
+
+typedef struct {
+    uint8_t csMask;
+    bool reading;
+    uint8_t size;                     // bytes on the bus, out and in are truncated to SPITRACE_MAX_BYTES
+    uint8_t out[SPITRACE_MAX_BYTES];  // bytes sent
+    uint8_t in[SPITRACE_MAX_BYTES];   // bytes received, only if reading
+    uint32_t micros;                  // when the transaction started (not compared on replay)
+    uint16_t busyMicros;              // time spent waiting for BUSY before it (not compared on replay)
+} spiTraceEntry_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t repeats;       // writes identical to the one before to the same radios
+    uint32_t busyMicros;
+    uint16_t maxBusyMicros;
+} spiTraceStats_t;
+
+class SPITrace
+{
+public:
+    SPITrace() { reset(); }
+
+    /**
+     * @brief Clear the recorded transactions and stats, and stop any replay
+     */
+    void reset();
+
+    /**
+     * @brief Called by the HALs with the time spent waiting on BUSY before the next transaction
+     */
+    void ICACHE_RAM_ATTR busyWait(uint32_t us) { pendingBusy += us; }
+
+    /**
+     * @brief Record the start of a transaction, and for a write all of it
+     */
+    void ICACHE_RAM_ATTR record(uint8_t csMask, const uint8_t *data, uint32_t size, bool reading);
+
+    /**
+     * @brief Record the bytes read by the transaction passed to record()
+     */
+    void ICACHE_RAM_ATTR recordRead(const uint8_t *data, uint32_t size);
+
+    /**
+     * @brief Check the following transactions against the golden trace, and answer the
+     * reads with its in bytes (native only)
+     */
+    void replay(const spiTraceEntry_t *golden, uint16_t count);
+
+    /**
+     * @brief Stand in for the SPI bus: record the transaction, and replace the buffer with
+     * the replayed response if reading (native only)
+     */
+    void transfer(uint8_t csMask, uint8_t *data, uint32_t size, bool reading);
+
+    // The number of retained transactions, the oldest are dropped after SPITRACE_SIZE
+    uint16_t count() const { return recorded < SPITRACE_SIZE ? recorded : SPITRACE_SIZE; }
+    // The retained transactions, oldest first
+    const spiTraceEntry_t &entry(uint16_t index) const;
+    const spiTraceStats_t &getStats() const { return stats; }
+
+    // The number of golden transactions consumed by replay
+    uint16_t replayed() const { return replayIndex; }
+    // The index of the first transaction which did not match the golden trace, or -1
+    int16_t firstMismatch() const { return mismatch; }
+
+private:
+    spiTraceEntry_t entries[SPITRACE_SIZE];
+    uint32_t recorded;
+    uint32_t pendingBusy;
+    spiTraceStats_t stats;
+
+    const spiTraceEntry_t *golden;
+    uint16_t goldenCount;
+    uint16_t replayIndex;
+    int16_t mismatch;
+
+    spiTraceEntry_t &last() { return entries[(recorded - 1) % SPITRACE_SIZE]; }
+};
+
+#if defined(SPI_TRACE_ENABLED)
+extern SPITrace spiTrace;
+
+/**
+ * @brief Declared at the top of a HAL's WaitOnBusy() to time it
+ */
+class SPITraceBusyTimer
+{
+public:
+    SPITraceBusyTimer() : start(micros()) {}
+    ~SPITraceBusyTimer() { spiTrace.busyWait(micros() - start); }
+private:
+    uint32_t start;
+};
+#define SPI_TRACE_BUSY() SPITraceBusyTimer spiTraceBusyTimer
+#else
+#define SPI_TRACE_BUSY()
+#endif
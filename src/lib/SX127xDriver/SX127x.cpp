@@ -59,6 +59,7 @@ bool SX127xDriver::Begin(uint32_t minimumFrequency, uint32_t maximumFrequency)
   hal.IsrCallback_2 = &SX127xDriver::IsrCallback_2;
 
   hal.reset();
+  shadow.invalidate(SX12XX_Radio_All);
   DBGLN("SX127x Begin");
 
   RFAMP.init();
@@ -277,7 +278,7 @@ void SX127xDriver::SetSyncWord(uint8_t syncWord)
  * @brief: Schedule an output power change after the next transmit
  * The radio must be in SX127x_OPMODE_STANDBY to change the power
  ***/
-void SX127xDriver::SetOutputPower(uint8_t Power)
+void ICACHE_RAM_ATTR SX127xDriver::SetOutputPower(uint8_t Power)
 {
   uint8_t pwrNew;
   Power &= SX127X_PA_POWER_MASK;
@@ -353,7 +354,9 @@ void ICACHE_RAM_ATTR SX127xDriver::SetFrequencyReg(uint32_t regfreq, SX12XX_Radi
 
   WORD_ALIGNED_ATTR uint8_t outbuff[3] = {FRQ_MSB, FRQ_MID, FRQ_LSB}; //check speedup
 
-  hal.writeRegister(SX127X_REG_FRF_MSB, outbuff, sizeof(outbuff), radioNumber);
+  SX12XX_Radio_Number_t changed = shadow.update(SHADOW_FRF, outbuff, sizeof(outbuff), radioNumber);
+  if (changed)
+    hal.writeRegister(SX127X_REG_FRF_MSB, outbuff, sizeof(outbuff), changed);
 }
 
 void ICACHE_RAM_ATTR SX127xDriver::SetRxTimeoutUs(uint32_t interval)
@@ -440,6 +443,21 @@ void ICACHE_RAM_ATTR SX127xDriver::TXnbISR()
 }
 
 void ICACHE_RAM_ATTR SX127xDriver::TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+  txStage.load(data, size);
+  TXnbStaged(radioNumber);
+}
+
+/***
+ * @brief: Keep the next packet for TXnbStaged(). The FIFO is shared with RX, so unlike
+ * the SX1280/LR1121 it can't be written until the radio leaves RX to transmit.
+ ***/
+void ICACHE_RAM_ATTR SX127xDriver::TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+  txStage.load(data, size);
+}
+
+void ICACHE_RAM_ATTR SX127xDriver::TXnbStaged(SX12XX_Radio_Number_t radioNumber)
 {
   // if (currOpmode == SX127x_OPMODE_TX)
   // {
@@ -453,6 +471,7 @@ void ICACHE_RAM_ATTR SX127xDriver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
 
   if (radioNumber == SX12XX_Radio_NONE)
   {
+      txStage.clear();
       return;
   }
 
@@ -467,10 +486,22 @@ void ICACHE_RAM_ATTR SX127xDriver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
     }
 #endif
 
+  txStage.transmit(*this, radioNumber);
+}
+
+void ICACHE_RAM_ATTR SX127xDriver::TxPrepare(SX12XX_Radio_Number_t radioNumber)
+{
   RFAMP.TXenable(radioNumber);
+}
+
+void ICACHE_RAM_ATTR SX127xDriver::TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
   hal.writeRegister(SX127X_REG_FIFO_ADDR_PTR, SX127X_FIFO_TX_BASE_ADDR_MAX, radioNumber);
   hal.writeRegister(SX127X_REG_FIFO, data, size, radioNumber);
+}
 
+void ICACHE_RAM_ATTR SX127xDriver::TxStart(SX12XX_Radio_Number_t radioNumber)
+{
   SetMode(SX127x_OPMODE_TX, radioNumber);
 }
 
@@ -630,6 +661,7 @@ void SX127xDriver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t freq, uin
 void SX127xDriver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t freq, uint8_t preambleLen, uint8_t syncWord, bool InvertIQ, uint8_t _PayloadLength, uint32_t interval)
 {
   PayloadLength = _PayloadLength;
+  txStage.clear();
   ConfigLoraDefaults();
   SetPreambleLength(preambleLen);
   SetSpreadingFactor((SX127x_SpreadingFactor)sf);
@@ -42,6 +42,7 @@ public:
     void SetCRCMode(bool on); //false for off
     void SetSyncWord(uint8_t syncWord);
     void SetOutputPower(uint8_t Power);
+    void CommitOutputPower();
     void SetPreambleLength(uint8_t PreambleLen);
     void SetSpreadingFactor(SX127x_SpreadingFactor sf);
     void SetRxTimeoutUs(uint32_t interval);
@@ -75,6 +76,8 @@ public:
 
     ////////////Non-blocking TX related Functions/////////////////
     void TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXnbStaged(SX12XX_Radio_Number_t radioNumber);
     /////////////Non-blocking RX related Functions///////////////
     void RXnb();
 
@@ -94,10 +97,21 @@ private:
     int16_t pwrPending;
     uint8_t lowFrequencyMode;
 
+    // SX12xxShadow slots
+    enum
+    {
+        SHADOW_FRF,
+    };
+
     static void IsrCallback_1();
     static void IsrCallback_2();
     static void IsrCallback(SX12XX_Radio_Number_t radioNumber);
     bool RXnbISR(SX12XX_Radio_Number_t radioNumber); // ISR for non-blocking RX routine
     void TXnbISR(); // ISR for non-blocking TX routine
-    void CommitOutputPower();
+
+    // SX12xxTxStage operations
+    friend class SX12xxTxStage;
+    void TxPrepare(SX12XX_Radio_Number_t radioNumber);
+    void TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TxStart(SX12XX_Radio_Number_t radioNumber);
 };
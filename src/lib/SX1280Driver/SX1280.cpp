@@ -85,6 +85,7 @@ bool SX1280Driver::Begin(uint32_t minimumFrequency, uint32_t maximumFrequency)
     hal.IsrCallback_2 = &SX1280Driver::IsrCallback_2;
 
     hal.reset();
+    shadow.invalidate(SX12XX_Radio_All);
     DBGLN("SX1280 Begin");
 
     RFAMP.init();
@@ -164,7 +165,14 @@ void SX1280Driver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t regfreq,
     IQinverted = InvertIQ;
     packet_mode = mode;
     SetMode(SX1280_MODE_STDBY_RC, SX12XX_Radio_All);
-    hal.WriteCommand(SX1280_RADIO_SET_PACKETTYPE, mode, SX12XX_Radio_All, 20);
+    // The modulation and packet params are lost when changing packet type
+    SX12XX_Radio_Number_t changed = shadow.changed(SHADOW_PACKETTYPE, &mode, 1, SX12XX_Radio_All);
+    if (changed)
+    {
+        shadow.invalidate(changed);
+        shadow.store(SHADOW_PACKETTYPE, &mode, 1, changed);
+        hal.WriteCommand(SX1280_RADIO_SET_PACKETTYPE, mode, changed, 20);
+    }
     if (mode == SX1280_PACKET_TYPE_FLRC)
     {
         DBG("Config FLRC ");
@@ -184,6 +192,9 @@ void SX1280Driver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t regfreq,
     }
     SetFrequencyReg(regfreq);
     SetRxTimeoutUs(interval);
+    // Separate TX and RX buffers so a staged packet survives a reception
+    SetFIFOaddr(SX1280_TX_BUFFER_BASE, SX1280_RX_BUFFER_BASE);
+    txStage.clear();
 
     uint16_t dio1Mask = SX1280_IRQ_TX_DONE | SX1280_IRQ_RX_DONE;
     uint16_t irqMask  = SX1280_IRQ_TX_DONE | SX1280_IRQ_RX_DONE | SX1280_IRQ_SYNCWORD_VALID | SX1280_IRQ_SYNCWORD_ERROR | SX1280_IRQ_CRC_ERROR;
@@ -205,14 +216,13 @@ void SX1280Driver::SetRxTimeoutUs(uint32_t interval)
 /***
  * @brief: Schedule an output power change after the next transmit
  ***/
-void SX1280Driver::SetOutputPower(int8_t power)
+void ICACHE_RAM_ATTR SX1280Driver::SetOutputPower(int8_t power)
 {
     uint8_t pwrNew = constrain(power, SX1280_POWER_MIN, SX1280_POWER_MAX) + (-SX1280_POWER_MIN);
 
     if ((pwrPending == PWRPENDING_NONE && pwrCurrent != pwrNew) || pwrPending != pwrNew)
     {
         pwrPending = pwrNew;
-        DBGLN("SetPower: %u", pwrPending);
     }
 }
 
@@ -246,6 +256,7 @@ void SX1280Driver::SetMode(SX1280_RadioOperatingModes_t OPmode, SX12XX_Radio_Num
 
     case SX1280_MODE_SLEEP:
         hal.WriteCommand(SX1280_RADIO_SET_SLEEP, (uint8_t)0x01, radioNumber);
+        shadow.invalidate(radioNumber);
         break;
 
     case SX1280_MODE_CALIBRATION:
@@ -304,20 +315,25 @@ void SX1280Driver::ConfigModParamsLoRa(uint8_t bw, uint8_t sf, uint8_t cr)
 
     WORD_ALIGNED_ATTR uint8_t rfparams[3] = {sf, bw, cr};
 
-    hal.WriteCommand(SX1280_RADIO_SET_MODULATIONPARAMS, rfparams, sizeof(rfparams), SX12XX_Radio_All, 25);
+    // The SF additional config follows the modulation params, so is skipped with them
+    SX12XX_Radio_Number_t changed = shadow.update(SHADOW_MODULATIONPARAMS, rfparams, sizeof(rfparams), SX12XX_Radio_All);
+    if (!changed)
+        return;
+
+    hal.WriteCommand(SX1280_RADIO_SET_MODULATIONPARAMS, rfparams, sizeof(rfparams), changed, 25);
 
     switch (sf)
     {
     case SX1280_LORA_SF5:
     case SX1280_LORA_SF6:
-        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x1E, SX12XX_Radio_All); // for SF5 or SF6
+        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x1E, changed); // for SF5 or SF6
         break;
     case SX1280_LORA_SF7:
     case SX1280_LORA_SF8:
-        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x37, SX12XX_Radio_All); // for SF7 or SF8
+        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x37, changed); // for SF7 or SF8
         break;
     default:
-        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x32, SX12XX_Radio_All); // for SF9, SF10, SF11, SF12
+        hal.WriteRegister(SX1280_REG_SF_ADDITIONAL_CONFIG, 0x32, changed); // for SF9, SF10, SF11, SF12
     }
     // Datasheet in LoRa Operation says "After SetModulationParams command:
     // In all cases 0x1 must be written to the Frequency Error Compensation mode register 0x093C"
@@ -341,7 +357,7 @@ void SX1280Driver::SetPacketParamsLoRa(uint8_t PreambleLength, SX1280_RadioLoRaP
     buf[5] = 0x00;
     buf[6] = 0x00;
 
-    hal.WriteCommand(SX1280_RADIO_SET_PACKETPARAMS, buf, sizeof(buf), SX12XX_Radio_All, 20);
+    WriteCommandShadowed(SHADOW_PACKETPARAMS, SX1280_RADIO_SET_PACKETPARAMS, buf, sizeof(buf), SX12XX_Radio_All, 20);
 
     // FEI only triggers in Lora mode when the header is present :(
     modeSupportsFei = HeaderType == SX1280_LORA_PACKET_VARIABLE_LENGTH;
@@ -350,7 +366,7 @@ void SX1280Driver::SetPacketParamsLoRa(uint8_t PreambleLength, SX1280_RadioLoRaP
 void SX1280Driver::ConfigModParamsFLRC(uint8_t bw, uint8_t cr, uint8_t bt)
 {
     WORD_ALIGNED_ATTR uint8_t rfparams[3] = {bw, cr, bt};
-    hal.WriteCommand(SX1280_RADIO_SET_MODULATIONPARAMS, rfparams, sizeof(rfparams), SX12XX_Radio_All, 110);
+    WriteCommandShadowed(SHADOW_MODULATIONPARAMS, SX1280_RADIO_SET_MODULATIONPARAMS, rfparams, sizeof(rfparams), SX12XX_Radio_All, 110);
 }
 
 void SX1280Driver::SetPacketParamsFLRC(uint8_t HeaderType,
@@ -372,12 +388,14 @@ void SX1280Driver::SetPacketParamsFLRC(uint8_t HeaderType,
     buf[4] = PayloadLength;                     // PayloadLength
     buf[5] = SX1280_FLRC_CRC_3_BYTE;            // CrcLength
     buf[6] = 0x08;                              // Must be whitening disabled
-    hal.WriteCommand(SX1280_RADIO_SET_PACKETPARAMS, buf, sizeof(buf), SX12XX_Radio_All, 30);
+    WriteCommandShadowed(SHADOW_PACKETPARAMS, SX1280_RADIO_SET_PACKETPARAMS, buf, sizeof(buf), SX12XX_Radio_All, 30);
 
     // CRC seed (use dedicated cipher)
     buf[0] = (uint8_t)(crcSeed >> 8);
     buf[1] = (uint8_t)crcSeed;
-    hal.WriteRegister(SX1280_REG_FLRC_CRC_SEED, buf, 2, SX12XX_Radio_All);
+    SX12XX_Radio_Number_t changed = shadow.update(SHADOW_FLRC_CRC_SEED, buf, 2, SX12XX_Radio_All);
+    if (changed)
+        hal.WriteRegister(SX1280_REG_FLRC_CRC_SEED, buf, 2, changed);
 
     // Set SyncWord1
     buf[0] = (uint8_t)(syncWord >> 24);
@@ -398,7 +416,9 @@ void SX1280Driver::SetPacketParamsFLRC(uint8_t HeaderType,
             buf[3] |= 0x80; // 0x80 or 0x40 would work
     }
 
-    hal.WriteRegister(SX1280_REG_FLRC_SYNC_WORD, buf, 4, SX12XX_Radio_All);
+    changed = shadow.update(SHADOW_FLRC_SYNC_WORD, buf, 4, SX12XX_Radio_All);
+    if (changed)
+        hal.WriteRegister(SX1280_REG_FLRC_SYNC_WORD, buf, 4, changed);
 
     // FEI only works in Lora and Ranging mode
     modeSupportsFei = false;
@@ -419,18 +439,29 @@ void ICACHE_RAM_ATTR SX1280Driver::SetFrequencyReg(uint32_t regfreq, SX12XX_Radi
     buf[1] = (uint8_t)((regfreq >> 8) & 0xFF);
     buf[2] = (uint8_t)(regfreq & 0xFF);
 
-    hal.WriteCommand(SX1280_RADIO_SET_RFFREQUENCY, buf, sizeof(buf), radioNumber);
+    WriteCommandShadowed(SHADOW_RFFREQUENCY, SX1280_RADIO_SET_RFFREQUENCY, buf, sizeof(buf), radioNumber);
 
     currFreq = regfreq;
 }
 
+/***
+ * @brief: Write a configuration command only to the radios whose shadow says it would change something
+ ***/
+void ICACHE_RAM_ATTR SX1280Driver::WriteCommandShadowed(uint8_t slot, SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size,
+                                                        SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+{
+    SX12XX_Radio_Number_t changed = shadow.update(slot, buffer, size, radioNumber);
+    if (changed)
+        hal.WriteCommand(command, buffer, size, changed, busyDelay);
+}
+
 void SX1280Driver::SetFIFOaddr(uint8_t txBaseAddr, uint8_t rxBaseAddr)
 {
     uint8_t buf[2];
 
     buf[0] = txBaseAddr;
     buf[1] = rxBaseAddr;
-    hal.WriteCommand(SX1280_RADIO_SET_BUFFERBASEADDRESS, buf, sizeof(buf), SX12XX_Radio_All);
+    WriteCommandShadowed(SHADOW_BUFFERBASEADDRESS, SX1280_RADIO_SET_BUFFERBASEADDRESS, buf, sizeof(buf), SX12XX_Radio_All);
 }
 
 void SX1280Driver::SetDioIrqParams(uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2Mask, uint16_t dio3Mask)
@@ -446,7 +477,7 @@ void SX1280Driver::SetDioIrqParams(uint16_t irqMask, uint16_t dio1Mask, uint16_t
     buf[6] = (uint8_t)((dio3Mask >> 8) & 0x00FF);
     buf[7] = (uint8_t)(dio3Mask & 0x00FF);
 
-    hal.WriteCommand(SX1280_RADIO_SET_DIOIRQPARAMS, buf, sizeof(buf), SX12XX_Radio_All);
+    WriteCommandShadowed(SHADOW_DIOIRQPARAMS, SX1280_RADIO_SET_DIOIRQPARAMS, buf, sizeof(buf), SX12XX_Radio_All);
 }
 
 uint16_t ICACHE_RAM_ATTR SX1280Driver::GetIrqStatus(SX12XX_Radio_Number_t radioNumber)
@@ -457,14 +488,21 @@ uint16_t ICACHE_RAM_ATTR SX1280Driver::GetIrqStatus(SX12XX_Radio_Number_t radioN
     return status[0] << 8 | status[1];
 }
 
-void ICACHE_RAM_ATTR SX1280Driver::ClearIrqStatus(uint16_t irqMask, SX12XX_Radio_Number_t radioNumber)
+/***
+ * @brief: Clear the IRQs, and with post set don't wait for the radio to finish a command
+ * started just before, e.g. the SetRx from the TX done callback
+ ***/
+void ICACHE_RAM_ATTR SX1280Driver::ClearIrqStatus(uint16_t irqMask, SX12XX_Radio_Number_t radioNumber, bool post)
 {
     uint8_t buf[2];
 
     buf[0] = (uint8_t)(((uint16_t)irqMask >> 8) & 0x00FF);
     buf[1] = (uint8_t)((uint16_t)irqMask & 0x00FF);
 
-    hal.WriteCommand(SX1280_RADIO_CLR_IRQSTATUS, buf, sizeof(buf), radioNumber);
+    if (post)
+        hal.PostCommand(SX1280_RADIO_CLR_IRQSTATUS, buf, sizeof(buf), radioNumber);
+    else
+        hal.WriteCommand(SX1280_RADIO_CLR_IRQSTATUS, buf, sizeof(buf), radioNumber);
 }
 
 void ICACHE_RAM_ATTR SX1280Driver::TXnbISR()
@@ -479,6 +517,25 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnbISR()
 }
 
 void ICACHE_RAM_ATTR SX1280Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    txStage.load(data, size);
+    TXnbStaged(radioNumber);
+}
+
+/***
+ * @brief: Write the next packet into the TX FIFO of radioNumber ahead of TXnbStaged().
+ * The TX buffer does not overlap the RX buffer, so this can be done while receiving.
+ ***/
+void ICACHE_RAM_ATTR SX1280Driver::TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    txStage.stage(*this, data, size, radioNumber);
+}
+
+/***
+ * @brief: Transmit the packet from TXstage() on radioNumber, which only needs the SetTx
+ * command if it was staged on that radio
+ ***/
+void ICACHE_RAM_ATTR SX1280Driver::TXnbStaged(SX12XX_Radio_Number_t radioNumber)
 {
     transmittingRadio = radioNumber;
     
@@ -486,6 +543,7 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
     if (currOpmode == SX1280_MODE_TX)
     {
         DBGLN("Timeout!");
+        txStage.clear();
         SetMode(fallBackMode, SX12XX_Radio_All);
         ClearIrqStatus(SX1280_IRQ_RADIO_ALL, SX12XX_Radio_All);
         TXnbISR();
@@ -494,6 +552,7 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
 
     if (radioNumber == SX12XX_Radio_NONE)
     {
+        txStage.clear();
         instance->SetMode(fallBackMode, SX12XX_Radio_All);
         return;
     }
@@ -509,6 +568,15 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
     }
 #endif
 
+    txStage.transmit(*this, radioNumber);
+
+#ifdef DEBUG_SX1280_OTA_TIMING
+    beginTX = micros();
+#endif
+}
+
+void ICACHE_RAM_ATTR SX1280Driver::TxPrepare(SX12XX_Radio_Number_t radioNumber)
+{
     // Normal diversity mode
     if (GPIO_PIN_NSS_2 != UNDEF_PIN && radioNumber != SX12XX_Radio_All)
     {
@@ -524,12 +592,16 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnb(uint8_t * data, uint8_t size, SX12XX_Rad
     }
 
     RFAMP.TXenable(radioNumber); // do first to allow PA stablise
-    hal.WriteBuffer(0x00, data, size, radioNumber); //todo fix offset to equal fifo addr
-    instance->SetMode(SX1280_MODE_TX, radioNumber);
+}
 
-#ifdef DEBUG_SX1280_OTA_TIMING
-    beginTX = micros();
-#endif
+void ICACHE_RAM_ATTR SX1280Driver::TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+{
+    hal.WriteBuffer(SX1280_TX_BUFFER_BASE, data, size, radioNumber);
+}
+
+void ICACHE_RAM_ATTR SX1280Driver::TxStart(SX12XX_Radio_Number_t radioNumber)
+{
+    instance->SetMode(SX1280_MODE_TX, radioNumber);
 }
 
 bool ICACHE_RAM_ATTR SX1280Driver::RXnbISR(uint16_t irqStatus, SX12XX_Radio_Number_t radioNumber)
@@ -551,7 +623,9 @@ bool ICACHE_RAM_ATTR SX1280Driver::RXnbISR(uint16_t irqStatus, SX12XX_Radio_Numb
                ((irqStatus & SX1280_IRQ_SYNCWORD_VALID) ? SX12XX_RX_OK : SX12XX_RX_SYNCWORD_ERROR) |
                ((irqStatus & SX1280_IRQ_SYNCWORD_ERROR) ? SX12XX_RX_SYNCWORD_ERROR : SX12XX_RX_OK);
     }
-    if (fail == SX12XX_RX_OK)
+    // With two radios a packet which only failed the CRC is still read, as it may be
+    // recovered by combining it with the other radio's copy
+    if (fail == SX12XX_RX_OK || (fail == SX12XX_RX_CRC_FAIL && GPIO_PIN_NSS_2 != UNDEF_PIN))
     {
         uint8_t const FIFOaddr = GetRxBufferAddr(radioNumber);
         hal.ReadBuffer(FIFOaddr, RXdataBuffer, PayloadLength, radioNumber);
@@ -762,5 +836,5 @@ void ICACHE_RAM_ATTR SX1280Driver::IsrCallback(SX12XX_Radio_Number_t radioNumber
     {
         return;
     }
-    instance->ClearIrqStatus(SX1280_IRQ_RADIO_ALL, irqClearRadio);
+    instance->ClearIrqStatus(SX1280_IRQ_RADIO_ALL, irqClearRadio, true);
 }
@@ -34,6 +34,7 @@ public:
     void SetFrequencyReg(uint32_t freq, SX12XX_Radio_Number_t radioNumber = SX12XX_Radio_All);
     void SetRxTimeoutUs(uint32_t interval);
     void SetOutputPower(int8_t power);
+    void CommitOutputPower();
     void startCWTest(uint32_t freq, SX12XX_Radio_Number_t radioNumber);
 
 
@@ -41,10 +42,12 @@ public:
     bool FrequencyErrorAvailable() const { return modeSupportsFei && (LastPacketSNRRaw > 0); }
 
     void TXnb(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXstage(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TXnbStaged(SX12XX_Radio_Number_t radioNumber);
     void RXnb(SX1280_RadioOperatingModes_t rxMode = SX1280_MODE_RX, uint32_t incomingTimeout = 0);
 
     uint16_t GetIrqStatus(SX12XX_Radio_Number_t radioNumber);
-    void ClearIrqStatus(uint16_t irqMask, SX12XX_Radio_Number_t radioNumber);
+    void ClearIrqStatus(uint16_t irqMask, SX12XX_Radio_Number_t radioNumber, bool post = false);
 
     void GetStatus(SX12XX_Radio_Number_t radioNumber);
 
@@ -64,7 +67,22 @@ private:
     uint8_t pwrPending;
     SX1280_RadioOperatingModes_t fallBackMode;
 
+    // SX12xxShadow slots, for the configuration which is kept until written again
+    enum
+    {
+        SHADOW_PACKETTYPE,
+        SHADOW_MODULATIONPARAMS,
+        SHADOW_PACKETPARAMS,
+        SHADOW_RFFREQUENCY,
+        SHADOW_BUFFERBASEADDRESS,
+        SHADOW_DIOIRQPARAMS,
+        SHADOW_FLRC_CRC_SEED,
+        SHADOW_FLRC_SYNC_WORD,
+    };
+
     void SetMode(SX1280_RadioOperatingModes_t OPmode, SX12XX_Radio_Number_t radioNumber, uint32_t incomingTimeout = 0);
+    void WriteCommandShadowed(uint8_t slot, SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size,
+                              SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay = 15);
     void SetFIFOaddr(uint8_t txBaseAddr, uint8_t rxBaseAddr);
 
     // LoRa functions
@@ -90,5 +108,10 @@ private:
     static void IsrCallback(SX12XX_Radio_Number_t radioNumber);
     bool RXnbISR(uint16_t irqStatus, SX12XX_Radio_Number_t radioNumber); // ISR for non-blocking RX routine
     void TXnbISR(); // ISR for non-blocking TX routine
-    void CommitOutputPower();
+
+    // SX12xxTxStage operations
+    friend class SX12xxTxStage;
+    void TxPrepare(SX12XX_Radio_Number_t radioNumber);
+    void TxWriteBuffer(uint8_t * data, uint8_t size, SX12XX_Radio_Number_t radioNumber);
+    void TxStart(SX12XX_Radio_Number_t radioNumber);
 };
@@ -15,6 +15,10 @@
 #define SX1280_POWER_MIN (-18)
 #define SX1280_POWER_MAX (13)
 
+// Data buffer base addresses, the 256 byte buffer is split so TX and RX never overlap
+#define SX1280_TX_BUFFER_BASE 0x80
+#define SX1280_RX_BUFFER_BASE 0x00
+
 typedef enum
 {
     SX1280_RF_IDLE = 0x00, //!< The radio is idle
@@ -16,7 +16,6 @@ Maintainer: Miguel Luis, Gregory Cristian and Matthieu Verdy
 Modified and adapted by Alessandro Carcione for ELRS project
 */
 
-#ifndef UNIT_TEST
 #include "SX1280_Regs.h"
 #include "SX1280_hal.h"
 #include <SPIEx.h>
@@ -36,6 +35,17 @@ void SX1280Hal::end()
     {
         detachInterrupt(GPIO_PIN_DIO1_2);
     }
+#if defined(SX12XX_POSTED_COMMANDS)
+    if (GPIO_PIN_BUSY != UNDEF_PIN)
+    {
+        detachInterrupt(GPIO_PIN_BUSY);
+    }
+    if (GPIO_PIN_BUSY_2 != UNDEF_PIN)
+    {
+        detachInterrupt(GPIO_PIN_BUSY_2);
+    }
+#endif
+    posted.clear();
     SPIEx.end();
     IsrCallback_1 = nullptr; // remove callbacks
     IsrCallback_2 = nullptr; // remove callbacks
@@ -93,7 +103,16 @@ void SX1280Hal::init()
     SPIEx.setClockDivider(SPI_CLOCK_DIV4); // 72 / 8 = 9 MHz
 #endif
 
-    //attachInterrupt(digitalPinToInterrupt(GPIO_PIN_BUSY), this->busyISR, CHANGE); //not used atm
+#if defined(SX12XX_POSTED_COMMANDS)
+    if (GPIO_PIN_BUSY != UNDEF_PIN)
+    {
+        attachInterrupt(digitalPinToInterrupt(GPIO_PIN_BUSY), this->busyISR, FALLING);
+    }
+    if (GPIO_PIN_BUSY_2 != UNDEF_PIN)
+    {
+        attachInterrupt(digitalPinToInterrupt(GPIO_PIN_BUSY_2), this->busyISR, FALLING);
+    }
+#endif
     attachInterrupt(digitalPinToInterrupt(GPIO_PIN_DIO1), this->dioISR_1, RISING);
     if (GPIO_PIN_DIO1_2 != UNDEF_PIN)
     {
@@ -149,6 +168,32 @@ void ICACHE_RAM_ATTR SX1280Hal::WriteCommand(SX1280_RadioCommands_t command, uin
     BusyDelay(busyDelay);
 }
 
+void ICACHE_RAM_ATTR SX1280Hal::PostCommand(SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+{
+#if defined(SX12XX_POSTED_COMMANDS)
+    if (GPIO_PIN_BUSY != UNDEF_PIN && posted.add(command, buffer, size, radioNumber, busyDelay))
+    {
+        posted.service(*this, false);
+        return;
+    }
+#endif
+    WriteCommand(command, buffer, size, radioNumber, busyDelay);
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WritePosted(uint16_t command, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+{
+    WORD_ALIGNED_ATTR uint8_t OutBuffer[WORD_PADDED(size + 1)] = {
+        (uint8_t)command,
+    };
+
+    memcpy(OutBuffer + 1, buffer, size);
+
+    SpinOnBusy(radioNumber);
+    SPIEx.write(radioNumber, OutBuffer, size + 1);
+
+    BusyDelay(busyDelay);
+}
+
 void ICACHE_RAM_ATTR SX1280Hal::ReadCommand(SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber)
 {
     WORD_ALIGNED_ATTR uint8_t OutBuffer[WORD_PADDED(size + 2)] = {
@@ -248,6 +293,27 @@ void ICACHE_RAM_ATTR SX1280Hal::ReadBuffer(uint8_t offset, uint8_t *buffer, uint
 
 bool ICACHE_RAM_ATTR SX1280Hal::WaitOnBusy(SX12XX_Radio_Number_t radioNumber)
 {
+    // Anything posted goes first, so the radio sees the commands in order
+    if (posted.size())
+        posted.service(*this, true);
+    return SpinOnBusy(radioNumber);
+}
+
+bool ICACHE_RAM_ATTR SX1280Hal::IsBusy(SX12XX_Radio_Number_t radioNumber)
+{
+    if (GPIO_PIN_BUSY == UNDEF_PIN)
+        return (micros() - BusyDelayStart) < BusyDelayDuration;
+
+    if ((radioNumber & SX12XX_Radio_1) && digitalRead(GPIO_PIN_BUSY) == HIGH)
+        return true;
+    if ((radioNumber & SX12XX_Radio_2) && GPIO_PIN_BUSY_2 != UNDEF_PIN && digitalRead(GPIO_PIN_BUSY_2) == HIGH)
+        return true;
+    return false;
+}
+
+bool ICACHE_RAM_ATTR SX1280Hal::SpinOnBusy(SX12XX_Radio_Number_t radioNumber)
+{
+    SPI_TRACE_BUSY();
     if (GPIO_PIN_BUSY != UNDEF_PIN)
     {
         constexpr uint32_t wtimeoutUS = 1000U;
@@ -290,6 +356,11 @@ bool ICACHE_RAM_ATTR SX1280Hal::WaitOnBusy(SX12XX_Radio_Number_t radioNumber)
     return true;
 }
 
+void ICACHE_RAM_ATTR SX1280Hal::busyISR()
+{
+    instance->posted.service(*instance, false);
+}
+
 void ICACHE_RAM_ATTR SX1280Hal::dioISR_1()
 {
     if (instance->IsrCallback_1)
@@ -301,5 +372,3 @@ void ICACHE_RAM_ATTR SX1280Hal::dioISR_2()
     if (instance->IsrCallback_2)
         instance->IsrCallback_2();
 }
-
-#endif // UNIT_TEST
@@ -20,6 +20,7 @@ Heavily modified/simplified by Alessandro Carcione 2020 for ELRS project
 
 #include "SX1280_Regs.h"
 #include "SX1280.h"
+#include "SX12xxCommandQueue.h"
 
 enum SX1280_BusyState_
 {
@@ -51,9 +52,17 @@ public:
     void ICACHE_RAM_ATTR ReadBuffer(uint8_t offset, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber);
 
     bool ICACHE_RAM_ATTR WaitOnBusy(SX12XX_Radio_Number_t radioNumber);
+    bool ICACHE_RAM_ATTR IsBusy(SX12XX_Radio_Number_t radioNumber);
+
+    /**
+     * @brief Write a command which nothing waits on, without spinning while the radio is BUSY.
+     * If it is, the command is written from the BUSY interrupt, or before the next transaction.
+     */
+    void ICACHE_RAM_ATTR PostCommand(SX1280_RadioCommands_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay = 15);
 
     static ICACHE_RAM_ATTR void dioISR_1();
     static ICACHE_RAM_ATTR void dioISR_2();
+    static ICACHE_RAM_ATTR void busyISR();
     void (*IsrCallback_1)(); //function pointer for callback
     void (*IsrCallback_2)(); //function pointer for callback
 
@@ -69,5 +78,9 @@ public:
     }
 
 private:
+    friend class SX12xxCommandQueue<4>;
+    SX12xxCommandQueue<4> posted;
 
+    bool ICACHE_RAM_ATTR SpinOnBusy(SX12XX_Radio_Number_t radioNumber);
+    void ICACHE_RAM_ATTR WritePosted(uint16_t opcode, uint8_t *buffer, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay);
 };
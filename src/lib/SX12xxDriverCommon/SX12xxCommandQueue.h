@@ -0,0 +1,141 @@
+#pragma once
+
+#include "targets.h"
+#include <string.h>
+
+typedef uint8_t SX12XX_Radio_Number_t;
+
+// Posted commands need the BUSY falling edge interrupt. On STM32 it could share an EXTI
+// line with DIO1, so commands are always written straight away there.
+#if defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266) || defined(UNIT_TEST)
+#define SX12XX_POSTED_COMMANDS
+#endif
+
+/**
+ * @brief Commands posted to a radio which is still BUSY from the one before, to be written
+ * once it is ready instead of spinning on the BUSY pin. Used for the fire-and-forget
+ * commands at the end of an ISR, e.g. clearing the IRQs after a SetRx.
+ *
+ * service() is called from the BUSY falling edge interrupt to write what it can, and with
+ * wait set before any other transaction so the radio still sees the commands in order.
+ * Only one caller writes at a time, an interrupt arriving meanwhile leaves it to them.
+ *
+ * The SPI work is done by the HAL passed to service(), which must provide:
+ *   IsBusy(radioNumber)                                     the BUSY pin, without waiting
+ *   WritePosted(opcode, data, size, radioNumber, busyDelay) wait on BUSY and write the command
+ *
+ * @tparam N the number of commands which can be pending at once
+ */
+template <uint8_t N>
+class SX12xxCommandQueue
+{
+public:
+    static const uint8_t MAX_SIZE = 8;
+
+    /**
+     * @return false if the queue is full or the command too long, and it was not posted
+     */
+    ICACHE_RAM_ATTR bool add(uint16_t opcode, const uint8_t *data, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+    {
+        if (size > MAX_SIZE)
+            return false;
+        lock();
+        if (count == N)
+        {
+            unlock();
+            return false;
+        }
+        entry_t &e = entries[(head + count) % N];
+        e.opcode = opcode;
+        e.radioNumber = radioNumber;
+        e.size = size;
+        e.busyDelay = busyDelay;
+        memcpy(e.data, data, size);
+        count++;
+        unlock();
+        return true;
+    }
+
+    /**
+     * @brief Write the posted commands, stopping at the first whose radio is still BUSY
+     * unless wait is set
+     */
+    template <class Hal>
+    ICACHE_RAM_ATTR void service(Hal &hal, bool wait)
+    {
+        for (;;)
+        {
+            lock();
+            if (count == 0 || draining)
+            {
+                unlock();
+                return;
+            }
+            draining = true;
+            unlock();
+
+            while (count && (wait || !hal.IsBusy(entries[head].radioNumber)))
+            {
+                entry_t &e = entries[head];
+                hal.WritePosted(e.opcode, e.data, e.size, e.radioNumber, e.busyDelay);
+                lock();
+                head = (head + 1) % N;
+                count--;
+                unlock();
+            }
+
+            lock();
+            draining = false;
+            unlock();
+
+            // BUSY may have fallen after the check above, with the interrupt finding us
+            // still draining, so look again rather than leave the command waiting
+            if (count == 0 || hal.IsBusy(entries[head].radioNumber))
+                return;
+        }
+    }
+
+    uint8_t size() const { return count; }
+
+    void clear()
+    {
+        lock();
+        count = 0;
+        unlock();
+    }
+
+private:
+    typedef struct {
+        uint16_t opcode;
+        SX12XX_Radio_Number_t radioNumber;
+        uint8_t size;
+        uint32_t busyDelay;
+        uint8_t data[MAX_SIZE];
+    } entry_t;
+
+    ICACHE_RAM_ATTR void inline lock()
+    {
+    #if defined(PLATFORM_ESP32)
+        portENTER_CRITICAL(&mux);
+    #elif defined(PLATFORM_ESP8266) || defined(PLATFORM_STM32)
+        noInterrupts();
+    #endif
+    }
+
+    ICACHE_RAM_ATTR void inline unlock()
+    {
+    #if defined(PLATFORM_ESP32)
+        portEXIT_CRITICAL(&mux);
+    #elif defined(PLATFORM_ESP8266) || defined(PLATFORM_STM32)
+        interrupts();
+    #endif
+    }
+
+    entry_t entries[N];
+    uint8_t head = 0;
+    volatile uint8_t count = 0;
+    volatile bool draining = false;
+#if defined(PLATFORM_ESP32)
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
@@ -2,6 +2,8 @@
 
 #include <targets.h>
 #include "FEC.h"
+#include "SX12xxTxStage.h"
+#include "SX12xxShadow.h"
 
 typedef uint8_t SX12XX_Radio_Number_t;
 enum
@@ -58,6 +60,9 @@ public:
 
     bool isFirstRxIrq = true;
 
+    // A packet loaded by TXstage() is waiting for TXnbStaged()
+    bool IsTxStaged() const { return txStage.isLoaded(); }
+
 #if defined(DEBUG_RCVR_SIGNAL_STATS)
     typedef struct rxSignalStats_s
     {
@@ -75,6 +80,9 @@ public:
 #endif
 
 protected:
+    SX12xxTxStage txStage;
+    SX12xxShadow shadow;
+
     void RemoveCallbacks(void)
     {
         RXdoneCallback = nullCallbackRx;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "targets.h"
+#include <string.h>
+
+typedef uint8_t SX12XX_Radio_Number_t;
+
+/**
+ * @brief The parameters last written to each radio for the configuration commands which
+ * stay in effect until written again, so a write which would not change anything can be
+ * skipped. Each command the driver tracks has its own slot.
+ *
+ * The radios are tracked separately, so when only one of a pair differs only it is written,
+ * and when both differ they still get a single transaction with both chip selects.
+ */
+class SX12xxShadow
+{
+public:
+    static const uint8_t SLOTS = 8;
+    static const uint8_t MAX_SIZE = 10;
+
+    SX12xxShadow() { invalidate(0b11); }
+
+    /**
+     * @brief Forget what radioNumber holds, e.g. after a reset, sleep or a packet type change
+     */
+    void invalidate(SX12XX_Radio_Number_t radioNumber)
+    {
+        for (uint8_t radio = 0; radio < 2; radio++)
+        {
+            if (radioNumber & (1 << radio))
+                memset(valid[radio], 0, sizeof(valid[radio]));
+        }
+    }
+
+    /**
+     * @return the radios in radioNumber which do not already hold these params in slot
+     */
+    SX12XX_Radio_Number_t ICACHE_RAM_ATTR changed(uint8_t slot, const uint8_t *params, uint8_t size, SX12XX_Radio_Number_t radioNumber) const
+    {
+        SX12XX_Radio_Number_t differs = 0;
+        for (uint8_t radio = 0; radio < 2; radio++)
+        {
+            if ((radioNumber & (1 << radio)) &&
+                (!valid[radio][slot] || sizes[radio][slot] != size || memcmp(values[radio][slot], params, size) != 0))
+            {
+                differs |= 1 << radio;
+            }
+        }
+        return differs;
+    }
+
+    /**
+     * @brief Record that radioNumber now holds these params in slot
+     */
+    void ICACHE_RAM_ATTR store(uint8_t slot, const uint8_t *params, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+    {
+        for (uint8_t radio = 0; radio < 2; radio++)
+        {
+            if (radioNumber & (1 << radio))
+            {
+                memcpy(values[radio][slot], params, size);
+                sizes[radio][slot] = size;
+                valid[radio][slot] = true;
+            }
+        }
+    }
+
+    /**
+     * @brief changed() and store() together, for the usual write-if-different
+     * @return the radios which need the write
+     */
+    SX12XX_Radio_Number_t ICACHE_RAM_ATTR update(uint8_t slot, const uint8_t *params, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+    {
+        SX12XX_Radio_Number_t differs = changed(slot, params, size, radioNumber);
+        store(slot, params, size, differs);
+        return differs;
+    }
+
+private:
+    uint8_t values[2][SLOTS][MAX_SIZE];
+    uint8_t sizes[2][SLOTS];
+    bool valid[2][SLOTS];
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t SX12XX_Radio_Number_t;
+
+/**
+ * @brief Holds the next packet to transmit so it can be written into the radio FIFO
+ * ahead of its transmit slot, leaving only the SetTx command on the time critical path.
+ *
+ * The SPI work is done by the driver passed to stage()/transmit(), which must provide:
+ *   TxPrepare(radioNumber)                 idle the unused radio and enable the PA
+ *   TxWriteBuffer(data, size, radioNumber) write the packet into the TX FIFO
+ *   TxStart(radioNumber)                   enter TX mode
+ */
+class SX12xxTxStage
+{
+public:
+    static const uint8_t MAX_SIZE = 16;
+
+    SX12xxTxStage() { clear(); }
+
+    /**
+     * @brief Forget any packet, e.g. when the radio is reconfigured
+     */
+    void clear()
+    {
+        loaded = false;
+        staged = 0;
+    }
+
+    bool isLoaded() const { return loaded; }
+    SX12XX_Radio_Number_t stagedRadios() const { return staged; }
+
+    /**
+     * @brief Keep a copy of the packet to be written when it is transmitted
+     * @return false if the packet is longer than MAX_SIZE, nothing is loaded then
+     */
+    bool load(const uint8_t *data, uint8_t len)
+    {
+        if (len > MAX_SIZE)
+        {
+            clear();
+            return false;
+        }
+        size = len;
+        memcpy(buffer, data, size);
+        loaded = true;
+        staged = 0;
+        return true;
+    }
+
+    /**
+     * @brief Load the packet and write it into the FIFO of radioNumber now
+     * @return false if the packet is longer than MAX_SIZE
+     */
+    template <class Driver>
+    bool stage(Driver &driver, const uint8_t *data, uint8_t len, SX12XX_Radio_Number_t radioNumber)
+    {
+        if (!load(data, len))
+            return false;
+        if (radioNumber)
+        {
+            driver.TxWriteBuffer(buffer, size, radioNumber);
+            staged = radioNumber;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Transmit the loaded packet on radioNumber, only writing the FIFO of a radio
+     * it was not staged on. The packet is used up either way.
+     * @return false if there was no packet loaded
+     */
+    template <class Driver>
+    bool transmit(Driver &driver, SX12XX_Radio_Number_t radioNumber)
+    {
+        if (!loaded)
+            return false;
+
+        driver.TxPrepare(radioNumber);
+        if ((staged & radioNumber) != radioNumber)
+            driver.TxWriteBuffer(buffer, size, radioNumber);
+        driver.TxStart(radioNumber);
+
+        clear();
+        return true;
+    }
+
+private:
+    uint8_t buffer[MAX_SIZE];
+    uint8_t size;
+    bool loaded;
+    SX12XX_Radio_Number_t staged;
+};
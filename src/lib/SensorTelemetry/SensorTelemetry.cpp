@@ -0,0 +1,101 @@
+#include "SensorTelemetry.h"
+#include "CRSF.h"
+
+SensorTelemetry::SensorTelemetry()
+    : m_groups(), m_nextGroup(0),
+      m_voltage(0), m_current(0), m_capacity(0), m_remaining(0),
+      m_altitude(0), m_verticalSpeed(0),
+      m_latitude(0), m_longitude(0), m_groundSpeed(0), m_heading(0), m_gpsAltitude(0), m_satellites(0)
+{
+}
+
+void SensorTelemetry::setBatteryVoltage(uint16_t decivolts) { set(SENSOR_TLM_BATTERY, m_voltage, decivolts); }
+void SensorTelemetry::setBatteryCurrent(uint16_t deciamps) { set(SENSOR_TLM_BATTERY, m_current, deciamps); }
+void SensorTelemetry::setBatteryCapacity(uint32_t mAh) { set(SENSOR_TLM_BATTERY, m_capacity, mAh); }
+void SensorTelemetry::setBatteryRemaining(uint8_t percent) { set(SENSOR_TLM_BATTERY, m_remaining, percent); }
+
+void SensorTelemetry::setAltitude(int32_t cm) { set(SENSOR_TLM_BARO, m_altitude, cm); }
+void SensorTelemetry::setVerticalSpeed(int16_t cmPerSec) { set(SENSOR_TLM_BARO, m_verticalSpeed, cmPerSec); }
+
+void SensorTelemetry::setGpsLatitude(int32_t degE7) { set(SENSOR_TLM_GPS, m_latitude, degE7); }
+void SensorTelemetry::setGpsLongitude(int32_t degE7) { set(SENSOR_TLM_GPS, m_longitude, degE7); }
+void SensorTelemetry::setGpsGroundSpeed(uint16_t kmhE1) { set(SENSOR_TLM_GPS, m_groundSpeed, kmhE1); }
+void SensorTelemetry::setGpsHeading(uint16_t degE2) { set(SENSOR_TLM_GPS, m_heading, degE2); }
+void SensorTelemetry::setGpsAltitude(int16_t meters) { set(SENSOR_TLM_GPS, m_gpsAltitude, meters); }
+void SensorTelemetry::setGpsSatellites(uint8_t satellites) { set(SENSOR_TLM_GPS, m_satellites, satellites); }
+
+static uint8_t *putBE(uint8_t *p, uint32_t value, uint8_t len)
+{
+    while (len--)
+        *p++ = value >> (len * 8);
+    return p;
+}
+
+void SensorTelemetry::buildBattery()
+{
+    uint8_t *p = &m_frame[sizeof(crsf_header_t)];
+    p = putBE(p, m_voltage, 2);
+    p = putBE(p, m_current, 2);
+    p = putBE(p, m_capacity, 3);
+    *p = m_remaining;
+    CRSF::SetHeaderAndCrc(m_frame, CRSF_FRAMETYPE_BATTERY_SENSOR, CRSF_FRAME_SIZE(sizeof(crsf_sensor_battery_t)), CRSF_ADDRESS_CRSF_TRANSMITTER);
+}
+
+void SensorTelemetry::buildBaro()
+{
+    // Decimeters + 10000, or meters with the high bit set when that doesn't fit
+    const int32_t dm = m_altitude / 10 + 10000;
+    uint16_t altitude;
+    if (dm < 0)
+        altitude = 0;
+    else if (dm < 0x8000)
+        altitude = dm;
+    else
+        altitude = 0x8000 | (m_altitude / 100 > 0x7FFF ? 0x7FFF : m_altitude / 100);
+
+    uint8_t *p = &m_frame[sizeof(crsf_header_t)];
+    p = putBE(p, altitude, 2);
+    putBE(p, (uint16_t)m_verticalSpeed, 2);
+    CRSF::SetHeaderAndCrc(m_frame, CRSF_FRAMETYPE_BARO_ALTITUDE, CRSF_FRAME_SIZE(sizeof(crsf_sensor_baro_vario_t)), CRSF_ADDRESS_CRSF_TRANSMITTER);
+}
+
+void SensorTelemetry::buildGps()
+{
+    uint8_t *p = &m_frame[sizeof(crsf_header_t)];
+    p = putBE(p, (uint32_t)m_latitude, 4);
+    p = putBE(p, (uint32_t)m_longitude, 4);
+    p = putBE(p, m_groundSpeed, 2);
+    p = putBE(p, m_heading, 2);
+    p = putBE(p, (uint16_t)(m_gpsAltitude + 1000), 2);
+    *p = m_satellites;
+    CRSF::SetHeaderAndCrc(m_frame, CRSF_FRAMETYPE_GPS, CRSF_FRAME_SIZE(sizeof(crsf_sensor_gps_t)), CRSF_ADDRESS_CRSF_TRANSMITTER);
+}
+
+const uint8_t *SensorTelemetry::nextFrame(uint32_t now)
+{
+    // Round robin so a fast changing group can't starve the others
+    for (uint8_t i = 0; i < SENSOR_TLM_GROUP_COUNT; i++)
+    {
+        const sensorTlmGroup_e group = (sensorTlmGroup_e)m_nextGroup;
+        m_nextGroup = (m_nextGroup + 1) % SENSOR_TLM_GROUP_COUNT;
+
+        group_t &g = m_groups[group];
+        if (!g.present)
+            continue;
+        const uint32_t elapsed = now - g.lastSent;
+        if (!g.sent || (g.changed && elapsed >= SENSOR_TLM_MIN_INTERVAL_MS) || elapsed >= SENSOR_TLM_KEEPALIVE_MS)
+        {
+            g.sent = true;
+            g.changed = false;
+            g.lastSent = now;
+            switch (group)
+            {
+            case SENSOR_TLM_BATTERY: buildBattery(); break;
+            case SENSOR_TLM_BARO: buildBaro(); break;
+            default: buildGps(); break;
+            }
+            return m_frame;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "targets.h"
+#include "crsf_protocol.h"
+
+#define SENSOR_TLM_MIN_INTERVAL_MS  100     // fastest a changing value is sent to the TX
+#define SENSOR_TLM_KEEPALIVE_MS     5000    // unchanged values are still sent this often
+
+typedef enum : uint8_t {
+    SENSOR_TLM_BATTERY,
+    SENSOR_TLM_BARO,
+    SENSOR_TLM_GPS,
+    SENSOR_TLM_GROUP_COUNT
+} sensorTlmGroup_e;
+
+/**
+ * Collects sensor values read from the FC by serial protocols with their own telemetry
+ * (IBUS sensors, FPort/S.Port) and turns them into CRSF telemetry frames for the TX.
+ *
+ * Values are set in CRSF units. A group is sent as soon as one of its values changes,
+ * but no more often than SENSOR_TLM_MIN_INTERVAL_MS, and otherwise every
+ * SENSOR_TLM_KEEPALIVE_MS once it has been seen.
+ */
+class SensorTelemetry
+{
+public:
+    SensorTelemetry();
+
+    void setBatteryVoltage(uint16_t decivolts);
+    void setBatteryCurrent(uint16_t deciamps);
+    void setBatteryCapacity(uint32_t mAh);
+    void setBatteryRemaining(uint8_t percent);
+
+    void setAltitude(int32_t cm);
+    void setVerticalSpeed(int16_t cmPerSec);
+
+    void setGpsLatitude(int32_t degE7);
+    void setGpsLongitude(int32_t degE7);
+    void setGpsGroundSpeed(uint16_t kmhE1);
+    void setGpsHeading(uint16_t degE2);
+    void setGpsAltitude(int16_t meters);
+    void setGpsSatellites(uint8_t satellites);
+
+    bool hasSensor(sensorTlmGroup_e group) const { return m_groups[group].present; }
+
+    /**
+     * @brief Build the next CRSF telemetry frame that is due
+     * @return the frame, valid until the next call, or nullptr if nothing is due
+     */
+    const uint8_t *nextFrame(uint32_t now);
+
+private:
+    typedef struct {
+        bool present;
+        bool changed;
+        bool sent;
+        uint32_t lastSent;
+    } group_t;
+
+    template <typename T>
+    void set(sensorTlmGroup_e group, T &value, T newValue)
+    {
+        group_t &g = m_groups[group];
+        g.changed |= !g.present || value != newValue;
+        g.present = true;
+        value = newValue;
+    }
+
+    void buildBattery();
+    void buildBaro();
+    void buildGps();
+
+    group_t m_groups[SENSOR_TLM_GROUP_COUNT];
+    uint8_t m_nextGroup;
+
+    uint16_t m_voltage;
+    uint16_t m_current;
+    uint32_t m_capacity;
+    uint8_t m_remaining;
+
+    int32_t m_altitude;
+    int16_t m_verticalSpeed;
+
+    int32_t m_latitude;
+    int32_t m_longitude;
+    uint16_t m_groundSpeed;
+    uint16_t m_heading;
+    int16_t m_gpsAltitude;
+    uint8_t m_satellites;
+
+    uint8_t m_frame[CRSF_MAX_PACKET_LEN];
+};
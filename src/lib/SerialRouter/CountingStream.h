@@ -0,0 +1,44 @@
+#pragma once
+
+#include "targets.h"
+
+/**
+ * Passes everything through to another Stream, counting the bytes written so the
+ * serial router can keep per-port statistics and enforce bandwidth limits without
+ * every protocol implementation having to report what it wrote.
+ */
+class CountingStream : public Stream
+{
+public:
+    explicit CountingStream(Stream *stream) : m_stream(stream) {}
+
+    int available() override { return m_stream->available(); }
+    int read() override { return m_stream->read(); }
+    int peek() override { return m_stream->peek(); }
+    void flush() override { m_stream->flush(); }
+
+    size_t write(uint8_t c) override
+    {
+        const size_t n = m_stream->write(c);
+        m_bytesWritten += n;
+        return n;
+    }
+    size_t write(const uint8_t *s, size_t l) override
+    {
+        const size_t n = m_stream->write(s, l);
+        m_bytesWritten += n;
+        return n;
+    }
+#if !defined(TARGET_NATIVE)
+    int availableForWrite() override { return m_stream->availableForWrite(); }
+#endif
+
+    Stream *getStream() const { return m_stream; }
+    uint32_t getBytesWritten() const { return m_bytesWritten; }
+    // Bytes written to the stream on our behalf, e.g. by a RCOutputStage
+    void addBytesWritten(uint32_t n) { m_bytesWritten += n; }
+
+private:
+    Stream *m_stream;
+    uint32_t m_bytesWritten = 0;
+};
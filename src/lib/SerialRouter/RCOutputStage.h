@@ -0,0 +1,111 @@
+#pragma once
+
+#include "targets.h"
+
+#define RC_OUTPUT_STAGE_SIZE    128     // largest RC frame written in one sendRCFrame, an FPort frame with every byte stuffed
+
+/**
+ * Holds the RC frame written by a protocol's sendRCFrame, so a timed stage can write it
+ * to the serial port at a fixed phase to the RF packets instead of whenever the main
+ * loop gets to it.
+ *
+ * The protocol writes into the stage as if it were the serial port, commit() publishes
+ * what was written, and writeOut() writes the latest published frame to the output.
+ * A frame replaced before it was written out is counted as dropped.
+ *
+ * There are three buffers: the one being filled, the one published and the one being
+ * written out. The output's write() may block and let the main loop run, so commit() only
+ * ever swaps the filled and published buffers, never the one still being written out.
+ * The swaps themselves are done with interrupts off, so writeOut() and commit() must run
+ * on the same core.
+ */
+class RCOutputStage : public Stream
+{
+public:
+    RCOutputStage() : m_output(nullptr), m_fill(0), m_ready(1), m_out(2), m_fillLen(0), m_readyLen(0), m_frames(0), m_dropped(0) {}
+
+    void setOutput(Stream *output) { m_output = output; }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *s, size_t l) override
+    {
+        if (m_fillLen + l > RC_OUTPUT_STAGE_SIZE)
+            return 0;
+        memcpy(&m_buf[m_fill][m_fillLen], s, l);
+        m_fillLen += l;
+        return l;
+    }
+#if !defined(TARGET_NATIVE)
+    int availableForWrite() override { return RC_OUTPUT_STAGE_SIZE - m_fillLen; }
+#endif
+
+    /**
+     * @brief Publish the bytes written since the last commit for writeOut()
+     * @return the number of bytes published
+     */
+    uint16_t commit()
+    {
+        const uint16_t len = m_fillLen;
+        if (len == 0)
+            return 0;
+        noInterrupts();
+        m_dropped += m_readyLen != 0;
+        m_readyLen = len;
+        const uint8_t ready = m_ready;
+        m_ready = m_fill;
+        m_fill = ready;
+        interrupts();
+        m_fillLen = 0;
+        ++m_frames;
+        return len;
+    }
+
+    /**
+     * @brief Write the latest published frame to the output, if there is one
+     * @return the number of bytes written
+     */
+    uint16_t writeOut()
+    {
+        noInterrupts();
+        const uint16_t len = m_readyLen;
+        m_readyLen = 0;
+        if (len != 0)
+        {
+            const uint8_t ready = m_ready;
+            m_ready = m_out;
+            m_out = ready;
+        }
+        interrupts();
+        if (len == 0 || m_output == nullptr)
+            return 0;
+        return m_output->write(m_buf[m_out], len);
+    }
+
+    // Forget anything written or published, e.g. when the protocol stops using the stage
+    void clear()
+    {
+        noInterrupts();
+        m_readyLen = 0;
+        interrupts();
+        m_fillLen = 0;
+    }
+
+    uint32_t getFrames() const { return m_frames; }
+    uint32_t getDropped() const { return m_dropped; }
+
+private:
+    Stream *m_output;
+    uint8_t m_buf[3][RC_OUTPUT_STAGE_SIZE];
+    uint8_t m_fill;
+    uint8_t m_ready;
+    uint8_t m_out;
+    uint16_t m_fillLen;
+    volatile uint16_t m_readyLen;
+    uint32_t m_frames;
+    uint32_t m_dropped;
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "targets.h"
+#include "device.h"
+
+#define SERIAL_ROUTER_MIN_BURST 64  // bytes a rate limited port may always send at once
+
+typedef enum : uint8_t {
+    SERIAL_ROUTE_RC        = 1 << 0,  // channel data out
+    SERIAL_ROUTE_LINKSTATS = 1 << 1,  // link statistics out
+    SERIAL_ROUTE_MSP       = 1 << 2,  // MSP/CRSF frames addressed to the FC
+    SERIAL_ROUTE_VTX       = 1 << 3,  // MSP_SET_VTX_CONFIG for a VTX control protocol
+} serialRoute_e;
+
+typedef struct {
+    uint32_t rcFrames;      // frames the port was told were available
+    uint32_t rcMissed;      // frames the port was told were missed
+    uint32_t linkStats;
+    uint32_t mspFrames;
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+    uint32_t throttled;     // times output was held back by the bandwidth limit
+} serialRouterStats_t;
+
+/**
+ * Routes RC, link statistics and MSP from the RF link to a number of serial ports,
+ * each running its own protocol pipeline (IO, a SerialIO). Traffic is not forwarded
+ * from one port to another. MAVLink is not routed, SerialMavlink exchanges it with
+ * the link through its own buffers, so only one port can run it.
+ *
+ * Each port is attached with a pointer to the variable holding its pipeline so the
+ * protocol can be swapped on reconfigure, a bitmask of serialRoute_e it takes part in,
+ * and an optional output bandwidth limit.
+ *
+ * RC frame availability is signalled once for all ports from the ISR. The frame filter
+ * (model match, teamrace) runs once per frame and its result is shared by all ports,
+ * rather than each port running its own copy of the state machine.
+ */
+template <class IO, uint8_t MaxPorts>
+class SerialRouter
+{
+public:
+    typedef bool (*frame_filter_t)();
+
+    SerialRouter() : m_portCount(0), m_rcSeq(0), m_filteredSeq(0), m_filterResult(false), m_filter(nullptr) {}
+
+    void setFrameFilter(frame_filter_t filter) { m_filter = filter; }
+
+    /**
+     * @return the port index, or -1 if there are no free ports
+     */
+    int8_t attach(IO **io, uint8_t routes, uint32_t maxBytesPerSecond = 0)
+    {
+        if (m_portCount >= MaxPorts)
+            return -1;
+        port_t &port = m_ports[m_portCount];
+        port.io = io;
+        port.routes = routes;
+        port.maxBytesPerSecond = maxBytesPerSecond;
+        port.tokens = 0;
+        port.lastRefill = 0;
+        port.rcSeq = m_rcSeq;
+        port.missed = false;
+        port.lastBytesRead = 0;
+        port.lastBytesWritten = 0;
+        port.lastIO = nullptr;
+        port.stats = {};
+        return m_portCount++;
+    }
+
+    uint8_t getPortCount() const { return m_portCount; }
+    void setRoutes(uint8_t port, uint8_t routes) { m_ports[port].routes = routes; }
+    uint8_t getRoutes(uint8_t port) const { return m_ports[port].routes; }
+
+    // Change the output bandwidth limit of a port, 0 for unlimited
+    void setBandwidthLimit(uint8_t port, uint32_t maxBytesPerSecond)
+    {
+        m_ports[port].maxBytesPerSecond = maxBytesPerSecond;
+        m_ports[port].tokens = 0;
+        m_ports[port].lastRefill = 0;
+    }
+    const serialRouterStats_t &getStats(uint8_t port) const { return m_ports[port].stats; }
+    IO *getIO(uint8_t port) const { return *m_ports[port].io; }
+
+    void resetStats()
+    {
+        for (uint8_t i = 0; i < m_portCount; i++)
+            m_ports[i].stats = {};
+    }
+
+    // Called from the ISR when a new RC frame has been received
+    void ICACHE_RAM_ATTR rcFrameAvailable() { ++m_rcSeq; }
+
+    // Called from the ISR when an RC frame was expected but not received
+    void ICACHE_RAM_ATTR rcFrameMissed()
+    {
+        for (uint8_t i = 0; i < m_portCount; i++)
+            m_ports[i].missed = true;
+    }
+
+    void queueLinkStatistics()
+    {
+        for (uint8_t i = 0; i < m_portCount; i++)
+        {
+            port_t &port = m_ports[i];
+            if ((port.routes & SERIAL_ROUTE_LINKSTATS) && *port.io != nullptr)
+            {
+                (*port.io)->queueLinkStatisticsPacket();
+                ++port.stats.linkStats;
+            }
+        }
+    }
+
+    /**
+     * @brief Queue an MSP frame on every port that takes part in route
+     * @return the number of ports it was queued on
+     */
+    uint8_t queueMSP(uint8_t *data, serialRoute_e route)
+    {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < m_portCount; i++)
+        {
+            port_t &port = m_ports[i];
+            if ((port.routes & route) && *port.io != nullptr)
+            {
+                (*port.io)->queueMSPFrameTransmission(data);
+                ++port.stats.mspFrames;
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    void setFailsafe(bool failsafe)
+    {
+        for (uint8_t i = 0; i < m_portCount; i++)
+        {
+            if (*m_ports[i].io != nullptr)
+                (*m_ports[i].io)->setFailsafe(failsafe);
+        }
+    }
+
+    /**
+     * @brief Run the pipeline of one port: RC out, serial input, queued output
+     * @return the duration returned by the pipeline's sendRCFrame, or DURATION_NEVER if the port is empty
+     */
+    int32_t service(uint8_t portIdx, uint32_t *channelData, uint32_t now)
+    {
+        port_t &port = m_ports[portIdx];
+        IO *io = *port.io;
+        if (io == nullptr)
+            return DURATION_NEVER;
+        if (io != port.lastIO)
+        {
+            // Protocol changed, its counters start again
+            port.lastIO = io;
+            port.lastBytesRead = 0;
+            port.lastBytesWritten = 0;
+        }
+
+        noInterrupts();
+        const uint32_t seq = m_rcSeq;
+        const bool missed = port.missed;
+        port.missed = false;
+        interrupts();
+
+        bool sendChannels = false;
+        if (seq != port.rcSeq)
+        {
+            port.rcSeq = seq;
+            if (seq != m_filteredSeq)
+            {
+                m_filteredSeq = seq;
+                m_filterResult = m_filter == nullptr || m_filter();
+            }
+            sendChannels = m_filterResult && (port.routes & SERIAL_ROUTE_RC);
+        }
+        port.stats.rcFrames += sendChannels;
+        port.stats.rcMissed += missed;
+
+        const int32_t duration = io->outputRCFrame(sendChannels, missed, channelData);
+        io->processSerialInput();
+
+        uint32_t maxBytes = io->getMaxSerialWriteSize();
+        if (port.maxBytesPerSecond)
+        {
+            refill(port, now);
+            if (port.tokens <= 0)
+                maxBytes = 0;
+            else if ((uint32_t)port.tokens < maxBytes)
+                maxBytes = port.tokens;
+        }
+        if (maxBytes)
+            io->sendQueuedData(maxBytes);
+        else
+            ++port.stats.throttled;
+
+        accountBytes(port, io);
+        return duration;
+    }
+
+private:
+    typedef struct {
+        IO **io;
+        IO *lastIO;
+        uint8_t routes;
+        bool missed;
+        uint32_t rcSeq;
+        uint32_t maxBytesPerSecond;
+        int32_t tokens;
+        uint32_t lastRefill;
+        uint32_t lastBytesRead;
+        uint32_t lastBytesWritten;
+        serialRouterStats_t stats;
+    } port_t;
+
+    void refill(port_t &port, uint32_t now)
+    {
+        const uint32_t burst = port.maxBytesPerSecond / 10 > SERIAL_ROUTER_MIN_BURST ? port.maxBytesPerSecond / 10 : SERIAL_ROUTER_MIN_BURST;
+        const uint32_t elapsed = now - port.lastRefill;
+        // Refill whole bytes only, keeping the remainder of the interval for next time
+        const uint32_t bytes = elapsed >= 1000 ? burst : elapsed * port.maxBytesPerSecond / 1000;
+        if (bytes == 0)
+            return;
+        port.lastRefill = elapsed >= 1000 ? now : port.lastRefill + bytes * 1000 / port.maxBytesPerSecond;
+        port.tokens = port.tokens + (int32_t)bytes > (int32_t)burst ? burst : port.tokens + bytes;
+    }
+
+    void accountBytes(port_t &port, IO *io)
+    {
+        const uint32_t read = io->getBytesRead();
+        const uint32_t written = io->getBytesWritten();
+        port.stats.bytesRead += read - port.lastBytesRead;
+        port.stats.bytesWritten += written - port.lastBytesWritten;
+        // Protocols may write outside of sendQueuedData (RC frames), all of it counts against the limit
+        if (port.maxBytesPerSecond)
+            port.tokens -= written - port.lastBytesWritten;
+        port.lastBytesRead = read;
+        port.lastBytesWritten = written;
+    }
+
+    port_t m_ports[MaxPorts];
+    uint8_t m_portCount;
+    volatile uint32_t m_rcSeq;
+    uint32_t m_filteredSeq;
+    bool m_filterResult;
+    frame_filter_t m_filter;
+};
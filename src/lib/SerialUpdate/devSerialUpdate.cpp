@@ -65,6 +65,7 @@ device_t SerialUpdate_device = {
     .initialize = initialize,
     .start = nullptr,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "SerialUpdate",
 };
 #endif
\ No newline at end of file
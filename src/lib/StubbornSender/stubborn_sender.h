@@ -26,6 +26,7 @@ public:
     void ConfirmCurrentPayload(bool telemetryConfirmValue);
     bool IsActive() const { return senderState != SENDER_IDLE; }
     uint16_t GetMaxPacketsBeforeResync() const { return maxWaitCount; }
+    uint8_t GetBytesRemaining() const { return IsActive() ? length - currentOffset : 0; }
 private:
     uint8_t *data;
     uint8_t length;
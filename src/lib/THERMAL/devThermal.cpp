@@ -279,7 +279,9 @@ device_t Thermal_device = {
     .initialize = initialize,
     .start = start,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = DEVICE_EVENT_TRIGGERED,
+    .name = "Thermal",
 };
 
 #endif // HAS_THERMAL || HAS_FAN
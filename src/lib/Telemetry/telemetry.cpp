@@ -12,6 +12,10 @@ extern TCPSOCKET wifi2tcp;
 #include "devMSPVTX.h"
 #endif
 
+#if defined(MSP_RESPONSE_CACHE_TTL_MS) && defined(TARGET_RX)
+#include "mspcache.h"
+#endif
+
 #if defined(UNIT_TEST)
 #include <iostream>
 using namespace std;
@@ -134,6 +138,24 @@ uint8_t Telemetry::UpdatedPayloadCount()
     return count;
 }
 
+/**
+ * @brief: Bytes of the messages (MSP and settings responses) waiting to be sent, not
+ * counting the one being sent. Sensor payloads are left out as they are always updated.
+ ***/
+uint16_t Telemetry::QueuedMessageBytes()
+{
+    uint16_t bytes = 0;
+    for (int8_t i = payloadTypesCount - 2; i < payloadTypesCount; i++)
+    {
+        if (payloadTypes[i].updated && !payloadTypes[i].locked)
+        {
+            bytes += CRSF_FRAME_SIZE(payloadTypes[i].data[CRSF_TELEMETRY_LENGTH_INDEX]);
+        }
+    }
+
+    return bytes;
+}
+
 uint8_t Telemetry::ReceivedPackagesCount()
 {
     return receivedPackages;
@@ -324,6 +346,9 @@ bool Telemetry::AppendTelemetryPackage(uint8_t *package)
                 {
                     mspVtxProcessPacket(package);
                 }
+#endif
+#if defined(MSP_RESPONSE_CACHE_TTL_MS) && defined(TARGET_RX)
+                mspResponseCache.handleResponse(package, millis());
 #endif
                 // This code is emulating a two slot FIFO with head dropping
                 if (currentPayloadIndex == payloadTypesCount - 2 && payloadTypes[currentPayloadIndex].locked)
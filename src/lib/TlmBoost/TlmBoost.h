@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include "common.h"
+
+/**
+ * @brief Telemetry ratio boost driven by the receiver's telemetry queue depth. The receiver
+ * reports how much telemetry it has waiting in each LinkStats, and the transmitter raises
+ * the telemetry ratio just enough to send it within TLM_BOOST_DRAIN_MS, up to
+ * TLM_BOOST_RATIO_MAX. The ratio drops back once the queue is reported empty, so RC packets
+ * are only given up while there is something to send.
+ */
+
+// Bytes per count of OTA_LinkStats_s::tlmQueued, 255 counts is about 4KB
+#define TLM_QUEUED_UNIT     16
+// Time the boosted ratio aims to send the queue in
+#define TLM_BOOST_DRAIN_MS  1000
+// Highest ratio the boost will use
+#if !defined(TLM_BOOST_RATIO_MAX)
+#define TLM_BOOST_RATIO_MAX TLM_RATIO_1_4
+#endif
+
+/**
+ * @brief Convert a number of queued bytes to the tlmQueued count, rounding up so any data
+ * at all is reported
+ */
+static inline uint8_t TlmQueuedToOta(uint32_t bytes)
+{
+    uint32_t units = (bytes + TLM_QUEUED_UNIT - 1) / TLM_QUEUED_UNIT;
+    return (units > 255) ? 255 : units;
+}
+
+/**
+ * @brief The lowest telemetry ratio which sends the reported queue within TLM_BOOST_DRAIN_MS
+ * @param rateHz: Packet rate
+ * @param bytesPerCall: Telemetry payload bytes per telemetry packet
+ * @param queued: tlmQueued from the receiver's LinkStats
+ * @returns TLM_RATIO_NO_TLM when nothing is queued, else TLM_RATIO_1_128 .. TLM_BOOST_RATIO_MAX
+ */
+static inline expresslrs_tlm_ratio_e TlmBoostRatio(uint16_t rateHz, uint8_t bytesPerCall, uint8_t queued)
+{
+    if (queued == 0)
+        return TLM_RATIO_NO_TLM;
+
+    const uint32_t bytes = (uint32_t)queued * TLM_QUEUED_UNIT;
+    uint8_t ratio = TLM_RATIO_1_128;
+    for (; ratio < TLM_BOOST_RATIO_MAX; ++ratio)
+    {
+        // Same as TLMratioEnumToValue()
+        uint32_t denom = 1U << (8 + TLM_RATIO_NO_TLM - ratio);
+        if ((uint32_t)rateHz * bytesPerCall * TLM_BOOST_DRAIN_MS / denom / 1000U >= bytes)
+            break;
+    }
+    return (expresslrs_tlm_ratio_e)ratio;
+}
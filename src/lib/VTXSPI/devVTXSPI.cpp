@@ -482,7 +482,8 @@ device_t VTxSPI_device = {
     .initialize = initialize,
     .start = start,
     .event = nullptr,
-    .timeout = timeout
+    .timeout = timeout,
+    .name = "VTXSPI",
 };
 
 #endif
@@ -42,6 +42,8 @@
 #include "helpers.h"
 #include "devVTXSPI.h"
 #include "devButton.h"
+#include "SPITrace.h"
+#include "LBT.h"
 
 #include "WebContent.h"
 
@@ -63,6 +65,12 @@ extern RxConfig config;
 
 extern unsigned long rebootTime;
 
+#if defined(TARGET_RX)
+#include "SerialRouter.h"
+extern const serialRouterStats_t *serialGetStats(uint8_t port);
+extern void serialResetStats();
+#endif
+
 static char station_ssid[33];
 static char station_password[65];
 
@@ -82,9 +90,13 @@ static IPAddress ipAddress;
 #if defined(USE_MSP_WIFI) && defined(TARGET_RX)  //MSP2WIFI in enabled only for RX only at the moment
 #include "crsf2msp.h"
 #include "msp2crsf.h"
+#include "MSPParser.h"
 
 #include "tcpsocket.h"
 TCPSOCKET wifi2tcp(5761); //port 5761 as used by BF configurator
+// Frames the TCP stream into whole MSP frames, which may arrive split or several per read.
+// Sized so a frame both fits msp2crsf's FIFO once fragmented and reassembles on the other side
+static MSPParser<MSP_PAYLOAD_MAX_LEN> wifiMspParser;
 #endif
 
 #if defined(PLATFORM_ESP8266)
@@ -549,6 +561,100 @@ static void UpdateConfiguration(AsyncWebServerRequest *request, JsonVariant &jso
 }
 #endif
 
+static void WebUpdateGetProfile(AsyncWebServerRequest *request)
+{
+  if (request->hasArg("reset"))
+  {
+    devicesResetStats();
+#if defined(DEBUG_SPI_TRACE)
+    spiTrace.reset();
+#endif
+#if defined(Regulatory_Domain_EU_CE_2400)
+    LBTResetStats();
+#endif
+#if defined(TARGET_RX)
+    serialResetStats();
+#endif
+  }
+
+  JsonDocument json;
+  const deviceLoopStats_t *loop = devicesGetLoopStats();
+  json["loop"]["count"] = loop->count;
+  json["loop"]["avg-us"] = loop->count ? (uint32_t)(loop->totalMicros / loop->count) : 0;
+  json["loop"]["max-us"] = loop->maxMicros;
+  for (int bucket = 0; bucket < DEVICE_LOOP_BUCKET_COUNT; bucket++)
+  {
+    // The last bucket has no upper limit
+    if (bucket < DEVICE_LOOP_BUCKET_COUNT - 1)
+      json["loop"]["histogram"][bucket]["le-us"] = deviceLoopBucketMicros[bucket];
+    json["loop"]["histogram"][bucket]["count"] = loop->buckets[bucket];
+  }
+  json["device-load"][0] = devicesGetDeviceLoad(0);
+  json["device-load"][1] = devicesGetDeviceLoad(1);
+
+  for (int i = 0; i < devicesGetCount(); i++)
+  {
+    const device_affinity_t *device = devicesGetDevice(i);
+    const deviceStats_t *stats = devicesGetStats(i);
+    JsonObject dev = json["devices"][i].to<JsonObject>();
+    dev["name"] = device->device->name ? device->device->name : "";
+    dev["core"] = device->core;
+    dev["events"] = stats->events;
+    dev["timeouts"] = stats->timeouts;
+    dev["total-us"] = stats->totalMicros;
+    dev["max-us"] = stats->maxMicros;
+    dev["late"] = stats->late;
+    dev["max-late-ms"] = stats->maxLateMillis;
+  }
+
+#if defined(TARGET_RX)
+  const serialRouterStats_t *serial;
+  for (uint8_t port = 0; (serial = serialGetStats(port)) != nullptr; port++)
+  {
+    JsonObject ser = json["serial"][port].to<JsonObject>();
+    ser["rc-frames"] = serial->rcFrames;
+    ser["rc-missed"] = serial->rcMissed;
+    ser["link-stats"] = serial->linkStats;
+    ser["msp-frames"] = serial->mspFrames;
+    ser["bytes-read"] = serial->bytesRead;
+    ser["bytes-written"] = serial->bytesWritten;
+    ser["throttled"] = serial->throttled;
+  }
+#endif
+
+#if defined(DEBUG_SPI_TRACE)
+  const spiTraceStats_t &spi = spiTrace.getStats();
+  json["spi"]["transactions"] = spi.transactions;
+  json["spi"]["bytes"] = spi.bytes;
+  json["spi"]["repeats"] = spi.repeats;
+  json["spi"]["busy-us"] = spi.busyMicros;
+  json["spi"]["max-busy-us"] = spi.maxBusyMicros;
+#endif
+
+#if defined(Regulatory_Domain_EU_CE_2400)
+  json["lbt"]["enabled"] = LBTEnabled;
+  json["lbt"]["success"] = LBTSuccessCalc.getLQ();
+  json["lbt"]["checks"] = LBTStats.checks;
+  json["lbt"]["waits"] = LBTStats.waits;
+  json["lbt"]["wait-us"] = LBTStats.waitMicros;
+  json["lbt"]["max-wait-us"] = LBTStats.maxWaitMicros;
+  json["lbt"]["skips"] = LBTStats.skips;
+  for (int channel = 0, i = 0; channel < LBT_MAX_CHANNELS; channel++)
+  {
+    if (LBTStats.channelChecks[channel] == 0)
+      continue;
+    json["lbt"]["channels"][i]["channel"] = channel;
+    json["lbt"]["channels"][i]["checks"] = LBTStats.channelChecks[channel];
+    json["lbt"]["channels"][i]["blocked"] = LBTStats.channelBlocked[channel];
+    i++;
+  }
+#endif
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  serializeJson(json, *response);
+  request->send(response);
+}
+
 static void WebUpdateGetTarget(AsyncWebServerRequest *request)
 {
   JsonDocument json;
@@ -897,7 +1003,7 @@ static void HandleContinuousWave(AsyncWebServerRequest *request) {
 #else
     Radio.startCWTest(FHSSconfig->freq_center, radio);
 #if defined(RADIO_SX127X)
-    deferExecutionMillis(50, [radio](){ Radio.cwRepeat(radio); });
+    deferExecutionMillis(50, [](void *context){ Radio.cwRepeat((SX12XX_Radio_Number_t)(uintptr_t)context); }, (void *)(uintptr_t)radio);
 #endif
 #endif
   } else {
@@ -1077,6 +1183,7 @@ static void startServices()
   server.on("/config", HTTP_GET, GetConfiguration);
   server.on("/access", WebUpdateAccessPoint);
   server.on("/target", WebUpdateGetTarget);
+  server.on("/profile.json", WebUpdateGetProfile);
   server.on("/firmware.bin", WebUpdateGetFirmware);
 
   server.on("/update", HTTP_POST, WebUploadResponseHandler, WebUploadDataHandler);
@@ -1258,7 +1365,24 @@ void HandleMSP2WIFI()
   {
     uint8_t data[bytesReady];
     wifi2tcp.read(data);
-    msp2crsf.parse(data, bytesReady);
+    uint16_t pos = 0;
+    while (pos < bytesReady)
+    {
+      pos += wifiMspParser.parse(&data[pos], bytesReady - pos);
+      if (wifiMspParser.frameReady())
+      {
+        // Drop the new frame rather than letting the FIFO flush the chunks already queued
+        if (msp2crsf.FIFOout.free() >= CRSF_MSP_FRAGMENTED_LEN(wifiMspParser.getFrameLen() - 4))
+        {
+          msp2crsf.parse(wifiMspParser.getFrame(), wifiMspParser.getFrameLen());
+        }
+        else
+        {
+          DBGLN("MSP2WIFI frame dropped, CRSF FIFO full");
+        }
+        wifiMspParser.markFrameConsumed();
+      }
+    }
   }
 
   wifi2tcp.handle();
@@ -1342,7 +1466,8 @@ device_t WIFI_device = {
   .initialize = initialize,
   .start = start,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .name = "WiFi",
 };
 
 #endif
@@ -3,6 +3,7 @@
 #if defined(TARGET_TX)
 #include <handset.h>
 #include <LBT.h>
+#include <LinkMargin.h>
 
 // LQ-based boost defines
 #define DYNPOWER_LQ_BOOST_THRESH_DIFF 20  // If LQ is dropped suddenly for this amount (relative), immediately boost to the max power configured.
@@ -10,13 +11,11 @@
 #define DYNPOWER_LQ_MOVING_AVG_K      8   // Number of previous values for calculating moving average. Best with power of 2.
 #define DYNPOWER_LQ_THRESH_UP         85  // Below this LQ, the RSSI/SNR code will increase the power if RSSI/SNR did nothing
 
-// RSSI-based increment defines
-#define DYNPOWER_RSSI_CNT 5               // Number of RSSI readings to average (straight average) to make an RSSI-based adjustment
+// RSSI-based margin defines
 #define DYNPOWER_RSSI_THRESH_UP 15        // RSSI < (Sensitivity+Up) -> raise power
 #define DYNPOWER_RSSI_THRESH_DN 21        // RSSI > (Sensitivity+Dn) >- lower power
 
-// SNR-based increment defines
-#define DYNPOWER_LQ_THRESH_DN 95          // Min LQ for lowering power using SNR-based power lowering
+#define DYNPOWER_LQ_THRESH_DN 95          // Min LQ for lowering power on the link margin
 
 template<uint8_t K, uint8_t SHIFT>
 class MovingAvg
@@ -33,7 +32,8 @@ private:
 };
 
 static MovingAvg<DYNPOWER_LQ_MOVING_AVG_K, 16> dynpower_mavg_lq;
-static MeanAccumulator<int32_t, int8_t, -128> dynpower_mean_rssi;
+static LinkMargin dynpower_margin;
+static const expresslrs_rf_pref_params_s *dynpower_margin_rfperf;
 static int8_t dynpower_updated;
 static uint32_t dynpower_last_linkstats_millis;
 
@@ -46,6 +46,7 @@ void DynamicPower_Init()
 {
     dynpower_mavg_lq = 100;
     dynpower_updated = DYNPOWER_UPDATE_NOUPDATE;
+    dynpower_margin.reset();
 }
 
 void ICACHE_RAM_ATTR DynamicPower_TelemetryUpdate(int8_t snrScaled)
@@ -141,52 +142,45 @@ void DynamicPower_Update(uint32_t now)
       return;
   }
 
-  PowerLevels_e startPowerLevel = POWERMGNT::currPower();
-  if (ExpressLRS_currAirRate_RFperfParams->DynpowerSnrThreshUp == DYNPOWER_SNR_THRESH_NONE)
+  // =============  Link margin based power control ==============
+  // The margin is over the level where the power must be raised: RSSI against the
+  // rate's sensitivity, or SNR against the rate's threshold where one is set
+  const expresslrs_rf_pref_params_s *rfperf = ExpressLRS_currAirRate_RFperfParams;
+  if (rfperf != dynpower_margin_rfperf)
   {
-    // =============  RSSI-based power increment ==============
-    // a simple threshold compared against N sample average of
-    // rssi vs the sensitivity limit +/- some thresholds
-    dynpower_mean_rssi.add(rssi);
+    dynpower_margin.reset();
+    dynpower_margin_rfperf = rfperf;
+  }
 
-    if (dynpower_mean_rssi.getCount() >= DYNPOWER_RSSI_CNT)
-    {
-      int32_t expected_RXsensitivity = ExpressLRS_currAirRate_RFperfParams->RXsensitivity;
-      int8_t rssi_inc_threshold = expected_RXsensitivity + DYNPOWER_RSSI_THRESH_UP;
-      int8_t rssi_dec_threshold = expected_RXsensitivity + DYNPOWER_RSSI_THRESH_DN;
-      int8_t avg_rssi = dynpower_mean_rssi.mean(); // resets it too
-      if ((avg_rssi < rssi_inc_threshold) && (powerHeadroom > 0))
-      {
-        DBGLN("+power (rssi)");
-        POWERMGNT::incPower();
-      }
-      else if (avg_rssi > rssi_dec_threshold && lq_avg >= DYNPOWER_LQ_THRESH_DN)
-      {
-        DBGVLN("-power (rssi)"); // Verbose because this spams when idle
-        POWERMGNT::decPower();
-      }
-    }
-  } // ^^ if RSSI-based
+  int16_t margin;
+  int16_t window;
+  if (rfperf->DynpowerSnrThreshUp == DYNPOWER_SNR_THRESH_NONE)
+  {
+    margin = (rssi - (rfperf->RXsensitivity + DYNPOWER_RSSI_THRESH_UP)) * LinkMargin::FRAC;
+    window = (DYNPOWER_RSSI_THRESH_DN - DYNPOWER_RSSI_THRESH_UP) * LinkMargin::FRAC;
+  }
   else
   {
-    // =============  SNR-based power increment ==============
-    // Decrease the power if SNR above threshold and LQ is good
-    // Increase the power for each (X) SNR below the threshold
-    if (snrScaled >= ExpressLRS_currAirRate_RFperfParams->DynpowerSnrThreshDn && lq_avg >= DYNPOWER_LQ_THRESH_DN)
-    {
-      DBGVLN("-power (snr)"); // Verbose because this spams when idle
-      POWERMGNT::decPower();
-    }
+    margin = (snrScaled - rfperf->DynpowerSnrThreshUp) * LinkMargin::FRAC / RADIO_SNR_SCALE;
+    window = (rfperf->DynpowerSnrThreshDn - rfperf->DynpowerSnrThreshUp) * LinkMargin::FRAC / RADIO_SNR_SCALE;
+  }
 
-    while ((snrScaled <= ExpressLRS_currAirRate_RFperfParams->DynpowerSnrThreshUp) && (powerHeadroom > 0))
-    {
-      DBGLN("+power (snr)");
-      POWERMGNT::incPower();
-      // Every power doubling will theoretically increase the SNR by 3dB, but closer to 2dB in testing
-      snrScaled += SNR_SCALE(2);
-      --powerHeadroom;
-    }
-  } // ^^ if SNR-based
+  PowerLevels_e startPowerLevel = POWERMGNT::currPower();
+  dynpower_margin.add(margin, startPowerLevel);
+  // Lowering needs the LQ to be good as well as the margin
+  PowerLevels_e newPowerLevel = (PowerLevels_e)dynpower_margin.choose(startPowerLevel,
+    POWERMGNT::getMinPower(), config.GetPower(), window, lq_avg >= DYNPOWER_LQ_THRESH_DN);
+  if (newPowerLevel > startPowerLevel)
+  {
+    DBGLN("+power (margin %d)", dynpower_margin.predictedAt(startPowerLevel) / LinkMargin::FRAC);
+    POWERMGNT::setPower(newPowerLevel);
+    powerHeadroom = (uint8_t)config.GetPower() - (uint8_t)newPowerLevel;
+  }
+  else if (newPowerLevel < startPowerLevel)
+  {
+    DBGVLN("-power (margin %d)", dynpower_margin.marginAt(startPowerLevel) / LinkMargin::FRAC); // Verbose because this spams when idle
+    POWERMGNT::setPower(newPowerLevel);
+  }
 
   // If instant LQ is low, but the SNR/RSSI did nothing, inc power by one step
   if ((powerHeadroom > 0) && (startPowerLevel == POWERMGNT::currPower()) && (lq_current <= DYNPOWER_LQ_THRESH_UP))
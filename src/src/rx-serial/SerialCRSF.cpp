@@ -62,51 +62,28 @@ uint32_t SerialCRSF::sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t
     if (!frameAvailable)
         return DURATION_IMMEDIATELY;
 
-    crsf_channels_s PackedRCdataOut;
-    PackedRCdataOut.ch0 = channelData[0];
-    PackedRCdataOut.ch1 = channelData[1];
-    PackedRCdataOut.ch2 = channelData[2];
-    PackedRCdataOut.ch3 = channelData[3];
-    PackedRCdataOut.ch4 = channelData[4];
-    PackedRCdataOut.ch5 = channelData[5];
-    PackedRCdataOut.ch6 = channelData[6];
-    PackedRCdataOut.ch7 = channelData[7];
-    PackedRCdataOut.ch8 = channelData[8];
-    PackedRCdataOut.ch9 = channelData[9];
-    PackedRCdataOut.ch10 = channelData[10];
-    PackedRCdataOut.ch11 = channelData[11];
-    PackedRCdataOut.ch12 = channelData[12];
-    PackedRCdataOut.ch13 = channelData[13];
+    uint8_t outBuffer[CRSF_FRAME_SIZE(sizeof(crsf_channels_t)) + 2];
+    uint8_t len;
 
     // In 16ch mode, do not output RSSI/LQ on channels
     if (OtaIsFullRes && OtaSwitchModeCurrent == smHybridOr16ch)
     {
-        PackedRCdataOut.ch14 = channelData[14];
-        PackedRCdataOut.ch15 = channelData[15];
+        len = encoder.encode(channelData, outBuffer);
     }
     else
     {
         // Not in 16-channel mode, send LQ and RSSI dBm
         int32_t rssiDBM = CRSF::LinkStatistics.active_antenna == 0 ? -CRSF::LinkStatistics.uplink_RSSI_1 : -CRSF::LinkStatistics.uplink_RSSI_2;
 
-        PackedRCdataOut.ch14 = UINT10_to_CRSF(fmap(CRSF::LinkStatistics.uplink_Link_quality, 0, 100, 0, 1023));
-        PackedRCdataOut.ch15 = UINT10_to_CRSF(map(constrain(rssiDBM, ExpressLRS_currAirRate_RFperfParams->RXsensitivity, -50),
-                                                   ExpressLRS_currAirRate_RFperfParams->RXsensitivity, -50, 0, 1023));
+        uint32_t channels[CRSF_NUM_CHANNELS];
+        memcpy(channels, channelData, 14 * sizeof(uint32_t));
+        channels[14] = UINT10_to_CRSF(fmap(CRSF::LinkStatistics.uplink_Link_quality, 0, 100, 0, 1023));
+        channels[15] = UINT10_to_CRSF(map(constrain(rssiDBM, ExpressLRS_currAirRate_RFperfParams->RXsensitivity, -50),
+                                          ExpressLRS_currAirRate_RFperfParams->RXsensitivity, -50, 0, 1023));
+        len = encoder.encode(channels, outBuffer);
     }
 
-    constexpr uint8_t outBuffer[] = {
-        // No need for length prefix as we aren't using the FIFO
-        CRSF_ADDRESS_FLIGHT_CONTROLLER,
-        CRSF_FRAME_SIZE(sizeof(PackedRCdataOut)),
-        CRSF_FRAMETYPE_RC_CHANNELS_PACKED
-    };
-
-    uint8_t crc = crsf_crc.calc(outBuffer[2]);
-    crc = crsf_crc.calc((byte *)&PackedRCdataOut, sizeof(PackedRCdataOut), crc);
-
-    _outputPort->write(outBuffer, sizeof(outBuffer));
-    _outputPort->write((byte *)&PackedRCdataOut, sizeof(PackedRCdataOut));
-    _outputPort->write(crc);
+    _outputPort->write(outBuffer, len);
     return DURATION_IMMEDIATELY;
 }
 
@@ -1,8 +1,9 @@
 #include "SerialIO.h"
+#include "ChannelEncoder.h"
 
 class SerialCRSF : public SerialIO {
 public:
-    explicit SerialCRSF(Stream &out, Stream &in) : SerialIO(&out, &in) {}
+    explicit SerialCRSF(Stream &out, Stream &in) : SerialIO(&out, &in), encoder(rcEncoderCRSF) {}
     virtual ~SerialCRSF() {}
 
     uint32_t sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData) override;
@@ -11,5 +12,6 @@ public:
     void sendQueuedData(uint32_t maxBytesToSend) override;
 
 private:
+    RCFrameEncoder encoder;
     void processBytes(uint8_t *bytes, uint16_t size) override;
 };
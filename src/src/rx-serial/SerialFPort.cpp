@@ -0,0 +1,84 @@
+#include "SerialFPort.h"
+#include "CRSF.h"
+#include "device.h"
+#include "config.h"
+#include "telemetry.h"
+
+#if defined(TARGET_RX) && (defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32))
+
+#if defined(PLATFORM_ESP32)
+#include <hal/uart_ll.h>
+#endif
+
+extern Telemetry telemetry;
+
+const auto UNCONNECTED_CALLBACK_INTERVAL_MS = 10;
+const auto FPORT_CALLBACK_INTERVAL_MS = 9;
+
+void SerialFPort::setTXMode()
+{
+#if defined(PLATFORM_ESP32)
+    pinMode(halfDuplexPin, OUTPUT);                                 // set half duplex GPIO to OUTPUT
+    digitalWrite(halfDuplexPin, HIGH);                              // set half duplex GPIO to high level
+    pinMatrixOutAttach(halfDuplexPin, UTXDoutIdx, false, false);    // attach GPIO as output of UART TX
+#endif
+    transmitting = true;
+}
+
+void SerialFPort::setRXMode()
+{
+#if defined(PLATFORM_ESP32)
+    pinMode(halfDuplexPin, INPUT_PULLUP);                           // set half duplex GPIO to INPUT
+    pinMatrixInAttach(halfDuplexPin, URXDinIdx, false);             // attach half duplex GPIO as input to UART RX
+#endif
+    transmitting = false;
+}
+
+uint32_t SerialFPort::sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData)
+{
+    static auto sendPackets = false;
+    bool effectivelyFailsafed = failsafe || (!connectionHasModelMatch) || (!teamraceHasModelMatch);
+    if ((effectivelyFailsafed && config.GetFailsafeMode() == FAILSAFE_NO_PULSES) || (!sendPackets && connectionState != connected))
+    {
+        return UNCONNECTED_CALLBACK_INTERVAL_MS;
+    }
+    sendPackets = true;
+
+    if ((!frameAvailable && !frameMissed && !effectivelyFailsafed) || _outputPort->availableForWrite() < 2 * FPORT_MAX_FRAME_LEN)
+    {
+        return DURATION_IMMEDIATELY;
+    }
+
+    uint8_t flags = 0;
+    flags |= effectivelyFailsafed ? FPORT_FLAG_FAILSAFE : 0;
+    flags |= frameMissed ? FPORT_FLAG_FRAME_LOST : 0;
+
+    uint8_t outBuffer[2 * FPORT_MAX_FRAME_LEN];
+    const uint8_t len = fport.encodeRCFrame(channelData, flags, CRSF::LinkStatistics.uplink_Link_quality, millis(), outBuffer);
+    setTXMode();
+    _outputPort->write(outBuffer, len);
+    return FPORT_CALLBACK_INTERVAL_MS;
+}
+
+void SerialFPort::sendQueuedData(uint32_t maxBytesToSend)
+{
+#if defined(PLATFORM_ESP32)
+    // Release the line for the FC's uplink frame as soon as the downlink request is out
+    if (transmitting && uart_ll_is_tx_idle(UART_LL_GET_HW(uartNum)))
+    {
+        setRXMode();
+    }
+#endif
+
+    const uint8_t *frame;
+    while ((frame = sensors.nextFrame(millis())) != nullptr)
+    {
+        if (frame[2] == CRSF_FRAMETYPE_BATTERY_SENSOR)
+            telemetry.SetCrsfBatterySensorDetected();
+        else if (frame[2] == CRSF_FRAMETYPE_BARO_ALTITUDE)
+            telemetry.SetCrsfBaroSensorDetected();
+        telemetry.AppendTelemetryPackage((uint8_t *)frame);
+    }
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "SerialIBUS.h"
+#include "CRSF.h"
+#include "device.h"
+#include "config.h"
+#include "telemetry.h"
+
+#if defined(TARGET_RX) && (defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32))
+
+#if defined(PLATFORM_ESP32)
+#include <hal/uart_ll.h>
+#endif
+
+extern Telemetry telemetry;
+
+const auto UNCONNECTED_CALLBACK_INTERVAL_MS = 10;
+const auto IBUS_CALLBACK_INTERVAL_MS = 7;
+
+void SerialIBUS::setTXMode()
+{
+#if defined(PLATFORM_ESP32)
+    pinMode(halfDuplexPin, OUTPUT);                                 // set half duplex GPIO to OUTPUT
+    digitalWrite(halfDuplexPin, HIGH);                              // set half duplex GPIO to high level
+    pinMatrixOutAttach(halfDuplexPin, UTXDoutIdx, false, false);    // attach GPIO as output of UART TX
+#endif
+    transmitting = true;
+}
+
+void SerialIBUS::setRXMode()
+{
+#if defined(PLATFORM_ESP32)
+    pinMode(halfDuplexPin, INPUT_PULLUP);                           // set half duplex GPIO to INPUT
+    pinMatrixInAttach(halfDuplexPin, URXDinIdx, false);             // attach half duplex GPIO as input to UART RX
+    // Anything received while the pin was driven is not from a sensor
+    while (_inputPort->available())
+        _inputPort->read();
+#endif
+    transmitting = false;
+}
+
+void SerialIBUS::processBytes(uint8_t *bytes, uint16_t size)
+{
+#if defined(PLATFORM_ESP32)
+    if (transmitting)
+        return;
+#elif defined(PLATFORM_ESP8266)
+    // The sensor poll reads back the same as a discovery reply, so the echo must be skipped
+    const uint16_t echo = size < echoBytes ? size : echoBytes;
+    echoBytes -= echo;
+    bytes += echo;
+    size -= echo;
+#endif
+    sensorMaster.processBytes(bytes, size);
+}
+
+uint32_t SerialIBUS::sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData)
+{
+    static auto sendPackets = false;
+    bool effectivelyFailsafed = failsafe || (!connectionHasModelMatch) || (!teamraceHasModelMatch);
+    if ((effectivelyFailsafed && config.GetFailsafeMode() == FAILSAFE_NO_PULSES) || (!sendPackets && connectionState != connected))
+    {
+        return UNCONNECTED_CALLBACK_INTERVAL_MS;
+    }
+    sendPackets = true;
+
+    if ((!frameAvailable && !frameMissed && !effectivelyFailsafed) || _outputPort->availableForWrite() < IBUS_SERVO_FRAME_LEN + IBUS_CMD_LEN)
+    {
+        return DURATION_IMMEDIATELY;
+    }
+
+    uint8_t outBuffer[IBUS_SERVO_FRAME_LEN + IBUS_CMD_LEN];
+    uint8_t len = encoder.encode(channelData, outBuffer);
+    // The sensor command goes out right behind the servo frame so the reply is in before the next one
+    len += sensorMaster.nextCommand(&outBuffer[len]);
+    setTXMode();
+#if defined(PLATFORM_ESP8266)
+    echoBytes += len;
+#endif
+    _outputPort->write(outBuffer, len);
+    return IBUS_CALLBACK_INTERVAL_MS;
+}
+
+void SerialIBUS::sendQueuedData(uint32_t maxBytesToSend)
+{
+#if defined(PLATFORM_ESP32)
+    // Release the line for the sensor's reply as soon as the poll is out
+    if (transmitting && uart_ll_is_tx_idle(UART_LL_GET_HW(uartNum)))
+    {
+        setRXMode();
+    }
+#endif
+
+    const uint8_t *frame;
+    while ((frame = sensors.nextFrame(millis())) != nullptr)
+    {
+        if (frame[2] == CRSF_FRAMETYPE_BATTERY_SENSOR)
+            telemetry.SetCrsfBatterySensorDetected();
+        else if (frame[2] == CRSF_FRAMETYPE_BARO_ALTITUDE)
+            telemetry.SetCrsfBaroSensorDetected();
+        telemetry.AppendTelemetryPackage((uint8_t *)frame);
+    }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#if defined(TARGET_RX) && (defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32))
+
+#pragma once
+
+#include "SerialIO.h"
+#include "ChannelEncoder.h"
+#include "IBusSensors.h"
+
+/**
+ * FlySky IBUS servo frames, with the FC's IBUS sensors polled on the same port. The servo
+ * frame and sensor poll are sent, then the line is released for the sensor's reply, half
+ * duplex on one pin on ESP32. On ESP8266 the RX and TX pins must be joined externally, and
+ * what was written is read back and dropped before the reply.
+ */
+class SerialIBUS : public SerialIO {
+public:
+    explicit SerialIBUS(Stream &out, Stream &in, int8_t serial1TXpin = UNDEF_PIN)
+        : SerialIO(&out, &in), encoder(rcEncoderIBUS), sensorMaster(sensors)
+    {
+#if defined(PLATFORM_ESP32)
+        if (serial1TXpin == UNDEF_PIN)
+        {
+            // we are on UART0, use default TX pin for half duplex if not defined otherwise
+            uartNum = 0;
+            UTXDoutIdx = U0TXD_OUT_IDX;
+            URXDinIdx = U0RXD_IN_IDX;
+            halfDuplexPin = GPIO_PIN_RCSIGNAL_TX == UNDEF_PIN ? U0TXD_GPIO_NUM : GPIO_PIN_RCSIGNAL_TX;
+        }
+        else
+        {
+            // we are on UART1, use Serial1 TX assigned pin for half duplex
+            uartNum = 1;
+            UTXDoutIdx = U1TXD_OUT_IDX;
+            URXDinIdx = U1RXD_IN_IDX;
+            halfDuplexPin = serial1TXpin;
+        }
+#endif
+        setRXMode();
+    }
+    ~SerialIBUS() override = default;
+
+    void queueLinkStatisticsPacket() override {}
+    void queueMSPFrameTransmission(uint8_t* data) override {}
+    uint32_t sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData) override;
+    // The half duplex pin is turned around for the frame, so it must be written straight away
+    bool canStageRCOutput() override { return false; }
+    void sendQueuedData(uint32_t maxBytesToSend) override;
+
+private:
+    void processBytes(uint8_t *bytes, uint16_t size) override;
+    void setTXMode();
+    void setRXMode();
+
+#if defined(PLATFORM_ESP32)
+    int8_t halfDuplexPin;
+    uint8_t uartNum;
+    uint8_t UTXDoutIdx;
+    uint8_t URXDinIdx;
+#endif
+    bool transmitting = false;
+#if defined(PLATFORM_ESP8266)
+    uint16_t echoBytes = 0;
+#endif
+
+    RCFrameEncoder encoder;
+    SensorTelemetry sensors;
+    IBusSensorMaster sensorMaster;
+};
+
+#endif
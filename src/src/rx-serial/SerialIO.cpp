@@ -5,12 +5,49 @@ void SerialIO::setFailsafe(bool failsafe)
     this->failsafe = failsafe;
 }
 
+uint32_t SerialIO::outputRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData)
+{
+    if (_rcStage == nullptr || _outputPort == nullptr)
+    {
+        return sendRCFrame(frameAvailable, frameMissed, channelData);
+    }
+
+    _outputPort = _rcStage;
+    const uint32_t duration = sendRCFrame(frameAvailable, frameMissed, channelData);
+    _outputPort = &_outputCounter;
+    _outputCounter.addBytesWritten(_rcStage->commit());
+    return duration;
+}
+
+void SerialIO::setRCOutputStage(RCOutputStage *stage)
+{
+    if (!canStageRCOutput())
+    {
+        stage = nullptr;
+    }
+    if (stage == _rcStage)
+    {
+        return;
+    }
+    if (_rcStage != nullptr)
+    {
+        _rcStage->clear();
+    }
+    _rcStage = stage;
+    if (stage != nullptr)
+    {
+        // The stage outlives the protocol, so it writes to the port itself
+        stage->setOutput(_outputCounter.getStream());
+    }
+}
+
 void SerialIO::processSerialInput()
 {
     auto maxBytes = getMaxSerialReadSize();
     uint8_t buffer[maxBytes];
     auto size = min(_inputPort->available(), maxBytes);
     _inputPort->readBytes(buffer, size);
+    _bytesRead += size;
     processBytes(buffer, size);
 }
 
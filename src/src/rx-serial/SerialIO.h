@@ -3,6 +3,8 @@
 #include "targets.h"
 #include "FIFO.h"
 #include "device.h"
+#include "CountingStream.h"
+#include "RCOutputStage.h"
 
 /**
  * @brief Abstract class that is to be extended by implementation classes for different serial protocols on the receiver side.
@@ -18,7 +20,7 @@
 class SerialIO {
 public:
 
-    SerialIO(Stream *output, Stream *input) : _outputPort(output), _inputPort(input) {}
+    SerialIO(Stream *output, Stream *input) : _outputCounter(output), _outputPort(output ? &_outputCounter : nullptr), _inputPort(input) {}
     virtual ~SerialIO() {}
 
     /**
@@ -67,6 +69,27 @@ public:
      */
     virtual uint32_t sendRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData) = 0;
 
+    /**
+     * @brief Call `sendRCFrame`, capturing what it writes in the RC output stage if
+     * one is set rather than writing it straight to the serial port.
+     *
+     * @return the duration returned by `sendRCFrame`
+     */
+    uint32_t outputRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData);
+
+    /**
+     * @brief Set the stage RC frames are held in until a timed writer sends them, or
+     * nullptr to write them out directly.
+     */
+    void setRCOutputStage(RCOutputStage *stage);
+
+    /**
+     * @brief Whether what `sendRCFrame` writes can be held back and written out later,
+     * which it can't be if it is more than one RC frame or the protocol changes the state
+     * of the port around it.
+     */
+    virtual bool canStageRCOutput() { return true; }
+
     /**
      * @brief send any previously queued data to the serial port stream `_outputPort`
      * member variable.
@@ -91,7 +114,15 @@ public:
      */
     virtual int getMaxSerialWriteSize() { return defaultMaxSerialWriteSize; }
 
+    /**
+     * @brief Bytes read from and written to the serial port since the protocol was created
+     */
+    uint32_t getBytesRead() const { return _bytesRead; }
+    uint32_t getBytesWritten() const { return _outputCounter.getBytesWritten(); }
+
 protected:
+    /// @brief counts the bytes written to the real output stream
+    CountingStream _outputCounter;
     /// @brief the output stream for the serial port
     Stream *_outputPort;
     /// @brief flag that indicates the receiver is in the failsafe state
@@ -127,4 +158,6 @@ private:
     const int defaultMaxSerialWriteSize = 128;
 
     Stream *_inputPort;
+    uint32_t _bytesRead = 0;
+    RCOutputStage *_rcStage = nullptr;
 };
@@ -4,6 +4,7 @@
 #include "device.h"
 #include "common.h"
 #include "CRSF.h"
+#include "OTA.h"
 
 // Variables / constants for Mavlink //
 FIFO<MAV_INPUT_BUF_LEN> mavlinkInputBuffer;
@@ -18,7 +19,8 @@ FIFO<MAV_OUTPUT_BUF_LEN> mavlinkOutputBuffer;
     this_system_id(255),
     this_component_id(0),
     target_system_id(1),
-    target_component_id(1)
+    target_component_id(1),
+    flowControl(MAV_INPUT_BUF_LEN, 255, 0)
 {
 }
 
@@ -47,6 +49,77 @@ void SerialMavlink::sendQueuedData(uint32_t maxBytesToSend)
 
 #define MAV_FTP_OPCODE_OPENFILERO 4
 
+#if defined(MAVLINK_TLM_COMPRESSION)
+#include "MAVLinkCodec.h"
+
+static MAVLinkScanner mavlinkScanner(mavlinkLookupMsg, true);
+static MAVLinkEncoder mavlinkEncoder;
+static MAVLinkLatestOnly mavlinkLatestOnly;
+
+// Largest token that still fits in a chunk on its own
+#define MAV_MAX_TOKEN_LEN CRSF_PAYLOAD_SIZE_MAX
+
+/**
+ * Queue a frame as length prefixed tokens, a frame that can't be compressed is split
+ * into raw tokens. The whole frame is dropped if it doesn't fit so the tokens stay intact.
+ */
+static void queueMavlinkFrame(const mavlink_scanned_msg_t *msg)
+{
+    uint8_t token[MAV_MAX_TOKEN_LEN];
+    const uint16_t len = MAVLinkEncoder::encode(msg, token, sizeof(token));
+    const uint16_t rawPerToken = MAV_MAX_TOKEN_LEN - 2;
+    const uint16_t rawTokens = (msg->frameLen + rawPerToken - 1) / rawPerToken;
+    const uint16_t needed = len ? len + 2 : msg->frameLen + rawTokens * 4;
+
+    mavlinkInputBuffer.lock();
+    if (mavlinkInputBuffer.free() >= needed)
+    {
+        if (len)
+        {
+            mavlinkInputBuffer.pushSize(len);
+            mavlinkInputBuffer.pushBytes(token, len);
+        }
+        else
+        {
+            for (uint16_t pos = 0; pos < msg->frameLen; pos += rawPerToken)
+            {
+                uint16_t rawLen = MAVLinkEncoder::encodeRaw(&msg->frame[pos], std::min<uint16_t>(rawPerToken, msg->frameLen - pos), token);
+                mavlinkInputBuffer.pushSize(rawLen);
+                mavlinkInputBuffer.pushBytes(token, rawLen);
+            }
+        }
+    }
+    mavlinkInputBuffer.unlock();
+}
+
+uint8_t mavlinkPackCompressedChunk(uint8_t *data, uint8_t maxLen)
+{
+    // Periodic messages are only queued once the backlog has gone, so they are the latest sample
+    if (mavlinkInputBuffer.size() < maxLen)
+    {
+        const mavlink_scanned_msg_t *msg;
+        while ((msg = mavlinkLatestOnly.release()) != nullptr)
+        {
+            queueMavlinkFrame(msg);
+        }
+    }
+
+    uint8_t count = 0;
+    uint8_t token[MAV_MAX_TOKEN_LEN];
+    mavlinkEncoder.startChunk();
+    mavlinkInputBuffer.lock();
+    // Compacting never makes a token bigger, so the full size is enough to know it fits
+    while (mavlinkInputBuffer.size() > 2 && count + mavlinkInputBuffer.peekSize() <= maxLen)
+    {
+        uint16_t len = mavlinkInputBuffer.popSize();
+        mavlinkInputBuffer.popBytes(token, len);
+        count += mavlinkEncoder.compact(token, len, &data[count]);
+    }
+    mavlinkInputBuffer.unlock();
+    return count;
+}
+#endif
+
 SerialMavlink::SerialMavlink(Stream &out, Stream &in):
     SerialIO(&out, &in),
     // 255 is typically used by the GCS, for RC override to work in ArduPilot `SYSID_MYGCS` must be set to this value (255 is the default)
@@ -56,7 +129,8 @@ SerialMavlink::SerialMavlink(Stream &out, Stream &in):
     // Assume vehicle system ID is 1, ArduPilot's `SYSID_THISMAV` parameter. (1 is the default)
     target_system_id(1),
     // Send to AutoPilot component
-    target_component_id(MAV_COMPONENT::MAV_COMP_ID_AUTOPILOT1)
+    target_component_id(MAV_COMPONENT::MAV_COMP_ID_AUTOPILOT1),
+    flowControl(MAV_INPUT_BUF_LEN, this_system_id, this_component_id)
 {
 }
 
@@ -98,46 +172,59 @@ uint32_t SerialMavlink::sendRCFrame(bool frameAvailable, bool frameMissed, uint3
 
 int SerialMavlink::getMaxSerialReadSize()
 {
+#if defined(MAVLINK_TLM_COMPRESSION)
+    // The scanner has to take it all, on top of a partial frame
+    return std::min(MAV_INPUT_BUF_LEN - mavlinkInputBuffer.size(), MAVLINK_SCANNER_BUFFER_SIZE - MAVLINK_CODEC_MAX_FRAME_LEN);
+#else
     return MAV_INPUT_BUF_LEN - mavlinkInputBuffer.size();
+#endif
 }
 
 void SerialMavlink::processBytes(uint8_t *bytes, u_int16_t size)
 {
     if (connectionState == connected)
     {
+        flowControl.received(size, millis());
+#if defined(MAVLINK_TLM_COMPRESSION)
+        mavlinkScanner.push(bytes, size);
+        const mavlink_scanned_msg_t *msg;
+        while ((msg = mavlinkScanner.next()) != nullptr)
+        {
+            if (!mavlinkLatestOnly.hold(msg))
+            {
+                queueMavlinkFrame(msg);
+            }
+        }
+#else
         mavlinkInputBuffer.atomicPushBytes(bytes, size);
+#endif
     }
 }
 
-void SerialMavlink::sendQueuedData(uint32_t maxBytesToSend)
+void SerialMavlink::updateLinkRate()
 {
-
-    // Send radio messages at 100Hz
-    const uint32_t now = millis();
-    if ((now - lastSentFlowCtrl) > 10)
+    if (flowControlInterval == ExpressLRS_currAirRate_Modparams->interval && flowControlTlmDenom == ExpressLRS_currTlmDenom)
     {
-        lastSentFlowCtrl = now; 
-
-        // Software-based flow control for mavlink
-        uint8_t percentage_remaining = ((MAV_INPUT_BUF_LEN - mavlinkInputBuffer.size()) * 100) / MAV_INPUT_BUF_LEN;
-
-        // Populate radio status packet
-        const mavlink_radio_status_t radio_status {
-            rxerrors: 0,
-            fixed: 0,
-            rssi: (uint8_t)((float)CRSF::LinkStatistics.uplink_Link_quality * 2.55),
-            remrssi: CRSF::LinkStatistics.uplink_RSSI_1,
-            txbuf: percentage_remaining,
-            noise: (uint8_t)CRSF::LinkStatistics.uplink_SNR,
-            remnoise: 0,
-        };
-
-        uint8_t buf[MAVLINK_MSG_ID_RADIO_STATUS_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES];
-        mavlink_message_t msg;
-        mavlink_msg_radio_status_encode(this_system_id, this_component_id, &msg, &radio_status);
-        uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
-        _outputPort->write(buf, len);
+        return;
     }
+    flowControlInterval = ExpressLRS_currAirRate_Modparams->interval;
+    flowControlTlmDenom = ExpressLRS_currTlmDenom;
+
+    const uint16_t hz = 1000000 / flowControlInterval;
+    flowControl.setLinkRate(hz, flowControlTlmDenom, TLMBurstMaxForRateRatio(hz, flowControlTlmDenom),
+        OtaIsFullRes ? ELRS8_TELEMETRY_BYTES_PER_CALL : ELRS4_TELEMETRY_BYTES_PER_CALL, CRSF_FRAME_SIZE_MAX);
+}
+
+void SerialMavlink::sendQueuedData(uint32_t maxBytesToSend)
+{
+    // Software-based flow control for mavlink, RADIO_STATUS with txbuf based on what the link can carry
+    updateLinkRate();
+    const mavlink_flow_link_status_t link {
+        rssi: (uint8_t)((float)CRSF::LinkStatistics.uplink_Link_quality * 2.55),
+        remrssi: CRSF::LinkStatistics.uplink_RSSI_1,
+        noise: (uint8_t)CRSF::LinkStatistics.uplink_SNR,
+    };
+    flowControl.update(_outputPort, mavlinkInputBuffer.size(), link, millis());
 
     auto size = mavlinkOutputBuffer.size();
     if (size == 0)
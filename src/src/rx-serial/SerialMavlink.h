@@ -1,6 +1,7 @@
 #include "SerialIO.h"
 #include "FIFO.h"
 #include "telemetry_protocol.h"
+#include "MAVLinkFlowControl.h"
 
 #define MAV_INPUT_BUF_LEN   1024
 #define MAV_OUTPUT_BUF_LEN  512
@@ -9,6 +10,11 @@
 extern FIFO<MAV_INPUT_BUF_LEN> mavlinkInputBuffer;
 extern FIFO<MAV_OUTPUT_BUF_LEN> mavlinkOutputBuffer;
 
+#if defined(MAVLINK_TLM_COMPRESSION)
+// Fill a compressed downlink chunk with whole tokens from mavlinkInputBuffer, returns the number of bytes used
+uint8_t mavlinkPackCompressedChunk(uint8_t *data, uint8_t maxLen);
+#endif
+
 class SerialMavlink : public SerialIO {
 public:
     explicit SerialMavlink(Stream &out, Stream &in);
@@ -23,6 +29,7 @@ public:
 
 private:
     void processBytes(uint8_t *bytes, u_int16_t size) override;
+    void updateLinkRate();
 
     const uint8_t this_system_id;
     const uint8_t this_component_id;
@@ -30,5 +37,7 @@ private:
     const uint8_t target_system_id;
     const uint8_t target_component_id;
 
-    uint32_t lastSentFlowCtrl = 0;
+    MAVLinkFlowControl flowControl;
+    uint32_t flowControlInterval = 0;
+    uint8_t flowControlTlmDenom = 0;
 };
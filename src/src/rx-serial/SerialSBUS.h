@@ -1,8 +1,9 @@
 #include "SerialIO.h"
+#include "ChannelEncoder.h"
 
 class SerialSBUS : public SerialIO {
 public:
-    explicit SerialSBUS(Stream &out, Stream &in) : SerialIO(&out, &in)
+    explicit SerialSBUS(Stream &out, Stream &in) : SerialIO(&out, &in), encoder(rcEncoderSBUS)
     {
         streamOut = &out;
     }
@@ -17,4 +18,5 @@ private:
     void processBytes(uint8_t *bytes, uint16_t size) override {};
 
     Stream *streamOut;
+    RCFrameEncoder encoder;
 };
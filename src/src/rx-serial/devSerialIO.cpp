@@ -7,6 +7,8 @@
 #include "SerialIO.h"
 #include "CRSF.h"
 #include "config.h"
+#include "options.h"
+#include "devSerialIO.h"
 
 #define NO_SERIALIO_INTERVAL 1000
 
@@ -22,69 +24,55 @@ enum teamraceOutputInhibitState_e {
     troiEnableAwaitConfirm,     // Have received one packet with this model selected, awaiting confirm to Pass
 };
 
-typedef struct devserial_ctx_s {
-  SerialIO **io;
-  bool frameAvailable;          
-  bool frameMissed ;
-  connectionState_e lastConnectionState;
-  uint8_t lastTeamracePosition;
-  teamraceOutputInhibitState_e teamraceOutputInhibitState;
-} devserial_ctx_t;
+SerialRouter<SerialIO, SERIAL_ROUTER_MAX_PORTS> serialRouter;
 
-static devserial_ctx_t serial0;
-#if defined(PLATFORM_ESP32)
-static devserial_ctx_t serial1;
-#endif
+static connectionState_e lastConnectionState[SERIAL_ROUTER_MAX_PORTS];
+static uint32_t lineRate[SERIAL_ROUTER_MAX_PORTS];
+// The frame filter runs once per RC frame for all ports, so there is a single teamrace state
+static uint8_t lastTeamracePosition;
+static teamraceOutputInhibitState_e teamraceOutputInhibitState;
 
 void ICACHE_RAM_ATTR crsfRCFrameAvailable()
 {
-    serial0.frameAvailable = true;
-#if defined(PLATFORM_ESP32)
-    serial1.frameAvailable = true;
-#endif
+    serialRouter.rcFrameAvailable();
 }
 
 void ICACHE_RAM_ATTR crsfRCFrameMissed()
 {
-    serial0.frameMissed = true;
-#if defined(PLATFORM_ESP32)
-    serial1.frameMissed = true;
-#endif
+    serialRouter.rcFrameMissed();
 }
 
-static int start()
-{
-    serial0.io = &serialIO;
 #if defined(PLATFORM_ESP32)
-    serial1.io = &serial1IO;
-#endif
-
-    return DURATION_IMMEDIATELY;
-}
+// Timed RC output: frames are staged by the protocols in the main loop and written out
+// by a task woken from the hwTimer, so the FC sees them at a constant phase to the RF
+// packets whatever else the main loop is doing.
+static RCOutputStage rcOutputStage[SERIAL_ROUTER_MAX_PORTS];
+static TaskHandle_t rcOutputTask = nullptr;
 
-static int event(devserial_ctx_t *ctx)
+static void rcOutputTaskLoop(void *)
 {
-    ctx->lastConnectionState = disconnected;
-
-    if ((*(ctx->io)) != nullptr)
+    for (;;)
     {
-        (*(ctx->io))->setFailsafe(connectionState == disconnected && ctx->lastConnectionState == connected);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (auto &stage : rcOutputStage)
+        {
+            stage.writeOut();
+        }
     }
-
-    ctx->lastConnectionState = connectionState;
-
-    return DURATION_IGNORE;
-}
-
-static int event0()
-{
-    return event(&serial0);
 }
 
-#if defined(PLATFORM_ESP32)
-static int event1()
+void ICACHE_RAM_ATTR serialRCOutputTick()
 {
-    return event(&serial1);
+    if (rcOutputTask == nullptr)
+    {
+        return;
+    }
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(rcOutputTask, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
 }
 #endif
 
@@ -117,16 +105,11 @@ static uint8_t teamraceChannelToConfigValue()
 }
 
 /***
- * @brief: Determine if FrameAvailable and it should be sent to FC
- * @return: TRUE if a new frame is available and should be processed
+ * @brief: Determine if a new frame should be sent to the FC, called by the router once per frame for all ports
+ * @return: TRUE if the frame should be processed
 */
-static bool confirmFrameAvailable(devserial_ctx_t *ctx)
+static bool confirmFrameAvailable()
 {
-    if (!ctx->frameAvailable)
-        return false;
-
-    ctx->frameAvailable = false;
-
     // ModelMatch failure always prevents passing the frame on
     if (!connectionHasModelMatch)
         return false;
@@ -134,64 +117,170 @@ static bool confirmFrameAvailable(devserial_ctx_t *ctx)
     constexpr uint8_t CONFIG_TEAMRACE_POS_OFF = 0;
     if (config.GetTeamracePosition() == CONFIG_TEAMRACE_POS_OFF)
     {
-        ctx->teamraceOutputInhibitState = troiPass;
+        teamraceOutputInhibitState = troiPass;
         return true;
     }
 
     // Pass the packet on if in troiPass (of course) or
     // troiDisableAwaitConfirm (keep sending channels until the teamracepos stabilizes)
-    bool retVal = ctx->teamraceOutputInhibitState < troiInhibit;
+    bool retVal = teamraceOutputInhibitState < troiInhibit;
 
     uint8_t newTeamracePosition = teamraceChannelToConfigValue();
 
-    switch (ctx->teamraceOutputInhibitState)
+    switch (teamraceOutputInhibitState)
     {
         case troiPass:
             // User appears to be switching away from this model, wait for confirm
             if (newTeamracePosition != config.GetTeamracePosition())
-                ctx->teamraceOutputInhibitState = troiDisableAwaitConfirm;
+                teamraceOutputInhibitState = troiDisableAwaitConfirm;
             break;
 
         case troiDisableAwaitConfirm:
             // Must receive the same new position twice in a row for state to change
-            if (ctx->lastTeamracePosition == newTeamracePosition)
+            if (lastTeamracePosition == newTeamracePosition)
             {
                 if (newTeamracePosition != config.GetTeamracePosition())
-                    ctx->teamraceOutputInhibitState = troiInhibit; // disable output
+                    teamraceOutputInhibitState = troiInhibit; // disable output
                 else
-                    ctx->teamraceOutputInhibitState = troiPass; // return to normal
+                    teamraceOutputInhibitState = troiPass; // return to normal
             }
             break;
 
         case troiInhibit:
             // User appears to be switching to this model, wait for confirm
             if (newTeamracePosition == config.GetTeamracePosition())
-                ctx->teamraceOutputInhibitState = troiEnableAwaitConfirm;
+                teamraceOutputInhibitState = troiEnableAwaitConfirm;
             break;
 
         case troiEnableAwaitConfirm:
             // Must receive the same new position twice in a row for state to change
-            if (ctx->lastTeamracePosition == newTeamracePosition)
+            if (lastTeamracePosition == newTeamracePosition)
             {
                 if (newTeamracePosition == config.GetTeamracePosition())
-                    ctx->teamraceOutputInhibitState = troiPass; // return to normal
+                    teamraceOutputInhibitState = troiPass; // return to normal
                 else
-                    ctx->teamraceOutputInhibitState = troiInhibit; // back to disabled
+                    teamraceOutputInhibitState = troiInhibit; // back to disabled
             }
             break;
     }
 
-    ctx->lastTeamracePosition = newTeamracePosition;
+    lastTeamracePosition = newTeamracePosition;
     // troiPass or troiDisablePending indicate the model is selected still,
     // however returning true if troiDisablePending means this RX could send
     // telemetry and we do not want that
-    teamraceHasModelMatch = ctx->teamraceOutputInhibitState == troiPass;
+    teamraceHasModelMatch = teamraceOutputInhibitState == troiPass;
     return retVal;
 }
 
-static int timeout(devserial_ctx_t *ctx)
+static bool isCRSFProtocol(uint8_t port)
 {
-    if (*(ctx->io) == nullptr)
+    if (port == SERIAL_ROUTER_PORT_SERIAL0)
+    {
+        return !firmwareOptions.is_airport &&
+            (config.GetSerialProtocol() == PROTOCOL_CRSF || config.GetSerialProtocol() == PROTOCOL_INVERTED_CRSF);
+    }
+#if defined(PLATFORM_ESP32)
+    return config.GetSerial1Protocol() == PROTOCOL_SERIAL1_CRSF || config.GetSerial1Protocol() == PROTOCOL_SERIAL1_INVERTED_CRSF;
+#else
+    return false;
+#endif
+}
+
+void serialSetLineRate(uint8_t port, uint32_t baud)
+{
+    // Counted as 8N1, ports with parity or two stop bits are allowed a little over their line rate
+    lineRate[port] = baud / 10;
+}
+
+void serialUpdateRoutes()
+{
+    // Every port takes RC. Link statistics only go to ports running CRSF, the other
+    // protocols have no frame for them. MSP for the FC stays on Serial0
+    uint8_t routes = SERIAL_ROUTE_RC;
+    if (isCRSFProtocol(SERIAL_ROUTER_PORT_SERIAL0))
+    {
+        routes |= SERIAL_ROUTE_LINKSTATS | SERIAL_ROUTE_MSP;
+    }
+    serialRouter.setRoutes(SERIAL_ROUTER_PORT_SERIAL0, routes);
+
+#if defined(PLATFORM_ESP32)
+    routes = SERIAL_ROUTE_RC;
+    if (isCRSFProtocol(SERIAL_ROUTER_PORT_SERIAL1))
+    {
+        routes |= SERIAL_ROUTE_LINKSTATS;
+    }
+    if (config.GetSerial1Protocol() == PROTOCOL_SERIAL1_TRAMP || config.GetSerial1Protocol() == PROTOCOL_SERIAL1_SMARTAUDIO)
+    {
+        routes |= SERIAL_ROUTE_VTX;
+    }
+    serialRouter.setRoutes(SERIAL_ROUTER_PORT_SERIAL1, routes);
+#endif
+
+    // Hold each port to what its UART can carry, so a slow port (HoTT, SmartAudio)
+    // is not handed more than it can send and the loop does not block in write()
+    for (uint8_t port = 0; port < serialRouter.getPortCount(); port++)
+    {
+        serialRouter.setBandwidthLimit(port, lineRate[port]);
+    }
+}
+
+const serialRouterStats_t *serialGetStats(uint8_t port)
+{
+    return port < serialRouter.getPortCount() ? &serialRouter.getStats(port) : nullptr;
+}
+
+void serialResetStats()
+{
+    serialRouter.resetStats();
+}
+
+static int start()
+{
+    // Both devices share start()
+    if (serialRouter.getPortCount() == 0)
+    {
+        serialRouter.setFrameFilter(confirmFrameAvailable);
+        serialRouter.attach(&serialIO, 0);
+#if defined(PLATFORM_ESP32)
+        serialRouter.attach(&serial1IO, 0);
+        // Above the loop on the same core, so a stage is never written out while a protocol is filling it
+        xTaskCreatePinnedToCore(rcOutputTaskLoop, "rcOutput", 2048, nullptr, configMAX_PRIORITIES - 1, &rcOutputTask, xPortGetCoreID());
+#endif
+    }
+    serialUpdateRoutes();
+
+    return DURATION_IMMEDIATELY;
+}
+
+static int event(uint8_t port)
+{
+    lastConnectionState[port] = disconnected;
+
+    if (serialRouter.getIO(port) != nullptr)
+    {
+        serialRouter.getIO(port)->setFailsafe(connectionState == disconnected && lastConnectionState[port] == connected);
+    }
+
+    lastConnectionState[port] = connectionState;
+
+    return DURATION_IGNORE;
+}
+
+static int event0()
+{
+    return event(SERIAL_ROUTER_PORT_SERIAL0);
+}
+
+#if defined(PLATFORM_ESP32)
+static int event1()
+{
+    return event(SERIAL_ROUTER_PORT_SERIAL1);
+}
+#endif
+
+static int timeout(uint8_t port)
+{
+    if (serialRouter.getIO(port) == nullptr)
     {
         return NO_SERIALIO_INTERVAL;
     }
@@ -215,32 +304,26 @@ static int timeout(devserial_ctx_t *ctx)
      * Commiting this anyway though to work out a better resolution
     */
 
-    noInterrupts();
-    bool missed = ctx->frameMissed;
-    ctx->frameMissed = false;
-    interrupts();
-
-    // Verify there is new ChannelData and they should be sent on
-    bool sendChannels = confirmFrameAvailable(ctx);
-
-    uint32_t duration = (*(ctx->io))->sendRCFrame(sendChannels, missed, ChannelData);
+#if defined(PLATFORM_ESP32)
+    // The hwTimer only ticks in step with the TX while connected, otherwise write the frames out directly
+    const bool timedOutput = config.GetSerialTimedOutput() && connectionState == connected;
+    serialRouter.getIO(port)->setRCOutputStage(timedOutput ? &rcOutputStage[port] : nullptr);
+#endif
 
+    // Verify there is new ChannelData and they should be sent on, then
     // still get telemetry and send link stats if theres no model match
-    (*(ctx->io))->processSerialInput();
-    (*(ctx->io))->sendQueuedData((*(ctx->io))->getMaxSerialWriteSize());
-    
-    return duration;
+    return serialRouter.service(port, ChannelData, millis());
 }
 
 static int timeout0()
 {
-  return timeout(&serial0);
+  return timeout(SERIAL_ROUTER_PORT_SERIAL0);
 }
 
 #if defined(PLATFORM_ESP32)
 static int timeout1()
 {
-  return timeout(&serial1);
+  return timeout(SERIAL_ROUTER_PORT_SERIAL1);
 }
 #endif
 
@@ -248,7 +331,9 @@ device_t Serial0_device = {
     .initialize = nullptr,
     .start = start,
     .event = event0,
-    .timeout = timeout0
+    .timeout = timeout0,
+    .eventMask = DEVICE_EVENT_CONNECTION_STATE,
+    .name = "Serial0",
 };
 
 #if defined(PLATFORM_ESP32)
@@ -256,7 +341,9 @@ device_t Serial1_device = {
     .initialize = nullptr,
     .start = start,
     .event = event1,
-    .timeout = timeout1
+    .timeout = timeout1,
+    .eventMask = DEVICE_EVENT_CONNECTION_STATE,
+    .name = "Serial1",
 };
 #endif
 
@@ -1,6 +1,18 @@
 #pragma once
 
 #include "device.h"
+#include "SerialRouter.h"
+
+#define SERIAL_ROUTER_PORT_SERIAL0 0
+#define SERIAL_ROUTER_PORT_SERIAL1 1
+#if defined(PLATFORM_ESP32)
+#define SERIAL_ROUTER_MAX_PORTS 2   // Serial and Serial1
+#else
+#define SERIAL_ROUTER_MAX_PORTS 1
+#endif
+
+class SerialIO;
+extern SerialRouter<SerialIO, SERIAL_ROUTER_MAX_PORTS> serialRouter;
 
 extern device_t Serial0_device;
 #if defined(PLATFORM_ESP32)
@@ -8,3 +20,16 @@ extern device_t Serial1_device;
 #endif
 extern void crsfRCFrameAvailable();
 extern void crsfRCFrameMissed();
+#if defined(PLATFORM_ESP32)
+// Called from the hwTimer to write out the staged RC frames when timed output is on
+extern void serialRCOutputTick();
+#else
+static inline void serialRCOutputTick() {}
+#endif
+// Record the baud rate a port was opened at, its output is limited to it on the next serialUpdateRoutes()
+extern void serialSetLineRate(uint8_t port, uint32_t baud);
+// Set which port takes which traffic, and its bandwidth limit, from the configured protocols
+extern void serialUpdateRoutes();
+// Per port statistics for /profile.json, nullptr past the last port
+extern const serialRouterStats_t *serialGetStats(uint8_t port);
+extern void serialResetStats();
@@ -14,6 +14,9 @@
 #include "options.h"
 #include "dynpower.h"
 #include "MeanAccumulator.h"
+#include "AntennaDiversity.h"
+#include "PacketCombiner.h"
+#include "TlmBoost.h"
 #include "freqTable.h"
 
 #include "rx-serial/SerialIO.h"
@@ -24,6 +27,11 @@
 #include "rx-serial/SerialAirPort.h"
 #include "rx-serial/SerialHoTT_TLM.h"
 #include "rx-serial/SerialMavlink.h"
+#include "rx-serial/SerialIBUS.h"
+#include "rx-serial/SerialFPort.h"
+#if defined(MAVLINK_TLM_COMPRESSION)
+#include "MAVLinkCodec.h"
+#endif
 #include "rx-serial/SerialTramp.h"
 #include "rx-serial/SerialSmartAudio.h"
 
@@ -70,8 +78,7 @@
 
 //// CONSTANTS ////
 #define SEND_LINK_STATS_TO_FC_INTERVAL 100
-#define DIVERSITY_ANTENNA_INTERVAL 5
-#define DIVERSITY_ANTENNA_RSSI_TRIGGER 5
+#define DIVERSITY_CHANNELS 80 // The most channels of any regulatory domain
 #define PACKET_TO_TOCK_SLACK 200 // Desired buffer time between Packet ISR and Tock ISR
 ///////////////////
 
@@ -135,6 +142,12 @@ CROSSFIRE2MSP crsf2msp;
 MSP2CROSSFIRE msp2crsf;
 #endif
 
+#if defined(MSP_RESPONSE_CACHE_TTL_MS)
+#include "mspcache.h"
+
+MSPResponseCache mspResponseCache(MSP_RESPONSE_CACHE_TTL_MS);
+#endif
+
 #if defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32)
 unsigned long rebootTime = 0;
 extern bool webserverPreventAutoStart;
@@ -197,6 +210,10 @@ LPF LPF_OffsetDx(4);
 LQCALC<100> LQCalc;
 LQCALC<100> LQCalcDVDA;
 uint8_t uplinkLQ;
+AntennaDiversity<DIVERSITY_CHANNELS> diversity;
+// The first radio's copy of a packet which failed this slot, to combine with the second's
+static WORD_ALIGNED_ATTR uint8_t combineBuffer[OTA8_PACKET_SIZE];
+static SX12XX_Radio_Number_t combineRadio = SX12XX_Radio_NONE;
 LPF LPF_UplinkRSSI0(5);  // track rssi per antenna
 LPF LPF_UplinkRSSI1(5);
 MeanAccumulator<int32_t, int8_t, -16> SnrMean;
@@ -216,6 +233,7 @@ bool doStartTimer = false;
 bool didFHSS = false;
 bool alreadyFHSS = false;
 bool alreadyTLMresp = false;
+static bool tlmStaged = false;
 
 //////////////////////////////////////////////////////////////
 
@@ -463,6 +481,12 @@ void ICACHE_RAM_ATTR LinkStatsToOta(OTA_LinkStats_s * const ls)
     ls->modelMatch = connectionHasModelMatch;
     ls->lq = CRSF::LinkStatistics.uplink_Link_quality;
     ls->mspConfirm = MspReceiver.GetCurrentConfirm() ? 1 : 0;
+    // Report the telemetry waiting to be sent so the TX can boost the ratio to clear it
+    uint32_t queued = TelemetrySender.GetBytesRemaining() + telemetry.QueuedMessageBytes();
+    queued += mavlinkInputBuffer.size();
+    if (firmwareOptions.is_airport)
+        queued += apInputBuffer.size();
+    ls->tlmQueued = TlmQueuedToOta(queued);
 #if defined(DEBUG_FREQ_CORRECTION)
     ls->SNR = FreqCorrection * 127 / FreqCorrectionMax;
 #else
@@ -477,18 +501,22 @@ void ICACHE_RAM_ATTR LinkStatsToOta(OTA_LinkStats_s * const ls)
 #endif
 }
 
-bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
+static bool ICACHE_RAM_ATTR TelemetryResponseDue()
 {
     uint8_t modresult = (OtaNonce + 1) % ExpressLRS_currTlmDenom;
 
-    if ((connectionState == disconnected) || (ExpressLRS_currTlmDenom == 1) || (alreadyTLMresp == true) || (modresult != 0) || !teamraceHasModelMatch)
-    {
-        return false; // don't bother sending tlm if disconnected or TLM is off
-    }
+    // don't bother sending tlm if disconnected or TLM is off
+    return !((connectionState == disconnected) || (ExpressLRS_currTlmDenom == 1) || (alreadyTLMresp == true) || (modresult != 0) || !teamraceHasModelMatch);
+}
 
+/**
+ * Build the telemetry response and load it into the radio with TXstage(), writing it
+ * into the FIFO of radioNumber now if not SX12XX_Radio_NONE
+ **/
+static void ICACHE_RAM_ATTR StageTelemetryResponse(SX12XX_Radio_Number_t radioNumber)
+{
     // ESP requires word aligned buffer
     WORD_ALIGNED_ATTR OTA_Packet_s otaPkt = {0};
-    alreadyTLMresp = true;
     otaPkt.std.type = PACKET_TYPE_TLM;
 
     bool noAirportDataQueued = firmwareOptions.is_airport && apOutputBuffer.size() == 0;
@@ -554,6 +582,23 @@ bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
 
     OtaGeneratePacketCrc(&otaPkt);
 
+    Radio.TXstage((uint8_t*)&otaPkt, ExpressLRS_currAirRate_Modparams->PayloadLength, radioNumber);
+}
+
+bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
+{
+    if (!TelemetryResponseDue())
+    {
+        return false;
+    }
+
+    alreadyTLMresp = true;
+    // Normally staged when the packet was received, unless it was missed
+    if (!tlmStaged || !Radio.IsTxStaged())
+    {
+        StageTelemetryResponse(SX12XX_Radio_NONE);
+    }
+
     SX12XX_Radio_Number_t transmittingRadio;
     if (config.GetForceTlmOff())
     {
@@ -577,7 +622,7 @@ bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
         transmittingRadio = Radio.LastPacketRSSI > Radio.LastPacketRSSI2 ? SX12XX_Radio_1 : SX12XX_Radio_2; // Pick the radio with best rf connection to the tx.
     }
 
-    Radio.TXnb((uint8_t*)&otaPkt, ExpressLRS_currAirRate_Modparams->PayloadLength, transmittingRadio);
+    Radio.TXnbStaged(transmittingRadio);
 
     if (transmittingRadio == SX12XX_Radio_NONE)
     {
@@ -680,6 +725,9 @@ void ICACHE_RAM_ATTR HWtimerCallbackTick() // this is 180 out of phase with the
     updatePhaseLock();
     OtaNonce++;
 
+    // Half a packet interval after the Tock the last packet's RC frame has been staged
+    serialRCOutputTick();
+
     // if (!alreadyTLMresp && !alreadyFHSS && !LQCalc.currentIsSet()) // packet timeout AND didn't DIDN'T just hop or send TLM
     // {
     //     Radio.RXnb(); // put the radio cleanly back into RX in case of garbage data
@@ -734,52 +782,22 @@ static void ICACHE_RAM_ATTR updateDiversity()
         {
             // 0 and 1 is use for gpio_antenna_select
             // 2 is diversity
-            static int32_t prevRSSI;        // saved rssi so that we can compare if switching made things better or worse
-            static int32_t antennaLQDropTrigger;
-            static int32_t antennaRSSIDropTrigger;
-            int32_t rssi = (antenna == 0) ? LPF_UplinkRSSI0.value() : LPF_UplinkRSSI1.value();
-            int32_t otherRSSI = (antenna == 0) ? LPF_UplinkRSSI1.value() : LPF_UplinkRSSI0.value();
-
-            //if rssi dropped by the amount of DIVERSITY_ANTENNA_RSSI_TRIGGER
-            if ((rssi < (prevRSSI - DIVERSITY_ANTENNA_RSSI_TRIGGER)) && antennaRSSIDropTrigger >= DIVERSITY_ANTENNA_INTERVAL)
-            {
-                switchAntenna();
-                antennaLQDropTrigger = 1;
-                antennaRSSIDropTrigger = 0;
-            }
-            else if (rssi > prevRSSI || antennaRSSIDropTrigger < DIVERSITY_ANTENNA_INTERVAL)
+            static bool wasReceiving;
+            if (wasReceiving)
             {
-                prevRSSI = rssi;
-                antennaRSSIDropTrigger++;
+                if (LQCalc.currentIsSet())
+                    diversity.received(Radio.LastPacketRSSI);
+                else
+                    diversity.missed();
             }
 
-            // if we didn't get a packet switch the antenna
-            if (!LQCalc.currentIsSet() && antennaLQDropTrigger == 0)
+            // Pick the antenna for the next packet's channel, which HandleFHSS() has already hopped to.
+            // No packet is received while telemetry is sent, so those slots are never probes.
+            wasReceiving = !TelemetryResponseDue();
+            uint8_t channel = FHSSsequence[FHSSgetCurrIndex()];
+            if (diversity.choose(channel, wasReceiving) != antenna)
             {
                 switchAntenna();
-                antennaLQDropTrigger = 1;
-                antennaRSSIDropTrigger = 0;
-            }
-            else if (antennaLQDropTrigger >= DIVERSITY_ANTENNA_INTERVAL)
-            {
-                // We switched antenna on the previous packet, so we now have relatively fresh rssi info for both antennas.
-                // We can compare the rssi values and see if we made things better or worse when we switched
-                if (rssi < otherRSSI)
-                {
-                    // things got worse when we switched, so change back.
-                    switchAntenna();
-                    antennaLQDropTrigger = 1;
-                    antennaRSSIDropTrigger = 0;
-                }
-                else
-                {
-                    // all good, we can stay on the current antenna. Clear the flag.
-                    antennaLQDropTrigger = 0;
-                }
-            }
-            else if (antennaLQDropTrigger > 0)
-            {
-                antennaLQDropTrigger ++;
             }
         }
         else
@@ -826,8 +844,11 @@ void ICACHE_RAM_ATTR HWtimerCallbackTock()
     didFHSS = false;
 
     Radio.isFirstRxIrq = true;
+    combineRadio = SX12XX_Radio_NONE;
     updateDiversity();
     tlmSent = HandleSendTelemetryResponse();
+    // Anything staged for this slot is sent or out of date now
+    tlmStaged = false;
 
     #if defined(DEBUG_RX_SCOREBOARD)
     static bool lastPacketWasTelemetry = false;
@@ -1183,6 +1204,50 @@ bool ICACHE_RAM_ATTR ProcessRFPacket(SX12xxDriverCommon::rx_status const status)
     return true;
 }
 
+static bool ICACHE_RAM_ATTR ValidateCombinedPacket(uint8_t *packet)
+{
+    return OtaValidatePacketCrc((OTA_Packet_s *)packet);
+}
+
+/**
+ * With two radios, keep the first copy of a packet which failed its CRC, and if the
+ * second radio's copy fails too try to recover the packet from the pair
+ **/
+static bool ICACHE_RAM_ATTR CombineFailedPacket(SX12xxDriverCommon::rx_status const status)
+{
+    if (GPIO_PIN_NSS_2 == UNDEF_PIN ||
+        (status != SX12xxDriverCommon::SX12XX_RX_OK && status != SX12xxDriverCommon::SX12XX_RX_CRC_FAIL))
+    {
+        return false;
+    }
+
+    uint8_t const len = OtaIsFullRes ? OTA8_PACKET_SIZE : OTA4_PACKET_SIZE;
+    SX12XX_Radio_Number_t const radio = Radio.GetProcessingPacketRadio();
+    if (combineRadio == SX12XX_Radio_NONE || combineRadio == radio)
+    {
+        memcpy(combineBuffer, Radio.RXdataBuffer, len);
+        combineRadio = radio;
+        return false;
+    }
+    combineRadio = SX12XX_Radio_NONE;
+
+    // Where they differ, the radio which has had the stronger signal lately is more likely right
+    bool const firstStronger = (radio == SX12XX_Radio_2) == (LPF_UplinkRSSI0.value() >= LPF_UplinkRSSI1.value());
+    WORD_ALIGNED_ATTR uint8_t combined[OTA8_PACKET_SIZE];
+    if (!PacketCombine(combined,
+        firstStronger ? combineBuffer : Radio.RXdataBuffer,
+        firstStronger ? Radio.RXdataBuffer : combineBuffer,
+        len, OtaIsFullRes ? PACKET_COMBINE_MAX_BITS_OTA8 : PACKET_COMBINE_MAX_BITS_OTA4,
+        ValidateCombinedPacket))
+    {
+        return false;
+    }
+
+    DBGVLN("Combined packet");
+    memcpy(Radio.RXdataBuffer, combined, len);
+    return ProcessRFPacket(SX12xxDriverCommon::SX12XX_RX_OK);
+}
+
 bool ICACHE_RAM_ATTR RXdoneISR(SX12xxDriverCommon::rx_status const status)
 {
     if (LQCalc.currentIsSet() && connectionState == connected)
@@ -1190,10 +1255,18 @@ bool ICACHE_RAM_ATTR RXdoneISR(SX12xxDriverCommon::rx_status const status)
         return false; // Already received a packet, do not run ProcessRFPacket() again.
     }
 
-    if (ProcessRFPacket(status))
+    if (ProcessRFPacket(status) || CombineFailedPacket(status))
     {
         didFHSS = HandleFHSS();
 
+        // Write the telemetry response into the FIFO now so the Tock only has to start the TX.
+        // It is built after ProcessRFPacket() so it carries this packet's telemetry and MSP acks.
+        if (!tlmStaged && TelemetryResponseDue())
+        {
+            StageTelemetryResponse(isDualRadio() ? SX12XX_Radio_All : SX12XX_Radio_1);
+            tlmStaged = true;
+        }
+
         if (doStartTimer)
         {
             doStartTimer = false;
@@ -1224,7 +1297,7 @@ void UpdateModelMatch(uint8_t model)
 
 void SendMSPFrameToFC(uint8_t *mspData)
 {
-    serialIO->queueMSPFrameTransmission(mspData);
+    serialRouter.queueMSP(mspData, SERIAL_ROUTE_MSP);
 }
 
 /**
@@ -1274,11 +1347,8 @@ void MspReceiveComplete()
                     }
                     devicesTriggerEvent();
                     break;
-#if defined(PLATFORM_ESP32)
-                } else if (config.GetSerial1Protocol() == PROTOCOL_SERIAL1_TRAMP || config.GetSerial1Protocol() == PROTOCOL_SERIAL1_SMARTAUDIO) {
-                    serial1IO->queueMSPFrameTransmission(MspData);
+                } else if (serialRouter.queueMSP(MspData, SERIAL_ROUTE_VTX)) {
                     break;
-#endif
                 }
             }
             // FALLTHROUGH
@@ -1297,7 +1367,12 @@ void MspReceiveComplete()
         if (connectionHasModelMatch && teamraceHasModelMatch &&
             (receivedHeader->dest_addr == CRSF_ADDRESS_BROADCAST || receivedHeader->dest_addr == CRSF_ADDRESS_FLIGHT_CONTROLLER))
         {
-            serialIO->queueMSPFrameTransmission(MspData);
+#if defined(MSP_RESPONSE_CACHE_TTL_MS)
+            // Answered from the cache, the response is queued from the main loop
+            if (mspResponseCache.handleRequest(MspData, millis()))
+                break;
+#endif
+            serialRouter.queueMSP(MspData, SERIAL_ROUTE_MSP);
         }
     }
 
@@ -1312,6 +1387,8 @@ static void setupSerial()
 
 #if defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32)
     bool hottTlmSerial = false;
+    bool ibusSerial = false;
+    bool fportSerial = false;
 #endif
 
     if (OPT_CRSF_RCVR_NO_SERIAL)
@@ -1357,8 +1434,19 @@ static void setupSerial()
         hottTlmSerial = true;
         serialBaud = 19200;
     }
+    else if (config.GetSerialProtocol() == PROTOCOL_IBUS)
+    {
+        ibusSerial = true;
+        serialBaud = 115200;
+    }
+    else if (config.GetSerialProtocol() == PROTOCOL_FPORT)
+    {
+        fportSerial = true;
+        serialBaud = 115200;
+    }
 #endif
-    bool invert = config.GetSerialProtocol() == PROTOCOL_SBUS || config.GetSerialProtocol() == PROTOCOL_INVERTED_CRSF || config.GetSerialProtocol() == PROTOCOL_DJI_RS_PRO;
+    bool invert = config.GetSerialProtocol() == PROTOCOL_SBUS || config.GetSerialProtocol() == PROTOCOL_INVERTED_CRSF || config.GetSerialProtocol() == PROTOCOL_DJI_RS_PRO
+        || config.GetSerialProtocol() == PROTOCOL_FPORT;
 
 #ifdef PLATFORM_STM32
 #if defined(TARGET_R9SLIMPLUS_RX)
@@ -1470,11 +1558,20 @@ static void setupSerial()
     {
         serialIO = new SerialHoTT_TLM(SERIAL_PROTOCOL_TX, SERIAL_PROTOCOL_RX);
     }
+    else if (ibusSerial)
+    {
+        serialIO = new SerialIBUS(SERIAL_PROTOCOL_TX, SERIAL_PROTOCOL_RX);
+    }
+    else if (fportSerial)
+    {
+        serialIO = new SerialFPort(SERIAL_PROTOCOL_TX, SERIAL_PROTOCOL_RX);
+    }
     #endif
     else
     {
         serialIO = new SerialCRSF(SERIAL_PROTOCOL_TX, SERIAL_PROTOCOL_RX);
     }
+    serialSetLineRate(SERIAL_ROUTER_PORT_SERIAL0, serialBaud);
 
 #if defined(DEBUG_ENABLED)
 #if defined(PLATFORM_ESP32_S3) || defined(PLATFORM_ESP32_C3)
@@ -1563,13 +1660,23 @@ static void setupSerial1()
             Serial1.begin(4800, SERIAL_8N2, UNDEF_PIN, serial1TXpin, false);
             serial1IO = new SerialSmartAudio(SERIAL1_PROTOCOL_TX, SERIAL1_PROTOCOL_RX, serial1TXpin);
             break;
+        case PROTOCOL_SERIAL1_IBUS:
+            Serial1.begin(115200, SERIAL_8N1, serial1RXpin, serial1TXpin, false);
+            serial1IO = new SerialIBUS(SERIAL1_PROTOCOL_TX, SERIAL1_PROTOCOL_RX, serial1TXpin);
+            break;
+        case PROTOCOL_SERIAL1_FPORT:
+            Serial1.begin(115200, SERIAL_8N1, serial1RXpin, serial1TXpin, true);
+            serial1IO = new SerialFPort(SERIAL1_PROTOCOL_TX, SERIAL1_PROTOCOL_RX, serial1TXpin);
+            break;
     }
+    serialSetLineRate(SERIAL_ROUTER_PORT_SERIAL1, serial1IO != nullptr ? Serial1.baudRate() : 0);
 }
 
 void reconfigureSerial1()
 {
     serial1Shutdown();
     setupSerial1();
+    serialUpdateRoutes();
 }
 #else
     void setupSerial1() {};
@@ -1601,6 +1708,7 @@ void reconfigureSerial()
 {
     serialShutdown();
     setupSerial();
+    serialUpdateRoutes();
 }
 
 static void setupConfigAndPocCheck()
@@ -1898,7 +2006,7 @@ static void checkSendLinkStatsToFc(uint32_t now)
         if ((connectionState != disconnected && connectionHasModelMatch && teamraceHasModelMatch) ||
             SendLinkStatstoFCForcedSends)
         {
-            serialIO->queueLinkStatisticsPacket();
+            serialRouter.queueLinkStatistics();
             SendLinkStatstoFCintervalLastSent = now;
             if (SendLinkStatstoFCForcedSends)
                 --SendLinkStatstoFCForcedSends;
@@ -2207,6 +2315,16 @@ void loop()
         DBGLN("Timer locked");
     }
 
+#if defined(MSP_RESPONSE_CACHE_TTL_MS)
+    // One cached chunk per telemetry cycle so the MSP slots in telemetry are never overrun
+    uint8_t *cachedChunk;
+    if (!TelemetrySender.IsActive() && mspResponseCache.getReplayChunk(&cachedChunk))
+    {
+        telemetry.AppendTelemetryPackage(cachedChunk);
+        mspResponseCache.endReplayChunk();
+    }
+#endif
+
     uint8_t *nextPayload = 0;
     uint8_t nextPlayloadSize = 0;
     if (!TelemetrySender.IsActive() && telemetry.GetNextPayload(&nextPlayloadSize, &nextPayload))
@@ -2215,6 +2333,18 @@ void loop()
     }
 
     uint16_t count = mavlinkInputBuffer.size();
+#if defined(MAVLINK_TLM_COMPRESSION)
+    // Whole tokens per chunk so the TX can decode every chunk on its own, held back periodic messages
+    // are added here too so there may be something to send even when the buffer is empty
+    if (!TelemetrySender.IsActive() && (count = mavlinkPackCompressedChunk(mavlinkSSBuffer + CRSF_FRAME_NOT_COUNTED_BYTES, CRSF_PAYLOAD_SIZE_MAX)) > 0)
+    {
+        mavlinkSSBuffer[0] = MAVLINK_COMPRESSED_TLM_MARKER;
+        mavlinkSSBuffer[1] = count;
+        nextPayload = mavlinkSSBuffer;
+        nextPlayloadSize = count + CRSF_FRAME_NOT_COUNTED_BYTES;
+        TelemetrySender.SetDataToTransmit(nextPayload, nextPlayloadSize);
+    }
+#else
     if (count > 0 && !TelemetrySender.IsActive())
     {
         count = std::min(count, (uint16_t)CRSF_PAYLOAD_SIZE_MAX); // Constrain to CRSF max payload size to match SS
@@ -2227,6 +2357,7 @@ void loop()
         nextPlayloadSize = count + CRSF_FRAME_NOT_COUNTED_BYTES;
         TelemetrySender.SetDataToTransmit(nextPayload, nextPlayloadSize);
     }
+#endif
 
     updateTelemetryBurst();
     updateBindingMode();
@@ -2,26 +2,13 @@
 #include "common.h"
 #include "config.h"
 #include "logging.h"
-
-#include <functional>
+#include "deferred.h"
 
 #if defined(USE_I2C)
 #include <Wire.h>
 #endif
 
-static const int maxDeferredFunctions = 3;
-
-struct deferred_t {
-    unsigned long started;
-    unsigned long timeout;
-    std::function<void()> function;
-};
-
-static deferred_t deferred[maxDeferredFunctions] = {
-    {0, 0, nullptr},
-    {0, 0, nullptr},
-    {0, 0, nullptr},
-};
+static DeferredQueue<8> deferred;
 
 boolean i2c_enabled = false;
 
@@ -79,32 +66,27 @@ void setupTargetCommon()
     setupWire();
 }
 
-void deferExecutionMicros(unsigned long us, std::function<void()> f)
+ICACHE_RAM_ATTR void deferExecutionMicros(unsigned long us, deferredFunction_t f, void *context)
 {
-    for (int i=0 ; i<maxDeferredFunctions ; i++)
+    if (!deferred.add(micros(), us, f, context))
     {
-        if (deferred[i].function == nullptr)
-        {
-            deferred[i].started = micros();
-            deferred[i].timeout = us;
-            deferred[i].function = f;
-            return;
-        }
+        // Bail out, there are no slots available!
+        DBGLN("No more deferred function slots available!");
     }
+}
+
+static void callPlainFunction(void *context)
+{
+    ((void (*)())context)();
+}
 
-    // Bail out, there are no slots available!
-    DBGLN("No more deferred function slots available!");
+ICACHE_RAM_ATTR void deferExecutionMicros(unsigned long us, void (*f)())
+{
+    // A function without a context is called through a wrapper with the function as the context
+    deferExecutionMicros(us, callPlainFunction, (void *)f);
 }
 
 void executeDeferredFunction(unsigned long now)
 {
-    // execute deferred function if its time has elapsed
-    for (int i=0 ; i<maxDeferredFunctions ; i++)
-    {
-        if (deferred[i].function != nullptr && (now - deferred[i].started) > deferred[i].timeout)
-        {
-            deferred[i].function();
-            deferred[i].function = nullptr;
-        }
-    }
+    deferred.run(now);
 }
@@ -8,6 +8,7 @@
 #include "telemetry_protocol.h"
 #include "stubborn_receiver.h"
 #include "stubborn_sender.h"
+#include "TlmBoost.h"
 
 #include "devHandset.h"
 #include "devLED.h"
@@ -24,6 +25,8 @@
 #include "devBackpack.h"
 
 #include "MAVLink.h"
+#include "MAVLinkCodec.h"
+#include "SPSCQueue.h"
 
 #if defined(PLATFORM_ESP32_S3)
 #include "USB.h"
@@ -48,6 +51,7 @@ FIFO<AP_MAX_BUF_LEN> apOutputBuffer;
 FIFO<UART_INPUT_BUF_LEN> uartInputBuffer;
 
 uint8_t mavlinkSSBuffer[CRSF_MAX_PACKET_LEN]; // Buffer for current stubbon sender packet (mavlink only)
+static MAVLinkDecoder mavlinkDecoder(mavlinkLookupMsg); // For compressed mavlink telemetry from the RX
 
 #if defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32)
 unsigned long rebootTime = 0;
@@ -63,6 +67,8 @@ char backpackVersion[32] = "";
 #define syncSpamAmountAfterRateChange 10
 volatile uint8_t syncSpamCounter = 0;
 volatile uint8_t syncSpamCounterAfterRateChange = 0;
+// Telemetry ratio wanted to clear the RX's telemetry queue, TLM_RATIO_NO_TLM for none
+volatile expresslrs_tlm_ratio_e tlmBoostRatio = TLM_RATIO_NO_TLM;
 uint32_t rfModeLastChangedMS = 0;
 uint32_t SyncPacketLastSent = 0;
 ////////////////////////////////////////////////
@@ -91,8 +97,24 @@ StubbornReceiver TelemetryReceiver;
 StubbornSender MspSender;
 uint8_t CRSFinBuffer[CRSF_MAX_PACKET_LEN+1];
 
+// Telemetry from the RX and the link statistics, passed from the loop to the telemetry device
+// which may be on the other core. All the telemetry written to the backpack goes out from there.
+typedef struct {
+  uint8_t data[CRSF_MAX_PACKET_LEN+1];
+} tlmFrame_t;
+static SPSCQueue<tlmFrame_t, 4> telemetryInQueue;
+// MSP from the backpack, passed from the telemetry device to the loop which owns the radio and config
+static SPSCQueue<mspPacket_t, 2> backpackMspQueue;
+
+extern device_t Telemetry_device;
+// Set by the telemetry device when MAVLink is seen on the USB or backpack port, acted on by the loop
+static volatile bool mavlinkDetected = false;
+
+// The loop core is kept for the RF timing, OTA packing, handset input and LUA, which changes
+// the link state directly, everything else goes to the alternate core on dual core SoCs
 device_affinity_t ui_devices[] = {
   {&Handset_device, 1},
+  {&Telemetry_device, 0},
 #ifdef HAS_LED
   {&LED_device, 0},
 #endif
@@ -179,6 +201,14 @@ void ICACHE_RAM_ATTR LinkStatsFromOta(OTA_LinkStats_s * const ls)
 #endif
   CRSF::LinkStatistics.active_antenna = ls->antenna;
   connectionHasModelMatch = ls->modelMatch;
+  // Boost the TLM ratio while the RX has telemetry queued, sending a sync to switch to it now
+  expresslrs_tlm_ratio_e boost = TlmBoostRatio(1000000 / ExpressLRS_currAirRate_Modparams->interval,
+    OtaIsFullRes ? ELRS8_TELEMETRY_BYTES_PER_CALL : ELRS4_TELEMETRY_BYTES_PER_CALL, ls->tlmQueued);
+  if (boost != tlmBoostRatio)
+  {
+    tlmBoostRatio = boost;
+    syncSpamCounter = 1;
+  }
   // -- downlink_SNR / downlink_RSSI is updated for any packet received, not just Linkstats
   // -- uplink_TX_Power is updated when sending to the handset, so it updates when missing telemetry
   // -- rf_mode is updated when we change rates
@@ -293,6 +323,12 @@ expresslrs_tlm_ratio_e ICACHE_RAM_ATTR UpdateTlmRatioEffective()
     retVal = ratioConfigured;
   }
 
+  // Raise the ratio while the RX has a telemetry queue, unless telemetry is off
+  if (retVal != TLM_RATIO_NO_TLM && tlmBoostRatio > retVal)
+  {
+    retVal = tlmBoostRatio;
+  }
+
   if (updateTelemDenom)
   {
     uint8_t newTlmDenom = TLMratioEnumToValue(retVal);
@@ -410,6 +446,7 @@ void SetRFLinkRate(uint8_t index) // Set speed of RF link
 
   handset->setPacketInterval(interval * ExpressLRS_currAirRate_Modparams->numOfSends);
   connectionState = disconnected;
+  tlmBoostRatio = TLM_RATIO_NO_TLM;
   rfModeLastChangedMS = millis();
 }
 
@@ -440,6 +477,12 @@ void ICACHE_RAM_ATTR HandleFHSS()
     {
       Radio.SetFrequencyReg(FHSSgetNextFreq());
     }
+
+    // Both radios share the output power, the calibration follows Radio 1
+    if (!FHSSuseDualBand)
+    {
+      POWERMGNT::setChannel(FHSSsequence[FHSSgetCurrIndex()]);
+    }
   }
 }
 
@@ -912,6 +955,7 @@ static void UpdateConnectDisconnectStatus()
   {
     connectionState = disconnected;
     connectionHasModelMatch = true;
+    tlmBoostRatio = TLM_RATIO_NO_TLM;
     CRSFHandset::ForwardDevicePings = false;
   }
 }
@@ -948,30 +992,48 @@ static void CheckReadyToSend()
 void OnPowerGetCalibration(mspPacket_t *packet)
 {
   uint8_t index = packet->readByte();
-  UNUSED(index);
-  int8_t values[PWR_COUNT] = {0};
-  POWERMGNT::GetPowerCaliValues(values, PWR_COUNT);
-  DBGLN("power get calibration value %d",  values[index]);
+  uint8_t band = packet->readByte();
+  if (packet->readError)
+  {
+    band = 0;
+  }
+  if ((index >= PWR_COUNT) || (band >= POWER_CALI_BANDS))
+  {
+    DBGLN("calibration error index %d band %d out of range", index, band);
+    return;
+  }
+  int8_t values[PWR_COUNT][POWER_CALI_BANDS] = {{0}};
+  POWERMGNT::GetPowerCaliValues(&values[0][0], sizeof(values));
+  DBGLN("power get calibration value %d",  values[index][band]);
 }
 
 void OnPowerSetCalibration(mspPacket_t *packet)
 {
   uint8_t index = packet->readByte();
   int8_t value = packet->readByte();
+  // The band is optional, without it the value is for the whole band as before
+  uint8_t band = packet->readByte();
+  bool allBands = packet->readError;
 
-  if((index < 0) || (index > PWR_COUNT))
+  if ((index >= PWR_COUNT) || (!allBands && band >= POWER_CALI_BANDS))
   {
-    DBGLN("calibration error index %d out of range", index);
+    DBGLN("calibration error index %d band %d out of range", index, band);
     return;
   }
   hwTimer::stop();
   delay(20);
 
-  int8_t values[PWR_COUNT] = {0};
-  POWERMGNT::GetPowerCaliValues(values, PWR_COUNT);
-  values[index] = value;
-  POWERMGNT::SetPowerCaliValues(values, PWR_COUNT);
-  DBGLN("power calibration done %d, %d", index, value);
+  int8_t values[PWR_COUNT][POWER_CALI_BANDS] = {{0}};
+  POWERMGNT::GetPowerCaliValues(&values[0][0], sizeof(values));
+  for (uint8_t i = 0; i < POWER_CALI_BANDS; i++)
+  {
+    if (allBands || i == band)
+    {
+      values[index][i] = value;
+    }
+  }
+  POWERMGNT::SetPowerCaliValues(&values[0][0], sizeof(values));
+  DBGLN("power calibration done %d, %d, %d", index, band, value);
   hwTimer::resume();
 }
 #endif
@@ -1149,8 +1211,7 @@ static void HandleUARTin()
         {
           if (isThisAMavPacket(buf, size))
           {
-            config.SetLinkMode(TX_MAVLINK_MODE);
-            UARTconnected();
+            mavlinkDetected = true;
           }
         }
       }
@@ -1175,19 +1236,91 @@ static void HandleUARTin()
         // Start the hwTimer since the user might be operating the module as a standalone unit without a handset.
         if (connectionState == noCrossfire)
         {
-          UARTconnected();
+          mavlinkDetected = true;
         }
       }
     }
-    else if (msp.processReceivedByte(TxBackpack->read()))
+    else
     {
-      // Finished processing a complete packet
-      ProcessMSPPacket(millis(), msp.getReceivedPacket());
-      msp.markPacketReceived();
+      // Complete packets are acted on by the loop, while it's behind the bytes wait in the UART
+      mspPacket_t *packet = backpackMspQueue.reserve();
+      if (packet && msp.processReceivedByte(TxBackpack->read()))
+      {
+        *packet = *msp.getReceivedPacket();
+        backpackMspQueue.commit();
+        msp.markPacketReceived();
+      }
     }
   }
 }
 
+static void ProcessTelemetryFrame(uint8_t *frame)
+{
+  if (frame[0] == CRSF_ADDRESS_USB)
+  {
+    if (config.GetLinkMode() == TX_MAVLINK_MODE)
+    {
+      // raw mavlink data - forward to USB rather than handset
+      uint8_t count = frame[1];
+      // Convert to CRSF telemetry where we can
+      convert_mavlink_to_crsf_telem(frame + CRSF_FRAME_NOT_COUNTED_BYTES, count, handset);
+      TxUSB->write(frame + CRSF_FRAME_NOT_COUNTED_BYTES, count);
+      // If we have a backpack
+      if (TxUSB != TxBackpack)
+      {
+        TxBackpack->write(frame + CRSF_FRAME_NOT_COUNTED_BYTES, count);
+      }
+    }
+  }
+  else if (frame[0] == MAVLINK_COMPRESSED_TLM_MARKER)
+  {
+    if (config.GetLinkMode() == TX_MAVLINK_MODE)
+    {
+      // compressed mavlink data - rebuild the frames and forward them the same way
+      uint8_t mavFrame[MAVLINK_CODEC_MAX_FRAME_LEN];
+      uint16_t len;
+      mavlinkDecoder.startChunk(frame + CRSF_FRAME_NOT_COUNTED_BYTES, frame[1]);
+      while ((len = mavlinkDecoder.next(mavFrame)) != 0)
+      {
+        convert_mavlink_to_crsf_telem(mavFrame, len, handset);
+        TxUSB->write(mavFrame, len);
+        if (TxUSB != TxBackpack)
+        {
+          TxBackpack->write(mavFrame, len);
+        }
+      }
+    }
+  }
+  else
+  {
+    // Send all other tlm to handset
+    handset->sendTelemetryToTX(frame);
+    crsfTelemToMSPOut(frame);
+  }
+}
+
+static int timeoutTelemetry()
+{
+  HandleUARTout(); // Only used for non-CRSF output
+  HandleUARTin();
+
+  tlmFrame_t *frame;
+  while ((frame = telemetryInQueue.peek()) != nullptr)
+  {
+    ProcessTelemetryFrame(frame->data);
+    telemetryInQueue.release();
+  }
+  return 1;
+}
+
+device_t Telemetry_device = {
+  .initialize = nullptr,
+  .start = nullptr,
+  .event = nullptr,
+  .timeout = timeoutTelemetry,
+  .name = "Telemetry",
+};
+
 static void setupSerial()
 {  /*
    * Setup the logging/backpack serial port, and the USB serial port.
@@ -1468,8 +1601,6 @@ void loop()
 {
   uint32_t now = millis();
 
-  HandleUARTout(); // Only used for non-CRSF output
-
   #if defined(USE_BLE_JOYSTICK)
   if (connectionState != bleJoystick && connectionState != noCrossfire) // Wait until the correct crsf baud has been found
   {
@@ -1497,7 +1628,23 @@ void loop()
 
   executeDeferredFunction(micros());
 
-  HandleUARTin();
+  mspPacket_t *mspPacket;
+  while ((mspPacket = backpackMspQueue.peek()) != nullptr)
+  {
+    ProcessMSPPacket(now, mspPacket);
+    backpackMspQueue.release();
+  }
+
+  // The connection state belongs to this core, so the switch to MAVLink is made here
+  if (mavlinkDetected)
+  {
+    mavlinkDetected = false;
+    if (connectionState == noCrossfire)
+    {
+      config.SetLinkMode(TX_MAVLINK_MODE);
+      UARTconnected();
+    }
+  }
 
   if (connectionState > MODE_STATES)
   {
@@ -1514,39 +1661,28 @@ void loop()
   if ((connectionState == connected) && (LastTLMpacketRecvMillis != 0) &&
       (now >= (uint32_t)(firmwareOptions.tlm_report_interval + TLMpacketReported)))
   {
-    uint8_t linkStatisticsFrame[CRSF_FRAME_NOT_COUNTED_BYTES + CRSF_FRAME_SIZE(sizeof(crsfLinkStatistics_t))];
-
-    CRSFHandset::makeLinkStatisticsPacket(linkStatisticsFrame);
-    handset->sendTelemetryToTX(linkStatisticsFrame);
-    crsfTelemToMSPOut(linkStatisticsFrame);
-    TLMpacketReported = now;
+    // Sent with the rest of the telemetry so the backpack has one writer, tried again next
+    // loop if the queue is full
+    tlmFrame_t *frame = telemetryInQueue.reserve();
+    if (frame)
+    {
+      CRSFHandset::makeLinkStatisticsPacket(frame->data);
+      telemetryInQueue.commit();
+      TLMpacketReported = now;
+    }
   }
 
   if (TelemetryReceiver.HasFinishedData())
   {
-      if (CRSFinBuffer[0] == CRSF_ADDRESS_USB)
-      {
-        if (config.GetLinkMode() == TX_MAVLINK_MODE)
-        {
-          // raw mavlink data - forward to USB rather than handset
-          uint8_t count = CRSFinBuffer[1];
-          // Convert to CRSF telemetry where we can
-          convert_mavlink_to_crsf_telem(CRSFinBuffer, count, handset);
-          TxUSB->write(CRSFinBuffer + CRSF_FRAME_NOT_COUNTED_BYTES, count);
-          // If we have a backpack
-          if (TxUSB != TxBackpack)
-          {
-            TxBackpack->write(CRSFinBuffer + CRSF_FRAME_NOT_COUNTED_BYTES, count);
-          }
-        }
-      }
-      else
-      {
-        // Send all other tlm to handset
-        handset->sendTelemetryToTX(CRSFinBuffer);
-        crsfTelemToMSPOut(CRSFinBuffer);
-      }
+    // Hand the frame over so the receiver can take the next one straight away,
+    // it stays locked while the telemetry device is behind and the queue is full
+    tlmFrame_t *frame = telemetryInQueue.reserve();
+    if (frame)
+    {
+      memcpy(frame->data, CRSFinBuffer, sizeof(frame->data));
+      telemetryInQueue.commit();
       TelemetryReceiver.Unlock();
+    }
   }
 
   // only send msp data when binding is not active
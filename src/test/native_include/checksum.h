@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Stand-in for the mavlink library's checksum.h, which isn't a dependency of the native env.
+// Only what the code under test uses, matching the library's implementation.
+
+static inline void crc_accumulate(uint8_t data, uint16_t *crcAccum)
+{
+    uint8_t tmp = data ^ (uint8_t)(*crcAccum & 0xff);
+    tmp ^= (tmp << 4);
+    *crcAccum = (*crcAccum >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
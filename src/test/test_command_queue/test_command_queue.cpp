@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <SX12xxCommandQueue.h>
+#include <unity.h>
+#include <string>
+
+enum {
+    RADIO_1 = 0b01,
+    RADIO_2 = 0b10,
+    RADIO_ALL = 0b11,
+};
+
+typedef SX12xxCommandQueue<4> Queue;
+
+// Records the commands the queue writes, with a BUSY pin per radio the test controls
+class MockHal
+{
+public:
+    std::string log;
+    uint8_t busy;
+    Queue *reenter;
+
+    MockHal() : busy(0), reenter(nullptr) {}
+
+    bool IsBusy(SX12XX_Radio_Number_t radioNumber) { return (busy & radioNumber) != 0; }
+    void WritePosted(uint16_t opcode, uint8_t *data, uint8_t size, SX12XX_Radio_Number_t radioNumber, uint32_t busyDelay)
+    {
+        // Waits out BUSY like the HAL
+        busy &= ~radioNumber;
+        log += (char)('A' + opcode);
+        log += (char)('0' + radioNumber);
+        log += (char)('0' + size);
+        log += ' ';
+        // A BUSY interrupt arriving while this one writes
+        if (reenter)
+            reenter->service(*this, false);
+    }
+};
+
+static MockHal hal;
+static Queue queue;
+static uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static void reset()
+{
+    hal = MockHal();
+    queue.clear();
+}
+
+void test_posted_not_busy_writes_now(void)
+{
+    reset();
+    TEST_ASSERT_TRUE(queue.add(0, data, 2, RADIO_1, 15));
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("A12 ", hal.log.c_str());
+    TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+void test_posted_busy_waits_for_interrupt(void)
+{
+    reset();
+    hal.busy = RADIO_1;
+    queue.add(0, data, 2, RADIO_1, 15);
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("", hal.log.c_str());
+    TEST_ASSERT_EQUAL(1, queue.size());
+
+    // BUSY on the other radio doesn't matter, BUSY falling on this one writes it
+    hal.busy = RADIO_2;
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("A12 ", hal.log.c_str());
+
+    // Both radios must be ready for a command to both
+    hal.log.clear();
+    hal.busy = RADIO_2;
+    queue.add(1, data, 4, RADIO_ALL, 15);
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("", hal.log.c_str());
+    hal.busy = 0;
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("B34 ", hal.log.c_str());
+}
+
+void test_posted_written_in_order(void)
+{
+    reset();
+    hal.busy = RADIO_ALL;
+    queue.add(0, data, 1, RADIO_1, 15);
+    queue.add(1, data, 2, RADIO_2, 15);
+    queue.add(2, data, 3, RADIO_ALL, 15);
+    queue.service(hal, false);
+    TEST_ASSERT_EQUAL_STRING("", hal.log.c_str());
+
+    // Another transaction waits on BUSY to write them all first
+    queue.service(hal, true);
+    TEST_ASSERT_EQUAL_STRING("A11 B22 C33 ", hal.log.c_str());
+    TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+void test_posted_full(void)
+{
+    reset();
+    hal.busy = RADIO_1;
+    for (uint8_t i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(queue.add(i, data, 1, RADIO_1, 15));
+    TEST_ASSERT_FALSE(queue.add(4, data, 1, RADIO_1, 15));
+    TEST_ASSERT_FALSE(queue.add(0, data, Queue::MAX_SIZE + 1, RADIO_1, 15));
+    TEST_ASSERT_EQUAL(4, queue.size());
+
+    // Wraps around once some are written
+    queue.service(hal, true);
+    hal.log.clear();
+    hal.busy = RADIO_1;
+    queue.add(5, data, 1, RADIO_1, 15);
+    queue.add(6, data, 1, RADIO_1, 15);
+    queue.service(hal, true);
+    TEST_ASSERT_EQUAL_STRING("F11 G11 ", hal.log.c_str());
+}
+
+void test_posted_interrupt_while_writing(void)
+{
+    reset();
+    hal.busy = RADIO_1;
+    queue.add(0, data, 1, RADIO_1, 15);
+    queue.add(1, data, 1, RADIO_1, 15);
+
+    // The interrupt finds the queue already being written and leaves it, so each
+    // command is written once
+    hal.reenter = &queue;
+    queue.service(hal, true);
+    TEST_ASSERT_EQUAL_STRING("A11 B11 ", hal.log.c_str());
+    TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_posted_not_busy_writes_now);
+    RUN_TEST(test_posted_busy_waits_for_interrupt);
+    RUN_TEST(test_posted_written_in_order);
+    RUN_TEST(test_posted_full);
+    RUN_TEST(test_posted_interrupt_while_writing);
+    UNITY_END();
+
+    return 0;
+}
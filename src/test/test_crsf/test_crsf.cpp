@@ -23,7 +23,7 @@ void test_ver_to_u32(void)
         {{0x31, 0x2e, 0x32, 0x2e, 0x33, 0x2e, 0x34, 32,73,83,77,50,71,52,0}, 0x01020304}, // 1.2.3.4 ISM2G4
         {{0x31, 0x30, 0x30, 0x2e, 0x32, 0x35, 0x35, 32,0}, (OTA_VERSION_ID << 16)}, // 100.255(space)
         {"3.1.2",0x00030102},
-        {"3.x.x-maint",0x00030000},
+        {"3.x.x-maint",(OTA_VERSION_ID << 16)}, // major only, below 1.0.0
         {{0}, 0},
     };
 
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <DeferredQueue.h>
+#include <unity.h>
+
+static DeferredQueue<4> queue;
+static char calls[16];
+static uint8_t callCount;
+
+static void record(void *context)
+{
+    calls[callCount++] = (char)(uintptr_t)context;
+}
+
+static void reset()
+{
+    queue.clear();
+    callCount = 0;
+}
+
+void test_deferred_not_before_delay(void)
+{
+    reset();
+    TEST_ASSERT_TRUE(queue.add(1000, 500, record, (void *)'A'));
+
+    // Only runs once more than the delay has passed
+    queue.run(1000);
+    queue.run(1500);
+    TEST_ASSERT_EQUAL(0, callCount);
+    queue.run(1501);
+    TEST_ASSERT_EQUAL(1, callCount);
+    TEST_ASSERT_EQUAL('A', calls[0]);
+    TEST_ASSERT_EQUAL(0, queue.size());
+
+    // And only once
+    queue.run(5000);
+    TEST_ASSERT_EQUAL(1, callCount);
+}
+
+void test_deferred_multiple_pending(void)
+{
+    reset();
+    queue.add(0, 300, record, (void *)'C');
+    queue.add(0, 100, record, (void *)'A');
+    queue.add(0, 200, record, (void *)'B');
+    queue.add(0, 100, record, (void *)'a');
+    TEST_ASSERT_EQUAL(4, queue.size());
+
+    // Full, the new function is refused
+    TEST_ASSERT_FALSE(queue.add(0, 50, record, (void *)'X'));
+
+    // Earliest first, equal deadlines in the order they were added
+    queue.run(150);
+    TEST_ASSERT_EQUAL(2, callCount);
+    TEST_ASSERT_EQUAL('A', calls[0]);
+    TEST_ASSERT_EQUAL('a', calls[1]);
+
+    queue.run(1000);
+    TEST_ASSERT_EQUAL(4, callCount);
+    TEST_ASSERT_EQUAL('B', calls[2]);
+    TEST_ASSERT_EQUAL('C', calls[3]);
+}
+
+void test_deferred_wraparound(void)
+{
+    reset();
+    // micros() wraps every 71 minutes
+    queue.add(0xFFFFFF00, 0x200, record, (void *)'A');
+    queue.run(0xFFFFFFFF);
+    TEST_ASSERT_EQUAL(0, callCount);
+    queue.run(0x00000101);
+    TEST_ASSERT_EQUAL(1, callCount);
+}
+
+static uint32_t rescheduleNow;
+
+static void reschedule(void *context)
+{
+    record(context);
+    queue.add(rescheduleNow, 0, reschedule, context);
+}
+
+void test_deferred_added_while_running(void)
+{
+    reset();
+    // A function deferring itself with no delay runs once per run()
+    rescheduleNow = 10;
+    queue.add(0, 0, reschedule, (void *)'R');
+    queue.run(10);
+    TEST_ASSERT_EQUAL(1, callCount);
+    rescheduleNow = 11;
+    queue.run(11);
+    TEST_ASSERT_EQUAL(2, callCount);
+    TEST_ASSERT_EQUAL(1, queue.size());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_deferred_not_before_delay);
+    RUN_TEST(test_deferred_multiple_pending);
+    RUN_TEST(test_deferred_wraparound);
+    RUN_TEST(test_deferred_added_while_running);
+    UNITY_END();
+
+    return 0;
+}
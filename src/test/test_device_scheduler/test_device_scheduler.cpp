@@ -0,0 +1,289 @@
+#include <cstdint>
+#include <cstdlib>
+#include <TimerHeap.h>
+#include "common.h"
+#include "device.h"
+#include <unity.h>
+
+bool connectionHasModelMatch = true;
+bool teamraceHasModelMatch = true;
+connectionState_e connectionState = disconnected;
+
+void test_timer_heap_order(void)
+{
+    TimerHeap<16> heap;
+    const uint32_t deadlines[] = {50, 10, 40, 30, 20, 60};
+    for (uint8_t i = 0; i < 6; i++)
+        heap.set(i, deadlines[i]);
+
+    TEST_ASSERT_EQUAL(6, heap.size());
+    uint32_t last = 0;
+    while (!heap.empty())
+    {
+        const uint32_t deadline = heap.topDeadline();
+        TEST_ASSERT_GREATER_OR_EQUAL(last, deadline);
+        last = deadline;
+        heap.pop();
+    }
+    TEST_ASSERT_EQUAL(60, last);
+}
+
+void test_timer_heap_reschedule(void)
+{
+    TimerHeap<16> heap;
+    heap.set(0, 10);
+    heap.set(1, 20);
+    heap.set(2, 30);
+
+    // Moving an id updates it in place rather than adding it again
+    heap.set(2, 5);
+    TEST_ASSERT_EQUAL(3, heap.size());
+    TEST_ASSERT_EQUAL(2, heap.top());
+
+    heap.set(2, 100);
+    TEST_ASSERT_EQUAL(0, heap.top());
+    TEST_ASSERT_EQUAL(0, heap.pop());
+    TEST_ASSERT_EQUAL(1, heap.pop());
+    TEST_ASSERT_EQUAL(2, heap.pop());
+    TEST_ASSERT_TRUE(heap.empty());
+}
+
+void test_timer_heap_remove(void)
+{
+    TimerHeap<16> heap;
+    for (uint8_t i = 0; i < 8; i++)
+        heap.set(i, 100 - i * 10);
+
+    heap.remove(7);
+    heap.remove(3);
+    heap.remove(3);     // not in the heap any more
+    TEST_ASSERT_FALSE(heap.contains(3));
+    TEST_ASSERT_TRUE(heap.contains(4));
+    TEST_ASSERT_EQUAL(6, heap.size());
+
+    const uint8_t expected[] = {6, 5, 4, 2, 1, 0};
+    for (uint8_t i = 0; i < 6; i++)
+        TEST_ASSERT_EQUAL(expected[i], heap.pop());
+}
+
+void test_timer_heap_wraparound(void)
+{
+    TimerHeap<16> heap;
+    // Deadlines just after millis() wraps are still later than those just before
+    heap.set(0, 0x00000010);
+    heap.set(1, 0xFFFFFFF0);
+    heap.set(2, 0x00000000);
+
+    TEST_ASSERT_EQUAL(1, heap.pop());
+    TEST_ASSERT_EQUAL(2, heap.pop());
+    TEST_ASSERT_EQUAL(0, heap.pop());
+}
+
+void test_timer_heap_random(void)
+{
+    // Random sets and removes against a brute force search for the earliest deadline
+    TimerHeap<16> heap;
+    uint32_t deadlines[16];
+    bool present[16] = {false};
+    srand(1234);
+
+    for (int n = 0; n < 2000; n++)
+    {
+        const uint8_t id = rand() % 16;
+        if (rand() % 4 == 0)
+        {
+            heap.remove(id);
+            present[id] = false;
+        }
+        else
+        {
+            deadlines[id] = rand() % 1000;
+            present[id] = true;
+            heap.set(id, deadlines[id]);
+        }
+
+        int earliest = -1;
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            if (!present[i])
+                continue;
+            count++;
+            if (earliest == -1 || deadlines[i] < deadlines[earliest])
+                earliest = i;
+        }
+        TEST_ASSERT_EQUAL(count, heap.size());
+        if (earliest != -1)
+            TEST_ASSERT_EQUAL(deadlines[earliest], heap.topDeadline());
+    }
+}
+
+static int events[3];
+static int timeouts[3];
+static char order[16];
+static uint8_t orderLen;
+
+static int periodicTimeout() { timeouts[0]++; order[orderLen++] = 'P'; return 10; }
+static int periodicEvent() { events[0]++; return DURATION_IGNORE; }
+static int immediateTimeout() { timeouts[1]++; order[orderLen++] = 'I'; return DURATION_IMMEDIATELY; }
+static int immediateStart() { return 5; }
+static int connectionEvent() { events[2]++; return 20; }
+static int connectionTimeout() { timeouts[2]++; order[orderLen++] = 'C'; return DURATION_NEVER; }
+
+static device_t periodicDevice = {
+    .initialize = nullptr,
+    .start = nullptr,
+    .event = periodicEvent,
+    .timeout = periodicTimeout,
+};
+
+static device_t immediateDevice = {
+    .initialize = nullptr,
+    .start = immediateStart,
+    .event = nullptr,
+    .timeout = immediateTimeout,
+};
+
+static device_t connectionDevice = {
+    .initialize = nullptr,
+    .start = nullptr,
+    .event = connectionEvent,
+    .timeout = connectionTimeout,
+    .eventMask = DEVICE_EVENT_CONNECTION_STATE,
+};
+
+static device_affinity_t devices[] = {
+    {&periodicDevice, 1},
+    {&immediateDevice, 1},
+    {&connectionDevice, 1},
+};
+
+static void startDevices()
+{
+    memset(events, 0, sizeof(events));
+    memset(timeouts, 0, sizeof(timeouts));
+    orderLen = 0;
+    connectionState = disconnected;
+    devicesRegister(devices, 3);
+    devicesStart();
+    devicesUpdate(0);   // swallow the connection state starting as disconnected
+    memset(events, 0, sizeof(events));
+}
+
+void test_device_timeouts(void)
+{
+    startDevices();
+
+    // Nothing is due until the immediate device's start delay
+    devicesUpdate(4);
+    TEST_ASSERT_EQUAL(0, timeouts[1]);
+
+    // Due timeouts run once per update, even when they return DURATION_IMMEDIATELY
+    devicesUpdate(5);
+    TEST_ASSERT_EQUAL(1, timeouts[1]);
+    devicesUpdate(5);
+    TEST_ASSERT_EQUAL(2, timeouts[1]);
+
+    // The periodic device has no start() so only runs once an event gives it a timeout
+    TEST_ASSERT_EQUAL(0, timeouts[0]);
+    TEST_ASSERT_EQUAL(0, timeouts[2]);
+}
+
+void test_device_event_mask(void)
+{
+    startDevices();
+
+    // A triggered event only goes to devices subscribed to all events
+    devicesTriggerEvent();
+    devicesUpdate(1);
+    TEST_ASSERT_EQUAL(1, events[0]);
+    TEST_ASSERT_EQUAL(0, events[2]);
+
+    // The connection state changing goes to both
+    connectionState = connected;
+    devicesUpdate(2);
+    TEST_ASSERT_EQUAL(2, events[0]);
+    TEST_ASSERT_EQUAL(1, events[2]);
+
+    // No more events until something changes
+    devicesUpdate(3);
+    TEST_ASSERT_EQUAL(2, events[0]);
+    TEST_ASSERT_EQUAL(1, events[2]);
+}
+
+void test_device_timeout_order(void)
+{
+    startDevices();
+    connectionState = connected;
+    devicesUpdate(0);   // connection device is due at 20
+    devicesTriggerEvent(DEVICE_EVENT_ALL);
+    devicesUpdate(0);   // DURATION_IGNORE leaves the periodic device without a timeout
+
+    // Expired timeouts run earliest deadline first
+    orderLen = 0;
+    devicesUpdate(30);
+    TEST_ASSERT_EQUAL(2, orderLen);
+    TEST_ASSERT_EQUAL('I', order[0]);   // due at 5
+    TEST_ASSERT_EQUAL('C', order[1]);   // due at 20
+}
+
+void test_device_stats(void)
+{
+    startDevices();
+    devicesUpdate(8);   // 3ms late
+    devicesUpdate(8);   // on time
+    devicesUpdate(10);  // 2ms late
+
+    const deviceStats_t *stats = devicesGetStats(1);
+    TEST_ASSERT_NOT_NULL(stats);
+    TEST_ASSERT_EQUAL(3, stats->timeouts);
+    TEST_ASSERT_EQUAL(0, stats->events);
+    TEST_ASSERT_EQUAL(2, stats->late);
+    TEST_ASSERT_EQUAL(3, stats->maxLateMillis);
+    TEST_ASSERT_NULL(devicesGetStats(3));
+
+    devicesResetStats();
+    TEST_ASSERT_EQUAL(0, devicesGetStats(1)->timeouts);
+}
+
+void test_device_loop_stats(void)
+{
+    startDevices();
+    devicesResetStats();
+
+    // The first update after a reset only starts the measurement
+    devicesUpdate(1);
+    TEST_ASSERT_EQUAL(0, devicesGetLoopStats()->count);
+    for (int i = 0; i < 4; i++)
+        devicesUpdate(1);
+
+    const deviceLoopStats_t *loop = devicesGetLoopStats();
+    TEST_ASSERT_EQUAL(4, loop->count);
+    uint32_t total = 0;
+    for (int i = 0; i < DEVICE_LOOP_BUCKET_COUNT; i++)
+        total += loop->buckets[i];
+    TEST_ASSERT_EQUAL(4, total);
+    TEST_ASSERT_LESS_OR_EQUAL(loop->maxMicros * 4, loop->totalMicros);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_heap_order);
+    RUN_TEST(test_timer_heap_reschedule);
+    RUN_TEST(test_timer_heap_remove);
+    RUN_TEST(test_timer_heap_wraparound);
+    RUN_TEST(test_timer_heap_random);
+    RUN_TEST(test_device_timeouts);
+    RUN_TEST(test_device_event_mask);
+    RUN_TEST(test_device_timeout_order);
+    RUN_TEST(test_device_stats);
+    RUN_TEST(test_device_loop_stats);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <AntennaDiversity.h>
+#include <LowPassFilter.h>
+#include <unity.h>
+
+#define CHANNELS 80
+#define SENSITIVITY -100
+#define HOP_INTERVAL 4
+#define TLM_RATIO 16
+#define PACKETS 50000
+
+typedef AntennaDiversity<CHANNELS> Diversity;
+
+static uint32_t seed;
+static uint32_t rng()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+// A fading model of two antennas at the receiver: each has a slow swing from the craft's
+// orientation, with the nulls of the two at different times, and a frequency selective
+// fade per channel which drifts slowly. On top of that each packet has some noise.
+class Channel
+{
+public:
+    int8_t base;
+    int8_t fade[2][CHANNELS];
+
+    void init(int8_t pathRssi)
+    {
+        seed = 1;
+        base = pathRssi;
+        for (uint8_t ant = 0; ant < 2; ant++)
+            for (uint8_t ch = 0; ch < CHANNELS; ch++)
+                fade[ant][ch] = randomFade();
+    }
+
+    int8_t randomFade() { return -(int8_t)(rng() % 19) + 3; } // +3 to -15dB
+
+    int16_t rssi(uint32_t t, uint8_t ant, uint8_t ch)
+    {
+        // Re-roll one channel's fade every so often
+        if (rng() % 64 == 0)
+            fade[rng() % 2][rng() % CHANNELS] = randomFade();
+        double swing = 8.0 * sin(2.0 * M_PI * t / 3000.0 + (ant ? M_PI : 0.0));
+        return base + (int16_t)swing + fade[ant][ch] + (int16_t)(rng() % 5) - 2;
+    }
+};
+
+enum Strategy { FIXED, LEGACY, PREDICTIVE };
+
+// The LPF and drop triggers updateDiversity() used before
+class Legacy
+{
+public:
+    LPF rssi[2] = {LPF(5), LPF(5)};
+    int32_t prevRSSI = 0;
+    int32_t lqTrigger = 0;
+    int32_t rssiTrigger = 0;
+    uint8_t antenna = 0;
+
+    void switchAntenna()
+    {
+        antenna = !antenna;
+        rssi[antenna].reset();
+    }
+
+    void update(bool received)
+    {
+        int32_t r = rssi[antenna].value();
+        int32_t other = rssi[!antenna].value();
+        if ((r < (prevRSSI - 5)) && rssiTrigger >= 5)
+        {
+            switchAntenna();
+            lqTrigger = 1;
+            rssiTrigger = 0;
+        }
+        else if (r > prevRSSI || rssiTrigger < 5)
+        {
+            prevRSSI = r;
+            rssiTrigger++;
+        }
+
+        if (!received && lqTrigger == 0)
+        {
+            switchAntenna();
+            lqTrigger = 1;
+            rssiTrigger = 0;
+        }
+        else if (lqTrigger >= 5)
+        {
+            if (r < other)
+            {
+                switchAntenna();
+                lqTrigger = 1;
+                rssiTrigger = 0;
+            }
+            else
+            {
+                lqTrigger = 0;
+            }
+        }
+        else if (lqTrigger > 0)
+        {
+            lqTrigger++;
+        }
+    }
+};
+
+// Runs the link for PACKETS packets, returning the LQ of the uplink packets in percent
+static uint8_t simulate(Strategy strategy, int8_t pathRssi)
+{
+    static Channel channel;
+    static Diversity diversity;
+    Legacy legacy;
+    channel.init(pathRssi);
+    diversity.reset();
+
+    uint8_t sequence[256];
+    for (uint16_t i = 0; i < 256; i++)
+        sequence[i] = (i * 37) % CHANNELS;
+
+    uint8_t antenna = 0;
+    uint32_t uplink = 0, received = 0;
+    for (uint32_t t = 0; t < PACKETS; t++)
+    {
+        uint8_t ch = sequence[(t / HOP_INTERVAL) % 256];
+        bool receiving = (t % TLM_RATIO) != 0;
+        if (strategy == PREDICTIVE)
+            antenna = diversity.choose(ch, receiving);
+        if (!receiving)
+            continue;
+
+        int16_t rssi = channel.rssi(t, antenna, ch);
+        bool ok = rssi >= SENSITIVITY;
+        ++uplink;
+        if (ok)
+            ++received;
+
+        if (strategy == PREDICTIVE)
+            ok ? diversity.received(rssi) : diversity.missed();
+        else if (strategy == LEGACY)
+        {
+            if (ok)
+                legacy.rssi[antenna].update(rssi);
+            legacy.update(ok);
+            antenna = legacy.antenna;
+        }
+    }
+    return received * 100 / uplink;
+}
+
+void test_diversity_follows_better_antenna(void)
+{
+    Diversity diversity;
+    // Antenna 0 is heard first, then the other is probed straight away
+    TEST_ASSERT_EQUAL(0, diversity.choose(0, true));
+    diversity.received(-80);
+    TEST_ASSERT_EQUAL(1, diversity.choose(0, true));
+    TEST_ASSERT_TRUE(diversity.isProbing());
+    diversity.received(-70);
+
+    // It was better so it stays there
+    TEST_ASSERT_EQUAL(1, diversity.choose(0, true));
+    TEST_ASSERT_FALSE(diversity.isProbing());
+}
+
+void test_diversity_probe_returns(void)
+{
+    Diversity diversity;
+    diversity.choose(0, true);
+    diversity.received(-70);
+    diversity.choose(0, true);
+    diversity.received(-80);
+    TEST_ASSERT_EQUAL(0, diversity.choose(0, true));
+
+    // The other is probed once per PROBE_INTERVAL, and not when telemetry will be sent
+    for (uint8_t i = 0; i < Diversity::PROBE_INTERVAL - 2; i++)
+    {
+        TEST_ASSERT_EQUAL(0, diversity.choose(0, true));
+        diversity.received(-70);
+    }
+    TEST_ASSERT_EQUAL(0, diversity.choose(0, false));
+    TEST_ASSERT_EQUAL(1, diversity.choose(0, true));
+    diversity.received(-85);
+    TEST_ASSERT_EQUAL(0, diversity.choose(0, true));
+}
+
+void test_diversity_per_channel(void)
+{
+    Diversity diversity;
+    diversity.choose(0, true);
+    diversity.received(-70);
+    diversity.choose(0, true);
+    diversity.received(-72);
+    TEST_ASSERT_EQUAL(0, diversity.choose(6, false));
+
+    // Antenna 0 is in a deep fade on channel 5, but fine elsewhere
+    diversity.received(-70);
+    TEST_ASSERT_EQUAL(0, diversity.choose(5, false));
+    diversity.received(-90);
+    TEST_ASSERT_EQUAL(0, diversity.choose(6, false));
+    diversity.received(-70);
+    TEST_ASSERT_TRUE(diversity.expected(0, 5) < diversity.expected(0, 6) - 8 * Diversity::FRAC);
+
+    // So the next time on channel 5 it uses the other
+    TEST_ASSERT_EQUAL(1, diversity.choose(5, false));
+}
+
+void test_diversity_missed_switches(void)
+{
+    Diversity diversity;
+    diversity.choose(0, true);
+    diversity.received(-75);
+    diversity.choose(0, true);
+    diversity.received(-76);
+    TEST_ASSERT_EQUAL(0, diversity.choose(0, true));
+
+    // A miss on this antenna goes to the other
+    diversity.missed();
+    TEST_ASSERT_EQUAL(1, diversity.choose(0, true));
+}
+
+void test_diversity_simulated_lq(void)
+{
+    // Near the edge of the range, where the fades decide which packets are lost
+    for (int8_t pathRssi = -92; pathRssi >= -96; pathRssi -= 2)
+    {
+        uint8_t fixed = simulate(FIXED, pathRssi);
+        uint8_t legacy = simulate(LEGACY, pathRssi);
+        uint8_t predictive = simulate(PREDICTIVE, pathRssi);
+        printf("path %d: LQ fixed %u legacy %u predictive %u\n", pathRssi, fixed, legacy, predictive);
+        TEST_ASSERT_GREATER_THAN(fixed, legacy);
+        TEST_ASSERT_GREATER_OR_EQUAL(legacy + 5, predictive);
+    }
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_diversity_follows_better_antenna);
+    RUN_TEST(test_diversity_probe_returns);
+    RUN_TEST(test_diversity_per_channel);
+    RUN_TEST(test_diversity_missed_switches);
+    RUN_TEST(test_diversity_simulated_lq);
+    UNITY_END();
+
+    return 0;
+}
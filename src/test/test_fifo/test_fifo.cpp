@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <FIFO.h>
+#include <SPSCQueue.h>
 #include <unity.h>
 #include <set>
 
@@ -58,6 +59,56 @@ void test_fifo_ensure()
         TEST_ASSERT_EQUAL(10, f.pop()); // and that all the bytes in the head packet are what we expect
 }
 
+void test_spsc_queue_order(void)
+{
+    SPSCQueue<uint32_t, 4> q;
+    TEST_ASSERT_NULL(q.peek());
+
+    // Fill it, one more is refused
+    for (uint32_t i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(q.push(i));
+    TEST_ASSERT_FALSE(q.push(99));
+    TEST_ASSERT_EQUAL(4, q.size());
+
+    uint32_t item;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(q.pop(item));
+        TEST_ASSERT_EQUAL(i, item);
+    }
+    TEST_ASSERT_FALSE(q.pop(item));
+}
+
+void test_spsc_queue_wrap(void)
+{
+    // The indexes wrap many times over while the queue is in use
+    SPSCQueue<uint8_t[8], 8> q;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for (int n = 0; n < 1000; n++)
+    {
+        for (int i = 0; i < n % 5; i++)
+        {
+            uint8_t (*slot)[8] = q.reserve();
+            if (slot == nullptr)
+                break;
+            memset(*slot, pushed++, sizeof(*slot));
+            q.commit();
+        }
+        for (int i = 0; i < n % 3 + 1; i++)
+        {
+            uint8_t (*slot)[8] = q.peek();
+            if (slot == nullptr)
+                break;
+            for (int b = 0; b < 8; b++)
+                TEST_ASSERT_EQUAL((uint8_t)popped, (*slot)[b]);
+            popped++;
+            q.release();
+        }
+        TEST_ASSERT_EQUAL(pushed - popped, q.size());
+    }
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -68,6 +119,8 @@ int main(int argc, char **argv)
     RUN_TEST(test_fifo_pop_wrap);
     RUN_TEST(test_fifo_popBytes_wrap);
     RUN_TEST(test_fifo_ensure);
+    RUN_TEST(test_spsc_queue_order);
+    RUN_TEST(test_spsc_queue_wrap);
     UNITY_END();
 
     return 0;
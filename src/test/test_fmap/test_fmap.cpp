@@ -3,6 +3,12 @@
 #include <unity.h>
 #include <iostream>
 #include <bitset>
+#include <cstdlib>
+#include <cstring>
+#include "crc.h"
+#include "ChannelEncoder.h"
+
+GENERIC_CRC8 crsf_crc(CRSF_CRC_POLY);
 
 static uint16_t fmapf(uint16_t x, float in_min, float in_max, float out_min, float out_max) { return round((x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min); };
 
@@ -35,6 +41,179 @@ void test_fmap_consistent_bider(void)
     }
 }
 
+void test_fmap_scale_exact(void)
+{
+    // The ranges used by the RC encoders and the CRSF conversions
+    const uint16_t ranges[][4] = {
+        {CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696},
+        {CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 176, 848},
+        {CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 988, 2012},
+        {CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 0, 1023},
+        {0, 1023, CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX},
+        {0, 100, 0, 1023},
+        {CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 1000, 2000},
+        {1000, 2000, 0, 65535},
+    };
+
+    for (auto &r : ranges)
+    {
+        const rcChannelScale_t scale = rcScaleLinear(r[0], r[1], r[2], r[3]);
+        // Including values outside the input range, which fmap() extrapolates
+        for (uint16_t x = 0; x <= RC_SCALE_MAX_INPUT; x++)
+        {
+            TEST_ASSERT_EQUAL(fmap(x, r[0], r[1], r[2], r[3]), rcScale(scale, x));
+        }
+    }
+}
+
+void test_fmap_scale_switch(void)
+{
+    const rcChannelScale_t scale = rcScaleSwitch(CRSF_CHANNEL_VALUE_MID, 352, 1696);
+    TEST_ASSERT_EQUAL(352, rcScale(scale, CRSF_CHANNEL_VALUE_MIN));
+    TEST_ASSERT_EQUAL(352, rcScale(scale, CRSF_CHANNEL_VALUE_MID - 1));
+    TEST_ASSERT_EQUAL(1696, rcScale(scale, CRSF_CHANNEL_VALUE_MID));
+    TEST_ASSERT_EQUAL(1696, rcScale(scale, CRSF_CHANNEL_VALUE_MAX));
+}
+
+// The hand unrolled encoders the tables replaced
+static void refSBUS(const uint32_t *channelData, bool djiRsPro, uint8_t *out)
+{
+    crsf_channels_s PackedRCdataOut;
+    if (djiRsPro)
+    {
+        PackedRCdataOut.ch0 = fmap(channelData[0], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch1 = fmap(channelData[1], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch2 = fmap(channelData[2], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch3 = fmap(channelData[3], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch4 = fmap(channelData[5], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch5 = fmap(channelData[6], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch6 = fmap(channelData[7], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 176,  848);
+        PackedRCdataOut.ch7 = fmap(channelData[8], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch8 = fmap(channelData[9], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch9 = fmap(channelData[10], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch10 = fmap(channelData[11], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch11 = fmap(channelData[12], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch12 = fmap(channelData[13], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch13 = fmap(channelData[14], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch14 = fmap(channelData[15], CRSF_CHANNEL_VALUE_MIN, CRSF_CHANNEL_VALUE_MAX, 352, 1696);
+        PackedRCdataOut.ch15 = channelData[4] < CRSF_CHANNEL_VALUE_MID ? 352 : 1696;
+    }
+    else
+    {
+        PackedRCdataOut.ch0 = channelData[0];
+        PackedRCdataOut.ch1 = channelData[1];
+        PackedRCdataOut.ch2 = channelData[2];
+        PackedRCdataOut.ch3 = channelData[3];
+        PackedRCdataOut.ch4 = channelData[4];
+        PackedRCdataOut.ch5 = channelData[5];
+        PackedRCdataOut.ch6 = channelData[6];
+        PackedRCdataOut.ch7 = channelData[7];
+        PackedRCdataOut.ch8 = channelData[8];
+        PackedRCdataOut.ch9 = channelData[9];
+        PackedRCdataOut.ch10 = channelData[10];
+        PackedRCdataOut.ch11 = channelData[11];
+        PackedRCdataOut.ch12 = channelData[12];
+        PackedRCdataOut.ch13 = channelData[13];
+        PackedRCdataOut.ch14 = channelData[14];
+        PackedRCdataOut.ch15 = channelData[15];
+    }
+    out[0] = 0x0F;
+    memcpy(&out[1], &PackedRCdataOut, sizeof(PackedRCdataOut));
+}
+
+static void refSUMD(const uint32_t *channelData, uint8_t *out)
+{
+    static const uint8_t order[16] = {0, 1, 2, 3, 7, 5, 6, 4, 8, 9, 10, 11, 12, 13, 14, 15};
+    Crc2Byte crc2Byte;
+    crc2Byte.init(16, 0x1021);
+
+    out[0] = 0xA8;
+    out[1] = 0x01;
+    out[2] = 0x10;
+    for (int i = 0; i < 16; i++)
+    {
+        uint16_t us = (CRSF_to_US(channelData[order[i]]) << 3);
+        out[3 + i * 2] = us >> 8;
+        out[4 + i * 2] = us & 0x00ff;
+    }
+    uint16_t crc = crc2Byte.calc(out, 35, 0);
+    out[35] = (uint8_t)(crc >> 8);
+    out[36] = (uint8_t)(crc & 0x00ff);
+}
+
+static void refCRSF(const uint32_t *channelData, uint8_t *out)
+{
+    crsf_channels_s PackedRCdataOut;
+    PackedRCdataOut.ch0 = channelData[0];
+    PackedRCdataOut.ch1 = channelData[1];
+    PackedRCdataOut.ch2 = channelData[2];
+    PackedRCdataOut.ch3 = channelData[3];
+    PackedRCdataOut.ch4 = channelData[4];
+    PackedRCdataOut.ch5 = channelData[5];
+    PackedRCdataOut.ch6 = channelData[6];
+    PackedRCdataOut.ch7 = channelData[7];
+    PackedRCdataOut.ch8 = channelData[8];
+    PackedRCdataOut.ch9 = channelData[9];
+    PackedRCdataOut.ch10 = channelData[10];
+    PackedRCdataOut.ch11 = channelData[11];
+    PackedRCdataOut.ch12 = channelData[12];
+    PackedRCdataOut.ch13 = channelData[13];
+    PackedRCdataOut.ch14 = channelData[14];
+    PackedRCdataOut.ch15 = channelData[15];
+
+    out[0] = CRSF_ADDRESS_FLIGHT_CONTROLLER;
+    out[1] = CRSF_FRAME_SIZE(sizeof(PackedRCdataOut));
+    out[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+    memcpy(&out[3], &PackedRCdataOut, sizeof(PackedRCdataOut));
+    out[3 + sizeof(PackedRCdataOut)] = crsf_crc.calc(&out[2], sizeof(PackedRCdataOut) + 1);
+}
+
+static void randomChannels(uint32_t *channelData, int i)
+{
+    for (int ch = 0; ch < 16; ch++)
+    {
+        // The first frames are the full range of every channel together, then random values
+        channelData[ch] = i < 2048 ? i : rand() % 2048;
+    }
+}
+
+void test_fmap_encoders_match_reference(void)
+{
+    RCFrameEncoder crsf(rcEncoderCRSF);
+    RCFrameEncoder sbus(rcEncoderSBUS);
+    RCFrameEncoder sumd(rcEncoderSUMD);
+    TEST_ASSERT_EQUAL(26, crsf.getFrameLen());
+    TEST_ASSERT_EQUAL(23, sbus.getFrameLen());
+    TEST_ASSERT_EQUAL(37, sumd.getFrameLen());
+
+    srand(1);
+    uint32_t channelData[16];
+    uint8_t expected[37];
+    uint8_t actual[37];
+    for (int i = 0; i < 10000; i++)
+    {
+        randomChannels(channelData, i);
+
+        refCRSF(channelData, expected);
+        TEST_ASSERT_EQUAL(26, crsf.encode(channelData, actual));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 26);
+
+        sbus.setDescriptor(rcEncoderSBUS);
+        refSBUS(channelData, false, expected);
+        TEST_ASSERT_EQUAL(23, sbus.encode(channelData, actual));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 23);
+
+        sbus.setDescriptor(rcEncoderSBUSDJIRSPro);
+        refSBUS(channelData, true, expected);
+        TEST_ASSERT_EQUAL(23, sbus.encode(channelData, actual));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 23);
+
+        refSUMD(channelData, expected);
+        TEST_ASSERT_EQUAL(37, sumd.encode(channelData, actual));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 37);
+    }
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -44,6 +223,9 @@ int main(int argc, char **argv)
     UNITY_BEGIN();
     RUN_TEST(test_fmap_consistent_with_float);
     RUN_TEST(test_fmap_consistent_bider);
+    RUN_TEST(test_fmap_scale_exact);
+    RUN_TEST(test_fmap_scale_switch);
+    RUN_TEST(test_fmap_encoders_match_reference);
     UNITY_END();
 
     return 0;
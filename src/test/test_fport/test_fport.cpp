@@ -0,0 +1,211 @@
+#include <cstdint>
+#include <vector>
+#include <unity.h>
+#include "common.h"
+#include "CRSF.h"
+#include "ChannelEncoder.h"
+#include "FPort.h"
+
+using namespace std;
+
+// Split the bytes on the wire into the unstuffed frames between markers
+static vector<vector<uint8_t>> unstuff(const uint8_t *data, uint8_t len)
+{
+    vector<vector<uint8_t>> frames;
+    vector<uint8_t> frame;
+    bool inFrame = false;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (data[i] == FPORT_FRAME_MARKER)
+        {
+            if (inFrame)
+                frames.push_back(frame);
+            frame.clear();
+            inFrame = !inFrame;
+        }
+        else if (data[i] == FPORT_ESCAPE_CHAR)
+        {
+            frame.push_back(data[++i] ^ FPORT_ESCAPE_MASK);
+        }
+        else
+        {
+            frame.push_back(data[i]);
+        }
+    }
+    return frames;
+}
+
+static vector<uint8_t> uplinkFrame(uint16_t appId, uint32_t value)
+{
+    uint8_t frame[] = {FPORT_DOWNLINK_LEN, FPORT_TYPE_UPLINK, FPORT_PRIM_DATA,
+                       (uint8_t)appId, (uint8_t)(appId >> 8),
+                       (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24), 0};
+    frame[9] = fportChecksum(frame, 9);
+
+    vector<uint8_t> out;
+    for (uint8_t b : frame)
+    {
+        if (b == FPORT_FRAME_MARKER || b == FPORT_ESCAPE_CHAR)
+        {
+            out.push_back(FPORT_ESCAPE_CHAR);
+            b ^= FPORT_ESCAPE_MASK;
+        }
+        out.push_back(b);
+    }
+    return out;
+}
+
+static uint16_t getBE16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t getBE32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+void test_fport_checksum(void)
+{
+    // Carries are added back in before the result is inverted
+    const uint8_t data[] = {0xFF, 0xFF, 0x02};
+    TEST_ASSERT_EQUAL_HEX8(0xFF - 0x02, fportChecksum(data, sizeof(data)));
+
+    // A frame including its checksum sums to 0xFF
+    uint8_t frame[] = {0x08, 0x81, 0x10, 0x10, 0x02, 0x7E, 0x04, 0x00, 0x00, 0x00};
+    frame[9] = fportChecksum(frame, 9);
+    TEST_ASSERT_EQUAL_HEX8(0x00, fportChecksum(frame, sizeof(frame)));
+}
+
+void test_fport_rc_frame(void)
+{
+    SensorTelemetry tlm;
+    FPort fport(tlm);
+
+    uint32_t channelData[CRSF_NUM_CHANNELS];
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++)
+        channelData[i] = CRSF_CHANNEL_VALUE_MID;
+    channelData[0] = 0x37E;     // packs to a frame marker, which must be escaped
+
+    uint8_t out[2 * FPORT_MAX_FRAME_LEN];
+    const uint8_t len = fport.encodeRCFrame(channelData, FPORT_FLAG_FRAME_LOST, 87, 0, out);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_FRAME_MARKER, out[0]);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_FRAME_MARKER, out[len - 1]);
+
+    vector<vector<uint8_t>> frames = unstuff(out, len);
+    TEST_ASSERT_EQUAL(2, frames.size());
+
+    // Control frame with the channels packed as SBUS
+    const vector<uint8_t> &control = frames[0];
+    TEST_ASSERT_EQUAL(FPORT_CONTROL_LEN + 2, control.size());
+    TEST_ASSERT_EQUAL_HEX8(FPORT_CONTROL_LEN, control[0]);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_TYPE_CONTROL, control[1]);
+    uint8_t channels[22];
+    TEST_ASSERT_EQUAL(22, rcEncodeChannels(rcEncoderSBUS, channelData, channels));
+    TEST_ASSERT_EQUAL_HEX8(FPORT_FRAME_MARKER, channels[0]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(channels, &control[2], 22);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_FLAG_FRAME_LOST, control[24]);
+    TEST_ASSERT_EQUAL(87, control[25]);
+    TEST_ASSERT_EQUAL_HEX8(fportChecksum(control.data(), 26), control[26]);
+
+    // Followed by the downlink request
+    const vector<uint8_t> &downlink = frames[1];
+    TEST_ASSERT_EQUAL(FPORT_DOWNLINK_LEN + 2, downlink.size());
+    TEST_ASSERT_EQUAL_HEX8(FPORT_DOWNLINK_LEN, downlink[0]);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_TYPE_DOWNLINK, downlink[1]);
+    TEST_ASSERT_EQUAL_HEX8(FPORT_PRIM_NULL, downlink[2]);
+    TEST_ASSERT_EQUAL_HEX8(fportChecksum(downlink.data(), 9), downlink[9]);
+}
+
+void test_fport_uplink_sensors(void)
+{
+    SensorTelemetry tlm;
+    FPort fport(tlm);
+    uint32_t channelData[CRSF_NUM_CHANNELS] = {0};
+    uint8_t out[2 * FPORT_MAX_FRAME_LEN];
+    uint32_t now = 1000;
+
+    // One value is answered per downlink request, with a noise byte before the first
+    const struct { uint16_t appId; uint32_t value; } values[] = {
+        {0x0210, 1260},                             // VFAS, 12.60V
+        {0x0200, 157},                              // CURR, 15.7A
+        {0x0800, (1U << 30) | 20233500},            // 33deg 43.35' S
+        {0x0800, (1U << 31) | 90721080},            // 151deg 12.1080' E
+        {0x0830, 10000},                            // 10 knots
+        {0x0840, 27050},                            // 270.50deg
+        {0x0410, 1012},                             // 12 satellites
+        {0x0100, (uint32_t)-250},                   // -2.5m
+    };
+    for (const auto &v : values)
+    {
+        fport.encodeRCFrame(channelData, 0, 100, now, out);
+        vector<uint8_t> uplink = uplinkFrame(v.appId, v.value);
+        uplink.insert(uplink.begin(), 0x55);
+        fport.processBytes(uplink.data(), uplink.size(), now + 2);
+        now += 9;
+    }
+    TEST_ASSERT_EQUAL(8, fport.getUplinkFrames());
+    TEST_ASSERT_EQUAL(0, fport.getChecksumErrors());
+    TEST_ASSERT_EQUAL(0, fport.getLateFrames());
+
+    const uint8_t *frame = tlm.nextFrame(now);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_BATTERY_SENSOR, frame[2]);
+    TEST_ASSERT_EQUAL(126, getBE16(&frame[3]));
+    TEST_ASSERT_EQUAL(157, getBE16(&frame[5]));
+
+    frame = tlm.nextFrame(now);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_BARO_ALTITUDE, frame[2]);
+    TEST_ASSERT_EQUAL(10000 - 25, getBE16(&frame[3]));
+
+    frame = tlm.nextFrame(now);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_GPS, frame[2]);
+    TEST_ASSERT_EQUAL_INT32(-337225000, (int32_t)getBE32(&frame[3]));
+    TEST_ASSERT_EQUAL_INT32(1512018000, (int32_t)getBE32(&frame[7]));
+    TEST_ASSERT_EQUAL(185, getBE16(&frame[11]));        // 18.5 km/h
+    TEST_ASSERT_EQUAL(27050, getBE16(&frame[13]));
+    TEST_ASSERT_EQUAL(12, frame[17]);
+}
+
+void test_fport_uplink_timing(void)
+{
+    SensorTelemetry tlm;
+    FPort fport(tlm);
+    uint32_t channelData[CRSF_NUM_CHANNELS] = {0};
+    uint8_t out[2 * FPORT_MAX_FRAME_LEN];
+
+    // Nothing was asked for
+    vector<uint8_t> uplink = uplinkFrame(0x0210, 1260);
+    fport.processBytes(uplink.data(), uplink.size(), 0);
+    TEST_ASSERT_EQUAL(1, fport.getLateFrames());
+
+    // Answered after the slot closed
+    fport.encodeRCFrame(channelData, 0, 100, 10, out);
+    fport.processBytes(uplink.data(), uplink.size(), 10 + FPORT_UPLINK_TIMEOUT_MS + 1);
+    TEST_ASSERT_EQUAL(2, fport.getLateFrames());
+
+    // Only one answer per request
+    fport.encodeRCFrame(channelData, 0, 100, 20, out);
+    fport.processBytes(uplink.data(), uplink.size(), 20 + FPORT_UPLINK_TIMEOUT_MS);
+    fport.processBytes(uplink.data(), uplink.size(), 20 + FPORT_UPLINK_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(1, fport.getUplinkFrames());
+    TEST_ASSERT_EQUAL(3, fport.getLateFrames());
+
+    // Corrupted in transit
+    fport.encodeRCFrame(channelData, 0, 100, 30, out);
+    uplink[5] ^= 0x01;
+    fport.processBytes(uplink.data(), uplink.size(), 31);
+    TEST_ASSERT_EQUAL(1, fport.getChecksumErrors());
+    TEST_ASSERT_EQUAL(1, fport.getUplinkFrames());
+
+    TEST_ASSERT_TRUE(tlm.hasSensor(SENSOR_TLM_BATTERY));
+    TEST_ASSERT_FALSE(tlm.hasSensor(SENSOR_TLM_GPS));
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fport_checksum);
+    RUN_TEST(test_fport_rc_frame);
+    RUN_TEST(test_fport_uplink_sensors);
+    RUN_TEST(test_fport_uplink_timing);
+    UNITY_END();
+
+    return 0;
+}
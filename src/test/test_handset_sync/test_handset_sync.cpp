@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <unity.h>
+
+#include "HandsetSync.h"
+
+static HandsetSync sync;
+
+// Simple deterministic LCG so the jitter sequences are repeatable
+static uint32_t rngState;
+static int32_t jitter(int32_t amplitude)
+{
+    rngState = rngState * 1664525 + 1013904223;
+    return (int32_t)((rngState >> 8) % (2 * amplitude + 1)) - amplitude;
+}
+
+void test_constant_phase_converges(void)
+{
+    sync.setPacketInterval(2000);
+    uint32_t now = 1000000;
+    for (int i = 0; i < 200; i++)
+    {
+        TEST_ASSERT_TRUE(sync.rfPacketSent(now - 300, now));
+        now += 2000;
+    }
+    TEST_ASSERT_EQUAL(300, sync.getPhase());
+    // No jitter at all, the margin drops to the minimum
+    TEST_ASSERT_EQUAL(HandsetSync::MIN_MARGIN_US, sync.getMargin());
+    TEST_ASSERT_EQUAL((300 - HandsetSync::MIN_MARGIN_US) * 10, sync.getOffset());
+    TEST_ASSERT_EQUAL(HandsetSync::JITTER_BUCKET_US, sync.getJitterPercentile(99));
+}
+
+void test_default_margin_until_enough_samples(void)
+{
+    sync.setPacketInterval(2000);
+    uint32_t now = 0;
+    for (unsigned i = 0; i < HandsetSync::MIN_SAMPLES_FOR_ADAPTIVE_MARGIN / 2; i++)
+    {
+        sync.rfPacketSent(now - 500, now);
+        now += 2000;
+    }
+    TEST_ASSERT_EQUAL(HandsetSync::DEFAULT_MARGIN_US, sync.getMargin());
+    TEST_ASSERT_EQUAL((500 - HandsetSync::DEFAULT_MARGIN_US) * 10, sync.getOffset());
+}
+
+void test_drift_is_tracked(void)
+{
+    // Handset clock is slightly fast, its packets get 2us earlier relative to the RF packet every frame
+    sync.setPacketInterval(2000);
+    uint32_t now = 0;
+    int32_t phase = 200;
+    for (int i = 0; i < 400; i++)
+    {
+        sync.rfPacketSent(now - phase, now);
+        now += 2000;
+        phase += 2;
+    }
+    // the filter estimates the phase for the next packet, not the last one
+    TEST_ASSERT_INT_WITHIN(3, phase, sync.getOffset() / 10 + sync.getMargin());
+}
+
+void test_jitter_percentiles(void)
+{
+    sync.setPacketInterval(1000);
+    rngState = 1;
+    uint32_t now = 0;
+    for (int i = 0; i < 3000; i++)
+    {
+        sync.rfPacketSent(now - (400 + jitter(40)), now);
+        now += 1000;
+    }
+    TEST_ASSERT_INT_WITHIN(25, 400, sync.getPhase());
+    uint32_t p50 = sync.getJitterPercentile(50);
+    uint32_t p99 = sync.getJitterPercentile(99);
+    TEST_ASSERT_LESS_OR_EQUAL(p99, p50);
+    TEST_ASSERT_UINT32_WITHIN(8, 20, p50);
+    TEST_ASSERT_UINT32_WITHIN(8, 44, p99);
+    TEST_ASSERT_EQUAL((int32_t)p99 + HandsetSync::MARGIN_GUARD_US, sync.getMargin());
+}
+
+void test_missed_packet_forces_resync(void)
+{
+    sync.setPacketInterval(2000);
+    uint32_t now = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        sync.rfPacketSent(now - 300, now);
+        now += 2000;
+    }
+    TEST_ASSERT_FALSE(sync.rfPacketSent(now - 2300, now));
+    TEST_ASSERT_EQUAL(1, sync.getResyncCount());
+    TEST_ASSERT_EQUAL(-300, sync.getPhase());
+    TEST_ASSERT_TRUE(sync.getOffset() < 0);
+
+    // The next good packet relocks directly onto the measured phase
+    now += 2000;
+    TEST_ASSERT_TRUE(sync.rfPacketSent(now - 700, now));
+    TEST_ASSERT_EQUAL(700, sync.getPhase());
+}
+
+void test_handset_period(void)
+{
+    sync.setPacketInterval(4000);
+    TEST_ASSERT_EQUAL(0, sync.getHandsetPeriod());
+    uint32_t now = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        sync.handsetPacketReceived(now);
+        now += 4020;
+    }
+    TEST_ASSERT_INT_WITHIN(1, 4020, sync.getHandsetPeriod());
+
+    // a gap in the stream does not disturb the estimate
+    now += 50000;
+    sync.handsetPacketReceived(now);
+    TEST_ASSERT_INT_WITHIN(1, 4020, sync.getHandsetPeriod());
+}
+
+/**
+ * Closed loop simulation of a handset which adjusts its mixer period from the sync offset,
+ * shifting its phase by the advertised offset spread over a few frames after each sync packet.
+ * The handset clock runs clockErrorPpm fast or slow relative to the TX module.
+ * Returns the mean age of the channel data at the time each RF packet is sent.
+ */
+static int32_t simulateClosedLoop(int32_t interval, int32_t clockErrorPpm, int32_t jitterUs, uint32_t *misses)
+{
+    sync.setPacketInterval(interval);
+    rngState = 12345;
+
+    const int syncEvery = 200000 / interval; // 200ms sync packet interval
+    const int correctionFrames = 8;
+    const int64_t handsetPeriodNs = (int64_t)interval * (1000000 + clockErrorPpm) / 1000;
+
+    uint32_t rfTime = 1000000;
+    int64_t handsetTimeNs = ((int64_t)rfTime - interval / 2) * 1000;
+    uint32_t lastRecv = 0;
+    int32_t correction = 0;
+    int correctionLeft = 0;
+    int64_t ageSum = 0;
+    int ageCount = 0;
+    *misses = 0;
+
+    const int frames = 20000;
+    for (int f = 0; f < frames; f++)
+    {
+        // deliver all handset packets that arrive before this RF packet
+        while (handsetTimeNs <= (int64_t)rfTime * 1000)
+        {
+            lastRecv = (uint32_t)(handsetTimeNs / 1000) + jitter(jitterUs);
+            sync.handsetPacketReceived(lastRecv);
+            handsetTimeNs += handsetPeriodNs + (correctionLeft-- > 0 ? correction * 1000 : 0);
+        }
+
+        if (!sync.rfPacketSent(lastRecv, rfTime))
+            ++*misses;
+        else if (f > frames / 2)
+        {
+            ageSum += rfTime - lastRecv;
+            ++ageCount;
+        }
+
+        if (f % syncEvery == 0)
+        {
+            correction = sync.getOffset() / 10 / correctionFrames;
+            correctionLeft = correctionFrames;
+        }
+        rfTime += interval;
+    }
+    return (int32_t)(ageSum / ageCount);
+}
+
+void test_closed_loop_reduces_data_age(void)
+{
+    uint32_t misses;
+    // 500Hz with a clean UART and a 20ppm clock error
+    int32_t age = simulateClosedLoop(2000, 20, 3, &misses);
+    TEST_ASSERT_LESS_THAN(HandsetSync::DEFAULT_MARGIN_US, age);
+    TEST_ASSERT_GREATER_OR_EQUAL(HandsetSync::MIN_MARGIN_US / 2, age);
+    TEST_ASSERT_LESS_OR_EQUAL(2, misses);
+}
+
+void test_closed_loop_backs_off_with_jitter(void)
+{
+    uint32_t misses;
+    // 250Hz with a noisy handset, the margin must grow so that frames are not missed
+    int32_t age = simulateClosedLoop(4000, -30, 60, &misses);
+    TEST_ASSERT_GREATER_THAN(60, age);
+    TEST_ASSERT_LESS_OR_EQUAL(2, misses);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_phase_converges);
+    RUN_TEST(test_default_margin_until_enough_samples);
+    RUN_TEST(test_drift_is_tracked);
+    RUN_TEST(test_jitter_percentiles);
+    RUN_TEST(test_missed_packet_forces_resync);
+    RUN_TEST(test_handset_period);
+    RUN_TEST(test_closed_loop_reduces_data_age);
+    RUN_TEST(test_closed_loop_backs_off_with_jitter);
+    UNITY_END();
+
+    return 0;
+}
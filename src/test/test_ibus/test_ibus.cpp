@@ -0,0 +1,194 @@
+#include <cstdint>
+#include <vector>
+#include <unity.h>
+#include "common.h"
+#include "CRSF.h"
+#include "ChannelEncoder.h"
+#include "IBusSensors.h"
+
+using namespace std;
+
+// A sensor emulated by the FC, answering the receiver's commands
+typedef struct {
+    uint8_t type;
+    uint8_t size;
+    int32_t value;
+} fakeSensor_t;
+
+static fakeSensor_t fakeSensors[IBUS_MAX_ADDRESS + 1];
+
+static vector<uint8_t> withChecksum(vector<uint8_t> frame)
+{
+    const uint16_t checksum = ibusChecksum(frame.data(), frame.size());
+    frame.push_back(checksum);
+    frame.push_back(checksum >> 8);
+    return frame;
+}
+
+static vector<uint8_t> respond(const uint8_t *cmd)
+{
+    const uint8_t address = cmd[1] & 0x0F;
+    const fakeSensor_t &sensor = fakeSensors[address];
+    if (sensor.type == IBUS_SENSOR_TYPE_NONE)
+        return vector<uint8_t>();
+
+    switch (cmd[1] & 0xF0)
+    {
+    case IBUS_CMD_DISCOVER:
+        return withChecksum({4, cmd[1]});
+    case IBUS_CMD_TYPE:
+        return withChecksum({6, cmd[1], sensor.type, sensor.size});
+    default:
+    {
+        vector<uint8_t> frame = {(uint8_t)(4 + sensor.size), cmd[1]};
+        for (uint8_t i = 0; i < sensor.size; i++)
+            frame.push_back(sensor.value >> (i * 8));
+        return withChecksum(frame);
+    }
+    }
+}
+
+static uint16_t getBE16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t getBE32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+void test_ibus_servo_frame(void)
+{
+    uint32_t channelData[CRSF_NUM_CHANNELS];
+    for (int i = 0; i < CRSF_NUM_CHANNELS; i++)
+        channelData[i] = CRSF_CHANNEL_VALUE_MID;
+    channelData[0] = CRSF_CHANNEL_VALUE_MIN;
+    channelData[13] = CRSF_CHANNEL_VALUE_MAX;
+    channelData[14] = CRSF_CHANNEL_VALUE_MIN;   // beyond the 14 IBUS channels
+
+    RCFrameEncoder encoder(rcEncoderIBUS);
+    uint8_t frame[IBUS_SERVO_FRAME_LEN];
+    TEST_ASSERT_EQUAL(IBUS_SERVO_FRAME_LEN, encoder.getFrameLen());
+    TEST_ASSERT_EQUAL(IBUS_SERVO_FRAME_LEN, encoder.encode(channelData, frame));
+
+    TEST_ASSERT_EQUAL_HEX8(0x20, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x40, frame[1]);
+    TEST_ASSERT_EQUAL(988, frame[2] | (frame[3] << 8));
+    TEST_ASSERT_EQUAL(1500, frame[4] | (frame[5] << 8));
+    TEST_ASSERT_EQUAL(2012, frame[28] | (frame[29] << 8));
+    TEST_ASSERT_EQUAL_HEX16(ibusChecksum(frame, 30), frame[30] | (frame[31] << 8));
+}
+
+void test_ibus_discovery_and_polling(void)
+{
+    memset(fakeSensors, 0, sizeof(fakeSensors));
+    fakeSensors[1] = {IBUS_SENSOR_TYPE_EXTERNAL_VOLTAGE, 2, 1260};    // 12.60V
+    fakeSensors[2] = {IBUS_SENSOR_TYPE_GPS_LAT, 4, -337225000};
+
+    SensorTelemetry tlm;
+    IBusSensorMaster master(tlm);
+    uint8_t cmd[IBUS_CMD_LEN];
+
+    // The first command discovers the first address
+    TEST_ASSERT_EQUAL(IBUS_CMD_LEN, master.nextCommand(cmd));
+    TEST_ASSERT_EQUAL_HEX8(IBUS_CMD_LEN, cmd[0]);
+    TEST_ASSERT_EQUAL_HEX8(IBUS_CMD_DISCOVER | 1, cmd[1]);
+    TEST_ASSERT_EQUAL_HEX16(ibusChecksum(cmd, 2), cmd[2] | (cmd[3] << 8));
+    vector<uint8_t> reply = respond(cmd);
+    master.processBytes(reply.data(), reply.size());
+
+    // Run through discovery, after which only the sensors found are polled
+    for (int i = 0; i < IBUS_DISCOVERY_PASSES * IBUS_MAX_ADDRESS; i++)
+    {
+        TEST_ASSERT_EQUAL(IBUS_CMD_LEN, master.nextCommand(cmd));
+        reply = respond(cmd);
+        master.processBytes(reply.data(), reply.size());
+    }
+    TEST_ASSERT_EQUAL(IBUS_SENSOR_TYPE_EXTERNAL_VOLTAGE, master.getSensorType(1));
+    TEST_ASSERT_EQUAL(IBUS_SENSOR_TYPE_GPS_LAT, master.getSensorType(2));
+    TEST_ASSERT_EQUAL(IBUS_SENSOR_TYPE_NONE, master.getSensorType(3));
+
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_EQUAL(IBUS_CMD_LEN, master.nextCommand(cmd));
+        TEST_ASSERT_EQUAL_HEX8(IBUS_CMD_MEASURE | (i % 2 + 1), cmd[1]);
+        reply = respond(cmd);
+        master.processBytes(reply.data(), reply.size());
+    }
+    TEST_ASSERT_EQUAL(0, master.getChecksumErrors());
+
+    TEST_ASSERT_TRUE(tlm.hasSensor(SENSOR_TLM_BATTERY));
+    TEST_ASSERT_TRUE(tlm.hasSensor(SENSOR_TLM_GPS));
+    TEST_ASSERT_FALSE(tlm.hasSensor(SENSOR_TLM_BARO));
+
+    const uint8_t *frame = tlm.nextFrame(1000);
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_BATTERY_SENSOR, frame[2]);
+    TEST_ASSERT_EQUAL(126, getBE16(&frame[3]));
+    frame = tlm.nextFrame(1000);
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_GPS, frame[2]);
+    TEST_ASSERT_EQUAL_INT32(-337225000, (int32_t)getBE32(&frame[3]));
+    TEST_ASSERT_NULL(tlm.nextFrame(1000));
+}
+
+void test_ibus_bad_response(void)
+{
+    SensorTelemetry tlm;
+    IBusSensorMaster master(tlm);
+
+    // Garbage before a discovery reply with a broken checksum, then a good reply
+    vector<uint8_t> reply = withChecksum({4, IBUS_CMD_DISCOVER | 3});
+    reply[2] ^= 0x01;
+    reply.insert(reply.begin(), {0x00, 0xFF, 0x02});
+    master.processBytes(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(1, master.getChecksumErrors());
+    TEST_ASSERT_EQUAL(0, master.getResponses());
+
+    reply = withChecksum({6, IBUS_CMD_TYPE | 3, IBUS_SENSOR_TYPE_FUEL, 2});
+    master.processBytes(reply.data(), reply.size());
+    TEST_ASSERT_EQUAL(1, master.getResponses());
+    TEST_ASSERT_EQUAL(IBUS_SENSOR_TYPE_FUEL, master.getSensorType(3));
+}
+
+void test_sensor_telemetry_rate(void)
+{
+    SensorTelemetry tlm;
+    TEST_ASSERT_NULL(tlm.nextFrame(0));
+
+    // Sent as soon as it is seen
+    tlm.setAltitude(12345);
+    tlm.setVerticalSpeed(-150);
+    const uint8_t *frame = tlm.nextFrame(0);
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_EQUAL_HEX8(CRSF_FRAMETYPE_BARO_ALTITUDE, frame[2]);
+    TEST_ASSERT_EQUAL(10000 + 1234, getBE16(&frame[3]));
+    TEST_ASSERT_EQUAL_INT16(-150, (int16_t)getBE16(&frame[5]));
+    TEST_ASSERT_EQUAL_HEX8(crsf_crc.calc(&frame[2], frame[1] - 1), frame[frame[1] + 1]);
+
+    // Changes are held back until the minimum interval
+    tlm.setAltitude(12400);
+    TEST_ASSERT_NULL(tlm.nextFrame(SENSOR_TLM_MIN_INTERVAL_MS - 1));
+    TEST_ASSERT_NOT_NULL(tlm.nextFrame(SENSOR_TLM_MIN_INTERVAL_MS));
+
+    // Unchanged values only go out as a keepalive
+    tlm.setAltitude(12400);
+    TEST_ASSERT_NULL(tlm.nextFrame(2 * SENSOR_TLM_MIN_INTERVAL_MS));
+    TEST_ASSERT_NULL(tlm.nextFrame(SENSOR_TLM_MIN_INTERVAL_MS + SENSOR_TLM_KEEPALIVE_MS - 1));
+    TEST_ASSERT_NOT_NULL(tlm.nextFrame(SENSOR_TLM_MIN_INTERVAL_MS + SENSOR_TLM_KEEPALIVE_MS));
+
+    // Too high for decimeters, sent in meters with the high bit set
+    tlm.setAltitude(400000);
+    frame = tlm.nextFrame(20000);
+    TEST_ASSERT_EQUAL_HEX16(0x8000 | 4000, getBE16(&frame[3]));
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ibus_servo_frame);
+    RUN_TEST(test_ibus_discovery_and_polling);
+    RUN_TEST(test_ibus_bad_response);
+    RUN_TEST(test_sensor_telemetry_rate);
+    UNITY_END();
+
+    return 0;
+}
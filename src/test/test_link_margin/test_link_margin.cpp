@@ -0,0 +1,136 @@
+#include <cstdint>
+#include <LinkMargin.h>
+#include <unity.h>
+
+#define MIN_POWER 0
+#define MAX_POWER 6
+#define WINDOW (6 * LinkMargin::FRAC)
+
+static LinkMargin model;
+static uint8_t power;
+
+// Replays a trace of path losses, one per telemetry update, as the receiver would report
+// them back. The margin measured is what the transmitted power leaves over the loss, less
+// the raise threshold (sensitivity + 15). Returns the number of power changes.
+static uint8_t replay(const int16_t *loss, uint8_t count, int16_t *minMargin = nullptr)
+{
+    uint8_t changes = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int16_t margin = LinkMargin::levelDbm(power) - loss[i];
+        if (minMargin && margin < *minMargin)
+            *minMargin = margin;
+        model.add(margin * LinkMargin::FRAC, power);
+        uint8_t next = model.choose(power, MIN_POWER, MAX_POWER, WINDOW, true);
+        if (next != power)
+            ++changes;
+        power = next;
+    }
+    return changes;
+}
+
+static void reset(uint8_t startPower)
+{
+    model.reset();
+    power = startPower;
+}
+
+void test_margin_normalized_across_power(void)
+{
+    reset(0);
+    // 10dB over the threshold at 100mW is 3dB at 25mW
+    model.add(10 * LinkMargin::FRAC, 3);
+    TEST_ASSERT_EQUAL(10 * LinkMargin::FRAC, model.marginAt(3));
+    TEST_ASSERT_EQUAL(4 * LinkMargin::FRAC, model.marginAt(1));
+    TEST_ASSERT_EQUAL(model.marginAt(3), model.predictedAt(3));
+}
+
+void test_margin_strong_link_settles_low(void)
+{
+    // Close in at 1W, drops straight to the lowest power which keeps half the window,
+    // then holds it without hunting
+    static const int16_t loss[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    reset(6);
+    replay(loss, 3);
+    TEST_ASSERT_EQUAL(0, power);
+    TEST_ASSERT_EQUAL(0, replay(loss, sizeof(loss) / sizeof(loss[0])));
+}
+
+void test_margin_not_lowered_before_warmup(void)
+{
+    static const int16_t loss[] = {0, 0};
+    reset(6);
+    replay(loss, 2);
+    TEST_ASSERT_EQUAL(6, power);
+}
+
+void test_margin_lowered_only_past_window(void)
+{
+    // 100mW with 5dB margin is inside the window, so nothing changes in either direction
+    static const int16_t loss[] = {15, 15, 15, 15, 15, 15, 15, 15};
+    reset(3);
+    TEST_ASSERT_EQUAL(0, replay(loss, sizeof(loss) / sizeof(loss[0])));
+    TEST_ASSERT_EQUAL(3, power);
+}
+
+void test_margin_sudden_loss_jumps(void)
+{
+    // Losing line of sight costs 14dB in one update. It goes straight up from 25mW in
+    // one update rather than climbing a level per update.
+    static const int16_t loss[] = {9, 9, 9, 9, 9, 9, 23};
+    reset(1);
+    replay(loss, 6);
+    TEST_ASSERT_EQUAL(1, power);
+    TEST_ASSERT_EQUAL(1, replay(&loss[6], 1));
+    TEST_ASSERT_GREATER_OR_EQUAL(4, power);
+
+    // Then comes back down once the fade has stopped, to where the margin is inside the window
+    int16_t steady[20];
+    for (uint8_t i = 0; i < 20; i++)
+        steady[i] = 23;
+    replay(steady, 20);
+    TEST_ASSERT_EQUAL(5, power);
+}
+
+void test_margin_fade_predicted(void)
+{
+    // Flying away, the loss grows 1dB per update. The trend raises the power before the
+    // margin runs out, so it never goes below the threshold.
+    int16_t loss[30];
+    for (uint8_t i = 0; i < 30; i++)
+        loss[i] = (i < 10) ? 5 : 5 + (i - 10);
+    reset(0);
+    int16_t minMargin = 100;
+    replay(loss, sizeof(loss) / sizeof(loss[0]), &minMargin);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, minMargin);
+    TEST_ASSERT_EQUAL(MAX_POWER, power);
+}
+
+void test_margin_lower_is_at_least_one_level(void)
+{
+    // A saturated SNR only reports the window, lowering still steps down one level
+    reset(4);
+    for (uint8_t i = 0; i < LinkMargin::WARMUP; i++)
+        model.add(WINDOW, power);
+    TEST_ASSERT_EQUAL(3, model.choose(power, MIN_POWER, MAX_POWER, WINDOW, true));
+    TEST_ASSERT_EQUAL(4, model.choose(power, MIN_POWER, MAX_POWER, WINDOW, false));
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_margin_normalized_across_power);
+    RUN_TEST(test_margin_strong_link_settles_low);
+    RUN_TEST(test_margin_not_lowered_before_warmup);
+    RUN_TEST(test_margin_lowered_only_past_window);
+    RUN_TEST(test_margin_sudden_loss_jumps);
+    RUN_TEST(test_margin_fade_predicted);
+    RUN_TEST(test_margin_lower_is_at_least_one_level);
+    UNITY_END();
+
+    return 0;
+}
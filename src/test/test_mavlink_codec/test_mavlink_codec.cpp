@@ -0,0 +1,374 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <unity.h>
+#include "MAVLinkCodec.h"
+
+using namespace std;
+
+#define CHUNK_SIZE 62
+
+static const mavlink_scanner_msg_info_t known[] = {
+    {0, 50, 9},     // HEARTBEAT
+    {1, 124, 43},   // SYS_STATUS
+    {22, 220, 25},  // PARAM_VALUE
+    {24, 24, 52},   // GPS_RAW_INT
+    {30, 39, 28},   // ATTITUDE
+    {33, 104, 28},  // GLOBAL_POSITION_INT
+    {74, 20, 20},   // VFR_HUD
+    {110, 84, 254}, // FILE_TRANSFER_PROTOCOL
+    {147, 154, 54}, // BATTERY_STATUS
+    {253, 83, 54},  // STATUSTEXT
+    {12920, 5, 25}, // POWER_STATUS... any 24 bit id will do
+};
+
+static bool lookup(uint32_t msgid, mavlink_scanner_msg_info_t *info)
+{
+    for (auto &k : known)
+    {
+        if (k.msgid == msgid)
+        {
+            *info = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t crc_x25_bitwise(uint16_t crc, uint8_t data)
+{
+    uint8_t tmp = data ^ (uint8_t)(crc & 0xFF);
+    tmp ^= (tmp << 4);
+    return (crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+static uint32_t rngState;
+static uint32_t rng()
+{
+    rngState = rngState * 1664525 + 1013904223;
+    return rngState >> 8;
+}
+
+static vector<uint8_t> buildFrame(bool v2, uint8_t seq, uint8_t sysid, uint8_t compid, uint32_t msgid, uint8_t crcExtra,
+                                  vector<uint8_t> payload, bool truncate = true, bool sign = false)
+{
+    size_t len = payload.size();
+    if (v2 && truncate)
+        while (len > 1 && payload[len - 1] == 0)
+            --len;
+
+    vector<uint8_t> f;
+    if (v2)
+        f = {0xFD, (uint8_t)len, (uint8_t)(sign ? 1 : 0), 0, seq, sysid, compid,
+             (uint8_t)msgid, (uint8_t)(msgid >> 8), (uint8_t)(msgid >> 16)};
+    else
+        f = {0xFE, (uint8_t)len, seq, sysid, compid, (uint8_t)msgid};
+    f.insert(f.end(), payload.begin(), payload.begin() + len);
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 1; i < f.size(); i++)
+        crc = crc_x25_bitwise(crc, f[i]);
+    crc = crc_x25_bitwise(crc, crcExtra);
+    f.push_back(crc & 0xFF);
+    f.push_back(crc >> 8);
+    if (sign)
+        for (int i = 0; i < 13; i++)
+            f.push_back(rng());
+    return f;
+}
+
+static vector<uint8_t> randomPayload(uint8_t len)
+{
+    vector<uint8_t> p(len);
+    for (auto &b : p)
+        b = rng() & 0xFF;
+    for (size_t i = len - (rng() % (len / 2 + 1)); i < len; i++)
+        p[i] = 0;
+    return p;
+}
+
+/**
+ * The RX end, as in SerialMavlink: scan, hold periodic messages, queue full tokens
+ * and pack them into chunks of whole compacted tokens
+ */
+class Downlink
+{
+public:
+    Downlink() : scanner(lookup, true) {}
+
+    void receive(const vector<uint8_t> &bytes)
+    {
+        scanner.push(bytes.data(), bytes.size());
+        const mavlink_scanned_msg_t *msg;
+        while ((msg = scanner.next()) != nullptr)
+        {
+            if (!latestOnly.hold(msg))
+                queue(msg);
+        }
+    }
+
+    vector<uint8_t> pack()
+    {
+        size_t queued = 0;
+        for (auto &t : tokens)
+            queued += t.size();
+        if (queued < CHUNK_SIZE)
+        {
+            const mavlink_scanned_msg_t *msg;
+            while ((msg = latestOnly.release()) != nullptr)
+                queue(msg);
+        }
+
+        vector<uint8_t> chunk(CHUNK_SIZE);
+        size_t count = 0;
+        encoder.startChunk();
+        while (!tokens.empty() && count + tokens.front().size() <= CHUNK_SIZE)
+        {
+            count += encoder.compact(tokens.front().data(), tokens.front().size(), &chunk[count]);
+            tokens.pop_front();
+        }
+        chunk.resize(count);
+        return chunk;
+    }
+
+    MAVLinkScanner scanner;
+    MAVLinkEncoder encoder;
+    MAVLinkLatestOnly latestOnly;
+    deque<vector<uint8_t>> tokens;
+
+private:
+    void queue(const mavlink_scanned_msg_t *msg)
+    {
+        uint8_t token[CHUNK_SIZE];
+        uint16_t len = MAVLinkEncoder::encode(msg, token, sizeof(token));
+        if (len)
+        {
+            tokens.push_back(vector<uint8_t>(token, token + len));
+            return;
+        }
+        for (uint16_t pos = 0; pos < msg->frameLen; pos += CHUNK_SIZE - 2)
+        {
+            len = MAVLinkEncoder::encodeRaw(&msg->frame[pos], min<uint16_t>(CHUNK_SIZE - 2, msg->frameLen - pos), token);
+            tokens.push_back(vector<uint8_t>(token, token + len));
+        }
+    }
+};
+
+static vector<uint8_t> decodeChunk(MAVLinkDecoder &decoder, const vector<uint8_t> &chunk)
+{
+    vector<uint8_t> out;
+    uint8_t frame[MAVLINK_CODEC_MAX_FRAME_LEN];
+    uint16_t len;
+    decoder.startChunk(chunk.data(), chunk.size());
+    while ((len = decoder.next(frame)) != 0)
+        out.insert(out.end(), frame, frame + len);
+    return out;
+}
+
+void test_codec_round_trip(void)
+{
+    // GIVEN a stream with compressible, unknown, signed, v1 and oversize frames from several sources
+    // THEN the TX rebuilds the identical byte stream from fewer bytes over the air
+    rngState = 5;
+    vector<uint8_t> stream;
+    uint8_t seq[3] = {0, 100, 200};
+    for (int i = 0; i < 3000; i++)
+    {
+        const int source = rng() % 8 == 0 ? 1 + rng() % 2 : 0;
+        const uint8_t compid = source == 0 ? 1 : (source == 1 ? 190 : 154);
+        uint32_t r = rng() % 100;
+        vector<uint8_t> f;
+        if (r < 2)
+            f = buildFrame(true, seq[source]++, 1, compid, 9999, 1, randomPayload(30)); // unknown
+        else if (r < 4)
+            f = buildFrame(true, seq[source]++, 1, compid, 0, 50, randomPayload(9), true, true); // signed
+        else if (r < 6)
+            f = buildFrame(false, seq[source]++, 1, compid, 1, 124, randomPayload(31)); // v1
+        else if (r < 8)
+            f = buildFrame(true, seq[source]++, 1, compid, 110, 84, randomPayload(254)); // FTP
+        else
+        {
+            // anything but the periodic ones which may be dropped
+            const auto &k = known[rng() % 4 < 3 ? (rng() % 4) : 6 + rng() % 5];
+            if (k.msgid == 110)
+                continue;
+            f = buildFrame(rng() % 20 != 0, seq[source]++, 1, compid, k.msgid, k.crcExtra, randomPayload(k.len));
+        }
+        if (rng() % 50 == 0)
+            seq[source] += 3; // loss on the FC UART
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+
+    Downlink rx;
+    MAVLinkDecoder tx(lookup);
+    vector<uint8_t> out;
+    size_t overTheAir = 0;
+    size_t pos = 0;
+    while (pos < stream.size() || !rx.tokens.empty())
+    {
+        if (pos < stream.size())
+        {
+            size_t len = min<size_t>(stream.size() - pos, 1 + rng() % 100);
+            rx.receive(vector<uint8_t>(&stream[pos], &stream[pos] + len));
+            pos += len;
+        }
+        auto chunk = rx.pack();
+        overTheAir += chunk.size() + 2;
+        auto frames = decodeChunk(tx, chunk);
+        out.insert(out.end(), frames.begin(), frames.end());
+    }
+
+    TEST_ASSERT_EQUAL(0, tx.getErrors());
+    TEST_ASSERT_EQUAL(stream.size(), out.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(stream.data(), out.data(), stream.size());
+    // 118019 bytes go over the air as 106524, about 10% less
+    TEST_ASSERT_LESS_THAN(stream.size() * 92 / 100, overTheAir);
+    cout << "Sent " << stream.size() << " bytes of MAVLink as " << overTheAir << " bytes" << endl;
+}
+
+void test_codec_strips_trailing_zeros(void)
+{
+    // GIVEN a v2 sender that doesn't truncate its payloads
+    // THEN the TX rebuilds a valid truncated frame
+    rngState = 9;
+    auto payload = randomPayload(25);
+    payload[16] |= 1;
+    memset(&payload[17], 0, 8);
+    auto full = buildFrame(true, 7, 1, 1, 22, 220, payload, false);
+    auto truncated = buildFrame(true, 7, 1, 1, 22, 220, payload, true);
+    TEST_ASSERT_EQUAL(full.size() - 8, truncated.size());
+
+    Downlink rx;
+    MAVLinkDecoder tx(lookup);
+    rx.receive(full);
+    auto chunk = rx.pack();
+    TEST_ASSERT_EQUAL(1 + 2 + 1 + 1 + 1 + 17, chunk.size());
+    auto out = decodeChunk(tx, chunk);
+    TEST_ASSERT_EQUAL(truncated.size(), out.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(truncated.data(), out.data(), truncated.size());
+}
+
+void test_codec_header_prediction(void)
+{
+    // GIVEN consecutive frames from the same source in one chunk
+    // THEN only the first carries the sysid/compid and seq
+    rngState = 4;
+    Downlink rx;
+    MAVLinkDecoder tx(lookup);
+    vector<uint8_t> stream;
+    for (uint8_t s = 1; s < 4; s++)
+    {
+        auto f = buildFrame(true, s, 1, 1, 0, 50, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    rx.receive(stream);
+    auto chunk = rx.pack();
+    // flags sysid compid seq msgid len payload, then flags msgid len payload
+    TEST_ASSERT_EQUAL((6 + 9) + 2 * (3 + 9), chunk.size());
+    TEST_ASSERT_EQUAL(MAVLINK_TOKEN_COMPRESSED | MAVLINK_TOKEN_MSGID_8BIT | MAVLINK_TOKEN_SAME_SOURCE | MAVLINK_TOKEN_SEQ_PREDICTED, chunk[15]);
+    auto out = decodeChunk(tx, chunk);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(stream.data(), out.data(), stream.size());
+
+    // Every chunk stands alone, the first frame carries its source and seq again
+    auto f = buildFrame(true, 4, 1, 1, 0, 50, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+    rx.receive(f);
+    chunk = rx.pack();
+    TEST_ASSERT_EQUAL(6 + 9, chunk.size());
+    out = decodeChunk(tx, chunk);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(f.data(), out.data(), f.size());
+}
+
+void test_codec_lost_chunk(void)
+{
+    // GIVEN a chunk that never reaches the TX
+    // THEN the frames in the next chunk are rebuilt with their own seq
+    rngState = 6;
+    Downlink rx;
+    MAVLinkDecoder tx(lookup);
+    rx.receive(buildFrame(true, 10, 1, 1, 0, 50, randomPayload(9)));
+    decodeChunk(tx, rx.pack());
+    rx.receive(buildFrame(true, 11, 1, 1, 0, 50, randomPayload(9)));
+    rx.pack();
+
+    vector<uint8_t> stream;
+    for (uint8_t s = 12; s < 14; s++)
+    {
+        auto f = buildFrame(true, s, 1, 1, 0, 50, randomPayload(9));
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    rx.receive(stream);
+    auto out = decodeChunk(tx, rx.pack());
+    TEST_ASSERT_EQUAL(0, tx.getErrors());
+    TEST_ASSERT_EQUAL(stream.size(), out.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(stream.data(), out.data(), stream.size());
+}
+
+void test_codec_latest_only(void)
+{
+    // GIVEN attitude messages arriving faster than the link can send them
+    // THEN only the latest is sent, after the backlog
+    rngState = 2;
+    Downlink rx;
+    MAVLinkDecoder tx(lookup);
+    vector<uint8_t> last;
+    vector<uint8_t> param = buildFrame(true, 0, 1, 1, 22, 220, randomPayload(25));
+    rx.receive(param);
+    for (uint8_t s = 1; s <= 5; s++)
+    {
+        last = buildFrame(true, s, 1, 1, 30, 39, randomPayload(28));
+        rx.receive(last);
+    }
+    TEST_ASSERT_EQUAL(4, rx.latestOnly.getDropped());
+
+    vector<uint8_t> out;
+    for (int i = 0; i < 3; i++)
+    {
+        auto frames = decodeChunk(tx, rx.pack());
+        out.insert(out.end(), frames.begin(), frames.end());
+    }
+    vector<uint8_t> expected(param);
+    expected.insert(expected.end(), last.begin(), last.end());
+    TEST_ASSERT_EQUAL(expected.size(), out.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), out.data(), expected.size());
+}
+
+void test_codec_bad_chunk(void)
+{
+    // GIVEN a corrupt chunk
+    // THEN it is dropped and the next chunk decodes
+    rngState = 8;
+    MAVLinkDecoder tx(lookup);
+    vector<uint8_t> bad = {MAVLINK_TOKEN_COMPRESSED | MAVLINK_TOKEN_SAME_SOURCE | MAVLINK_TOKEN_MSGID_8BIT, 0, 1, 0};
+    TEST_ASSERT_EQUAL(0, decodeChunk(tx, bad).size());
+    bad = {MAVLINK_TOKEN_RAW, 10, 1, 2};
+    TEST_ASSERT_EQUAL(0, decodeChunk(tx, bad).size());
+    TEST_ASSERT_EQUAL(2, tx.getErrors());
+
+    Downlink rx;
+    auto f = buildFrame(true, 0, 1, 1, 33, 104, randomPayload(28));
+    rx.receive(f);
+    rx.receive(buildFrame(true, 1, 1, 1, 0, 50, randomPayload(9)));
+    auto chunk = rx.pack();
+    auto out = decodeChunk(tx, chunk);
+    TEST_ASSERT_GREATER_THAN(0, out.size());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_codec_round_trip);
+    RUN_TEST(test_codec_strips_trailing_zeros);
+    RUN_TEST(test_codec_header_prediction);
+    RUN_TEST(test_codec_lost_chunk);
+    RUN_TEST(test_codec_latest_only);
+    RUN_TEST(test_codec_bad_chunk);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <unity.h>
+#include "MAVLinkFlowControl.h"
+#include "MAVLinkScanner.h"
+
+using namespace std;
+
+// Captures what is written to the FC
+class MockStream : public Stream
+{
+public:
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush() {}
+    size_t write(uint8_t c) { data.push_back(c); return 1; }
+    size_t write(const uint8_t *s, size_t l) { data.insert(data.end(), s, s + l); return l; }
+
+    vector<uint8_t> data;
+};
+
+static const mavlink_scanner_msg_info_t radioStatus[] = {{109, 185, 9}};
+
+// Returns the txbuf of the last RADIO_STATUS written, or -1 if there wasn't one
+static int lastTxBuf(MAVLinkScanner &scanner, MockStream &out)
+{
+    int txbuf = -1;
+    scanner.push(out.data.data(), out.data.size());
+    out.data.clear();
+    const mavlink_scanned_msg_t *msg;
+    while ((msg = scanner.next()) != nullptr)
+    {
+        TEST_ASSERT_EQUAL(255, msg->sysid);
+        txbuf = msg->payload[6];
+    }
+    TEST_ASSERT_EQUAL(0, scanner.getCrcErrors());
+    return txbuf;
+}
+
+void test_flow_budget(void)
+{
+    MAVLinkFlowControl flow(1024, 255, 0);
+
+    // 250Hz 1:8 std packets, 5 bytes per call, 64 byte packages take 13 packets + 1 for the confirm
+    flow.setLinkRate(250, 8, 3, 5, 64);
+    TEST_ASSERT_EQUAL(250 * 3 * 64 / 8 / 4 / 14, flow.getBudget());
+    TEST_ASSERT_EQUAL(MAVLINK_FLOW_MIN_WINDOW, flow.getWindow());
+
+    // 1000Hz 1:2 full res, the window is limited by the buffer
+    flow.setLinkRate(1000, 2, 255, 10, 64);
+    TEST_ASSERT_EQUAL(1000 * 255 * 64 / 2 / 256 / 8, flow.getBudget());
+    TEST_ASSERT_EQUAL(1024, flow.getWindow());
+
+    // No telemetry
+    flow.setLinkRate(500, 1, 1, 5, 64);
+    TEST_ASSERT_EQUAL(0, flow.getBudget());
+    TEST_ASSERT_EQUAL(0, flow.getTxBuf(MAVLINK_FLOW_MIN_WINDOW, 0));
+}
+
+void test_flow_token_bucket(void)
+{
+    // GIVEN a link that carries 437 bytes/s, so the window is one second
+    MAVLinkFlowControl flow(1024, 255, 0);
+    flow.setLinkRate(500, 8, 7, 10, 64);
+    const uint32_t budget = flow.getBudget();
+    TEST_ASSERT_EQUAL(437, budget);
+    TEST_ASSERT_EQUAL(budget, flow.getWindow());
+
+    // THEN sending at the budget leaves the bucket empty
+    uint32_t now = 1000;
+    for (int i = 0; i < 100; i++)
+    {
+        flow.received(budget / 100, now);
+        now += 10;
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(95, flow.getTxBuf(0, now));
+
+    // and sending at twice the budget fills it, even though nothing is queued yet
+    for (uint32_t i = 0; i < 50; i++)
+    {
+        flow.received((i + 1) * budget / 50 - i * budget / 50, now);
+        now += 10;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(55, flow.getTxBuf(0, now));
+    TEST_ASSERT_GREATER_OR_EQUAL(45, flow.getTxBuf(0, now));
+
+    // The real queue is used when it is fuller than the bucket
+    TEST_ASSERT_EQUAL(0, flow.getTxBuf(flow.getWindow(), now));
+
+    // and the bucket drains at the budget rate
+    now += 600;
+    TEST_ASSERT_GREATER_OR_EQUAL(99, flow.getTxBuf(0, now));
+}
+
+void test_flow_status_interval(void)
+{
+    MockStream out;
+    MAVLinkScanner scanner(radioStatus, 1);
+    MAVLinkFlowControl flow(1024, 255, 0);
+    flow.setLinkRate(500, 4, 63, 5, 64);
+    const mavlink_flow_link_status_t link = {200, 80, 10};
+
+    // Room in the window, at the slow rate
+    uint32_t sent = 0;
+    for (uint32_t now = 1000; now < 2000; now++)
+    {
+        if (flow.update(&out, 0, link, now))
+        {
+            ++sent;
+            TEST_ASSERT_EQUAL(100, lastTxBuf(scanner, out));
+        }
+    }
+    TEST_ASSERT_EQUAL(1000 / MAVLINK_FLOW_STATUS_INTERVAL_MS, sent);
+
+    // Nearly full, at the fast rate
+    sent = 0;
+    for (uint32_t now = 2000; now < 3000; now++)
+    {
+        if (flow.update(&out, flow.getWindow() * 19 / 20, link, now))
+        {
+            ++sent;
+            TEST_ASSERT_LESS_THAN(MAVLINK_FLOW_URGENT_TXBUF, lastTxBuf(scanner, out));
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 1000 / MAVLINK_FLOW_URGENT_INTERVAL_MS, sent);
+}
+
+/**
+ * An autopilot which backs off its stream rate on RADIO_STATUS the way ArduPilot does,
+ * sending to an RX whose FIFO is drained a package at a time, a little slower than the
+ * estimated budget. Returns the bytes lost because the FIFO was full and the mean
+ * throughput over the last half of the run.
+ */
+static uint32_t simulateAutopilot(uint16_t airRateHz, uint8_t tlmRatio, uint32_t *throughput, uint16_t *maxQueued)
+{
+    const uint16_t bufferSize = 1024;
+    const uint16_t frameLen = 37; // PARAM_VALUE
+    MockStream out;
+    MAVLinkScanner scanner(radioStatus, 1);
+    MAVLinkFlowControl flow(bufferSize, 255, 0);
+    flow.setLinkRate(airRateHz, tlmRatio, 3, 5, 64);
+    const mavlink_flow_link_status_t link = {255, 100, 10};
+    const uint32_t drainRate = flow.getBudget() * 9 / 10;
+
+    uint32_t lost = 0;
+    uint32_t queued = 0;
+    uint32_t drainCredit = 0;
+    uint32_t delivered = 0;
+    uint32_t slowdown = 0;
+    uint32_t nextSend = 0;
+    *maxQueued = 0;
+
+    const uint32_t duration = 60000;
+    for (uint32_t now = 1; now < duration; now++)
+    {
+        // Parameter download, one frame every 2ms plus the slowdown
+        if (now >= nextSend)
+        {
+            flow.received(frameLen, now);
+            if (queued + frameLen <= bufferSize)
+                queued += frameLen;
+            else
+                lost += frameLen;
+            nextSend = now + 2 + slowdown;
+        }
+
+        // The link drains the FIFO one package at a time
+        drainCredit += drainRate;
+        uint32_t drained = 0;
+        if (drainCredit >= 62 * 1000)
+        {
+            drained = std::min<uint32_t>(queued, 62);
+            queued -= drained;
+            drainCredit = queued ? drainCredit - 62 * 1000 : 0;
+        }
+        if (now > duration / 2)
+        {
+            delivered += drained;
+            *maxQueued = std::max<uint16_t>(*maxQueued, queued);
+        }
+
+        if (flow.update(&out, queued, link, now))
+        {
+            // GCS_MAVLINK::handle_radio_status()
+            const int txbuf = lastTxBuf(scanner, out);
+            if (txbuf < 20 && slowdown < 2000)
+                slowdown += 60;
+            else if (txbuf < 50 && slowdown < 2000)
+                slowdown += 20;
+            else if (txbuf > 95 && slowdown > 10)
+                slowdown -= 10;
+            else if (txbuf > 90 && slowdown > 0)
+                slowdown -= 5;
+        }
+    }
+    *throughput = delivered * 1000 / (duration / 2);
+    return lost;
+}
+
+void test_flow_autopilot_does_not_overrun(void)
+{
+    const struct {
+        uint16_t hz;
+        uint8_t ratio;
+    } rates[] = {{50, 4}, {250, 8}, {500, 2}, {1000, 16}};
+
+    for (auto &r : rates)
+    {
+        uint32_t throughput;
+        uint16_t maxQueued;
+        MAVLinkFlowControl flow(1024, 255, 0);
+        flow.setLinkRate(r.hz, r.ratio, 3, 5, 64);
+        const uint32_t lost = simulateAutopilot(r.hz, r.ratio, &throughput, &maxQueued);
+        cout << r.hz << "Hz 1:" << (int)r.ratio << " budget " << flow.getBudget() << "B/s throughput " << throughput
+             << "B/s max queued " << maxQueued << " lost " << lost << endl;
+
+        // GIVEN a parameter download far faster than the link
+        // THEN nothing is lost, the link stays busy and the queue is kept within the window
+        TEST_ASSERT_EQUAL(0, lost);
+        TEST_ASSERT_GREATER_OR_EQUAL(flow.getBudget() * 9 / 10 * 3 / 4, throughput);
+        TEST_ASSERT_LESS_OR_EQUAL(flow.getWindow() + 37, maxQueued);
+    }
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flow_budget);
+    RUN_TEST(test_flow_token_bucket);
+    RUN_TEST(test_flow_status_interval);
+    RUN_TEST(test_flow_autopilot_does_not_overrun);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <unity.h>
+#include "MAVLinkScanner.h"
+
+using namespace std;
+
+// msgid, CRC_EXTRA and full payload length of the messages converted to CRSF on the TX
+static const mavlink_scanner_msg_info_t wanted[] = {
+    {0, 50, 9},     // HEARTBEAT
+    {24, 24, 52},   // GPS_RAW_INT
+    {30, 39, 28},   // ATTITUDE
+    {33, 104, 28},  // GLOBAL_POSITION_INT
+    {147, 154, 54}, // BATTERY_STATUS
+};
+
+// Other messages seen in an ArduPilot telemetry stream, with their usual payload lengths
+static const mavlink_scanner_msg_info_t others[] = {
+    {1, 124, 43},   // SYS_STATUS
+    {22, 220, 25},  // PARAM_VALUE
+    {62, 183, 26},  // NAV_CONTROLLER_OUTPUT
+    {74, 20, 20},   // VFR_HUD
+    {111, 34, 16},  // TIMESYNC
+    {125, 203, 6},  // POWER_STATUS
+    {253, 83, 54},  // STATUSTEXT
+};
+
+static uint16_t crc_x25_bitwise(uint16_t crc, uint8_t data)
+{
+    uint8_t tmp = data ^ (uint8_t)(crc & 0xFF);
+    tmp ^= (tmp << 4);
+    return (crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+static uint32_t rngState;
+static uint32_t rng()
+{
+    rngState = rngState * 1664525 + 1013904223;
+    return rngState >> 8;
+}
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t compid;
+    vector<uint8_t> payload; // full length
+} sent_msg_t;
+
+static vector<uint8_t> buildFrame(bool v2, uint8_t seq, uint8_t compid, const mavlink_scanner_msg_info_t &info,
+                                  const vector<uint8_t> &payload, bool sign = false)
+{
+    // MAVLink v2 drops trailing zero bytes from the payload
+    size_t len = payload.size();
+    if (v2)
+        while (len > 1 && payload[len - 1] == 0)
+            --len;
+
+    vector<uint8_t> f;
+    if (v2)
+        f = {0xFD, (uint8_t)len, (uint8_t)(sign ? 1 : 0), 0, seq, 1, compid,
+             (uint8_t)info.msgid, (uint8_t)(info.msgid >> 8), (uint8_t)(info.msgid >> 16)};
+    else
+        f = {0xFE, (uint8_t)len, seq, 1, compid, (uint8_t)info.msgid};
+    f.insert(f.end(), payload.begin(), payload.begin() + len);
+
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 1; i < f.size(); i++)
+        crc = crc_x25_bitwise(crc, f[i]);
+    crc = crc_x25_bitwise(crc, info.crcExtra);
+    f.push_back(crc & 0xFF);
+    f.push_back(crc >> 8);
+    if (sign)
+        for (int i = 0; i < 13; i++)
+            f.push_back(rng());
+    return f;
+}
+
+static vector<uint8_t> randomPayload(uint8_t len)
+{
+    vector<uint8_t> p(len);
+    for (auto &b : p)
+        b = rng() & 0xFF;
+    // Extension fields are often unset and end up truncated
+    for (size_t i = len - (rng() % (len / 2 + 1)); i < len; i++)
+        p[i] = 0;
+    return p;
+}
+
+/**
+ * Builds a stream resembling an ArduPilot telemetry download, the converted messages
+ * interleaved with a larger number of others, some of them v1 or signed
+ */
+static vector<uint8_t> buildCorpus(int frames, vector<sent_msg_t> &expected, uint32_t *otherCount)
+{
+    vector<uint8_t> stream;
+    *otherCount = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        const bool isWanted = rng() % 3 == 0;
+        const auto &info = isWanted ? wanted[rng() % 5] : others[rng() % 7];
+        const uint8_t compid = rng() % 8 == 0 ? 190 : 1; // some from the GCS / companion
+        const bool v2 = rng() % 10 != 0;
+        const bool sign = v2 && rng() % 10 == 0;
+        auto payload = randomPayload(info.len);
+        auto f = buildFrame(v2, i, compid, info, payload, sign);
+        stream.insert(stream.end(), f.begin(), f.end());
+        if (isWanted)
+            expected.push_back({info.msgid, compid, payload});
+        else
+            ++*otherCount;
+    }
+    return stream;
+}
+
+static size_t scanInChunks(MAVLinkScanner &scanner, const vector<uint8_t> &stream, vector<sent_msg_t> *received, size_t maxChunk)
+{
+    size_t msgs = 0;
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        size_t chunk = min<size_t>(stream.size() - pos, 1 + rng() % maxChunk);
+        scanner.push(&stream[pos], chunk);
+        pos += chunk;
+        const mavlink_scanned_msg_t *msg;
+        while ((msg = scanner.next()) != nullptr)
+        {
+            ++msgs;
+            if (received)
+                received->push_back({msg->msgid, msg->compid, vector<uint8_t>(msg->payload, msg->payload + msg->len)});
+        }
+    }
+    return msgs;
+}
+
+void test_crc_x25(void)
+{
+    const uint8_t check[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x6F91, crc_x25_update(0xFFFF, check, 9));
+
+    for (uint32_t crc = 0; crc < 0x10000; crc += 257)
+        for (unsigned b = 0; b < 256; b++)
+        {
+            uint8_t data = b;
+            TEST_ASSERT_EQUAL_HEX16(crc_x25_bitwise(crc, data), crc_x25_update(crc, &data, 1));
+        }
+}
+
+void test_scanner_corpus(void)
+{
+    // GIVEN a recorded style stream split into uneven CRSF sized chunks
+    // THEN every converted message is returned with its full payload and everything else is skipped
+    rngState = 1;
+    vector<sent_msg_t> expected;
+    uint32_t otherCount;
+    auto stream = buildCorpus(2000, expected, &otherCount);
+
+    MAVLinkScanner scanner(wanted, 5);
+    vector<sent_msg_t> received;
+    scanInChunks(scanner, stream, &received, 64);
+    // A skipped frame at the end is held until the next start byte shows its length was right
+    const uint8_t stx = 0xFD;
+    scanner.push(&stx, 1);
+    scanner.next();
+
+    TEST_ASSERT_EQUAL(expected.size(), received.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(expected[i].msgid, received[i].msgid);
+        TEST_ASSERT_EQUAL(expected[i].compid, received[i].compid);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected[i].payload.data(), received[i].payload.data(), expected[i].payload.size());
+    }
+    TEST_ASSERT_EQUAL(otherCount, scanner.getSkippedFrames());
+    TEST_ASSERT_EQUAL(0, scanner.getCrcErrors());
+    TEST_ASSERT_EQUAL(0, scanner.getDroppedBytes());
+}
+
+void test_scanner_resyncs_after_corruption(void)
+{
+    // GIVEN noise, a corrupted frame and a truncated frame among good frames
+    // THEN the good frames are still returned
+    rngState = 7;
+    MAVLinkScanner scanner(wanted, 5);
+    auto att = randomPayload(28);
+    auto good = buildFrame(true, 0, 1, wanted[2], att);
+    auto bad = buildFrame(true, 1, 1, wanted[3], randomPayload(28));
+    bad[12] ^= 0x40;
+
+    vector<uint8_t> stream = {0x00, 0x55, 0xFD, 0x03};
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), bad.begin(), bad.end());
+    stream.insert(stream.end(), good.begin(), good.begin() + 5); // cut off, then a new frame
+    stream.insert(stream.end(), good.begin(), good.end());
+
+    vector<sent_msg_t> received;
+    scanInChunks(scanner, stream, &received, 16);
+    TEST_ASSERT_EQUAL(2, received.size());
+    for (auto &msg : received)
+    {
+        TEST_ASSERT_EQUAL(30, msg.msgid);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(att.data(), msg.payload.data(), 28);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(1, scanner.getCrcErrors());
+}
+
+void test_scanner_unknown_frame_bad_length(void)
+{
+    // GIVEN a frame the scanner doesn't know, with a corrupted length, before good frames
+    // THEN its length is not trusted and the good frames are still returned
+    rngState = 11;
+    MAVLinkScanner scanner(wanted, 5);
+    auto att = randomPayload(28);
+    auto good = buildFrame(true, 0, 1, wanted[2], att);
+    auto other = buildFrame(true, 1, 1, others[0], randomPayload(others[0].len));
+    other[1] += 20;
+
+    vector<uint8_t> stream(other);
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), good.begin(), good.end());
+
+    vector<sent_msg_t> received;
+    scanInChunks(scanner, stream, &received, 16);
+    TEST_ASSERT_EQUAL(2, received.size());
+    TEST_ASSERT_EQUAL(0, scanner.getSkippedFrames());
+}
+
+void test_scanner_v1_and_signed(void)
+{
+    rngState = 3;
+    MAVLinkScanner scanner(wanted, 5);
+    auto hb = randomPayload(9);
+    auto v1 = buildFrame(false, 0, 1, wanted[0], hb);
+    auto signedV2 = buildFrame(true, 1, 1, wanted[0], hb, true);
+    vector<uint8_t> stream(v1);
+    stream.insert(stream.end(), signedV2.begin(), signedV2.end());
+    stream.insert(stream.end(), v1.begin(), v1.end());
+
+    scanner.push(stream.data(), stream.size());
+    for (int i = 0; i < 3; i++)
+    {
+        const mavlink_scanned_msg_t *msg = scanner.next();
+        TEST_ASSERT_NOT_NULL(msg);
+        TEST_ASSERT_EQUAL(0, msg->msgid);
+        TEST_ASSERT_EQUAL(1, msg->sysid);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(hb.data(), msg->payload, 9);
+    }
+    TEST_ASSERT_NULL(scanner.next());
+}
+
+/**
+ * Reference for the benchmark, the per byte approach of mavlink_frame_char where every
+ * byte goes through the state machine and the CRC of every frame is calculated
+ */
+static size_t scanPerByte(const vector<uint8_t> &stream)
+{
+    size_t msgs = 0;
+    enum { IDLE, HEADER, BODY } state = IDLE;
+    uint8_t header[10];
+    size_t idx = 0, need = 0;
+    uint16_t crc = 0;
+    for (uint8_t c : stream)
+    {
+        switch (state)
+        {
+        case IDLE:
+            if (c == 0xFD)
+            {
+                idx = 0;
+                state = HEADER;
+                crc = 0xFFFF;
+            }
+            break;
+        case HEADER:
+            header[idx++] = c;
+            crc = crc_x25_bitwise(crc, c);
+            if (idx == 9)
+            {
+                need = header[0] + 2 + ((header[1] & 1) ? 13 : 0);
+                state = BODY;
+            }
+            break;
+        case BODY:
+            if (need > 15 || (header[1] & 1) == 0)
+                crc = crc_x25_bitwise(crc, c);
+            if (--need == 0)
+            {
+                ++msgs;
+                state = IDLE;
+            }
+            break;
+        }
+    }
+    return msgs;
+}
+
+void test_scanner_benchmark(void)
+{
+    rngState = 11;
+    vector<sent_msg_t> expected;
+    uint32_t otherCount;
+    auto stream = buildCorpus(5000, expected, &otherCount);
+    const int iterations = 20;
+
+    MAVLinkScanner scanner(wanted, 5);
+    size_t msgs = 0;
+    auto start = chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++)
+        msgs += scanInChunks(scanner, stream, nullptr, 64);
+    auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(expected.size() * iterations, msgs);
+
+    start = chrono::steady_clock::now();
+    size_t refMsgs = 0;
+    for (int it = 0; it < iterations; it++)
+        refMsgs += scanPerByte(stream);
+    auto refUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    const uint64_t bytes = (uint64_t)stream.size() * iterations;
+    cout << "Scanned " << bytes << " bytes in " << us << "us, " << (us ? bytes * 1000000 / us : 0) << " bytes/s ("
+         << "per byte reference " << (refUs ? bytes * 1000000 / refUs : 0) << " bytes/s, " << refMsgs << " frames)" << endl;
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_x25);
+    RUN_TEST(test_scanner_corpus);
+    RUN_TEST(test_scanner_resyncs_after_corruption);
+    RUN_TEST(test_scanner_unknown_frame_bad_length);
+    RUN_TEST(test_scanner_v1_and_signed);
+    RUN_TEST(test_scanner_benchmark);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <vector>
+#include <unity.h>
+#include "msp.h"
+#include "MSPParser.h"
+
+extern uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a);
+
+static uint8_t crc8_dvb_s2_bitwise(uint8_t crc, uint8_t a)
+{
+    crc ^= a;
+    for (int ii = 0; ii < 8; ++ii)
+        crc = (crc & 0x80) ? (crc << 1) ^ 0xD5 : crc << 1;
+    return crc;
+}
+
+static std::vector<uint8_t> buildV2(char dir, uint16_t function, uint16_t payloadSize, uint8_t fill = 0)
+{
+    std::vector<uint8_t> f = {'$', 'X', (uint8_t)dir, 0, (uint8_t)function, (uint8_t)(function >> 8),
+                              (uint8_t)payloadSize, (uint8_t)(payloadSize >> 8)};
+    for (uint16_t i = 0; i < payloadSize; i++)
+        f.push_back(fill + i);
+    uint8_t crc = 0;
+    for (size_t i = 3; i < f.size(); i++)
+        crc = crc8_dvb_s2_bitwise(crc, f[i]);
+    f.push_back(crc);
+    return f;
+}
+
+static std::vector<uint8_t> buildV1(uint8_t function, uint16_t payloadSize, bool jumbo)
+{
+    std::vector<uint8_t> f = {'$', 'M', '>'};
+    if (jumbo)
+        f.insert(f.end(), {0xFF, function, (uint8_t)payloadSize, (uint8_t)(payloadSize >> 8)});
+    else
+        f.insert(f.end(), {(uint8_t)payloadSize, function});
+    for (uint16_t i = 0; i < payloadSize; i++)
+        f.push_back(i * 7);
+    uint8_t crc = 0;
+    for (size_t i = 3; i < f.size(); i++)
+        crc ^= f[i];
+    f.push_back(crc);
+    return f;
+}
+
+void test_msp_crc8_table(void)
+{
+    for (unsigned crc = 0; crc < 256; crc++)
+        for (unsigned b = 0; b < 256; b += 17)
+            TEST_ASSERT_EQUAL(crc8_dvb_s2_bitwise(crc, b), crc8_dvb_s2(crc, b));
+
+    const uint8_t data[] = {0x00, 0x64, 0x00, 0x00, 0x00};
+    TEST_ASSERT_EQUAL(0x8f, crc8_dvb_s2_update(0, data, sizeof(data)));
+}
+
+void test_msp_parser_zero_copy(void)
+{
+    // GIVEN a buffer containing garbage and two complete frames
+    // THEN both frames are returned pointing into the source buffer
+    MSPParser<64> parser;
+    auto f1 = buildV2('<', 100, 0);
+    auto f2 = buildV2('>', 0x1234, 20, 0x40);
+    std::vector<uint8_t> buf = {'x', '$', 'M', 'q'};
+    buf.insert(buf.end(), f1.begin(), f1.end());
+    buf.push_back('$');
+    buf.insert(buf.end(), f2.begin(), f2.end());
+
+    size_t pos = parser.parse(buf.data(), buf.size());
+    TEST_ASSERT_TRUE(parser.frameReady());
+    TEST_ASSERT_EQUAL(4 + f1.size(), pos);
+    TEST_ASSERT_TRUE(parser.getFrame() == &buf[4]);
+    TEST_ASSERT_EQUAL(f1.size(), parser.getFrameLen());
+    TEST_ASSERT_EQUAL(100, parser.getFunction());
+    TEST_ASSERT_EQUAL('<', parser.getType());
+    TEST_ASSERT_EQUAL(MSP_PARSER_V2, parser.getVersion());
+    TEST_ASSERT_EQUAL(0, parser.getPayloadSize());
+
+    // No progress until the frame has been consumed
+    TEST_ASSERT_EQUAL(0, parser.parse(&buf[pos], buf.size() - pos));
+    parser.markFrameConsumed();
+
+    pos += parser.parse(&buf[pos], buf.size() - pos);
+    TEST_ASSERT_TRUE(parser.frameReady());
+    TEST_ASSERT_EQUAL(buf.size(), pos);
+    TEST_ASSERT_TRUE(parser.getPayload() == &buf[buf.size() - f2.size() + 8]);
+    TEST_ASSERT_EQUAL(0x1234, parser.getFunction());
+    TEST_ASSERT_EQUAL(20, parser.getPayloadSize());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&f2[8], parser.getPayload(), 20);
+    TEST_ASSERT_EQUAL(0, parser.getCrcErrors());
+}
+
+void test_msp_parser_split_frames(void)
+{
+    // GIVEN a large v2 frame fed in uneven pieces
+    // THEN the frame is assembled in the parser buffer
+    MSPParser<512> parser;
+    auto f = buildV2('>', 0x3003, 300, 3);
+
+    size_t pos = 0;
+    size_t step = 1;
+    while (pos < f.size() && !parser.frameReady())
+    {
+        size_t len = std::min(step, f.size() - pos);
+        pos += parser.parse(&f[pos], len);
+        step = step * 3 + 1;
+    }
+    TEST_ASSERT_TRUE(parser.frameReady());
+    TEST_ASSERT_EQUAL(f.size(), pos);
+    TEST_ASSERT_EQUAL(f.size(), parser.getFrameLen());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(f.data(), parser.getFrame(), f.size());
+    TEST_ASSERT_EQUAL(300, parser.getPayloadSize());
+}
+
+void test_msp_parser_v1_and_jumbo(void)
+{
+    MSPParser<512> parser;
+    auto v1 = buildV1(60, 75, false);
+    auto jumbo = buildV1(116, 285, true);
+    std::vector<uint8_t> buf(v1);
+    buf.insert(buf.end(), jumbo.begin(), jumbo.end());
+
+    size_t pos = parser.parse(buf.data(), buf.size());
+    TEST_ASSERT_TRUE(parser.frameReady());
+    TEST_ASSERT_EQUAL(MSP_PARSER_V1, parser.getVersion());
+    TEST_ASSERT_EQUAL(60, parser.getFunction());
+    TEST_ASSERT_EQUAL(75, parser.getPayloadSize());
+    TEST_ASSERT_EQUAL(v1.size(), parser.getFrameLen());
+    parser.markFrameConsumed();
+
+    pos += parser.parse(&buf[pos], buf.size() - pos);
+    TEST_ASSERT_TRUE(parser.frameReady());
+    TEST_ASSERT_EQUAL(MSP_PARSER_V1_JUMBO, parser.getVersion());
+    TEST_ASSERT_EQUAL(116, parser.getFunction());
+    TEST_ASSERT_EQUAL(285, parser.getPayloadSize());
+    TEST_ASSERT_EQUAL(jumbo[7 + 100], parser.getPayload()[100]);
+    TEST_ASSERT_EQUAL(buf.size(), pos);
+}
+
+void test_msp_parser_oversize_and_crc_error(void)
+{
+    // GIVEN a frame too big for the parser, then a corrupt frame, then a good frame
+    // THEN only the good frame is returned and the others are counted
+    MSPParser<16> parser;
+    auto big = buildV2('>', 1, 40);
+    auto bad = buildV2('>', 2, 4);
+    bad[9] ^= 0x01;
+    auto good = buildV2('>', 3, 16);
+    std::vector<uint8_t> buf(big);
+    buf.insert(buf.end(), bad.begin(), bad.end());
+    buf.insert(buf.end(), good.begin(), good.end());
+
+    // byte at a time, like MSP::processReceivedByte
+    size_t frames = 0;
+    for (size_t i = 0; i < buf.size(); i++)
+    {
+        parser.parse(&buf[i], 1);
+        if (parser.frameReady())
+        {
+            ++frames;
+            TEST_ASSERT_EQUAL(3, parser.getFunction());
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(good.data(), parser.getFrame(), good.size());
+            parser.markFrameConsumed();
+        }
+    }
+    TEST_ASSERT_EQUAL(1, frames);
+    TEST_ASSERT_EQUAL(1, parser.getOversizeFrames());
+    TEST_ASSERT_EQUAL(1, parser.getCrcErrors());
+}
+
+void test_msp_receive_oversize_payload(void)
+{
+    // GIVEN a v2 frame with a payload bigger than mspPacket_t can hold
+    // THEN the MSP class rejects it rather than overflowing and still receives the next frame
+    MSP msp;
+    auto big = buildV2('<', 1, MSP_PORT_INBUF_SIZE + 10);
+    auto good = buildV2('<', 2, 3);
+    for (auto c : big)
+        TEST_ASSERT_FALSE(msp.processReceivedByte(c));
+
+    bool complete = false;
+    for (auto c : good)
+        complete = msp.processReceivedByte(c);
+    TEST_ASSERT_TRUE(complete);
+    TEST_ASSERT_EQUAL(2, msp.getReceivedPacket()->function);
+    TEST_ASSERT_EQUAL(3, msp.getReceivedPacket()->payloadSize);
+    msp.markPacketReceived();
+}
@@ -108,6 +108,13 @@ void test_msp_send(void)
 extern void test_encapsulated_msp_send(void);
 extern void test_encapsulated_msp_send_too_long(void);
 
+extern void test_msp_crc8_table(void);
+extern void test_msp_parser_zero_copy(void);
+extern void test_msp_parser_split_frames(void);
+extern void test_msp_parser_v1_and_jumbo(void);
+extern void test_msp_parser_oversize_and_crc_error(void);
+extern void test_msp_receive_oversize_payload(void);
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -121,6 +128,13 @@ int main(int argc, char **argv)
     RUN_TEST(test_encapsulated_msp_send);
     RUN_TEST(test_encapsulated_msp_send_too_long);
 
+    RUN_TEST(test_msp_crc8_table);
+    RUN_TEST(test_msp_parser_zero_copy);
+    RUN_TEST(test_msp_parser_split_frames);
+    RUN_TEST(test_msp_parser_v1_and_jumbo);
+    RUN_TEST(test_msp_parser_oversize_and_crc_error);
+    RUN_TEST(test_msp_receive_oversize_payload);
+
     UNITY_END();
 
     return 0;
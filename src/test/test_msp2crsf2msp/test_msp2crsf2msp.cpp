@@ -1,5 +1,7 @@
 #include <cstdint>
 #include <iostream>
+#include <vector>
+#include <chrono>
 #include <unity.h>
 #include "common.h"
 #include "msp2crsf.h"
@@ -152,6 +154,160 @@ void MSPV2_SERIAL_SETTINGS_TEST()
     // cout << endl;
 }
 
+// Convert a MSP frame to its CRSF chunks without passing them to crsf2msp
+std::vector<std::vector<uint8_t>> chunkFrame(const uint8_t *frame, int frameLen, uint8_t src, uint8_t dest)
+{
+    std::vector<std::vector<uint8_t>> chunks;
+    msp2crsf.parse(frame, frameLen, src, dest);
+    while (msp2crsf.FIFOout.peek() > 0)
+    {
+        uint8_t sizeOut = msp2crsf.FIFOout.pop();
+        std::vector<uint8_t> chunk(sizeOut);
+        msp2crsf.FIFOout.popBytes(chunk.data(), sizeOut);
+        chunks.push_back(chunk);
+    }
+    return chunks;
+}
+
+bool popFrame(std::vector<uint8_t> &out)
+{
+    if (crsf2msp.FIFOout.peekSize() == 0)
+        return false;
+    out.resize(crsf2msp.FIFOout.popSize());
+    crsf2msp.FIFOout.popBytes(out.data(), out.size());
+    return true;
+}
+
+void MSP_INTERLEAVED_STREAMS_TEST()
+{
+    // GIVEN multi-chunk MSP frames from two different sources
+    // WHEN their CRSF chunks arrive interleaved
+    // THEN both frames are reassembled intact
+    crsf2msp.reset();
+    crsf2msp.FIFOout.flush();
+    auto a = chunkFrame(MSPV1_JUMBO_289, sizeof(MSPV1_JUMBO_289), CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_ADDRESS_RADIO_TRANSMITTER);
+    auto b = chunkFrame(MSP_2CHUNKS_LONG, sizeof(MSP_2CHUNKS_LONG), CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_ADDRESS_CRSF_RECEIVER);
+    TEST_ASSERT_GREATER_THAN(2, a.size());
+    TEST_ASSERT_EQUAL(2, b.size());
+
+    for (size_t i = 0; i < a.size() || i < b.size(); i++)
+    {
+        if (i < a.size())
+            crsf2msp.parse(a[i].data());
+        if (i < b.size())
+            crsf2msp.parse(b[i].data());
+    }
+
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(popFrame(out));
+    TEST_ASSERT_EQUAL(sizeof(MSP_2CHUNKS_LONG), out.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(MSP_2CHUNKS_LONG, out.data(), out.size());
+    TEST_ASSERT_TRUE(popFrame(out));
+    TEST_ASSERT_EQUAL(sizeof(MSPV1_JUMBO_289), out.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(MSPV1_JUMBO_289, out.data(), out.size());
+    TEST_ASSERT_EQUAL(CRSF_ADDRESS_RADIO_TRANSMITTER, crsf2msp.getDest());
+    TEST_ASSERT_FALSE(popFrame(out));
+}
+
+void MSP_INTERLEAVED_STREAM_LOST_CHUNK_TEST()
+{
+    // GIVEN two interleaved streams where one loses a chunk
+    // THEN only the damaged stream is dropped
+    crsf2msp.reset();
+    crsf2msp.FIFOout.flush();
+    auto a = chunkFrame(MSPV1_JUMBO_289, sizeof(MSPV1_JUMBO_289), CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_ADDRESS_RADIO_TRANSMITTER);
+    auto b = chunkFrame(MSPV2_SERIAL_SETTINGS, sizeof(MSPV2_SERIAL_SETTINGS), CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_ADDRESS_CRSF_RECEIVER);
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (i != 1)
+            crsf2msp.parse(a[i].data());
+        if (i < b.size())
+            crsf2msp.parse(b[i].data());
+    }
+
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(popFrame(out));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(MSPV2_SERIAL_SETTINGS, out.data(), sizeof(MSPV2_SERIAL_SETTINGS));
+    TEST_ASSERT_FALSE(popFrame(out));
+}
+
+void MSP_PIPELINED_THROUGHPUT_TEST()
+{
+    // Push a batch of interleaved requests from several streams through the
+    // chunker and reassembler and report the frame rate
+    const int streams = CRSF_MSP_STREAMS;
+    const int iterations = 2000;
+    crsf2msp.reset();
+    crsf2msp.FIFOout.flush();
+
+    std::vector<std::vector<std::vector<uint8_t>>> chunks;
+    for (int s = 0; s < streams; s++)
+        chunks.push_back(chunkFrame(MSP_BOARD_INFO_81, sizeof(MSP_BOARD_INFO_81), CRSF_ADDRESS_FLIGHT_CONTROLLER, 0xC0 + s));
+
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    std::vector<uint8_t> out;
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++)
+    {
+        for (size_t c = 0; c < chunks[0].size(); c++)
+            for (int s = 0; s < streams; s++)
+                crsf2msp.parse(chunks[s][c].data());
+        while (popFrame(out))
+        {
+            ++frames;
+            bytes += out.size();
+        }
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL(streams * iterations, frames);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(MSP_BOARD_INFO_81, out.data(), sizeof(MSP_BOARD_INFO_81));
+    cout << "Reassembled " << dec << frames << " frames from " << streams << " interleaved streams in " << us << "us, "
+         << (us ? (uint64_t)bytes * 1000000 / us : 0) << " bytes/s" << endl;
+}
+
+void MSPV2_MAX_LEN_TEST()
+{
+    // GIVEN the largest MSP v2 frame the MSP2WIFI parser accepts
+    // WHEN it is fragmented into CRSF chunks
+    // THEN the chunks fit the FIFO without it flushing and reassemble intact
+    uint8_t frame[MSP_FRAME_MAX_LEN];
+    const uint16_t payloadLen = MSP_PAYLOAD_MAX_LEN;
+    frame[0] = '$';
+    frame[1] = 'X';
+    frame[2] = '<';
+    frame[3] = 0;
+    frame[4] = 0x10;
+    frame[5] = 0x25;
+    frame[6] = payloadLen & 0xFF;
+    frame[7] = payloadLen >> 8;
+    for (int i = 0; i < payloadLen; i++)
+        frame[8 + i] = i;
+    frame[8 + payloadLen] = crsf_crc.calc(&frame[3], 5 + payloadLen, 0);
+    TEST_ASSERT_EQUAL(MSP_FRAME_MAX_LEN, 9 + payloadLen);
+
+    crsf2msp.reset();
+    crsf2msp.FIFOout.flush();
+    msp2crsf.FIFOout.flush();
+    msp2crsf.parse(frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(CRSF_MSP_FRAGMENTED_LEN(sizeof(frame) - 4), msp2crsf.FIFOout.size());
+
+    while (msp2crsf.FIFOout.peek() > 0)
+    {
+        uint8_t sizeOut = msp2crsf.FIFOout.pop();
+        uint8_t crsfFrame[CRSF_MAX_PACKET_LEN];
+        msp2crsf.FIFOout.popBytes(crsfFrame, sizeOut);
+        crsf2msp.parse(crsfFrame);
+    }
+
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE(popFrame(out));
+    TEST_ASSERT_EQUAL(sizeof(frame), out.size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(frame, out.data(), sizeof(frame));
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -169,6 +325,10 @@ int main(int argc, char **argv)
     RUN_TEST(MSPV1_JUMBO_289_TEST);
     RUN_TEST(MSP_BOARD_INFO_81_TEST);
     RUN_TEST(MSPV2_SERIAL_SETTINGS_TEST);
+    RUN_TEST(MSP_INTERLEAVED_STREAMS_TEST);
+    RUN_TEST(MSP_INTERLEAVED_STREAM_LOST_CHUNK_TEST);
+    RUN_TEST(MSP_PIPELINED_THROUGHPUT_TEST);
+    RUN_TEST(MSPV2_MAX_LEN_TEST);
 
     UNITY_END();
 
@@ -0,0 +1,222 @@
+#include <cstdint>
+#include <vector>
+#include <unity.h>
+#include "common.h"
+#include "msp2crsf.h"
+#include "mspcache.h"
+#include "msptypes.h"
+
+using namespace std;
+
+GENERIC_CRC8 crsf_crc(CRSF_CRC_POLY);
+
+MSP2CROSSFIRE msp2crsf;
+
+// MSP_BOARD_INFO request and 75 byte response, two CRSF chunks
+const uint8_t MSP_BOARD_INFO_REQ[] = {36, 77, 60, 0, 4, 4};
+const uint8_t MSP_BOARD_INFO_RESP[] = {36, 77, 62, 75, 4, 83, 52, 48, 53, 0, 0, 2, 55, 9, 83, 84, 77, 51, 50, 70, 52, 48, 53, 9, 79, 77, 78, 73, 66, 85, 83, 70, 52, 4, 65, 73, 82, 66, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 2, 64, 31, 3, 0, 0, 0, 1, 0, 87};
+// MSPv2 MSP_API_VERSION request and response
+const uint8_t MSP_API_VERSION_REQ[] = {0x24, 0x58, 0x3c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x9f};
+const uint8_t MSP_API_VERSION_RESP[] = {0x24, 0x58, 0x3e, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x01, 0x2e, 0x00};
+// MSP_SET_NAME "x"
+const uint8_t MSP_SET_NAME_REQ[] = {36, 77, 60, 1, 11, 120, 114};
+// MSP_STATUS, read-only but not cached
+const uint8_t MSP_STATUS_REQ[] = {36, 77, 60, 0, 101, 101};
+// MSP_EEPROM_WRITE
+const uint8_t MSP_EEPROM_WRITE_REQ[] = {36, 77, 60, 0, 250, 250};
+
+static vector<vector<uint8_t>> toCrsf(const uint8_t *msp, uint32_t len, uint8_t src, uint8_t dest)
+{
+    vector<vector<uint8_t>> chunks;
+    msp2crsf.parse(msp, len, src, dest);
+    while (msp2crsf.FIFOout.size())
+    {
+        uint8_t chunkLen = msp2crsf.FIFOout.pop();
+        vector<uint8_t> chunk(chunkLen);
+        msp2crsf.FIFOout.popBytes(chunk.data(), chunkLen);
+        chunks.push_back(chunk);
+    }
+    return chunks;
+}
+
+static vector<vector<uint8_t>> request(const uint8_t *msp, uint32_t len)
+{
+    return toCrsf(msp, len, CRSF_ADDRESS_RADIO_TRANSMITTER, CRSF_ADDRESS_FLIGHT_CONTROLLER);
+}
+
+static vector<vector<uint8_t>> response(const uint8_t *msp, uint32_t len)
+{
+    return toCrsf(msp, len, CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_ADDRESS_RADIO_TRANSMITTER);
+}
+
+static void checkReplay(MSPResponseCache &cache, const vector<vector<uint8_t>> &expected)
+{
+    uint8_t *frame;
+    for (const auto &chunk : expected)
+    {
+        TEST_ASSERT_TRUE(cache.getReplayChunk(&frame));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(chunk.data(), frame, chunk.size());
+    }
+    TEST_ASSERT_FALSE(cache.getReplayChunk(&frame));
+}
+
+void test_msp_cache_hit_after_response(void)
+{
+    // GIVEN a board info request answered by the FC in two chunks
+    // THEN the second identical request is answered from the cache with the same chunks
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto resp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    TEST_ASSERT_EQUAL(1, req.size());
+    TEST_ASSERT_EQUAL(2, resp.size());
+
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 1000));
+    for (auto &chunk : resp)
+        cache.handleResponse(chunk.data(), 1010);
+
+    TEST_ASSERT_TRUE(cache.handleRequest(req[0].data(), 2000));
+    checkReplay(cache, resp);
+    TEST_ASSERT_EQUAL(1, cache.getHits());
+    TEST_ASSERT_EQUAL(1, cache.getMisses());
+}
+
+void test_msp_cache_v2_and_ttl(void)
+{
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_API_VERSION_REQ, sizeof(MSP_API_VERSION_REQ));
+    auto resp = response(MSP_API_VERSION_RESP, sizeof(MSP_API_VERSION_RESP));
+
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 1000));
+    cache.handleResponse(resp[0].data(), 1000);
+    TEST_ASSERT_TRUE(cache.handleRequest(req[0].data(), 5999));
+    checkReplay(cache, resp);
+
+    // expired, goes to the FC again
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 6000));
+    uint8_t *frame;
+    TEST_ASSERT_FALSE(cache.getReplayChunk(&frame));
+}
+
+void test_msp_cache_invalidated_by_write(void)
+{
+    // GIVEN a cached response
+    // WHEN a request that is not read-only is forwarded
+    // THEN the cache is emptied
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto resp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    auto set = request(MSP_SET_NAME_REQ, sizeof(MSP_SET_NAME_REQ));
+
+    cache.handleRequest(req[0].data(), 0);
+    for (auto &chunk : resp)
+        cache.handleResponse(chunk.data(), 0);
+
+    TEST_ASSERT_FALSE(cache.handleRequest(set[0].data(), 10));
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 20));
+}
+
+void test_msp_cache_kept_by_reads(void)
+{
+    // GIVEN a cached response
+    // WHEN a read-only request that is not cached is forwarded
+    // THEN the cache is kept, until an EEPROM write
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto resp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    auto status = request(MSP_STATUS_REQ, sizeof(MSP_STATUS_REQ));
+    auto save = request(MSP_EEPROM_WRITE_REQ, sizeof(MSP_EEPROM_WRITE_REQ));
+
+    cache.handleRequest(req[0].data(), 0);
+    for (auto &chunk : resp)
+        cache.handleResponse(chunk.data(), 0);
+
+    TEST_ASSERT_FALSE(cache.handleRequest(status[0].data(), 10));
+    TEST_ASSERT_TRUE(cache.handleRequest(req[0].data(), 20));
+    checkReplay(cache, resp);
+
+    TEST_ASSERT_FALSE(cache.handleRequest(save[0].data(), 30));
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 40));
+}
+
+void test_msp_cache_invalidated_by_msp_write(void)
+{
+    // GIVEN a cached response
+    // WHEN a CRSF MSP_WRITE frame is forwarded
+    // THEN the cache is emptied
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto resp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    auto write = request(MSP_STATUS_REQ, sizeof(MSP_STATUS_REQ));
+    write[0][CRSF_MSP_TYPE_IDX] = CRSF_FRAMETYPE_MSP_WRITE;
+
+    cache.handleRequest(req[0].data(), 0);
+    for (auto &chunk : resp)
+        cache.handleResponse(chunk.data(), 0);
+
+    TEST_ASSERT_FALSE(cache.handleRequest(write[0].data(), 10));
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 20));
+}
+
+void test_msp_cache_incomplete_response_not_cached(void)
+{
+    // GIVEN a response where the second chunk was lost and replaced by a later sequence number
+    // THEN nothing is cached
+    MSPResponseCache cache(5000);
+    auto req = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto resp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    resp[1][CRSF_MSP_STATUS_BYTE_OFFSET] = (resp[1][CRSF_MSP_STATUS_BYTE_OFFSET] & 0xF0) | ((resp[1][CRSF_MSP_STATUS_BYTE_OFFSET] + 1) & 0x0F);
+
+    cache.handleRequest(req[0].data(), 0);
+    for (auto &chunk : resp)
+        cache.handleResponse(chunk.data(), 0);
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 10));
+
+    // Only the first chunk arrives
+    cache.handleResponse(resp[0].data(), 10);
+    TEST_ASSERT_FALSE(cache.handleRequest(req[0].data(), 20));
+}
+
+void test_msp_cache_ignores_other_functions_and_replays(void)
+{
+    // GIVEN a pending board info request
+    // WHEN a response for a different function or a replayed chunk passes through first
+    // THEN the board info response is still captured
+    MSPResponseCache cache(5000);
+    auto boardReq = request(MSP_BOARD_INFO_REQ, sizeof(MSP_BOARD_INFO_REQ));
+    auto boardResp = response(MSP_BOARD_INFO_RESP, sizeof(MSP_BOARD_INFO_RESP));
+    auto apiReq = request(MSP_API_VERSION_REQ, sizeof(MSP_API_VERSION_REQ));
+    auto apiResp = response(MSP_API_VERSION_RESP, sizeof(MSP_API_VERSION_RESP));
+
+    cache.handleRequest(apiReq[0].data(), 0);
+    cache.handleResponse(apiResp[0].data(), 0);
+    cache.handleRequest(boardReq[0].data(), 0);
+    TEST_ASSERT_TRUE(cache.handleRequest(apiReq[0].data(), 0));
+    uint8_t *frame;
+    TEST_ASSERT_TRUE(cache.getReplayChunk(&frame));
+    cache.handleResponse(frame, 0);
+    cache.endReplayChunk();
+
+    for (auto &chunk : boardResp)
+        cache.handleResponse(chunk.data(), 0);
+    TEST_ASSERT_TRUE(cache.handleRequest(boardReq[0].data(), 0));
+    checkReplay(cache, boardResp);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_msp_cache_hit_after_response);
+    RUN_TEST(test_msp_cache_v2_and_ttl);
+    RUN_TEST(test_msp_cache_invalidated_by_write);
+    RUN_TEST(test_msp_cache_kept_by_reads);
+    RUN_TEST(test_msp_cache_invalidated_by_msp_write);
+    RUN_TEST(test_msp_cache_incomplete_response_not_cached);
+    RUN_TEST(test_msp_cache_ignores_other_functions_and_replays);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <crc.h>
+#include <PacketCombiner.h>
+#include <unity.h>
+
+// Like an OTA4 packet: 6 bytes of data then a 14 bit CRC
+#define LEN 8
+#define CRC_POLY 0x2E57
+
+static Crc2Byte crc;
+static uint8_t validated;
+
+static uint16_t packetCrc(const uint8_t *packet)
+{
+    return crc.calc((uint8_t *)packet, LEN - 2, 0);
+}
+
+static bool validate(uint8_t *packet)
+{
+    ++validated;
+    return packetCrc(packet) == ((packet[LEN - 2] << 8) | packet[LEN - 1]);
+}
+
+static uint32_t seed;
+static uint32_t rng()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static void makePacket(uint8_t *packet)
+{
+    for (uint8_t i = 0; i < LEN - 2; i++)
+        packet[i] = rng();
+    uint16_t c = packetCrc(packet);
+    packet[LEN - 2] = c >> 8;
+    packet[LEN - 1] = c;
+}
+
+static void flip(uint8_t *packet, uint8_t bit)
+{
+    packet[bit / 8] ^= 1 << (bit % 8);
+}
+
+void test_combine_different_errors(void)
+{
+    uint8_t good[LEN], a[LEN], b[LEN], out[LEN];
+    seed = 1;
+    crc.init(14, CRC_POLY);
+    makePacket(good);
+
+    // Each copy has a bit wrong the other has right
+    memcpy(a, good, LEN);
+    memcpy(b, good, LEN);
+    flip(a, 3);
+    flip(b, 40);
+    TEST_ASSERT_FALSE(validate(a));
+    TEST_ASSERT_FALSE(validate(b));
+
+    TEST_ASSERT_TRUE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(good, out, LEN);
+    TEST_ASSERT_TRUE(PacketCombine(out, b, a, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(good, out, LEN);
+}
+
+void test_combine_same_errors(void)
+{
+    uint8_t good[LEN], a[LEN], b[LEN], out[LEN];
+    seed = 2;
+    crc.init(14, CRC_POLY);
+    makePacket(good);
+
+    // Both wrong in the same place, there's nothing to choose between
+    memcpy(a, good, LEN);
+    flip(a, 10);
+    memcpy(b, a, LEN);
+    validated = 0;
+    TEST_ASSERT_FALSE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate));
+    TEST_ASSERT_EQUAL(0, validated);
+
+    // Or only one bit apart, which is one copy or the other
+    flip(b, 11);
+    TEST_ASSERT_FALSE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate));
+    TEST_ASSERT_EQUAL(0, validated);
+}
+
+void test_combine_too_many_differences(void)
+{
+    uint8_t good[LEN], a[LEN], b[LEN], out[LEN];
+    seed = 3;
+    crc.init(14, CRC_POLY);
+    makePacket(good);
+
+    memcpy(a, good, LEN);
+    memcpy(b, good, LEN);
+    for (uint8_t i = 0; i < PACKET_COMBINE_MAX_BITS_OTA4 + 1; i++)
+        flip((i % 2) ? a : b, i * 9);
+    validated = 0;
+    TEST_ASSERT_FALSE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate));
+    TEST_ASSERT_EQUAL(0, validated);
+}
+
+static bool acceptAll(uint8_t *packet)
+{
+    ++validated;
+    return true;
+}
+
+static bool rejectAll(uint8_t *packet)
+{
+    ++validated;
+    return false;
+}
+
+void test_combine_favours_stronger(void)
+{
+    uint8_t a[LEN] = {0}, b[LEN] = {0}, out[LEN];
+    b[0] = 0x0f;
+
+    // The first candidate takes one bit from the weaker copy, and the most is all but one
+    validated = 0;
+    TEST_ASSERT_TRUE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA8, acceptAll));
+    TEST_ASSERT_EQUAL(1, validated);
+    TEST_ASSERT_EQUAL(1, __builtin_popcount(out[0]));
+
+    validated = 0;
+    TEST_ASSERT_FALSE(PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA8, rejectAll));
+    TEST_ASSERT_EQUAL(14, validated);
+}
+
+void test_combine_random_errors(void)
+{
+    // Each copy gets 1 or 2 random bit errors, as at the edge of the range, as many as can
+    // be combined between them
+    uint8_t good[LEN], a[LEN], b[LEN], out[LEN];
+    seed = 4;
+    crc.init(14, CRC_POLY);
+    uint16_t failed = 0, recovered = 0, wrong = 0;
+    for (uint16_t n = 0; n < 1000; n++)
+    {
+        makePacket(good);
+        memcpy(a, good, LEN);
+        memcpy(b, good, LEN);
+        uint8_t errorsA = 1 + rng() % 2;
+        uint8_t errorsB = 1 + rng() % 2;
+        if (errorsA + errorsB > PACKET_COMBINE_MAX_BITS_OTA4)
+            continue;
+        for (uint8_t e = 0; e < errorsA; e++)
+            flip(a, rng() % (LEN * 8));
+        for (uint8_t e = 0; e < errorsB; e++)
+            flip(b, rng() % (LEN * 8));
+        if (validate(a) || validate(b))
+            continue;
+
+        ++failed;
+        if (PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate))
+        {
+            if (memcmp(out, good, LEN) == 0)
+                ++recovered;
+            else
+                ++wrong;
+        }
+    }
+    // Almost all have their errors in different places, and none pass the CRC corrupted
+    printf("recovered %u of %u, wrong %u\n", recovered, failed, wrong);
+    TEST_ASSERT_GREATER_THAN(failed * 95 / 100, recovered);
+    TEST_ASSERT_EQUAL(0, wrong);
+}
+
+void test_combine_unreachable(void)
+{
+    // Both copies share an error so no mix of them is right, anything passing the CRC is corrupt
+    uint8_t good[LEN], a[LEN], b[LEN], out[LEN];
+    seed = 5;
+    crc.init(14, CRC_POLY);
+    uint16_t tried = 0, accepted = 0;
+    for (uint16_t n = 0; n < 1000; n++)
+    {
+        // The shared error first, then where they differ, all different bits
+        uint8_t bits[1 + PACKET_COMBINE_MAX_BITS_OTA4];
+        for (uint8_t e = 0; e < sizeof(bits); e++)
+        {
+            bool repeated;
+            do
+            {
+                bits[e] = rng() % (LEN * 8);
+                repeated = false;
+                for (uint8_t i = 0; i < e; i++)
+                    repeated |= bits[i] == bits[e];
+            } while (repeated);
+        }
+
+        makePacket(good);
+        memcpy(a, good, LEN);
+        flip(a, bits[0]);
+        memcpy(b, a, LEN);
+        for (uint8_t e = 1; e < sizeof(bits); e++)
+            flip((e % 2) ? a : b, bits[e]);
+        if (validate(a) || validate(b))
+            continue;
+
+        ++tried;
+        if (PacketCombine(out, a, b, LEN, PACKET_COMBINE_MAX_BITS_OTA4, validate))
+            ++accepted;
+    }
+    printf("accepted %u of %u\n", accepted, tried);
+    TEST_ASSERT_EQUAL(0, accepted);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_combine_different_errors);
+    RUN_TEST(test_combine_same_errors);
+    RUN_TEST(test_combine_too_many_differences);
+    RUN_TEST(test_combine_favours_stronger);
+    RUN_TEST(test_combine_random_errors);
+    RUN_TEST(test_combine_unreachable);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <cstdint>
+#include <POWERMGNT.h>
+#include <unity.h>
+
+void test_power_cali_flat(void)
+{
+    // The same offset in every band is the old single offset per power level
+    int8_t cali[POWER_CALI_BANDS] = {-2, -2, -2, -2};
+    for (uint32_t channel = 0; channel < 80; channel++)
+        TEST_ASSERT_EQUAL(-2, powerCaliInterpolate(cali, channel, 80));
+}
+
+void test_power_cali_band_points(void)
+{
+    // The bands are calibrated at the ends and evenly between, e.g. channels 0, 13, 26 and
+    // 39 of FCC915
+    int8_t cali[POWER_CALI_BANDS] = {0, 3, -3, 6};
+    TEST_ASSERT_EQUAL(0, powerCaliInterpolate(cali, 0, 40));
+    TEST_ASSERT_EQUAL(3, powerCaliInterpolate(cali, 13, 40));
+    TEST_ASSERT_EQUAL(-3, powerCaliInterpolate(cali, 26, 40));
+    TEST_ASSERT_EQUAL(6, powerCaliInterpolate(cali, 39, 40));
+}
+
+void test_power_cali_interpolated(void)
+{
+    int8_t cali[POWER_CALI_BANDS] = {0, 3, -3, 6};
+    // A third of the way from 0 to 3, and rounded in each direction
+    TEST_ASSERT_EQUAL(1, powerCaliInterpolate(cali, 4, 40));
+    TEST_ASSERT_EQUAL(2, powerCaliInterpolate(cali, 8, 40));
+    // Halfway between 3 and -3, and between -3 and 6
+    TEST_ASSERT_EQUAL(0, powerCaliInterpolate(cali, 19, 40));
+    TEST_ASSERT_EQUAL(2, powerCaliInterpolate(cali, 33, 40));
+
+    // Never outside the points either side
+    for (uint32_t channel = 0; channel < 80; channel++)
+    {
+        int8_t offset = powerCaliInterpolate(cali, channel, 80);
+        TEST_ASSERT_TRUE(offset >= -3 && offset <= 6);
+    }
+}
+
+void test_power_cali_few_channels(void)
+{
+    // AU433 has 3 channels, IN866 4, one channel is just the first band
+    int8_t cali[POWER_CALI_BANDS] = {-4, 0, 2, 4};
+    TEST_ASSERT_EQUAL(-4, powerCaliInterpolate(cali, 0, 3));
+    TEST_ASSERT_EQUAL(1, powerCaliInterpolate(cali, 1, 3));
+    TEST_ASSERT_EQUAL(4, powerCaliInterpolate(cali, 2, 3));
+    TEST_ASSERT_EQUAL(0, powerCaliInterpolate(cali, 1, 4));
+    TEST_ASSERT_EQUAL(-4, powerCaliInterpolate(cali, 0, 1));
+}
+
+// Follows the drivers, a new power is pending until committed after the next transmit
+class MockRadio
+{
+public:
+    static const int8_t NONE = 0x7f;
+    int8_t current = 0;
+    int8_t pending = NONE;
+
+    void SetOutputPower(int8_t power) { pending = power; }
+    void CommitOutputPower()
+    {
+        if (pending == NONE)
+            return;
+        current = pending;
+        pending = NONE;
+    }
+    // Returns the power the packet went out at
+    int8_t transmit()
+    {
+        int8_t sent = current;
+        CommitOutputPower();
+        return sent;
+    }
+};
+
+void test_power_cali_hop_output(void)
+{
+    MockRadio radio;
+    int8_t cali[POWER_CALI_BANDS] = {-2, 0, 1, 3};
+
+    // Hop to each channel after the transmit, its first packet goes out with its offset
+    for (uint32_t channel = 0; channel < 40; channel++)
+    {
+        radio.transmit();
+        const int8_t output = 10 + powerCaliInterpolate(cali, channel, 40);
+        powerCaliSetHopOutput(radio, output);
+        TEST_ASSERT_EQUAL(output, radio.transmit());
+    }
+
+    // Without the commit, the first packet would still use the last channel's
+    radio.SetOutputPower(10 + cali[0]);
+    TEST_ASSERT_EQUAL(10 + cali[POWER_CALI_BANDS - 1], radio.transmit());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_power_cali_flat);
+    RUN_TEST(test_power_cali_band_points);
+    RUN_TEST(test_power_cali_interpolated);
+    RUN_TEST(test_power_cali_few_channels);
+    RUN_TEST(test_power_cali_hop_output);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <cstdint>
+#include <SX1280Driver.h>
+#include <SPITrace.h>
+#include <unity.h>
+
+SX1280Driver Radio;
+
+#define R1 SX12XX_Radio_1
+#define R2 SX12XX_Radio_2
+#define ALL SX12XX_Radio_All
+#define WR false
+#define RD true
+
+static void printTrace()
+{
+    for (uint16_t i = 0; i < spiTrace.count(); i++)
+    {
+        const spiTraceEntry_t &e = spiTrace.entry(i);
+        printf("%2u: cs=%u %s", i, e.csMask, e.reading ? "RD" : "WR");
+        for (uint8_t j = 0; j < e.size && j < SPITRACE_MAX_BYTES; j++)
+            printf(" %02X", e.out[j]);
+        printf("\n");
+    }
+}
+
+static void assertReplayed(uint16_t count)
+{
+    if (spiTrace.firstMismatch() >= 0 || spiTrace.replayed() != count)
+        printTrace();
+    TEST_ASSERT_EQUAL(-1, spiTrace.firstMismatch());
+    TEST_ASSERT_EQUAL(count, spiTrace.replayed());
+}
+
+// Begin() on a single SX1280, which reports firmware 0xA9B7
+static const spiTraceEntry_t goldenBegin[] = {
+    {ALL, WR, 2, {0x80, 0x00}},                                     // SetStandby(STDBY_RC)
+    {R1, RD, 5, {0x19, 0x01, 0x53, 0x00, 0x00}, {0, 0, 0, 0, 0xA9}}, // ReadRegister(firmware MSB)
+    {R1, RD, 5, {0x19, 0x01, 0x54, 0x00, 0x00}, {0, 0, 0, 0, 0xB7}}, // ReadRegister(firmware LSB)
+    {R1, RD, 5, {0x19, 0x08, 0x91, 0x00, 0x00}, {0, 0, 0, 0, 0x25}}, // ReadRegister(0x891)
+    {R1, WR, 4, {0x18, 0x08, 0x91, 0xE5}},                          // WriteRegister(0x891, high sensitivity)
+    {ALL, WR, 2, {0x9E, 0x01}},                                     // SetAutoFs(on)
+    {ALL, WR, 3, {0x8E, 0x00, 0x20}},                               // SetTxParams(-18dBm, 4us ramp)
+};
+
+// Config() for LoRa SF5 BW800 with an 8 byte payload
+static const spiTraceEntry_t goldenConfig[] = {
+    {ALL, WR, 2, {0x80, 0x00}},                                     // SetStandby(STDBY_RC)
+    {ALL, WR, 2, {0x8A, 0x01}},                                     // SetPacketType(LoRa)
+    {ALL, WR, 4, {0x8B, 0x50, 0x18, 0x06}},                         // SetModulationParams
+    {ALL, WR, 4, {0x18, 0x09, 0x25, 0x1E}},                         // WriteRegister(SF additional config)
+    {ALL, WR, 8, {0x8C, 0x0C, 0x80, 0x08, 0x00, 0x00, 0x00, 0x00}}, // SetPacketParams(implicit header, IQ inverted)
+    {ALL, WR, 4, {0x86, 0xB8, 0x9D, 0x89}},                         // SetRfFrequency
+    {ALL, WR, 3, {0x8F, 0x80, 0x00}},                               // SetBufferBaseAddress(TX 0x80, RX 0x00)
+    {ALL, WR, 9, {0x8D, 0x00, 0x4F, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00}}, // SetDioIrqParams
+};
+
+static void begin()
+{
+    spiTrace.reset();
+    spiTrace.replay(goldenBegin, sizeof(goldenBegin) / sizeof(goldenBegin[0]));
+    TEST_ASSERT_TRUE(Radio.Begin(2400000000, 2480000000));
+    assertReplayed(sizeof(goldenBegin) / sizeof(goldenBegin[0]));
+
+    spiTrace.reset();
+    spiTrace.replay(goldenConfig, sizeof(goldenConfig) / sizeof(goldenConfig[0]));
+    Radio.Config(SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 0xB89D89, 12, true, 8, 0);
+    assertReplayed(sizeof(goldenConfig) / sizeof(goldenConfig[0]));
+    spiTrace.reset();
+}
+
+void test_radio_begin_config(void)
+{
+    begin();
+}
+
+void test_radio_begin_no_radio(void)
+{
+    // A radio which doesn't answer stops Begin() after reading the firmware version
+    spiTrace.reset();
+    TEST_ASSERT_FALSE(Radio.Begin(2400000000, 2480000000));
+    TEST_ASSERT_EQUAL(3, spiTrace.count());
+}
+
+void test_radio_replay_mismatch(void)
+{
+    // A different command sequence is caught at the first transaction which differs
+    static const spiTraceEntry_t golden[] = {
+        {ALL, WR, 2, {0x80, 0x00}},
+        {R1, RD, 5, {0x19, 0x01, 0x53, 0x00, 0x00}, {0, 0, 0, 0, 0xA9}},
+        {R1, RD, 5, {0x19, 0x01, 0x55, 0x00, 0x00}, {0, 0, 0, 0, 0xB7}},
+    };
+    spiTrace.reset();
+    spiTrace.replay(golden, 3);
+    Radio.Begin(2400000000, 2480000000);
+    TEST_ASSERT_EQUAL(2, spiTrace.firstMismatch());
+}
+
+void test_radio_tx(void)
+{
+    begin();
+    uint8_t packet[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    // TXnb() writes the FIFO then starts the TX
+    static const spiTraceEntry_t goldenTx[] = {
+        {R1, WR, 10, {0x1A, 0x80, 1, 2, 3, 4, 5, 6, 7, 8}}, // WriteBuffer(TX base)
+        {R1, WR, 4, {0x83, 0x00, 0xFF, 0xFF}},              // SetTx(no timeout)
+    };
+    spiTrace.replay(goldenTx, 2);
+    Radio.TXnb(packet, sizeof(packet), R1);
+    assertReplayed(2);
+
+    // TX done IRQ
+    static const spiTraceEntry_t goldenTxDone[] = {
+        {R1, RD, 4, {0x15, 0x00, 0x00, 0x00}, {0, 0, 0x00, 0x01}}, // GetIrqStatus = TX_DONE
+        {ALL, WR, 3, {0x97, 0xFF, 0xFF}},                            // ClrIrqStatus(all)
+    };
+    spiTrace.reset();
+    spiTrace.replay(goldenTxDone, 2);
+    SX1280Hal::dioISR_1();
+    assertReplayed(2);
+
+    // A staged packet only needs the SetTx when its slot comes
+    spiTrace.reset();
+    spiTrace.replay(goldenTx, 1);
+    Radio.TXstage(packet, sizeof(packet), R1);
+    assertReplayed(1);
+    spiTrace.reset();
+    spiTrace.replay(&goldenTx[1], 1);
+    Radio.TXnbStaged(R1);
+    assertReplayed(1);
+    TEST_ASSERT_EQUAL(4, spiTrace.getStats().bytes);
+}
+
+static uint8_t rxStatus;
+static bool rxDone(SX12xxDriverCommon::rx_status status)
+{
+    rxStatus = status;
+    return true;
+}
+
+void test_radio_rx(void)
+{
+    begin();
+    Radio.RXdoneCallback = &rxDone;
+    rxStatus = 0xFF;
+
+    // The replayed responses drive the driver's RX path
+    static const spiTraceEntry_t goldenRx[] = {
+        {R1, RD, 4, {0x15, 0x00, 0x00, 0x00}, {0, 0, 0x00, 0x02}},                   // GetIrqStatus = RX_DONE
+        {R1, RD, 4, {0x17, 0x00, 0x00, 0x00}, {0, 0, 8, 0x00}},                      // GetRxBufferStatus
+        {R1, RD, 11, {0x1B, 0x00, 0x00}, {0, 0, 0, 9, 8, 7, 6, 5, 4, 3, 2}},          // ReadBuffer(RX base)
+        {ALL, WR, 3, {0x97, 0xFF, 0xFF}},                                              // ClrIrqStatus(all)
+    };
+    spiTrace.replay(goldenRx, 4);
+    SX1280Hal::dioISR_1();
+    assertReplayed(4);
+
+    TEST_ASSERT_EQUAL(SX12xxDriverCommon::SX12XX_RX_OK, rxStatus);
+    const uint8_t expected[8] = {9, 8, 7, 6, 5, 4, 3, 2};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, Radio.RXdataBuffer, 8);
+    Radio.RXdoneCallback = &SX12xxDriverCommon::nullCallbackRx;
+}
+
+void test_radio_stats(void)
+{
+    begin();
+
+    // Putting the radio in the same mode twice is a redundant transaction
+    Radio.SetTxIdleMode();
+    Radio.SetTxIdleMode();
+    const spiTraceStats_t &stats = spiTrace.getStats();
+    TEST_ASSERT_EQUAL(2, stats.transactions);
+    TEST_ASSERT_EQUAL(4, stats.bytes);
+    TEST_ASSERT_EQUAL(1, stats.repeats);
+
+    // Without a BUSY pin the HAL waits out a fixed delay after each command,
+    // which is counted against the next transaction
+    TEST_ASSERT_GREATER_THAN(0, spiTrace.entry(1).busyMicros);
+    TEST_ASSERT_EQUAL(spiTrace.entry(1).busyMicros, stats.maxBusyMicros);
+}
+
+void test_radio_shadow_config(void)
+{
+    begin();
+
+    // Configuring the same mode again only needs the standby
+    spiTrace.replay(goldenConfig, 1);
+    Radio.Config(SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 0xB89D89, 12, true, 8, 0);
+    assertReplayed(1);
+    TEST_ASSERT_EQUAL(1, spiTrace.getStats().transactions);
+
+    // A different packet type loses the radio's params, so they are all written again
+    spiTrace.reset();
+    Radio.Config(SX1280_FLRC_BR_0_650_BW_0_6, SX1280_FLRC_BT_1, SX1280_FLRC_CR_1_2, 0xB89D89, 32, true, 8, 0, 0x12345678, 0x1234, 1);
+    TEST_ASSERT_EQUAL(9, spiTrace.getStats().transactions);
+    spiTrace.reset();
+    spiTrace.replay(goldenConfig, sizeof(goldenConfig) / sizeof(goldenConfig[0]));
+    Radio.Config(SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 0xB89D89, 12, true, 8, 0);
+    assertReplayed(sizeof(goldenConfig) / sizeof(goldenConfig[0]));
+}
+
+void test_radio_shadow_hop(void)
+{
+    begin();
+
+    // Hopping to the channel the radio is already on is free
+    Radio.SetFrequencyReg(0xB89D89);
+    TEST_ASSERT_EQUAL(0, spiTrace.getStats().transactions);
+
+    // Both radios on a new channel get one transaction
+    static const spiTraceEntry_t goldenHop[] = {
+        {ALL, WR, 4, {0x86, 0xB9, 0x00, 0x00}},
+        {R1, WR, 4, {0x86, 0xBA, 0x00, 0x00}},
+        {R2, WR, 4, {0x86, 0xBA, 0x00, 0x00}},
+    };
+    spiTrace.replay(goldenHop, 3);
+    Radio.SetFrequencyReg(0xB90000);
+    TEST_ASSERT_EQUAL(1, spiTrace.replayed());
+
+    // Only the radio which is not already there is written
+    Radio.SetFrequencyReg(0xBA0000, R1);
+    Radio.SetFrequencyReg(0xBA0000, ALL);
+    assertReplayed(3);
+    Radio.SetFrequencyReg(0xBA0000, R2);
+    TEST_ASSERT_EQUAL(3, spiTrace.getStats().transactions);
+
+    // Sleeping forgets it all
+    Radio.End();
+    spiTrace.reset();
+    Radio.SetFrequencyReg(0xBA0000);
+    TEST_ASSERT_EQUAL(1, spiTrace.getStats().transactions);
+}
+
+void test_radio_trace_wraps(void)
+{
+    spiTrace.reset();
+    for (uint32_t i = 0; i < SPITRACE_SIZE + 2; i++)
+    {
+        uint8_t cmd[2] = {0x80, (uint8_t)i};
+        spiTrace.record(R1, cmd, sizeof(cmd), false);
+    }
+
+    // The oldest transactions are dropped, the stats count them all
+    TEST_ASSERT_EQUAL(SPITRACE_SIZE, spiTrace.count());
+    TEST_ASSERT_EQUAL(2, spiTrace.entry(0).out[1]);
+    TEST_ASSERT_EQUAL(SPITRACE_SIZE + 1, spiTrace.entry(SPITRACE_SIZE - 1).out[1]);
+    TEST_ASSERT_EQUAL(SPITRACE_SIZE + 2, spiTrace.getStats().transactions);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_radio_begin_config);
+    RUN_TEST(test_radio_begin_no_radio);
+    RUN_TEST(test_radio_replay_mismatch);
+    RUN_TEST(test_radio_tx);
+    RUN_TEST(test_radio_rx);
+    RUN_TEST(test_radio_stats);
+    RUN_TEST(test_radio_shadow_config);
+    RUN_TEST(test_radio_shadow_hop);
+    RUN_TEST(test_radio_trace_wraps);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,344 @@
+#include <cstdint>
+#include <vector>
+#include <unity.h>
+#include "SerialRouter.h"
+#include "CountingStream.h"
+#include "RCOutputStage.h"
+
+using namespace std;
+
+class MockStream : public Stream
+{
+public:
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush() {}
+    size_t write(uint8_t c) { data.push_back(c); return 1; }
+    size_t write(const uint8_t *s, size_t l) { data.insert(data.end(), s, s + l); return l; }
+
+    vector<uint8_t> data;
+};
+
+// Stands in for a SerialIO, with an endless amount of queued data to send
+class MockIO
+{
+public:
+    MockIO() : out(&stream) {}
+
+    uint32_t outputRCFrame(bool frameAvailable, bool frameMissed, uint32_t *channelData)
+    {
+        rcFrames += frameAvailable;
+        rcMissed += frameMissed;
+        if (frameAvailable)
+            out.write((const uint8_t *)channelData, 4);
+        return 5;
+    }
+    void processSerialInput() { bytesRead += inputPerCall; }
+    void sendQueuedData(uint32_t maxBytesToSend)
+    {
+        uint8_t buf[256] = {0};
+        const uint32_t len = maxBytesToSend < sizeof(buf) ? maxBytesToSend : sizeof(buf);
+        out.write(buf, len);
+        lastMaxBytes = maxBytesToSend;
+    }
+    int getMaxSerialWriteSize() { return 128; }
+    void queueLinkStatisticsPacket() { ++linkStats; }
+    void queueMSPFrameTransmission(uint8_t *data) { lastMsp = data; ++msp; }
+    void setFailsafe(bool f) { failsafe = f; }
+    uint32_t getBytesRead() const { return bytesRead; }
+    uint32_t getBytesWritten() const { return out.getBytesWritten(); }
+
+    MockStream stream;
+    CountingStream out;
+    uint32_t rcFrames = 0;
+    uint32_t rcMissed = 0;
+    uint32_t linkStats = 0;
+    uint32_t msp = 0;
+    uint8_t *lastMsp = nullptr;
+    bool failsafe = false;
+    uint32_t bytesRead = 0;
+    uint32_t inputPerCall = 0;
+    uint32_t lastMaxBytes = 0;
+};
+
+static uint32_t filterCalls;
+static bool filterResult;
+static bool frameFilter()
+{
+    ++filterCalls;
+    return filterResult;
+}
+
+static uint32_t channels[16];
+
+void test_router_rc_fan_out(void)
+{
+    // GIVEN three ports, one of which doesn't take RC
+    SerialRouter<MockIO, 4> router;
+    MockIO io0, io1, io2;
+    MockIO *p0 = &io0, *p1 = &io1, *p2 = &io2;
+    router.setFrameFilter(frameFilter);
+    TEST_ASSERT_EQUAL(0, router.attach(&p0, SERIAL_ROUTE_RC | SERIAL_ROUTE_MSP));
+    TEST_ASSERT_EQUAL(1, router.attach(&p1, SERIAL_ROUTE_RC));
+    TEST_ASSERT_EQUAL(2, router.attach(&p2, SERIAL_ROUTE_VTX));
+    filterCalls = 0;
+    filterResult = true;
+
+    // THEN every frame reaches each RC port once, and is filtered once for all of them
+    for (int i = 0; i < 10; i++)
+    {
+        router.rcFrameAvailable();
+        for (uint8_t port = 0; port < 3; port++)
+        {
+            TEST_ASSERT_EQUAL(5, router.service(port, channels, i));
+            router.service(port, channels, i);
+        }
+    }
+    TEST_ASSERT_EQUAL(10, filterCalls);
+    TEST_ASSERT_EQUAL(10, io0.rcFrames);
+    TEST_ASSERT_EQUAL(10, io1.rcFrames);
+    TEST_ASSERT_EQUAL(0, io2.rcFrames);
+    TEST_ASSERT_EQUAL(10, router.getStats(1).rcFrames);
+
+    // A frame the filter rejects goes nowhere
+    filterResult = false;
+    router.rcFrameAvailable();
+    for (uint8_t port = 0; port < 3; port++)
+        router.service(port, channels, 10);
+    TEST_ASSERT_EQUAL(11, filterCalls);
+    TEST_ASSERT_EQUAL(10, io0.rcFrames);
+
+    // Missed frames are reported to every port once
+    router.rcFrameMissed();
+    for (uint8_t port = 0; port < 3; port++)
+    {
+        router.service(port, channels, 11);
+        router.service(port, channels, 11);
+    }
+    TEST_ASSERT_EQUAL(1, io0.rcMissed);
+    TEST_ASSERT_EQUAL(1, io2.rcMissed);
+    TEST_ASSERT_EQUAL(1, router.getStats(2).rcMissed);
+}
+
+void test_router_msp_and_linkstats(void)
+{
+    SerialRouter<MockIO, 4> router;
+    MockIO io0, io1;
+    MockIO *p0 = &io0, *p1 = &io1;
+    router.attach(&p0, SERIAL_ROUTE_RC | SERIAL_ROUTE_LINKSTATS | SERIAL_ROUTE_MSP);
+    router.attach(&p1, SERIAL_ROUTE_RC);
+
+    uint8_t frame[8];
+    TEST_ASSERT_EQUAL(1, router.queueMSP(frame, SERIAL_ROUTE_MSP));
+    TEST_ASSERT_EQUAL(0, router.queueMSP(frame, SERIAL_ROUTE_VTX));
+    TEST_ASSERT_TRUE(io0.lastMsp == frame);
+    TEST_ASSERT_EQUAL(0, io1.msp);
+
+    // Routes follow the configured protocol
+    router.setRoutes(1, SERIAL_ROUTE_RC | SERIAL_ROUTE_VTX);
+    TEST_ASSERT_EQUAL(1, router.queueMSP(frame, SERIAL_ROUTE_VTX));
+    TEST_ASSERT_EQUAL(1, io1.msp);
+    TEST_ASSERT_EQUAL(1, router.getStats(1).mspFrames);
+
+    router.queueLinkStatistics();
+    TEST_ASSERT_EQUAL(1, io0.linkStats);
+    TEST_ASSERT_EQUAL(0, io1.linkStats);
+
+    // A port without a protocol takes no part
+    p1 = nullptr;
+    TEST_ASSERT_EQUAL(0, router.queueMSP(frame, SERIAL_ROUTE_VTX));
+    TEST_ASSERT_EQUAL(DURATION_NEVER, router.service(1, channels, 0));
+    TEST_ASSERT_EQUAL(1, router.getStats(1).mspFrames);
+
+    router.resetStats();
+    TEST_ASSERT_EQUAL(0, router.getStats(1).mspFrames);
+
+    router.setFailsafe(true);
+    TEST_ASSERT_TRUE(io0.failsafe);
+}
+
+void test_router_bandwidth_limit(void)
+{
+    // GIVEN a port limited to 2000 bytes/s and an unlimited one, both with plenty to send
+    SerialRouter<MockIO, 4> router;
+    MockIO io0, io1;
+    MockIO *p0 = &io0, *p1 = &io1;
+    router.attach(&p0, SERIAL_ROUTE_RC, 2000);
+    router.attach(&p1, SERIAL_ROUTE_RC);
+    io0.inputPerCall = 3;
+
+    // THEN the limited port writes no more than its limit, including its RC frames
+    for (uint32_t now = 1000; now < 3000; now++)
+    {
+        if (now % 4 == 0)
+            router.rcFrameAvailable();
+        router.service(0, channels, now);
+        router.service(1, channels, now);
+        TEST_ASSERT_LESS_OR_EQUAL(128, io0.lastMaxBytes);
+    }
+    const serialRouterStats_t &stats = router.getStats(0);
+    TEST_ASSERT_EQUAL(io0.stream.data.size(), stats.bytesWritten);
+    TEST_ASSERT_UINT32_WITHIN(2000 / 10 + 4, 2 * 2000, stats.bytesWritten);
+    TEST_ASSERT_GREATER_THAN(0, stats.throttled);
+    TEST_ASSERT_EQUAL(2000 * 3, stats.bytesRead);
+    TEST_ASSERT_EQUAL(500, stats.rcFrames);
+
+    TEST_ASSERT_EQUAL(2000 * 128 + 500 * 4, router.getStats(1).bytesWritten);
+    TEST_ASSERT_EQUAL(0, router.getStats(1).throttled);
+}
+
+void test_router_set_bandwidth_limit(void)
+{
+    // GIVEN an unlimited port that is later given a limit
+    SerialRouter<MockIO, 4> router;
+    MockIO io;
+    MockIO *p = &io;
+    router.attach(&p, SERIAL_ROUTE_RC);
+    router.service(0, channels, 1000);
+    TEST_ASSERT_EQUAL(128, router.getStats(0).bytesWritten);
+
+    // THEN it is held to the new limit
+    router.setBandwidthLimit(0, 1000);
+    router.resetStats();
+    for (uint32_t now = 1000; now < 2000; now++)
+        router.service(0, channels, now);
+    TEST_ASSERT_UINT32_WITHIN(SERIAL_ROUTER_MIN_BURST, 1000 + SERIAL_ROUTER_MIN_BURST, router.getStats(0).bytesWritten);
+
+    // AND removing the limit lets it write freely again
+    router.setBandwidthLimit(0, 0);
+    router.resetStats();
+    router.service(0, channels, 2000);
+    TEST_ASSERT_EQUAL(128, router.getStats(0).bytesWritten);
+    TEST_ASSERT_EQUAL(0, router.getStats(0).throttled);
+}
+
+void test_router_protocol_swap(void)
+{
+    // GIVEN a port whose protocol is replaced
+    SerialRouter<MockIO, 4> router;
+    MockIO *io = new MockIO();
+    router.attach(&io, SERIAL_ROUTE_RC);
+    router.service(0, channels, 0);
+    TEST_ASSERT_EQUAL(128, router.getStats(0).bytesWritten);
+
+    MockIO *old = io;
+    io = new MockIO();
+    delete old;
+    // THEN the counters of the new protocol add to the port statistics
+    router.service(0, channels, 1);
+    TEST_ASSERT_EQUAL(256, router.getStats(0).bytesWritten);
+    delete io;
+}
+
+void test_router_port_limit(void)
+{
+    SerialRouter<MockIO, 2> router;
+    MockIO *io = nullptr;
+    TEST_ASSERT_EQUAL(0, router.attach(&io, 0));
+    TEST_ASSERT_EQUAL(1, router.attach(&io, 0));
+    TEST_ASSERT_EQUAL(-1, router.attach(&io, 0));
+    TEST_ASSERT_EQUAL(2, router.getPortCount());
+}
+
+void test_rc_output_stage(void)
+{
+    MockStream port;
+    RCOutputStage stage;
+    stage.setOutput(&port);
+    const uint8_t frame1[] = {1, 2, 3};
+    const uint8_t frame2[] = {4, 5, 6, 7};
+
+    // Nothing goes out until a frame is committed
+    TEST_ASSERT_EQUAL(3, stage.write(frame1, sizeof(frame1)));
+    TEST_ASSERT_EQUAL(0, stage.writeOut());
+    TEST_ASSERT_EQUAL(3, stage.commit());
+    TEST_ASSERT_EQUAL(0, port.data.size());
+
+    // The next frame can be written while the last is waiting to go out
+    stage.write(frame2, 2);
+    TEST_ASSERT_EQUAL(3, stage.writeOut());
+    TEST_ASSERT_EQUAL(0, stage.writeOut());
+    stage.write(&frame2[2], 2);
+    stage.commit();
+    TEST_ASSERT_EQUAL(4, stage.writeOut());
+    const uint8_t expected[] = {1, 2, 3, 4, 5, 6, 7};
+    TEST_ASSERT_EQUAL(sizeof(expected), port.data.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, port.data.data(), sizeof(expected));
+
+    // Only the latest frame goes out if the writer falls behind
+    stage.write(frame1, sizeof(frame1));
+    stage.commit();
+    stage.write(frame2, sizeof(frame2));
+    stage.commit();
+    TEST_ASSERT_EQUAL(4, stage.writeOut());
+    TEST_ASSERT_EQUAL(4, stage.getFrames());
+    TEST_ASSERT_EQUAL(1, stage.getDropped());
+
+    // A frame that doesn't fit is refused, and an empty commit publishes nothing
+    uint8_t big[RC_OUTPUT_STAGE_SIZE + 1] = {0};
+    TEST_ASSERT_EQUAL(0, stage.write(big, sizeof(big)));
+    TEST_ASSERT_EQUAL(0, stage.commit());
+    stage.write(frame1, sizeof(frame1));
+    stage.commit();
+    stage.clear();
+    TEST_ASSERT_EQUAL(0, stage.writeOut());
+}
+
+// Blocks part way through writing, as HardwareSerial does with a full FIFO, and lets the
+// main loop stage more frames meanwhile
+class BlockingStream : public MockStream
+{
+public:
+    RCOutputStage *stage = nullptr;
+
+    size_t write(const uint8_t *s, size_t l)
+    {
+        MockStream::write(s, 1);
+        const uint8_t next[] = {8, 9};
+        for (int i = 0; i < 2; i++)
+        {
+            stage->write(next, sizeof(next));
+            stage->commit();
+        }
+        MockStream::write(s + 1, l - 1);
+        return l;
+    }
+};
+
+void test_rc_output_stage_blocked_write(void)
+{
+    BlockingStream port;
+    RCOutputStage stage;
+    port.stage = &stage;
+    stage.setOutput(&port);
+    const uint8_t frame[] = {1, 2, 3, 4};
+
+    // The frame going out is not overwritten by the frames committed while it is written
+    stage.write(frame, sizeof(frame));
+    stage.commit();
+    TEST_ASSERT_EQUAL(4, stage.writeOut());
+    TEST_ASSERT_EQUAL(sizeof(frame), port.data.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, port.data.data(), sizeof(frame));
+    TEST_ASSERT_EQUAL(1, stage.getDropped());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_router_rc_fan_out);
+    RUN_TEST(test_router_msp_and_linkstats);
+    RUN_TEST(test_router_bandwidth_limit);
+    RUN_TEST(test_router_set_bandwidth_limit);
+    RUN_TEST(test_router_protocol_swap);
+    RUN_TEST(test_router_port_limit);
+    RUN_TEST(test_rc_output_stage);
+    RUN_TEST(test_rc_output_stage_blocked_write);
+    UNITY_END();
+
+    return 0;
+}
@@ -184,6 +184,28 @@ void test_function_store_unknown_type_two_slots(void)
     TEST_ASSERT_EQUAL(1, telemetry.UpdatedPayloadCount());
 }
 
+void test_function_queued_message_bytes(void)
+{
+    telemetry.ResetState();
+    uint8_t batterySequence[] = {0xEC,10, CRSF_FRAMETYPE_BATTERY_SENSOR,0,0,0,0,0,0,0,0,109};
+    uint8_t unknownSequence[] = {0xEC,0x04,CRSF_FRAMETYPE_PARAMETER_READ,0x62,0x6c,85};
+
+    // Sensor payloads are not counted
+    sendData(batterySequence, sizeof(batterySequence));
+    TEST_ASSERT_EQUAL(0, telemetry.QueuedMessageBytes());
+
+    sendData(unknownSequence, sizeof(unknownSequence));
+    TEST_ASSERT_EQUAL(sizeof(unknownSequence), telemetry.QueuedMessageBytes());
+
+    // Nor the message being sent
+    uint8_t* data;
+    uint8_t receivedLength;
+    telemetry.GetNextPayload(&receivedLength, &data);
+    telemetry.GetNextPayload(&receivedLength, &data);
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_PARAMETER_READ, data[CRSF_TELEMETRY_TYPE_INDEX]);
+    TEST_ASSERT_EQUAL(0, telemetry.QueuedMessageBytes());
+}
+
 void test_function_store_ardupilot_status_text(void)
 {
     telemetry.ResetState();
@@ -254,6 +276,7 @@ int main(int argc, char **argv)
     RUN_TEST(test_function_store_unknown_type);
     RUN_TEST(test_function_store_unknown_type_two_slots);
     RUN_TEST(test_function_store_ardupilot_status_text);
+    RUN_TEST(test_function_queued_message_bytes);
     RUN_TEST(test_function_add_type_with_zero_crc);
     UNITY_END();
 
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include "targets.h"
+#include <TlmBoost.h>
+#include <unity.h>
+
+void test_tlm_queued_to_ota(void)
+{
+    TEST_ASSERT_EQUAL(0, TlmQueuedToOta(0));
+    // Any data at all is reported
+    TEST_ASSERT_EQUAL(1, TlmQueuedToOta(1));
+    TEST_ASSERT_EQUAL(1, TlmQueuedToOta(TLM_QUEUED_UNIT));
+    TEST_ASSERT_EQUAL(2, TlmQueuedToOta(TLM_QUEUED_UNIT + 1));
+    // Saturates rather than wrapping
+    TEST_ASSERT_EQUAL(255, TlmQueuedToOta(255 * TLM_QUEUED_UNIT));
+    TEST_ASSERT_EQUAL(255, TlmQueuedToOta(100000));
+}
+
+void test_tlm_boost_empty(void)
+{
+    TEST_ASSERT_EQUAL(TLM_RATIO_NO_TLM, TlmBoostRatio(500, 5, 0));
+}
+
+void test_tlm_boost_lowest_ratio(void)
+{
+    // 500Hz with 5 bytes per call sends 19 bytes/s at 1:128, 156 at 1:16 and 312 at 1:8
+    TEST_ASSERT_EQUAL(TLM_RATIO_1_128, TlmBoostRatio(500, 5, 1));
+    TEST_ASSERT_EQUAL(TLM_RATIO_1_16, TlmBoostRatio(500, 5, 156 / TLM_QUEUED_UNIT));
+    TEST_ASSERT_EQUAL(TLM_RATIO_1_8, TlmBoostRatio(500, 5, 10));
+    // Twice the bytes per call needs half the ratio
+    TEST_ASSERT_EQUAL(TLM_RATIO_1_16, TlmBoostRatio(500, 10, 10));
+    // Faster rates need less
+    TEST_ASSERT_EQUAL(TLM_RATIO_1_32, TlmBoostRatio(1000, 10, 10));
+}
+
+void test_tlm_boost_cap(void)
+{
+    TEST_ASSERT_EQUAL(TLM_BOOST_RATIO_MAX, TlmBoostRatio(500, 5, 255));
+    TEST_ASSERT_EQUAL(TLM_BOOST_RATIO_MAX, TlmBoostRatio(50, 5, 10));
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tlm_queued_to_ota);
+    RUN_TEST(test_tlm_boost_empty);
+    RUN_TEST(test_tlm_boost_lowest_ratio);
+    RUN_TEST(test_tlm_boost_cap);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <SX12xxTxStage.h>
+#include <unity.h>
+#include <string>
+
+enum {
+    RADIO_1 = 0b01,
+    RADIO_2 = 0b10,
+    RADIO_ALL = 0b11,
+};
+
+// Records the SPI work the stage asks the driver to do
+class MockDriver
+{
+public:
+    std::string log;
+    uint8_t written[SX12xxTxStage::MAX_SIZE];
+    uint8_t writtenSize;
+
+    void TxPrepare(SX12XX_Radio_Number_t radioNumber) { record('P', radioNumber); }
+    void TxWriteBuffer(uint8_t *data, uint8_t size, SX12XX_Radio_Number_t radioNumber)
+    {
+        memcpy(written, data, size);
+        writtenSize = size;
+        record('W', radioNumber);
+    }
+    void TxStart(SX12XX_Radio_Number_t radioNumber) { record('T', radioNumber); }
+
+private:
+    void record(char op, SX12XX_Radio_Number_t radioNumber)
+    {
+        log += op;
+        log += (char)('0' + radioNumber);
+        log += ' ';
+    }
+};
+
+static MockDriver driver;
+static SX12xxTxStage stage;
+static uint8_t packet[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static void reset()
+{
+    driver = MockDriver();
+    stage.clear();
+}
+
+void test_tx_unstaged_writes_before_tx(void)
+{
+    reset();
+    // TXnb(): the PA is enabled first, then the FIFO is written and TX started
+    stage.load(packet, sizeof(packet));
+    TEST_ASSERT_TRUE(stage.transmit(driver, RADIO_1));
+    TEST_ASSERT_EQUAL_STRING("P1 W1 T1 ", driver.log.c_str());
+    TEST_ASSERT_EQUAL(sizeof(packet), driver.writtenSize);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(packet, driver.written, sizeof(packet));
+    TEST_ASSERT_FALSE(stage.isLoaded());
+}
+
+void test_tx_staged_only_starts_tx(void)
+{
+    reset();
+    stage.stage(driver, packet, sizeof(packet), RADIO_1);
+    TEST_ASSERT_EQUAL_STRING("W1 ", driver.log.c_str());
+    TEST_ASSERT_EQUAL(RADIO_1, stage.stagedRadios());
+
+    // The packet may change after staging, the FIFO already has its copy
+    packet[0] = 0xFF;
+    driver.log.clear();
+    TEST_ASSERT_TRUE(stage.transmit(driver, RADIO_1));
+    TEST_ASSERT_EQUAL_STRING("P1 T1 ", driver.log.c_str());
+    TEST_ASSERT_EQUAL(1, driver.written[0]);
+    packet[0] = 1;
+}
+
+void test_tx_staged_other_radio(void)
+{
+    reset();
+    // Staged on radio 1 but the diversity picked radio 2, which needs the write
+    stage.stage(driver, packet, sizeof(packet), RADIO_1);
+    driver.log.clear();
+    stage.transmit(driver, RADIO_2);
+    TEST_ASSERT_EQUAL_STRING("P2 W2 T2 ", driver.log.c_str());
+
+    // Staged on both, either or both need no write
+    stage.stage(driver, packet, sizeof(packet), RADIO_ALL);
+    driver.log.clear();
+    stage.transmit(driver, RADIO_2);
+    TEST_ASSERT_EQUAL_STRING("P2 T2 ", driver.log.c_str());
+
+    stage.stage(driver, packet, sizeof(packet), RADIO_ALL);
+    driver.log.clear();
+    stage.transmit(driver, RADIO_ALL);
+    TEST_ASSERT_EQUAL_STRING("P3 T3 ", driver.log.c_str());
+
+    // Staged on one, sent on both
+    stage.stage(driver, packet, sizeof(packet), RADIO_2);
+    driver.log.clear();
+    stage.transmit(driver, RADIO_ALL);
+    TEST_ASSERT_EQUAL_STRING("P3 W3 T3 ", driver.log.c_str());
+}
+
+void test_tx_stage_used_once(void)
+{
+    reset();
+    // Nothing loaded, nothing sent
+    TEST_ASSERT_FALSE(stage.transmit(driver, RADIO_1));
+    TEST_ASSERT_EQUAL_STRING("", driver.log.c_str());
+
+    // A staged packet is only sent once
+    stage.stage(driver, packet, sizeof(packet), RADIO_1);
+    stage.transmit(driver, RADIO_1);
+    driver.log.clear();
+    TEST_ASSERT_FALSE(stage.transmit(driver, RADIO_1));
+    TEST_ASSERT_EQUAL_STRING("", driver.log.c_str());
+
+    // Reconfiguring the radio throws it away
+    stage.stage(driver, packet, sizeof(packet), RADIO_1);
+    stage.clear();
+    TEST_ASSERT_FALSE(stage.isLoaded());
+    TEST_ASSERT_FALSE(stage.transmit(driver, RADIO_1));
+
+    // Loading a new packet replaces the staged one, which must be written again
+    stage.stage(driver, packet, sizeof(packet), RADIO_1);
+    stage.load(packet, 4);
+    driver.log.clear();
+    stage.transmit(driver, RADIO_1);
+    TEST_ASSERT_EQUAL_STRING("P1 W1 T1 ", driver.log.c_str());
+    TEST_ASSERT_EQUAL(4, driver.writtenSize);
+}
+
+void test_tx_stage_rejects_oversize(void)
+{
+    reset();
+    uint8_t big[SX12xxTxStage::MAX_SIZE + 1] = {0};
+
+    // Too long to hold, so nothing is loaded rather than a truncated packet
+    TEST_ASSERT_TRUE(stage.load(big, SX12xxTxStage::MAX_SIZE));
+    TEST_ASSERT_FALSE(stage.load(big, sizeof(big)));
+    TEST_ASSERT_FALSE(stage.isLoaded());
+    TEST_ASSERT_FALSE(stage.stage(driver, big, sizeof(big), RADIO_1));
+    TEST_ASSERT_FALSE(stage.transmit(driver, RADIO_1));
+    TEST_ASSERT_EQUAL_STRING("", driver.log.c_str());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tx_unstaged_writes_before_tx);
+    RUN_TEST(test_tx_staged_only_starts_tx);
+    RUN_TEST(test_tx_staged_other_radio);
+    RUN_TEST(test_tx_stage_used_once);
+    RUN_TEST(test_tx_stage_rejects_oversize);
+    UNITY_END();
+
+    return 0;
+}